@@ -19,6 +19,7 @@
 #include <retro_assert.h>
 
 #include <lists/string_list.h>
+#include <audio/audio_pipeline.h>
 #include <audio/conversion/float_to_s16.h>
 #include <audio/conversion/s16_to_float.h>
 #include <audio/dsp_filter.h>
@@ -559,7 +560,7 @@ void audio_driver_set_nonblocking_state(bool enable)
  **/
 static void audio_driver_flush(const int16_t *data, size_t samples)
 {
-   struct resampler_data src_data;
+   struct audio_pipeline_data pipe_data;
    bool is_perfcnt_enable                               = false;
    bool is_paused                                       = false;
    bool is_idle                                         = false;
@@ -569,12 +570,6 @@ static void audio_driver_flush(const int16_t *data, size_t samples)
    float audio_volume_gain                              = !audio_driver_mute_enable ?
       audio_driver_volume_gain : 0.0f;
 
-   src_data.data_in                                     = NULL;
-   src_data.data_out                                    = NULL;
-   src_data.input_frames                                = 0;
-   src_data.output_frames                               = 0;
-   src_data.ratio                                       = 0.0f;
-
    if (recording_data)
       recording_push_audio(data, samples);
 
@@ -587,36 +582,6 @@ static void audio_driver_flush(const int16_t *data, size_t samples)
 		   !audio_driver_output_samples_buf)
       return;
 
-   convert_s16_to_float(audio_driver_input_data, data, samples,
-         audio_volume_gain);
-
-   src_data.data_in               = audio_driver_input_data;
-   src_data.input_frames          = samples >> 1;
-
-
-   if (audio_driver_dsp)
-   {
-      struct retro_dsp_data dsp_data;
-
-      dsp_data.input                 = NULL;
-      dsp_data.input_frames          = 0;
-      dsp_data.output                = NULL;
-      dsp_data.output_frames         = 0;
-
-      dsp_data.input                 = audio_driver_input_data;
-      dsp_data.input_frames          = (unsigned)(samples >> 1);
-
-      retro_dsp_filter_process(audio_driver_dsp, &dsp_data);
-
-      if (dsp_data.output)
-      {
-         src_data.data_in            = dsp_data.output;
-         src_data.input_frames       = dsp_data.output_frames;
-      }
-   }
-
-   src_data.data_out = audio_driver_output_samples_buf;
-
    if (audio_driver_control)
    {
       /* Readjust the audio input rate. */
@@ -648,15 +613,33 @@ static void audio_driver_flush(const int16_t *data, size_t samples)
 #endif
    }
 
-   src_data.ratio     = audio_source_ratio_current;
+   pipe_data.input          = data;
+   pipe_data.input_frames   = samples >> 1;
+   pipe_data.gain           = audio_volume_gain;
+   pipe_data.dsp            = audio_driver_dsp;
+   pipe_data.resampler      = audio_driver_resampler;
+   pipe_data.resampler_data = audio_driver_resampler_data;
+   pipe_data.ratio          = audio_source_ratio_current;
+   pipe_data.scratch        = audio_driver_input_data;
+   pipe_data.output         = audio_driver_output_samples_buf;
+   pipe_data.output_s16     = NULL;
+   pipe_data.output_frames  = 0;
 
    if (is_slowmotion)
    {
       settings_t *settings  = config_get_ptr();
-      src_data.ratio       *= settings->floats.slowmotion_ratio;
+      pipe_data.ratio      *= settings->floats.slowmotion_ratio;
    }
 
-   audio_driver_resampler->process(audio_driver_resampler_data, &src_data);
+   /* The mixer has to see the whole resampled batch at once, so the
+    * s16 output can only be converted on the fly without it. Samples
+    * from audio_driver_sample() live in the s16 output buffer itself. */
+   if (     !audio_driver_use_float
+         && !audio_mixer_active
+         && data != audio_driver_output_samples_conv_buf)
+      pipe_data.output_s16  = audio_driver_output_samples_conv_buf;
+
+   audio_pipeline_process(&pipe_data);
 
    if (audio_mixer_active)
    {
@@ -665,18 +648,19 @@ static void audio_driver_flush(const int16_t *data, size_t samples)
       float mixer_gain  = !audio_driver_mixer_mute_enable ?
          audio_driver_mixer_volume_gain : 0.0f;
       audio_mixer_mix(audio_driver_output_samples_buf,
-            src_data.output_frames, mixer_gain, override);
+            pipe_data.output_frames, mixer_gain, override);
    }
 
    output_data        = audio_driver_output_samples_buf;
-   output_frames      = (unsigned)src_data.output_frames;
+   output_frames      = (unsigned)pipe_data.output_frames;
 
    if (audio_driver_use_float)
       output_frames  *= sizeof(float);
    else
    {
-      convert_float_to_s16(audio_driver_output_samples_conv_buf,
-            (const float*)output_data, output_frames * 2);
+      if (!pipe_data.output_s16)
+         convert_float_to_s16(audio_driver_output_samples_conv_buf,
+               (const float*)output_data, output_frames * 2);
 
       output_data     = audio_driver_output_samples_conv_buf;
       output_frames  *= sizeof(int16_t);
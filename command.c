@@ -2003,7 +2003,9 @@ TODO: Add a setting for these tweaks */
                if (!netplay_driver_ctl(RARCH_NETPLAY_CTL_IS_ENABLED, NULL))
 #endif
                {
-                  state_manager_event_init((unsigned)settings->rewind_buffer_size);
+                  state_manager_event_init((unsigned)settings->rewind_buffer_size,
+                        settings->bools.rewind_threaded,
+                        settings->bools.rewind_compression);
                }
             }
          }
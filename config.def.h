@@ -71,6 +71,10 @@ static const bool def_history_list_enable = true;
 static const bool def_playlist_entry_remove = true;
 static const bool def_playlist_entry_rename = true;
 
+/* Keep a binary copy of each playlist next to it, which
+ * loads faster than parsing the playlist file. */
+static const bool def_playlist_cache_enable = false;
+
 static const unsigned int def_user_language = 0;
 
 #if (defined(_WIN32) && !defined(_XBOX)) || (defined(__linux) && !defined(ANDROID) && !defined(HAVE_LAKKA)) || (defined(__MACH__) && !defined(IOS)) || defined(EMSCRIPTEN)
@@ -134,6 +138,10 @@ static const bool load_dummy_on_core_shutdown = false;
 static const bool load_dummy_on_core_shutdown = true;
 #endif
 static const bool check_firmware_before_loading = false;
+
+/* Keep a binary cache of all the core info files, which
+ * loads faster than parsing each of them at startup. */
+static const bool core_info_cache_enable = false;
 /* Forcibly disable composition.
  * Only valid on Windows Vista/7/8 for now. */
 static const bool disable_composition = false;
@@ -159,6 +167,20 @@ static const unsigned hard_sync_frames = 0;
  */
 static const unsigned frame_delay = 0;
 
+/* Runs the core this many frames ahead and rolls back,
+ * hiding the game's internal input lag. Needs save state
+ * support in the core and costs one extra emulated frame
+ * (plus a serialize/unserialize) per frame of run-ahead.
+ */
+static const bool run_ahead_enabled = false;
+static const unsigned run_ahead_frames = 1;
+
+/* Runs the frames ahead on a second instance of the core,
+ * so audio always comes from the real frame and does not
+ * glitch when input changes. Software rendered cores only.
+ */
+static const bool run_ahead_secondary_instance = false;
+
 /* Inserts a black frame inbetween frames.
  * Useful for 120 Hz monitors who want to play 60 Hz material with eliminated
  * ghosting. video_refresh_rate should still be configured as if it
@@ -516,6 +538,20 @@ static const unsigned rewind_buffer_size = 20 << 20; /* 20MiB */
 /* How many frames to rewind at a time. */
 static const unsigned rewind_granularity = 1;
 
+/* Compress rewind states on a worker thread. The main thread
+ * only has to serialize the state, which keeps large-state
+ * cores from missing frame deadlines. */
+#ifdef HAVE_THREADS
+static const bool rewind_threaded = true;
+#else
+static const bool rewind_threaded = false;
+#endif
+
+/* Run the rewind deltas through zlib before they enter the
+ * rewind buffer. Costs CPU time per capture, but fits more
+ * history into the same buffer size. */
+static const bool rewind_compression = false;
+
 /* Pause gameplay when gameplay loses focus. */
 #ifdef EMSCRIPTEN
 static const bool pause_nonactive = false;
@@ -552,6 +588,11 @@ static const unsigned netplay_delay_frames = 16;
 
 static const int netplay_check_frames = 600;
 
+/* Skip serializing replayed frames that can't be rolled
+ * back to again. Faster catch-up, but a CRC that arrives
+ * after its frame was replayed can't be checked. */
+static const bool netplay_replay_fast_path = false;
+
 static const bool netplay_use_mitm_server = false;
 
 static const char *netplay_mitm_server = "nyc";
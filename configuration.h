@@ -175,6 +175,7 @@ typedef struct settings
       bool netplay_allow_slaves;
       bool netplay_require_slaves;
       bool netplay_stateless_mode;
+      bool netplay_replay_fast_path;
       bool netplay_nat_traversal;
       bool netplay_use_mitm_server;
       bool netplay_request_devices[MAX_USERS];
@@ -220,7 +221,12 @@ typedef struct settings
       bool history_list_enable;
       bool playlist_entry_remove;
       bool playlist_entry_rename;
+      bool playlist_cache_enable;
       bool rewind_enable;
+      bool rewind_threaded;
+      bool rewind_compression;
+      bool run_ahead_enabled;
+      bool run_ahead_secondary_instance;
       bool pause_nonactive;
       bool block_sram_overwrite;
       bool savestate_auto_index;
@@ -234,6 +240,7 @@ typedef struct settings
       bool network_remote_enable_user[MAX_USERS];
       bool load_dummy_on_core_shutdown;
       bool check_firmware_before_loading;
+      bool core_info_cache_enable;
 
       bool game_specific_options;
       bool auto_overrides_enable;
@@ -324,6 +331,7 @@ typedef struct settings
       unsigned content_history_size;
       unsigned libretro_log_level;
       unsigned rewind_granularity;
+      unsigned run_ahead_frames;
       unsigned autosave_interval;
       unsigned network_cmd_port;
       unsigned network_remote_base_port;
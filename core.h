@@ -170,6 +170,12 @@ bool core_set_poll_type(unsigned *type);
 /* Runs the core for one frame. */
 bool core_run(void);
 
+/* Runs the core for one frame, reusing the input
+ * polled by the previous call to core_run. */
+bool core_run_no_input_polling(void);
+
+void core_set_output_suspended(bool video, bool audio);
+
 bool core_init(void);
 
 bool core_deinit(void *data);
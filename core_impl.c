@@ -36,6 +36,7 @@
 #endif
 
 #include "core.h"
+#include "runahead.h"
 #include "content.h"
 #include "dynamic.h"
 #include "msg_hash.h"
@@ -60,6 +61,16 @@ static void retro_input_poll_null(void)
 {
 }
 
+static void retro_audio_sample_null(int16_t left, int16_t right)
+{
+}
+
+static size_t retro_audio_sample_batch_null(const int16_t *data,
+      size_t frames)
+{
+   return frames;
+}
+
 static void core_input_state_poll_maybe(void)
 {
    if (current_core.poll_type == POLL_TYPE_NORMAL)
@@ -292,6 +303,9 @@ bool core_load_game(retro_ctx_load_content_info_t *load_info)
    else
       current_core.game_loaded = false;
 
+   if (current_core.game_loaded)
+      runahead_set_load_info(load_info);
+
    return current_core.game_loaded;
 }
 
@@ -378,6 +392,8 @@ bool core_unload(void)
 
 bool core_unload_game(void)
 {
+   runahead_deinit();
+
    video_driver_free_hw_context();
    audio_driver_stop();
 
@@ -424,6 +440,48 @@ bool core_run(void)
    return true;
 }
 
+/**
+ * core_run_no_input_polling:
+ *
+ * Runs the core for one frame without polling input again,
+ * so the core sees the same input as the previous core_run.
+ * Used by run-ahead for frames that are emulated ahead of time.
+ **/
+bool core_run_no_input_polling(void)
+{
+   current_core.input_polled = true;
+   current_core.retro_set_input_poll(retro_input_poll_null);
+
+   current_core.retro_run();
+
+   current_core.retro_set_input_poll(core_input_state_poll_maybe);
+   return true;
+}
+
+/**
+ * core_set_output_suspended:
+ * @video          : discard video frames submitted by the core.
+ * @audio          : discard audio samples submitted by the core.
+ *
+ * Rebinds the core's video and audio callbacks so that output of
+ * frames which are emulated but never presented (run-ahead) is
+ * thrown away.
+ **/
+void core_set_output_suspended(bool video, bool audio)
+{
+   current_core.retro_set_video_refresh(video
+         ? retro_frame_null : video_driver_frame);
+
+   if (audio)
+   {
+      current_core.retro_set_audio_sample(retro_audio_sample_null);
+      current_core.retro_set_audio_sample_batch(
+            retro_audio_sample_batch_null);
+   }
+   else
+      core_set_rewind_callbacks();
+}
+
 bool core_load(unsigned poll_type_behavior)
 {
    current_core.poll_type = poll_type_behavior;
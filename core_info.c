@@ -15,6 +15,9 @@
  *  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <stdint.h>
+#include <time.h>
+
 #include <compat/strl.h>
 #include <string/stdstring.h>
 #include <file/file_path.h>
@@ -35,8 +38,96 @@
 #include "file_path_special.h"
 #include "list_special.h"
 
-static const char *core_info_tmp_path               = NULL;
-static const struct string_list *core_info_tmp_list = NULL;
+/* Binary cache of all the core info files */
+#define CORE_INFO_CACHE_MAGIC   0x43495241 /* "RAIC" */
+#define CORE_INFO_CACHE_VERSION 1
+
+#define CORE_INFO_CACHE_HAS_INFO             (1 << 0)
+#define CORE_INFO_CACHE_SUPPORTS_NO_GAME     (1 << 1)
+#define CORE_INFO_CACHE_MATCH_ARCHIVE_MEMBER (1 << 2)
+
+enum core_info_cache_field
+{
+   CORE_INFO_CACHE_PATH = 0,
+   CORE_INFO_CACHE_DISPLAY_NAME,
+   CORE_INFO_CACHE_CORE_NAME,
+   CORE_INFO_CACHE_SYSTEMNAME,
+   CORE_INFO_CACHE_MANUFACTURER,
+   CORE_INFO_CACHE_EXTENSIONS,
+   CORE_INFO_CACHE_AUTHORS,
+   CORE_INFO_CACHE_PERMISSIONS,
+   CORE_INFO_CACHE_LICENSES,
+   CORE_INFO_CACHE_CATEGORIES,
+   CORE_INFO_CACHE_DATABASES,
+   CORE_INFO_CACHE_NOTES,
+   CORE_INFO_CACHE_FIELDS
+};
+
+/* The header is followed by the core records, the firmware
+ * records, the extension records, the ids of the cores for
+ * each extension and finally the strings. String fields are
+ * string offsets + 1, 0 means NULL. */
+struct core_info_cache_header
+{
+   uint32_t magic;
+   uint32_t version;
+   uint32_t count;
+   uint32_t firmware_count;
+   uint32_t ext_count;
+   uint32_t ext_cores_count;
+   uint32_t strings_size;
+   /* The directories it was built from */
+   uint32_t cores_dir;
+   uint32_t info_dir;
+   uint32_t padding;
+   /* When it was built, and the modification times the
+    * directories had then */
+   int64_t built;
+   int64_t cores_mtime;
+   int64_t info_mtime;
+};
+
+struct core_info_cache_record
+{
+   uint32_t fields[CORE_INFO_CACHE_FIELDS];
+   uint32_t firmware_first;
+   uint32_t firmware_count;
+   uint32_t flags;
+   uint32_t padding;
+   /* Of the .info file, -1 if there was none */
+   int64_t info_mtime;
+   int64_t info_size;
+};
+
+struct core_info_cache_firmware
+{
+   uint32_t path;
+   uint32_t desc;
+   uint32_t optional;
+};
+
+struct core_info_cache_ext
+{
+   uint32_t ext;
+   uint32_t first;
+   uint32_t count;
+};
+
+struct core_info_cache_strings
+{
+   char *data;
+   size_t size;
+   size_t cap;
+   bool failed;
+};
+
+struct core_info_ext_pair
+{
+   const char *ext;
+   unsigned id;
+};
+
+static const bool *core_info_tmp_supported          = NULL;
 static core_info_t *core_info_current               = NULL;
 static core_info_list_t *core_info_curr_list        = NULL;
 
@@ -81,60 +172,56 @@ static void core_info_list_resolve_all_extensions(
 #endif
 }
 
-static void core_info_list_resolve_all_firmware(
-      core_info_list_t *core_info_list)
+static void core_info_resolve_firmware(core_info_t *info,
+      config_file_t *config)
 {
-   size_t i;
    unsigned c;
+   core_info_firmware_t *firmware  = NULL;
 
-   for (i = 0; i < core_info_list->count; i++)
-   {
-      unsigned count                  = 0;
-      core_info_firmware_t *firmware  = NULL;
-      core_info_t *info               = (core_info_t*)&core_info_list->list[i];
-      config_file_t *config           = (config_file_t*)info->config_data;
-
-      if (!config || !config_get_uint(config, "firmware_count", &count))
-         continue;
+   if (!info->firmware_count)
+      return;
 
-      firmware = (core_info_firmware_t*)calloc(count, sizeof(*firmware));
+   firmware = (core_info_firmware_t*)
+      calloc(info->firmware_count, sizeof(*firmware));
 
-      if (!firmware)
-         continue;
+   if (!firmware)
+   {
+      info->firmware_count = 0;
+      return;
+   }
 
-      info->firmware = firmware;
+   info->firmware = firmware;
 
-      for (c = 0; c < count; c++)
+   for (c = 0; c < info->firmware_count; c++)
+   {
+      char path_key[64];
+      char desc_key[64];
+      char opt_key[64];
+      bool tmp_bool     = false;
+      char *tmp         = NULL;
+      path_key[0]       = desc_key[0] = opt_key[0] = '\0';
+
+      snprintf(path_key, sizeof(path_key), "firmware%u_path", c);
+      snprintf(desc_key, sizeof(desc_key), "firmware%u_desc", c);
+      snprintf(opt_key,  sizeof(opt_key),  "firmware%u_opt",  c);
+
+      if (config_get_string(config, path_key, &tmp) && !string_is_empty(tmp))
       {
-         char path_key[64];
-         char desc_key[64];
-         char opt_key[64];
-         bool tmp_bool     = false;
-         char *tmp         = NULL;
-         path_key[0]       = desc_key[0] = opt_key[0] = '\0';
-
-         snprintf(path_key, sizeof(path_key), "firmware%u_path", c);
-         snprintf(desc_key, sizeof(desc_key), "firmware%u_desc", c);
-         snprintf(opt_key,  sizeof(opt_key),  "firmware%u_opt",  c);
-
-         if (config_get_string(config, path_key, &tmp) && !string_is_empty(tmp))
-         {
-            info->firmware[c].path = strdup(tmp);
-            free(tmp);
-            tmp = NULL;
-         }
-         if (config_get_string(config, desc_key, &tmp) && !string_is_empty(tmp))
-         {
-            info->firmware[c].desc = strdup(tmp);
-            free(tmp);
-            tmp = NULL;
-         }
-         if (tmp)
-            free(tmp);
+         info->firmware[c].path = strdup(tmp);
+         free(tmp);
          tmp = NULL;
-         if (config_get_bool(config, opt_key , &tmp_bool))
-            info->firmware[c].optional = tmp_bool;
       }
+      if (config_get_string(config, desc_key, &tmp) && !string_is_empty(tmp))
+      {
+         info->firmware[c].desc = strdup(tmp);
+         free(tmp);
+         tmp = NULL;
+      }
+      if (tmp)
+         free(tmp);
+      tmp = NULL;
+      if (config_get_bool(config, opt_key , &tmp_bool))
+         info->firmware[c].optional = tmp_bool;
    }
 }
 
@@ -149,6 +236,18 @@ static void core_info_list_free(core_info_list_t *core_info_list)
    {
       core_info_t *info = (core_info_t*)&core_info_list->list[i];
 
+      string_list_free(info->supported_extensions_list);
+      string_list_free(info->authors_list);
+      string_list_free(info->note_list);
+      string_list_free(info->permissions_list);
+      string_list_free(info->licenses_list);
+      string_list_free(info->categories_list);
+      string_list_free(info->databases_list);
+
+      /* Loaded from the cache, these all live in cache_data */
+      if (core_info_list->cache_data)
+         continue;
+
       free(info->path);
       free(info->core_name);
       free(info->systemname);
@@ -161,14 +260,6 @@ static void core_info_list_free(core_info_list_t *core_info_list)
       free(info->categories);
       free(info->databases);
       free(info->notes);
-      string_list_free(info->supported_extensions_list);
-      string_list_free(info->authors_list);
-      string_list_free(info->note_list);
-      string_list_free(info->permissions_list);
-      string_list_free(info->licenses_list);
-      string_list_free(info->categories_list);
-      string_list_free(info->databases_list);
-      config_file_free((config_file_t*)info->config_data);
 
       for (j = 0; j < info->firmware_count; j++)
       {
@@ -178,32 +269,32 @@ static void core_info_list_free(core_info_list_t *core_info_list)
       free(info->firmware);
    }
 
+   free(core_info_list->cache_firmware);
+   free(core_info_list->cache_data);
+   free(core_info_list->ext_map);
+   free(core_info_list->ext_cores);
    free(core_info_list->all_ext);
    free(core_info_list->list);
    free(core_info_list);
 }
 
-static bool core_info_list_iterate(
+static void core_info_get_info_path(
       char *s, size_t len,
       const char *path_basedir,
-      struct string_list *contents, size_t i)
+      const char *core_path)
 {
    size_t info_path_base_size = PATH_MAX_LENGTH * sizeof(char);
    char *info_path_base       = NULL;
    char             *substr   = NULL;
-   const char *current_path   = contents ? contents->elems[i].data : NULL;
 
    (void)substr;
 
-   if (!current_path)
-      return false;
-
    info_path_base             = (char*)malloc(PATH_MAX_LENGTH * sizeof(char));
 
    info_path_base[0] = '\0';
 
    fill_pathname_base_noext(info_path_base,
-         current_path,
+         core_path,
          info_path_base_size);
 
 #if defined(RARCH_MOBILE) || (defined(RARCH_CONSOLE) && !defined(PSP) && !defined(_3DS) && !defined(VITA) && !defined(HW_WUP))
@@ -221,19 +312,663 @@ static bool core_info_list_iterate(
          info_path_base, len);
 
    free(info_path_base);
+}
+
+static bool core_info_list_iterate(
+      char *s, size_t len,
+      const char *path_basedir,
+      struct string_list *contents, size_t i)
+{
+   const char *current_path   = contents ? contents->elems[i].data : NULL;
+
+   if (!current_path)
+      return false;
+
+   core_info_get_info_path(s, len, path_basedir, current_path);
    return true;
 }
 
+static int core_info_ext_pair_cmp(const void *a_, const void *b_)
+{
+   const struct core_info_ext_pair *a = (const struct core_info_ext_pair*)a_;
+   const struct core_info_ext_pair *b = (const struct core_info_ext_pair*)b_;
+   int order                          = strcasecmp(a->ext, b->ext);
+
+   if (order)
+      return order;
+   return (a->id > b->id) - (a->id < b->id);
+}
+
+/**
+ * core_info_list_build_ext_map:
+ * @core_info_list      : Core info list.
+ *
+ * Builds the table of which cores support each extension,
+ * from the supported extensions of every core.
+ **/
+static void core_info_list_build_ext_map(core_info_list_t *core_info_list)
+{
+   size_t i, j;
+   size_t count                     = 0;
+   size_t num_pairs                 = 0;
+   struct core_info_ext_pair *pairs = NULL;
+
+   for (i = 0; i < core_info_list->count; i++)
+   {
+      const struct string_list *exts =
+         core_info_list->list[i].supported_extensions_list;
+      if (exts)
+         num_pairs += exts->size;
+   }
+
+   if (!num_pairs)
+      return;
+
+   pairs                     = (struct core_info_ext_pair*)
+      malloc(num_pairs * sizeof(*pairs));
+   core_info_list->ext_map   = (core_info_ext_t*)
+      malloc(num_pairs * sizeof(*core_info_list->ext_map));
+   core_info_list->ext_cores = (unsigned*)
+      malloc(num_pairs * sizeof(*core_info_list->ext_cores));
+
+   if (!pairs || !core_info_list->ext_map || !core_info_list->ext_cores)
+      goto error;
+
+   num_pairs = 0;
+
+   for (i = 0; i < core_info_list->count; i++)
+   {
+      const struct string_list *exts =
+         core_info_list->list[i].supported_extensions_list;
+
+      if (!exts)
+         continue;
+
+      for (j = 0; j < exts->size; j++)
+      {
+         const char *ext = exts->elems[j].data;
+
+         /* Matches the way core_info_does_support_file compares */
+         if (ext && *ext == '.')
+            ext++;
+         if (string_is_empty(ext))
+            continue;
+
+         pairs[num_pairs].ext   = ext;
+         pairs[num_pairs].id    = core_info_list->list[i].id;
+         num_pairs++;
+      }
+   }
+
+   qsort(pairs, num_pairs, sizeof(*pairs), core_info_ext_pair_cmp);
+
+   for (i = 0; i < num_pairs; i++)
+   {
+      core_info_ext_t *ext = &core_info_list->ext_map[core_info_list->ext_count];
+
+      if (i && !strcasecmp(pairs[i].ext, pairs[i - 1].ext))
+      {
+         /* Listed twice by the same core */
+         if (pairs[i].id == pairs[i - 1].id)
+            continue;
+         ext[-1].count++;
+      }
+      else
+      {
+         ext->ext   = pairs[i].ext;
+         ext->first = count;
+         ext->count = 1;
+         core_info_list->ext_count++;
+      }
+
+      core_info_list->ext_cores[count++] = pairs[i].id;
+   }
+
+   free(pairs);
+   return;
+
+error:
+   free(pairs);
+   free(core_info_list->ext_map);
+   free(core_info_list->ext_cores);
+   core_info_list->ext_map   = NULL;
+   core_info_list->ext_cores = NULL;
+   core_info_list->ext_count = 0;
+}
+
+/* The cores supporting an extension, ignoring case, or NULL */
+static const core_info_ext_t *core_info_list_find_ext(
+      const core_info_list_t *core_info_list, const char *ext)
+{
+   size_t lo = 0;
+   size_t hi = core_info_list->ext_count;
+
+   if (string_is_empty(ext))
+      return NULL;
+
+   while (lo < hi)
+   {
+      size_t mid = lo + (hi - lo) / 2;
+      int order  = strcasecmp(ext, core_info_list->ext_map[mid].ext);
+
+      if (!order)
+         return &core_info_list->ext_map[mid];
+      if (order < 0)
+         hi = mid;
+      else
+         lo = mid + 1;
+   }
+
+   return NULL;
+}
+
+static void core_info_get_cache_path(char *s, size_t len,
+      const char *path_basedir)
+{
+   settings_t *settings = config_get_ptr();
+   const char *dir      = !string_is_empty(settings->paths.directory_cache)
+      ? settings->paths.directory_cache : path_basedir;
+
+   fill_pathname_join(s, dir,
+         file_path_str(FILE_PATH_CORE_INFO_CACHE), len);
+}
+
+static uint32_t core_info_cache_add_string(
+      struct core_info_cache_strings *strings, const char *str)
+{
+   size_t len;
+   uint32_t offset;
+
+   if (!str)
+      return 0;
+
+   len = strlen(str) + 1;
+
+   if (strings->size + len > strings->cap)
+   {
+      size_t cap = strings->cap ? strings->cap * 2 : 4096;
+      char *data = NULL;
+
+      while (cap < strings->size + len)
+         cap *= 2;
+
+      if (cap >= UINT32_MAX || !(data = (char*)realloc(strings->data, cap)))
+      {
+         strings->failed = true;
+         return 0;
+      }
+
+      strings->data = data;
+      strings->cap  = cap;
+   }
+
+   offset         = (uint32_t)strings->size;
+   memcpy(strings->data + strings->size, str, len);
+   strings->size += len;
+
+   return offset + 1;
+}
+
+/**
+ * core_info_cache_write:
+ * @core_info_list      : Core info list, freshly parsed.
+ * @cache_path          : Path of the cache file.
+ * @cores_dir           : Directory the cores were listed from.
+ * @info_dir            : Directory the info files were read from.
+ * @built               : When the directories were stat'ed.
+ * @cores_mtime         : Modification time of @cores_dir then.
+ * @info_mtime          : Modification time of @info_dir then.
+ *
+ * Writes every core info record, together with the extension
+ * table, to the cache. Each record is stamped with the size
+ * and modification time of its .info file, so that
+ * core_info_cache_read can tell whether it is still valid.
+ **/
+static void core_info_cache_write(core_info_list_t *core_info_list,
+      const char *cache_path, const char *cores_dir, const char *info_dir,
+      int64_t built, int64_t cores_mtime, int64_t info_mtime)
+{
+   size_t i, j, firmware_count = 0, size = 0;
+   struct core_info_cache_header header;
+   struct core_info_cache_strings strings;
+   struct core_info_cache_record *records     = NULL;
+   struct core_info_cache_firmware *firmware  = NULL;
+   struct core_info_cache_ext *exts           = NULL;
+   uint32_t *ext_cores                        = NULL;
+   uint8_t *buf                               = NULL;
+   char *info_path                            = (char*)
+      malloc(PATH_MAX_LENGTH * sizeof(char));
+
+   memset(&header, 0, sizeof(header));
+   memset(&strings, 0, sizeof(strings));
+
+   if (!info_path)
+      return;
+
+   for (i = 0; i < core_info_list->count; i++)
+      firmware_count += core_info_list->list[i].firmware_count;
+
+   records   = (struct core_info_cache_record*)
+      calloc(core_info_list->count, sizeof(*records));
+   firmware  = (struct core_info_cache_firmware*)
+      calloc(firmware_count + 1, sizeof(*firmware));
+   exts      = (struct core_info_cache_ext*)
+      calloc(core_info_list->ext_count + 1, sizeof(*exts));
+   ext_cores = (uint32_t*)calloc(core_info_list->ext_count
+         ? core_info_list->ext_map[core_info_list->ext_count - 1].first
+         + core_info_list->ext_map[core_info_list->ext_count - 1].count
+         : 1, sizeof(*ext_cores));
+
+   if (!records || !firmware || !exts || !ext_cores)
+      goto end;
+
+   header.cores_dir = core_info_cache_add_string(&strings, cores_dir);
+   header.info_dir  = core_info_cache_add_string(&strings, info_dir);
+
+   for (i = 0, firmware_count = 0; i < core_info_list->count; i++)
+   {
+      const core_info_t *info               = &core_info_list->list[i];
+      struct core_info_cache_record *record = &records[i];
+      const char *fields[CORE_INFO_CACHE_FIELDS];
+
+      fields[CORE_INFO_CACHE_PATH]         = info->path;
+      fields[CORE_INFO_CACHE_DISPLAY_NAME] = info->display_name;
+      fields[CORE_INFO_CACHE_CORE_NAME]    = info->core_name;
+      fields[CORE_INFO_CACHE_SYSTEMNAME]   = info->systemname;
+      fields[CORE_INFO_CACHE_MANUFACTURER] = info->system_manufacturer;
+      fields[CORE_INFO_CACHE_EXTENSIONS]   = info->supported_extensions;
+      fields[CORE_INFO_CACHE_AUTHORS]      = info->authors;
+      fields[CORE_INFO_CACHE_PERMISSIONS]  = info->permissions;
+      fields[CORE_INFO_CACHE_LICENSES]     = info->licenses;
+      fields[CORE_INFO_CACHE_CATEGORIES]   = info->categories;
+      fields[CORE_INFO_CACHE_DATABASES]    = info->databases;
+      fields[CORE_INFO_CACHE_NOTES]        = info->notes;
+
+      for (j = 0; j < CORE_INFO_CACHE_FIELDS; j++)
+         record->fields[j] = core_info_cache_add_string(&strings, fields[j]);
+
+      record->firmware_first = (uint32_t)firmware_count;
+      record->firmware_count = (uint32_t)info->firmware_count;
+
+      for (j = 0; j < info->firmware_count; j++, firmware_count++)
+      {
+         firmware[firmware_count].path     = core_info_cache_add_string(
+               &strings, info->firmware[j].path);
+         firmware[firmware_count].desc     = core_info_cache_add_string(
+               &strings, info->firmware[j].desc);
+         firmware[firmware_count].optional = info->firmware[j].optional;
+      }
+
+      if (info->has_info)
+         record->flags |= CORE_INFO_CACHE_HAS_INFO;
+      if (info->supports_no_game)
+         record->flags |= CORE_INFO_CACHE_SUPPORTS_NO_GAME;
+      if (info->database_match_archive_member)
+         record->flags |= CORE_INFO_CACHE_MATCH_ARCHIVE_MEMBER;
+
+      record->info_mtime = -1;
+      record->info_size  = -1;
+
+      if (info->path)
+      {
+         core_info_get_info_path(info_path, PATH_MAX_LENGTH * sizeof(char),
+               info_dir, info->path);
+         record->info_mtime = path_get_mtime(info_path);
+         if (record->info_mtime >= 0)
+            record->info_size = path_get_size(info_path);
+      }
+   }
+
+   for (i = 0; i < core_info_list->ext_count; i++)
+   {
+      const core_info_ext_t *ext = &core_info_list->ext_map[i];
+
+      exts[i].ext   = core_info_cache_add_string(&strings, ext->ext);
+      exts[i].first = (uint32_t)ext->first;
+      exts[i].count = (uint32_t)ext->count;
+
+      for (j = 0; j < ext->count; j++)
+         ext_cores[ext->first + j] = core_info_list->ext_cores[ext->first + j];
+   }
+
+   if (strings.failed)
+      goto end;
+
+   header.magic           = CORE_INFO_CACHE_MAGIC;
+   header.version         = CORE_INFO_CACHE_VERSION;
+   header.count           = (uint32_t)core_info_list->count;
+   header.firmware_count  = (uint32_t)firmware_count;
+   header.ext_count       = (uint32_t)core_info_list->ext_count;
+   header.ext_cores_count = core_info_list->ext_count
+      ? exts[header.ext_count - 1].first + exts[header.ext_count - 1].count
+      : 0;
+   header.strings_size    = (uint32_t)strings.size;
+   header.built           = built;
+   header.cores_mtime     = cores_mtime;
+   header.info_mtime      = info_mtime;
+
+   buf = (uint8_t*)malloc(sizeof(header)
+         + header.count           * sizeof(*records)
+         + header.firmware_count  * sizeof(*firmware)
+         + header.ext_count       * sizeof(*exts)
+         + header.ext_cores_count * sizeof(*ext_cores)
+         + strings.size);
+   if (!buf)
+      goto end;
+
+#define CORE_INFO_CACHE_PUT(data, len) \
+   memcpy(buf + size, data, len); \
+   size += len
+
+   CORE_INFO_CACHE_PUT(&header,     sizeof(header));
+   CORE_INFO_CACHE_PUT(records,     header.count           * sizeof(*records));
+   CORE_INFO_CACHE_PUT(firmware,    header.firmware_count  * sizeof(*firmware));
+   CORE_INFO_CACHE_PUT(exts,        header.ext_count       * sizeof(*exts));
+   CORE_INFO_CACHE_PUT(ext_cores,   header.ext_cores_count * sizeof(*ext_cores));
+   CORE_INFO_CACHE_PUT(strings.data, strings.size);
+
+#undef CORE_INFO_CACHE_PUT
+
+   if (!filestream_write_file(cache_path, buf, size))
+      RARCH_WARN("Failed to write core info cache: %s\n", cache_path);
+
+end:
+   free(buf);
+   free(strings.data);
+   free(ext_cores);
+   free(exts);
+   free(firmware);
+   free(records);
+   free(info_path);
+}
+
+/* The string at a field offset, or NULL. Offsets were
+ * checked against the size of the strings beforehand. */
+static char *core_info_cache_string(char *strings, uint32_t field)
+{
+   return field ? strings + field - 1 : NULL;
+}
+
+/**
+ * core_info_cache_read:
+ * @cache_path          : Path of the cache file.
+ * @cores_dir           : Directory the cores are listed from.
+ * @info_dir            : Directory the info files are read from.
+ * @cores_mtime         : Modification time of @cores_dir.
+ * @info_mtime          : Modification time of @info_dir.
+ *
+ * Loads the core info list from the cache with a single read,
+ * if the cache was built from the same directories and neither
+ * they nor any .info file changed since. The strings of the
+ * records point into the cache data, which the list keeps.
+ *
+ * Returns: the core info list, or NULL if there is no valid cache.
+ **/
+static core_info_list_t *core_info_cache_read(const char *cache_path,
+      const char *cores_dir, const char *info_dir,
+      int64_t cores_mtime, int64_t info_mtime)
+{
+   size_t i, j;
+   struct core_info_cache_header header;
+   ssize_t len                      = 0;
+   size_t expected                  = 0;
+   void *data                       = NULL;
+   const uint8_t *records           = NULL;
+   const uint8_t *firmware          = NULL;
+   const uint8_t *exts              = NULL;
+   const uint8_t *ext_cores         = NULL;
+   char *strings                    = NULL;
+   char *info_path                  = NULL;
+   core_info_t *core_info           = NULL;
+   core_info_list_t *core_info_list = NULL;
+
+   if (!path_is_valid(cache_path))
+      return NULL;
+
+   if (!filestream_read_file(cache_path, &data, &len)
+         || (size_t)len < sizeof(header))
+      goto error;
+
+   memcpy(&header, data, sizeof(header));
+
+   if (     header.magic       != CORE_INFO_CACHE_MAGIC
+         || header.version     != CORE_INFO_CACHE_VERSION
+         || header.cores_mtime != cores_mtime
+         || header.info_mtime  != info_mtime
+         /* Changes within the second it was built in
+          * would go unnoticed */
+         || cores_mtime >= header.built
+         || info_mtime  >= header.built)
+      goto error;
+
+   expected = sizeof(header)
+      + (uint64_t)header.count           * sizeof(struct core_info_cache_record)
+      + (uint64_t)header.firmware_count  * sizeof(struct core_info_cache_firmware)
+      + (uint64_t)header.ext_count       * sizeof(struct core_info_cache_ext)
+      + (uint64_t)header.ext_cores_count * sizeof(uint32_t)
+      + header.strings_size;
+
+   if (expected != (size_t)len
+         || (header.strings_size && ((char*)data)[len - 1]))
+      goto error;
+
+   records   = (const uint8_t*)data + sizeof(header);
+   firmware  = records  + header.count * sizeof(struct core_info_cache_record);
+   exts      = firmware + header.firmware_count
+      * sizeof(struct core_info_cache_firmware);
+   ext_cores = exts     + header.ext_count * sizeof(struct core_info_cache_ext);
+   strings   = (char*)ext_cores + header.ext_cores_count * sizeof(uint32_t);
+
+   if (     header.cores_dir > header.strings_size
+         || header.info_dir  > header.strings_size
+         || !string_is_equal(core_info_cache_string(strings, header.cores_dir), cores_dir)
+         || !string_is_equal(core_info_cache_string(strings, header.info_dir), info_dir))
+      goto error;
+
+   core_info_list = (core_info_list_t*)calloc(1, sizeof(*core_info_list));
+   if (!core_info_list)
+      goto error;
+
+   core_info_list->cache_data = data;
+
+   if (header.count)
+   {
+      core_info_list->list  = (core_info_t*)
+         calloc(header.count, sizeof(*core_info_list->list));
+      if (!core_info_list->list)
+         goto error;
+   }
+
+   if (header.firmware_count)
+   {
+      core_info_list->cache_firmware = (core_info_firmware_t*)
+         calloc(header.firmware_count, sizeof(*core_info_list->cache_firmware));
+      if (!core_info_list->cache_firmware)
+         goto error;
+   }
+
+   core_info_list->count = header.count;
+   core_info             = core_info_list->list;
+   info_path             = (char*)malloc(PATH_MAX_LENGTH * sizeof(char));
+   if (!info_path)
+      goto error;
+
+   for (i = 0; i < header.firmware_count; i++)
+   {
+      struct core_info_cache_firmware rec;
+      core_info_firmware_t *fw = &core_info_list->cache_firmware[i];
+
+      memcpy(&rec, firmware + i * sizeof(rec), sizeof(rec));
+
+      if (rec.path > header.strings_size || rec.desc > header.strings_size)
+         goto error;
+
+      fw->path     = core_info_cache_string(strings, rec.path);
+      fw->desc     = core_info_cache_string(strings, rec.desc);
+      fw->optional = !!rec.optional;
+   }
+
+   for (i = 0; i < header.count; i++)
+   {
+      struct core_info_cache_record rec;
+      char *fields[CORE_INFO_CACHE_FIELDS];
+      core_info_t *info = &core_info[i];
+
+      memcpy(&rec, records + i * sizeof(rec), sizeof(rec));
+
+      for (j = 0; j < CORE_INFO_CACHE_FIELDS; j++)
+      {
+         if (rec.fields[j] > header.strings_size)
+            goto error;
+         fields[j] = core_info_cache_string(strings, rec.fields[j]);
+      }
+
+      if (     !fields[CORE_INFO_CACHE_PATH]
+            || rec.firmware_first > header.firmware_count
+            || rec.firmware_count > header.firmware_count - rec.firmware_first)
+         goto error;
+
+      /* Stale if its .info file was added, removed or changed */
+      core_info_get_info_path(info_path, PATH_MAX_LENGTH * sizeof(char),
+            info_dir, fields[CORE_INFO_CACHE_PATH]);
+      if (path_get_mtime(info_path) != rec.info_mtime
+            || rec.info_mtime >= header.built
+            || (rec.info_mtime >= 0
+               && path_get_size(info_path) != rec.info_size))
+         goto error;
+
+      info->id                   = (unsigned)i;
+      info->path                 = fields[CORE_INFO_CACHE_PATH];
+      info->display_name         = fields[CORE_INFO_CACHE_DISPLAY_NAME];
+      info->core_name            = fields[CORE_INFO_CACHE_CORE_NAME];
+      info->systemname           = fields[CORE_INFO_CACHE_SYSTEMNAME];
+      info->system_manufacturer  = fields[CORE_INFO_CACHE_MANUFACTURER];
+      info->supported_extensions = fields[CORE_INFO_CACHE_EXTENSIONS];
+      info->authors              = fields[CORE_INFO_CACHE_AUTHORS];
+      info->permissions          = fields[CORE_INFO_CACHE_PERMISSIONS];
+      info->licenses             = fields[CORE_INFO_CACHE_LICENSES];
+      info->categories           = fields[CORE_INFO_CACHE_CATEGORIES];
+      info->databases            = fields[CORE_INFO_CACHE_DATABASES];
+      info->notes                = fields[CORE_INFO_CACHE_NOTES];
+      info->has_info             = !!(rec.flags & CORE_INFO_CACHE_HAS_INFO);
+      info->supports_no_game     = !!(rec.flags & CORE_INFO_CACHE_SUPPORTS_NO_GAME);
+      info->database_match_archive_member =
+         !!(rec.flags & CORE_INFO_CACHE_MATCH_ARCHIVE_MEMBER);
+      info->firmware_count       = rec.firmware_count;
+      info->firmware             = rec.firmware_count
+         ? &core_info_list->cache_firmware[rec.firmware_first] : NULL;
+
+      if (info->supported_extensions)
+         info->supported_extensions_list =
+            string_split(info->supported_extensions, "|");
+      if (info->authors)
+         info->authors_list     = string_split(info->authors, "|");
+      if (info->permissions)
+         info->permissions_list = string_split(info->permissions, "|");
+      if (info->licenses)
+         info->licenses_list    = string_split(info->licenses, "|");
+      if (info->categories)
+         info->categories_list  = string_split(info->categories, "|");
+      if (info->databases)
+         info->databases_list   = string_split(info->databases, "|");
+      if (info->notes)
+         info->note_list        = string_split(info->notes, "|");
+   }
+
+   if (header.ext_count)
+   {
+      core_info_list->ext_map   = (core_info_ext_t*)
+         malloc(header.ext_count * sizeof(*core_info_list->ext_map));
+      core_info_list->ext_cores = (unsigned*)
+         malloc(header.ext_cores_count * sizeof(*core_info_list->ext_cores));
+      if (!core_info_list->ext_map || !core_info_list->ext_cores)
+         goto error;
+   }
+
+   for (i = 0; i < header.ext_cores_count; i++)
+   {
+      uint32_t id;
+      memcpy(&id, ext_cores + i * sizeof(id), sizeof(id));
+      if (id >= header.count)
+         goto error;
+      core_info_list->ext_cores[i] = id;
+   }
+
+   for (i = 0; i < header.ext_count; i++)
+   {
+      struct core_info_cache_ext rec;
+      core_info_ext_t *ext = &core_info_list->ext_map[i];
+
+      memcpy(&rec, exts + i * sizeof(rec), sizeof(rec));
+
+      if (     !rec.ext || rec.ext > header.strings_size
+            || rec.first > header.ext_cores_count
+            || rec.count > header.ext_cores_count - rec.first)
+         goto error;
+
+      ext->ext   = core_info_cache_string(strings, rec.ext);
+      ext->first = rec.first;
+      ext->count = rec.count;
+   }
+
+   core_info_list->ext_count = header.ext_count;
+
+   free(info_path);
+   return core_info_list;
+
+error:
+   free(info_path);
+   if (core_info_list)
+      core_info_list_free(core_info_list);
+   else
+      free(data);
+   return NULL;
+}
+
 static core_info_list_t *core_info_list_new(const char *path)
 {
    size_t i;
+   char cache_path[PATH_MAX_LENGTH];
+   int64_t built                    = 0;
+   int64_t cores_mtime              = -1;
+   int64_t info_mtime               = -1;
    core_info_t *core_info           = NULL;
    core_info_list_t *core_info_list = NULL;
-   struct string_list *contents     = dir_list_new_special(
-                                      path, DIR_LIST_CORES, NULL);
+   struct string_list *contents     = NULL;
    settings_t             *settings = config_get_ptr();
    const char       *path_basedir   = !string_is_empty(settings->paths.path_libretro_info) ?
       settings->paths.path_libretro_info : settings->paths.directory_libretro;
+   bool use_cache                   = settings->bools.core_info_cache_enable;
+
+   cache_path[0]                    = '\0';
+
+   if (use_cache)
+   {
+      core_info_get_cache_path(cache_path, sizeof(cache_path), path_basedir);
+
+      /* Creating the cache file changes the modification time of
+       * its directory, which may be one of the directories below */
+      if (!path_is_valid(cache_path))
+         filestream_write_file(cache_path, "", 0);
+
+      built       = (int64_t)time(NULL);
+      cores_mtime = path_get_mtime(path);
+      info_mtime  = path_get_mtime(path_basedir);
+
+      if (cores_mtime >= 0 && info_mtime >= 0)
+      {
+         core_info_list = core_info_cache_read(cache_path,
+               path, path_basedir, cores_mtime, info_mtime);
+
+         if (core_info_list)
+         {
+            core_info_list_resolve_all_extensions(core_info_list);
+            return core_info_list;
+         }
+      }
+   }
+
+   contents = dir_list_new_special(path, DIR_LIST_CORES, NULL);
 
    if (!contents)
       return NULL;
@@ -256,6 +991,7 @@ static core_info_list_t *core_info_list_new(const char *path)
       char *info_path       = (char*)malloc(PATH_MAX_LENGTH * sizeof(char));
 
       info_path[0]          = '\0';
+      core_info[i].id       = (unsigned)i;
 
       if (
             core_info_list_iterate(info_path, info_path_size,
@@ -395,7 +1131,10 @@ static core_info_list_t *core_info_list_new(const char *path)
                &tmp_bool))
             core_info[i].database_match_archive_member = tmp_bool;
 
-         core_info[i].config_data = conf;
+         core_info_resolve_firmware(&core_info[i], conf);
+
+         core_info[i].has_info = true;
+         config_file_free(conf);
       }
       else
          free(info_path);
@@ -408,11 +1147,13 @@ static core_info_list_t *core_info_list_new(const char *path)
             strdup(path_basename(core_info[i].path));
    }
 
-   if (core_info_list)
-   {
-      core_info_list_resolve_all_extensions(core_info_list);
-      core_info_list_resolve_all_firmware(core_info_list);
-   }
+   core_info_list_resolve_all_extensions(core_info_list);
+   core_info_list_build_ext_map(core_info_list);
+
+   /* Missing or stale, the next startup can use it */
+   if (use_cache && cores_mtime >= 0 && info_mtime >= 0)
+      core_info_cache_write(core_info_list, cache_path,
+            path, path_basedir, built, cores_mtime, info_mtime);
 
    dir_list_free(contents);
    return core_info_list;
@@ -484,12 +1225,8 @@ static int core_info_qsort_cmp(const void *a_, const void *b_)
 {
    const core_info_t *a = (const core_info_t*)a_;
    const core_info_t *b = (const core_info_t*)b_;
-   int support_a        =
-         core_info_does_support_any_file(a, core_info_tmp_list)
-      || core_info_does_support_file(a, core_info_tmp_path);
-   int support_b        =
-         core_info_does_support_any_file(b, core_info_tmp_list)
-      || core_info_does_support_file(b, core_info_tmp_path);
+   int support_a        = core_info_tmp_supported[a->id];
+   int support_b        = core_info_tmp_supported[b->id];
 
    if (support_a != support_b)
       return support_b - support_a;
@@ -710,45 +1447,61 @@ void core_info_list_get_supported_cores(core_info_list_t *core_info_list,
       const char *path, const core_info_t **infos, size_t *num_infos)
 {
    size_t i;
-   struct string_list *list = NULL;
-   size_t supported         = 0;
+   struct string_list *list   = NULL;
+   const core_info_ext_t *ext = NULL;
+   bool *supported            = NULL;
+   size_t num_supported       = 0;
 
    if (!core_info_list)
       return;
 
-   core_info_tmp_path = path;
+   supported = (bool*)calloc(core_info_list->count + 1, sizeof(*supported));
+   if (!supported)
+      return;
 
 #ifdef HAVE_COMPRESSION
    if (path_is_compressed_file(path))
       list = file_archive_get_file_list(path, NULL);
-   core_info_tmp_list = list;
 #endif
 
-   /* Let supported core come first in list so we can return
-    * a pointer to them. */
-   qsort(core_info_list->list, core_info_list->count,
-         sizeof(core_info_t), core_info_qsort_cmp);
+   /* Decide once per core, rather than on every comparison */
+   if (core_info_list->ext_map)
+   {
+      ext = core_info_list_find_ext(core_info_list,
+            path_get_extension(path));
+
+      for (i = 0; ext && i < ext->count; i++)
+         supported[core_info_list->ext_cores[ext->first + i]] = true;
+   }
 
-   for (i = 0; i < core_info_list->count; i++, supported++)
+   for (i = 0; i < core_info_list->count; i++)
    {
       const core_info_t *core = &core_info_list->list[i];
 
-      if (core_info_does_support_file(core, path))
-         continue;
+      if (!core_info_list->ext_map && !string_is_empty(path))
+         supported[core->id] = core_info_does_support_file(core, path);
 
 #ifdef HAVE_COMPRESSION
-      if (core_info_does_support_any_file(core, list))
-         continue;
+      if (!supported[core->id] && list)
+         supported[core->id] = core_info_does_support_any_file(core, list);
 #endif
 
-      break;
+      num_supported += supported[core->id];
    }
 
+   /* Let supported core come first in list so we can return
+    * a pointer to them. */
+   core_info_tmp_supported = supported;
+   qsort(core_info_list->list, core_info_list->count,
+         sizeof(core_info_t), core_info_qsort_cmp);
+   core_info_tmp_supported = NULL;
+
    if (list)
       string_list_free(list);
+   free(supported);
 
    *infos     = core_info_list->list;
-   *num_infos = supported;
+   *num_infos = num_supported;
 }
 
 void core_info_get_name(const char *path, char *s, size_t len)
@@ -820,9 +1573,7 @@ size_t core_info_list_num_info_files(core_info_list_t *core_info_list)
 
    for (i = 0; i < core_info_list->count; i++)
    {
-      config_file_t *conf = (config_file_t*)
-         core_info_list->list[i].config_data;
-      num += !!conf;
+      num += core_info_list->list[i].has_info;
    }
 
    return num;
@@ -39,9 +39,12 @@ typedef struct
 {
    bool supports_no_game;
    bool database_match_archive_member;
+   /* Whether an .info file was found for the core */
+   bool has_info;
+   /* Index in the list as it was built, before any sorting */
+   unsigned id;
    size_t firmware_count;
    char *path;
-   void *config_data;
    char *display_name;
    char *core_name;
    char *system_manufacturer;
@@ -64,11 +67,29 @@ typedef struct
    void *userdata;
 } core_info_t;
 
+/* The cores supporting one extension: ext_cores[first]
+ * up to ext_cores[first + count - 1] are their ids. */
+typedef struct
+{
+   const char *ext;
+   size_t first;
+   size_t count;
+} core_info_ext_t;
+
 typedef struct
 {
    core_info_t *list;
    size_t count;
    char *all_ext;
+   /* Sorted by extension, ignoring case */
+   core_info_ext_t *ext_map;
+   size_t ext_count;
+   unsigned *ext_cores;
+   /* When loaded from the cache, the strings of every core
+    * point into cache_data and their firmware into
+    * cache_firmware, instead of being allocated one by one. */
+   void *cache_data;
+   core_info_firmware_t *cache_firmware;
 } core_info_list_t;
 
 typedef struct core_info_ctx_firmware
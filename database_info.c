@@ -24,6 +24,7 @@
 #include <string/stdstring.h>
 
 #include "libretro-db/libretrodb.h"
+#include "libretro-db/libretrodb_lookup.h"
 
 #include "list_special.h"
 #include "database_info.h"
@@ -179,31 +180,24 @@ char *bin_to_hex_alloc(const uint8_t *data, size_t len)
 }
 
 
-static int database_cursor_iterate(libretrodb_cursor_t *cur,
+static int database_info_from_item(struct rmsgpack_dom_value *item,
       database_info_t *db_info)
 {
    unsigned i;
-   struct rmsgpack_dom_value item;
    const char* str                = NULL;
 
-   if (libretrodb_cursor_read_item(cur, &item) != 0)
-      return -1;
-
-   if (item.type != RDT_MAP)
-   {
-      rmsgpack_dom_value_free(&item);
+   if (item->type != RDT_MAP)
       return 1;
-   }
 
    db_info->analog_supported       = -1;
    db_info->rumble_supported       = -1;
    db_info->coop_supported         = -1;
 
-   for (i = 0; i < item.val.map.len; i++)
+   for (i = 0; i < item->val.map.len; i++)
    {
       uint32_t                 value = 0;
-      struct rmsgpack_dom_value *key = &item.val.map.items[i].key;
-      struct rmsgpack_dom_value *val = &item.val.map.items[i].value;
+      struct rmsgpack_dom_value *key = &item->val.map.items[i].key;
+      struct rmsgpack_dom_value *val = &item->val.map.items[i].value;
       const char *val_string         = NULL;
 
       if (!key || !val)
@@ -327,18 +321,33 @@ static int database_cursor_iterate(libretrodb_cursor_t *cur,
       }
    }
 
+   return 0;
+}
+
+static int database_cursor_iterate(libretrodb_cursor_t *cur,
+      database_info_t *db_info)
+{
+   int ret;
+   struct rmsgpack_dom_value item;
+
+   if (libretrodb_cursor_read_item(cur, &item) != 0)
+      return -1;
+
+   ret = database_info_from_item(&item, db_info);
+
    rmsgpack_dom_value_free(&item);
 
-   return 0;
+   return ret;
 }
 
 static int database_cursor_open(libretrodb_t *db,
-      libretrodb_cursor_t *cur, const char *path, const char *query)
+      libretrodb_cursor_t *cur, const char *path, const char *query,
+      const char **fields, unsigned num_fields)
 {
    const char *error     = NULL;
    libretrodb_query_t *q = NULL;
 
-   if ((libretrodb_open(path, db)) != 0)
+   if ((libretrodb_open_mapped(path, db)) != 0)
       return -1;
 
    if (query)
@@ -349,6 +358,11 @@ static int database_cursor_open(libretrodb_t *db,
       goto error;
    if ((libretrodb_cursor_open(db, cur, q)) != 0)
       goto error;
+   if (num_fields && libretrodb_cursor_set_fields(cur, fields, num_fields) != 0)
+   {
+      libretrodb_cursor_close(cur);
+      goto error;
+   }
 
    if (q)
       libretrodb_query_free(q);
@@ -463,8 +477,19 @@ void database_info_free(database_info_handle_t *db)
    string_list_free(db->list);
 }
 
-database_info_list_t *database_info_list_new(
-      const char *rdb_path, const char *query)
+/**
+ * database_info_list_new_fields:
+ * @rdb_path            : Path to the database.
+ * @query               : Query to run, NULL for every entry.
+ * @fields              : Fields to fill in, everything else is
+ *                        left empty and is not even decoded.
+ * @num_fields          : Number of @fields, 0 for all of them.
+ *
+ * Returns: list of the matching entries, or NULL on failure.
+ **/
+database_info_list_t *database_info_list_new_fields(
+      const char *rdb_path, const char *query,
+      const char **fields, unsigned num_fields)
 {
    int ret                                  = 0;
    unsigned k                               = 0;
@@ -476,7 +501,8 @@ database_info_list_t *database_info_list_new(
    if (!db || !cur)
       goto end;
 
-   if ((database_cursor_open(db, cur, rdb_path, query) != 0))
+   if ((database_cursor_open(db, cur, rdb_path, query,
+               fields, num_fields) != 0))
       goto end;
 
    database_info_list = (database_info_list_t*)
@@ -532,6 +558,52 @@ end:
    return database_info_list;
 }
 
+database_info_list_t *database_info_list_new(
+      const char *rdb_path, const char *query)
+{
+   return database_info_list_new_fields(rdb_path, query, NULL, 0);
+}
+
+/**
+ * database_info_list_new_record:
+ * @db                  : Database index.
+ * @record              : Record number returned by a lookup.
+ *
+ * Decodes the single record @record of an indexed database.
+ *
+ * Returns: list holding one entry, or NULL on failure.
+ **/
+database_info_list_t *database_info_list_new_record(
+      libretrodb_lookup_db_t *db, int record)
+{
+   struct rmsgpack_dom_value item;
+   database_info_t *database_info           = NULL;
+   database_info_list_t *database_info_list = NULL;
+
+   if (libretrodb_lookup_read(db, record, &item) != 0)
+      return NULL;
+
+   database_info      = (database_info_t*)calloc(1, sizeof(*database_info));
+   database_info_list = (database_info_list_t*)
+      malloc(sizeof(*database_info_list));
+
+   if (!database_info || !database_info_list
+         || database_info_from_item(&item, database_info) != 0)
+   {
+      rmsgpack_dom_value_free(&item);
+      free(database_info);
+      free(database_info_list);
+      return NULL;
+   }
+
+   rmsgpack_dom_value_free(&item);
+
+   database_info_list->list  = database_info;
+   database_info_list->count = 1;
+
+   return database_info_list;
+}
+
 void database_info_list_free(database_info_list_t *database_info_list)
 {
    size_t i;
@@ -27,6 +27,8 @@
 
 RETRO_BEGIN_DECLS
 
+struct libretrodb_lookup_db;
+
 enum database_status
 {
    DATABASE_STATUS_NONE = 0,
@@ -123,6 +125,12 @@ typedef struct
 database_info_list_t *database_info_list_new(const char *rdb_path,
       const char *query);
 
+database_info_list_t *database_info_list_new_fields(const char *rdb_path,
+      const char *query, const char **fields, unsigned num_fields);
+
+database_info_list_t *database_info_list_new_record(
+      struct libretrodb_lookup_db *db, int record);
+
 void database_info_list_free(database_info_list_t *list);
 
 database_info_handle_t *database_info_dir_init(const char *dir,
@@ -74,6 +74,7 @@
 } while (0)
 
 static dylib_t lib_handle;
+static dylib_t secondary_lib_handle;
 #else
 #define SYMBOL(x) current_core->x = x
 #endif
@@ -673,6 +674,98 @@ void uninit_libretro_sym(struct retro_core_t *current_core)
    performance_counters_clear();
 }
 
+#ifdef HAVE_DYNAMIC
+#define SYMBOL_SECONDARY(x) do { \
+   function_t func = dylib_proc(secondary_lib_handle, #x); \
+   memcpy(&core->x, &func, sizeof(func)); \
+   if (core->x == NULL) { RARCH_ERR("Failed to load secondary symbol: \"%s\"\n", #x); goto error; } \
+} while (0)
+
+/**
+ * init_libretro_sym_secondary:
+ * @path                        : Path to a private copy of the
+ *                                current core library.
+ * @core                        : Symbol table to fill in.
+ *
+ * Loads a second, independent instance of a libretro core.
+ * Unlike init_libretro_sym, a failure here is not fatal and
+ * does not touch the state of the primary core.
+ *
+ * Returns: true (1) if successful, otherwise false (0).
+ **/
+bool init_libretro_sym_secondary(const char *path,
+      struct retro_core_t *core)
+{
+   if (secondary_lib_handle)
+      uninit_libretro_sym_secondary(core);
+
+   secondary_lib_handle = dylib_load(path);
+
+   if (!secondary_lib_handle)
+   {
+      RARCH_ERR("Failed to open secondary libretro core: \"%s\"\n", path);
+      RARCH_ERR("Error(s): %s\n", dylib_error());
+      return false;
+   }
+
+   SYMBOL_SECONDARY(retro_init);
+   SYMBOL_SECONDARY(retro_deinit);
+
+   SYMBOL_SECONDARY(retro_api_version);
+   SYMBOL_SECONDARY(retro_get_system_info);
+   SYMBOL_SECONDARY(retro_get_system_av_info);
+
+   SYMBOL_SECONDARY(retro_set_environment);
+   SYMBOL_SECONDARY(retro_set_video_refresh);
+   SYMBOL_SECONDARY(retro_set_audio_sample);
+   SYMBOL_SECONDARY(retro_set_audio_sample_batch);
+   SYMBOL_SECONDARY(retro_set_input_poll);
+   SYMBOL_SECONDARY(retro_set_input_state);
+
+   SYMBOL_SECONDARY(retro_set_controller_port_device);
+
+   SYMBOL_SECONDARY(retro_reset);
+   SYMBOL_SECONDARY(retro_run);
+
+   SYMBOL_SECONDARY(retro_serialize_size);
+   SYMBOL_SECONDARY(retro_serialize);
+   SYMBOL_SECONDARY(retro_unserialize);
+
+   SYMBOL_SECONDARY(retro_cheat_reset);
+   SYMBOL_SECONDARY(retro_cheat_set);
+
+   SYMBOL_SECONDARY(retro_load_game);
+   SYMBOL_SECONDARY(retro_load_game_special);
+
+   SYMBOL_SECONDARY(retro_unload_game);
+   SYMBOL_SECONDARY(retro_get_region);
+   SYMBOL_SECONDARY(retro_get_memory_data);
+   SYMBOL_SECONDARY(retro_get_memory_size);
+
+   core->symbols_inited = true;
+   return true;
+
+error:
+   uninit_libretro_sym_secondary(core);
+   return false;
+}
+
+/**
+ * uninit_libretro_sym_secondary:
+ *
+ * Closes the secondary core instance and unbinds its symbols.
+ * Does not touch core options or any other frontend state.
+ **/
+void uninit_libretro_sym_secondary(struct retro_core_t *core)
+{
+   if (secondary_lib_handle)
+      dylib_close(secondary_lib_handle);
+   secondary_lib_handle = NULL;
+
+   memset(core, 0, sizeof(struct retro_core_t));
+}
+#endif
+
 static void rarch_log_libretro(enum retro_log_level level,
       const char *fmt, ...)
 {
@@ -143,6 +143,27 @@ bool init_libretro_sym(enum rarch_core_type type,
  **/
 void uninit_libretro_sym(struct retro_core_t *core);
 
+#ifdef HAVE_DYNAMIC
+/**
+ * init_libretro_sym_secondary:
+ * @path                        : Path to a private copy of the
+ *                                current core library.
+ *
+ * Loads a second, independent instance of a libretro core
+ * into @core. Used by run-ahead. Returns true on success,
+ * or false if the library or its symbols could not be loaded.
+ **/
+bool init_libretro_sym_secondary(const char *path,
+      struct retro_core_t *core);
+
+/**
+ * uninit_libretro_sym_secondary:
+ *
+ * Frees the secondary libretro core instance.
+ **/
+void uninit_libretro_sym_secondary(struct retro_core_t *core);
+#endif
+
 RETRO_END_DECLS
 
 #endif
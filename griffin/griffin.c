@@ -674,6 +674,7 @@ STATE TRACKER
 FIFO BUFFER
 ============================================================ */
 #include "../libretro-common/queues/fifo_queue.c"
+#include "../libretro-common/queues/spsc_queue.c"
 
 /*============================================================
 AUDIO RESAMPLER
@@ -834,9 +835,12 @@ FILTERS
 #include "../gfx/video_filters/lq2x.c"
 #include "../gfx/video_filters/phosphor2x.c"
 
+#include "../libretro-common/audio/dsp_filters/fft/fft.c"
 #include "../libretro-common/audio/dsp_filters/echo.c"
 #include "../libretro-common/audio/dsp_filters/eq.c"
 #include "../libretro-common/audio/dsp_filters/chorus.c"
+#include "../libretro-common/audio/dsp_filters/convolution.c"
+#include "../libretro-common/audio/dsp_filters/crystalizer.c"
 #include "../libretro-common/audio/dsp_filters/iir.c"
 #include "../libretro-common/audio/dsp_filters/panning.c"
 #include "../libretro-common/audio/dsp_filters/phaser.c"
@@ -851,6 +855,7 @@ DYNAMIC
 #include "../dynamic.c"
 #include "../gfx/video_filter.c"
 #include "../libretro-common/audio/dsp_filter.c"
+#include "../libretro-common/audio/audio_pipeline.c"
 
 /*============================================================
 CORES
@@ -898,6 +903,7 @@ CONFIGURATION
 /*============================================================
 STATE MANAGER
 ============================================================ */
+#include "../managers/state_manager_raw.c"
 #include "../managers/state_manager.c"
 
 /*============================================================
@@ -977,6 +983,7 @@ GIT
 RETROARCH
 ============================================================ */
 #include "../core_impl.c"
+#include "../runahead.c"
 #include "../retroarch.c"
 #include "../dirs.c"
 #include "../paths.c"
@@ -1075,6 +1082,7 @@ NETPLAY
 #include "../network/netplay/netplay_sync.c"
 #include "../network/netplay/netplay_discovery.c"
 #include "../network/netplay/netplay_buf.c"
+#include "../network/netplay/netplay_thread.c"
 #include "../network/netplay/netplay_room_parse.c"
 #include "../libretro-common/net/net_compat.c"
 #include "../libretro-common/net/net_socket.c"
@@ -1340,6 +1348,7 @@ XML
 #ifdef HAVE_LIBRETRODB
 #include "../libretro-db/bintree.c"
 #include "../libretro-db/libretrodb.c"
+#include "../libretro-db/libretrodb_lookup.c"
 #include "../libretro-db/rmsgpack.c"
 #include "../libretro-db/rmsgpack_dom.c"
 #include "../libretro-db/query.c"
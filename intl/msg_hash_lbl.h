@@ -383,6 +383,8 @@ MSG_HASH(MENU_ENUM_LABEL_DRIVER_SETTINGS,
       "driver_settings")
 MSG_HASH(MENU_ENUM_LABEL_CHECK_FOR_MISSING_FIRMWARE,
       "check_for_missing_firmware")
+MSG_HASH(MENU_ENUM_LABEL_CORE_INFO_CACHE_ENABLE,
+      "core_info_cache_enable")
 MSG_HASH(MENU_ENUM_LABEL_DUMMY_ON_CORE_SHUTDOWN,
       "dummy_on_core_shutdown")
 MSG_HASH(MENU_ENUM_LABEL_DYNAMIC_WALLPAPER,
@@ -633,6 +635,8 @@ MSG_HASH(MENU_ENUM_LABEL_NETPLAY,
       "netplay")
 MSG_HASH(MENU_ENUM_LABEL_NETPLAY_CHECK_FRAMES,
       "netplay_check_frames")
+MSG_HASH(MENU_ENUM_LABEL_NETPLAY_REPLAY_FAST_PATH,
+      "netplay_replay_fast_path")
 MSG_HASH(MENU_ENUM_LABEL_NETPLAY_REQUEST_DEVICE_I,
       "netplay_request_device_%u")
 MSG_HASH(MENU_ENUM_LABEL_NETPLAY_SHARE_ANALOG,
@@ -909,6 +913,10 @@ MSG_HASH(MENU_ENUM_LABEL_REWIND_ENABLE,
       "rewind_enable")
 MSG_HASH(MENU_ENUM_LABEL_REWIND_GRANULARITY,
       "rewind_granularity")
+MSG_HASH(MENU_ENUM_LABEL_REWIND_THREADED,
+      "rewind_threaded")
+MSG_HASH(MENU_ENUM_LABEL_REWIND_COMPRESSION,
+      "rewind_compression")
 MSG_HASH(MENU_ENUM_LABEL_REWIND_SETTINGS,
       "rewind_settings")
 MSG_HASH(MENU_ENUM_LABEL_RGUI_BROWSER_DIRECTORY,
@@ -1111,6 +1119,12 @@ MSG_HASH(MENU_ENUM_LABEL_VIDEO_FORCE_SRGB_DISABLE,
       "video_force_srgb_disable")
 MSG_HASH(MENU_ENUM_LABEL_VIDEO_FRAME_DELAY,
       "video_frame_delay")
+MSG_HASH(MENU_ENUM_LABEL_RUN_AHEAD_ENABLED,
+      "run_ahead_enabled")
+MSG_HASH(MENU_ENUM_LABEL_RUN_AHEAD_FRAMES,
+      "run_ahead_frames")
+MSG_HASH(MENU_ENUM_LABEL_RUN_AHEAD_SECONDARY_INSTANCE,
+      "run_ahead_secondary_instance")
 MSG_HASH(MENU_ENUM_LABEL_VIDEO_FULLSCREEN,
       "video_fullscreen")
 MSG_HASH(MENU_ENUM_LABEL_VIDEO_GAMMA,
@@ -1353,6 +1367,8 @@ MSG_HASH(MENU_ENUM_LABEL_CORE_DELETE,
       "core_delete")
 MSG_HASH(MENU_ENUM_LABEL_PLAYLIST_ENTRY_RENAME,
       "playlist_entry_rename")
+MSG_HASH(MENU_ENUM_LABEL_PLAYLIST_CACHE_ENABLE,
+      "playlist_cache_enable")
 MSG_HASH(MENU_ENUM_LABEL_MENU_FRAMEBUFFER_OPACITY,
       "menu_framebuffer_opacity")
 MSG_HASH(MENU_ENUM_LABEL_GOTO_FAVORITES,
@@ -645,6 +645,8 @@ MSG_HASH(MENU_ENUM_LABEL_VALUE_DUMMY_ON_CORE_SHUTDOWN,
       "Load Dummy on Core Shutdown")
 MSG_HASH(MENU_ENUM_LABEL_VALUE_CHECK_FOR_MISSING_FIRMWARE,
       "Check for Missing Firmware Before Loading")
+MSG_HASH(MENU_ENUM_LABEL_VALUE_CORE_INFO_CACHE_ENABLE,
+      "Core Info Cache")
 MSG_HASH(MENU_ENUM_LABEL_VALUE_DYNAMIC_WALLPAPER,
       "Dynamic Background")
 MSG_HASH(MENU_ENUM_LABEL_VALUE_DYNAMIC_WALLPAPERS_DIRECTORY,
@@ -1071,6 +1073,8 @@ MSG_HASH(MENU_ENUM_LABEL_VALUE_NETPLAY_ALLOW_SLAVES,
       "Allow Slave-Mode Clients")
 MSG_HASH(MENU_ENUM_LABEL_VALUE_NETPLAY_CHECK_FRAMES,
       "Netplay Check Frames")
+MSG_HASH(MENU_ENUM_LABEL_VALUE_NETPLAY_REPLAY_FAST_PATH,
+      "Netplay Fast Replay")
 MSG_HASH(MENU_ENUM_LABEL_VALUE_NETPLAY_INPUT_LATENCY_FRAMES_MIN,
       "Input Latency Frames")
 MSG_HASH(MENU_ENUM_LABEL_VALUE_NETPLAY_INPUT_LATENCY_FRAMES_RANGE,
@@ -1351,6 +1355,10 @@ MSG_HASH(MENU_ENUM_LABEL_VALUE_REWIND_ENABLE,
       "Rewind Enable")
 MSG_HASH(MENU_ENUM_LABEL_VALUE_REWIND_GRANULARITY,
       "Rewind Granularity")
+MSG_HASH(MENU_ENUM_LABEL_VALUE_REWIND_THREADED,
+      "Threaded Rewind Capture")
+MSG_HASH(MENU_ENUM_LABEL_VALUE_REWIND_COMPRESSION,
+      "Rewind Compression")
 MSG_HASH(MENU_ENUM_LABEL_VALUE_REWIND_SETTINGS,
       "Rewind")
 MSG_HASH(MENU_ENUM_LABEL_VALUE_RGUI_BROWSER_DIRECTORY,
@@ -1717,6 +1725,12 @@ MSG_HASH(MENU_ENUM_LABEL_VALUE_VIDEO_FORCE_SRGB_DISABLE,
       "Force-disable sRGB FBO")
 MSG_HASH(MENU_ENUM_LABEL_VALUE_VIDEO_FRAME_DELAY,
       "Frame Delay")
+MSG_HASH(MENU_ENUM_LABEL_VALUE_RUN_AHEAD_ENABLED,
+      "Run-Ahead to Reduce Latency")
+MSG_HASH(MENU_ENUM_LABEL_VALUE_RUN_AHEAD_FRAMES,
+      "Number of Frames to Run Ahead")
+MSG_HASH(MENU_ENUM_LABEL_VALUE_RUN_AHEAD_SECONDARY_INSTANCE,
+      "Use Second Instance for Run-Ahead")
 MSG_HASH(MENU_ENUM_LABEL_VALUE_VIDEO_FULLSCREEN,
       "Start in Fullscreen Mode")
 MSG_HASH(MENU_ENUM_LABEL_VALUE_VIDEO_GAMMA,
@@ -1981,6 +1995,12 @@ MSG_HASH(MENU_ENUM_SUBLABEL_VIDEO_BLACK_FRAME_INSERTION,
       "Inserts a black frame inbetween frames. Useful for users with 120Hz screens who want to play 60Hz content to eliminate ghosting.")
 MSG_HASH(MENU_ENUM_SUBLABEL_VIDEO_FRAME_DELAY,
       "Reduces latency at the cost of a higher risk of video stuttering. Adds a delay after V-Sync (in ms).")
+MSG_HASH(MENU_ENUM_SUBLABEL_RUN_AHEAD_ENABLED,
+      "Run core logic one or more frames ahead then load the state back to reduce perceived input lag. Requires save state support.")
+MSG_HASH(MENU_ENUM_SUBLABEL_RUN_AHEAD_FRAMES,
+      "The number of frames to run ahead. Causes gameplay issues such as jitter if you exceed the number of lag frames internal to the game.")
+MSG_HASH(MENU_ENUM_SUBLABEL_RUN_AHEAD_SECONDARY_INSTANCE,
+      "Use a second instance of the core to run ahead. Prevents audio problems due to loading state. Software rendered cores only.")
 MSG_HASH(MENU_ENUM_SUBLABEL_VIDEO_HARD_SYNC_FRAMES,
       "Sets how many frames the CPU can run ahead of the GPU when using 'Hard GPU Sync'.")
 MSG_HASH(MENU_ENUM_SUBLABEL_VIDEO_MAX_SWAPCHAIN_IMAGES,
@@ -2469,6 +2489,10 @@ MSG_HASH(
    MENU_ENUM_SUBLABEL_CHECK_FOR_MISSING_FIRMWARE,
    "Check if all the required firmware is present before attempting to load content."
    )
+MSG_HASH(
+   MENU_ENUM_SUBLABEL_CORE_INFO_CACHE_ENABLE,
+   "Keep a binary cache of the core info files. Startup is faster with many cores installed."
+   )
 MSG_HASH(
    MENU_ENUM_SUBLABEL_VIDEO_REFRESH_RATE,
    "Vertical refresh rate of your screen. Used to calculate a suitable audio input rate. NOTE: This will be ignored if 'Threaded Video' is enabled."
@@ -2710,6 +2734,14 @@ MSG_HASH(
       MENU_ENUM_SUBLABEL_REWIND_GRANULARITY,
       "When rewinding a defined number of frames, you can rewind several frames at a time, increasing the rewind speed."
       )
+MSG_HASH(
+      MENU_ENUM_SUBLABEL_REWIND_THREADED,
+      "Compress rewind states on a separate thread. Reduces stutter with cores that have large save states."
+      )
+MSG_HASH(
+      MENU_ENUM_SUBLABEL_REWIND_COMPRESSION,
+      "Compress rewind states with zlib. Fits more rewind history in the same buffer size, at some CPU cost per frame."
+      )
 MSG_HASH(
       MENU_ENUM_SUBLABEL_LIBRETRO_LOG_LEVEL,
       "Sets log level for cores. If a log level issued by a core is below this value, it is ignored."
@@ -2870,6 +2902,10 @@ MSG_HASH(
       MENU_ENUM_SUBLABEL_NETPLAY_CHECK_FRAMES,
       "The frequency in frames with which netplay will verify that the host and client are in sync."
       )
+MSG_HASH(
+      MENU_ENUM_SUBLABEL_NETPLAY_REPLAY_FAST_PATH,
+      "When catching up, don't save states for frames that can't be rolled back to. Uses less CPU, but a desync reported late for one of those frames goes unnoticed."
+      )
 MSG_HASH(
       MENU_ENUM_SUBLABEL_NETPLAY_NAT_TRAVERSAL,
       "When hosting, attempt to listen for connections from the public Internet, using UPnP or similar technologies to escape LANs."
@@ -3277,6 +3313,10 @@ MSG_HASH(MENU_ENUM_SUBLABEL_PLAYLIST_ENTRY_RENAME,
       "Allow the user to rename entries in collections.")
 MSG_HASH(MENU_ENUM_LABEL_VALUE_PLAYLIST_ENTRY_RENAME,
       "Allow to rename entries")
+MSG_HASH(MENU_ENUM_SUBLABEL_PLAYLIST_CACHE_ENABLE,
+      "Keep a binary cache next to each playlist. Large playlists and collections load faster.")
+MSG_HASH(MENU_ENUM_LABEL_VALUE_PLAYLIST_CACHE_ENABLE,
+      "Playlist Cache")
 MSG_HASH(MENU_ENUM_SUBLABEL_RENAME_ENTRY,
       "Rename the title of the entry.")
 MSG_HASH(MENU_ENUM_LABEL_VALUE_RENAME_ENTRY,
@@ -25,6 +25,7 @@
 
 #include <formats/rwav.h>
 #include <memalign.h>
+#include <retro_miscellaneous.h>
 
 #ifdef HAVE_THREADS
 #include <rthreads/rthreads.h>
@@ -52,7 +53,26 @@
 #endif
 
 #define AUDIO_MIXER_MAX_VOICES      8
-#define AUDIO_MIXER_TEMP_OGG_BUFFER 8192
+
+/* Streamed voices are decoded this many frames at a time... */
+#define AUDIO_MIXER_DECODE_FRAMES   1024
+/* ...into a ring this many frames long. Must be a power of two. */
+#define AUDIO_MIXER_STREAM_FRAMES   16384
+#define AUDIO_MIXER_RING_SAMPLES    (AUDIO_MIXER_STREAM_FRAMES * 2)
+#define AUDIO_MIXER_RING_MASK       (AUDIO_MIXER_RING_SAMPLES - 1)
+/* How long the decoder sleeps when nothing wakes it, in microseconds */
+#define AUDIO_MIXER_DECODER_IDLE_US 10000
+
+/* With threads, streams are decoded ahead of time on a thread of their
+ * own, and the mixer only has to sum up what's in the rings. */
+#if defined(HAVE_THREADS) && (defined(__GNUC__) || defined(__clang__))
+#define AUDIO_MIXER_HAVE_DECODER 1
+#define AUDIO_MIXER_LOAD(x)     __atomic_load_n(&(x), __ATOMIC_ACQUIRE)
+#define AUDIO_MIXER_STORE(x, v) __atomic_store_n(&(x), (v), __ATOMIC_RELEASE)
+#else
+#define AUDIO_MIXER_LOAD(x)     (x)
+#define AUDIO_MIXER_STORE(x, v) ((x) = (v))
+#endif
 
 struct audio_mixer_sound
 {
@@ -87,6 +107,30 @@ struct audio_mixer_sound
    } types;
 };
 
+/* Decoded PCM of a streamed voice, at the output rate. The decoder
+ * writes at write_ptr and the mixer reads at read_ptr. Both count
+ * samples and only ever go up, and each has a single writer, so
+ * neither side has to take a lock. */
+struct audio_mixer_stream
+{
+   float *ring;
+   unsigned read_ptr;
+   unsigned write_ptr;
+
+   /* Bumped by the decoder each time a repeating voice starts over */
+   unsigned repeats;
+   /* The mixer's count of the repeats it has reported */
+   unsigned repeats_seen;
+   /* Where the decoder last started over */
+   unsigned loop_ptr;
+
+   /* Which decoder the voice's state belongs to, if any */
+   unsigned type;
+
+   /* Set once the decoder has written the last sample */
+   bool eof;
+};
+
 struct audio_mixer_voice
 {
    bool     repeat;
@@ -94,6 +138,7 @@ struct audio_mixer_voice
    float    volume;
    audio_mixer_sound_t *sound;
    audio_mixer_stop_cb_t stop_cb;
+   struct audio_mixer_stream stream;
 
    union
    {
@@ -105,8 +150,7 @@ struct audio_mixer_voice
 #ifdef HAVE_STB_VORBIS
       struct
       {
-         unsigned    position;
-         unsigned    samples;
+         unsigned    decode_frames;
          unsigned    buf_samples;
          float*      buffer;
          float       ratio;
@@ -119,11 +163,10 @@ struct audio_mixer_voice
 #ifdef HAVE_IBXM
       struct
       {
-         unsigned    		position;
-         unsigned    		samples;
-         unsigned    		buf_samples;
+         unsigned           buf_samples;
          int*               buffer;
-         struct replay*		stream;
+         struct replay*     stream;
+         struct module*     module;
       } mod;
 #endif
    } types;
@@ -134,6 +177,16 @@ static unsigned s_rate = 0;
 
 #ifdef HAVE_THREADS
 static slock_t* s_locker = NULL;
+
+/* Held while setting up, decoding into, or tearing down a stream */
+static slock_t* s_decoder_lock = NULL;
+#endif
+
+#ifdef AUDIO_MIXER_HAVE_DECODER
+static sthread_t* s_decoder        = NULL;
+static slock_t* s_decoder_wait     = NULL;
+static scond_t* s_decoder_cond     = NULL;
+static bool s_decoder_quit         = false;
 #endif
 
 static bool wav2float(const rwav_t* wav, float** pcm, size_t samples_out)
@@ -249,6 +302,240 @@ static bool one_shot_resample(const float* in, size_t samples_in,
    return true;
 }
 
+#if defined(HAVE_STB_VORBIS) || defined(HAVE_IBXM)
+static unsigned audio_mixer_stream_space(const struct audio_mixer_stream *stream)
+{
+   return AUDIO_MIXER_RING_SAMPLES -
+      (stream->write_ptr - AUDIO_MIXER_LOAD(stream->read_ptr));
+}
+
+#ifdef HAVE_STB_VORBIS
+static void audio_mixer_stream_write(struct audio_mixer_stream *stream,
+      const float *pcm, unsigned samples)
+{
+   unsigned pos   = stream->write_ptr & AUDIO_MIXER_RING_MASK;
+   unsigned first = MIN(samples, AUDIO_MIXER_RING_SAMPLES - pos);
+
+   memcpy(stream->ring + pos, pcm, first * sizeof(float));
+   memcpy(stream->ring, pcm + first, (samples - first) * sizeof(float));
+
+   AUDIO_MIXER_STORE(stream->write_ptr, stream->write_ptr + samples);
+}
+#endif
+
+/* At the end of the data, either start over or call it done. Returns
+ * true if there's more to decode. */
+static bool audio_mixer_stream_end(audio_mixer_voice_t *voice)
+{
+   struct audio_mixer_stream *stream = &voice->stream;
+
+   /* Nothing since the last time round means nothing ever */
+   if (!voice->repeat || stream->write_ptr == stream->loop_ptr)
+   {
+      AUDIO_MIXER_STORE(stream->eof, true);
+      return false;
+   }
+
+   stream->loop_ptr = stream->write_ptr;
+   AUDIO_MIXER_STORE(stream->repeats, stream->repeats + 1);
+   return true;
+}
+
+#endif
+
+#ifdef HAVE_STB_VORBIS
+static bool audio_mixer_decode_ogg(audio_mixer_voice_t *voice)
+{
+   float temp_buffer[AUDIO_MIXER_DECODE_FRAMES * 2];
+   unsigned frames;
+
+   if (audio_mixer_stream_space(&voice->stream) < voice->types.ogg.buf_samples)
+      return false;
+
+   frames = stb_vorbis_get_samples_float_interleaved(
+         voice->types.ogg.stream, 2, temp_buffer,
+         voice->types.ogg.decode_frames * 2);
+
+   if (frames == 0)
+   {
+      if (!audio_mixer_stream_end(voice))
+         return false;
+      stb_vorbis_seek_start(voice->types.ogg.stream);
+      return true;
+   }
+
+   if (voice->types.ogg.resampler)
+   {
+      struct resampler_data info;
+
+      info.data_in       = temp_buffer;
+      info.data_out      = voice->types.ogg.buffer;
+      info.input_frames  = frames;
+      info.output_frames = 0;
+      info.ratio         = voice->types.ogg.ratio;
+
+      voice->types.ogg.resampler->process(
+            voice->types.ogg.resampler_data, &info);
+      audio_mixer_stream_write(&voice->stream,
+            voice->types.ogg.buffer, info.output_frames * 2);
+   }
+   else
+      audio_mixer_stream_write(&voice->stream, temp_buffer, frames * 2);
+
+   return true;
+}
+#endif
+
+#ifdef HAVE_IBXM
+static bool audio_mixer_decode_mod(audio_mixer_voice_t *voice)
+{
+   unsigned i, samples;
+   const int *pcm;
+   struct audio_mixer_stream *stream = &voice->stream;
+
+   if (audio_mixer_stream_space(stream) < voice->types.mod.buf_samples)
+      return false;
+
+   samples = replay_get_audio(voice->types.mod.stream,
+         voice->types.mod.buffer) * 2; /* stereo */
+
+   if (samples == 0)
+   {
+      if (!audio_mixer_stream_end(voice))
+         return false;
+      replay_seek(voice->types.mod.stream, 0);
+      return true;
+   }
+
+   pcm = voice->types.mod.buffer;
+
+   for (i = 0; i < samples; i++)
+   {
+      float samplef = (float)((int)pcm[i] + 32768) / 65535.0f;
+      stream->ring[(stream->write_ptr + i) & AUDIO_MIXER_RING_MASK] =
+         samplef * 2.0f - 1.0f;
+   }
+
+   AUDIO_MIXER_STORE(stream->write_ptr, stream->write_ptr + samples);
+   return true;
+}
+#endif
+
+/* Decodes a chunk of a streamed voice if there's room for it in the
+ * ring. Returns false when there's nothing to do for now. */
+static bool audio_mixer_decode(audio_mixer_voice_t *voice)
+{
+   if (voice->stream.eof)
+      return false;
+
+   switch (voice->stream.type)
+   {
+      case AUDIO_MIXER_TYPE_OGG:
+#ifdef HAVE_STB_VORBIS
+         return audio_mixer_decode_ogg(voice);
+#else
+         break;
+#endif
+      case AUDIO_MIXER_TYPE_MOD:
+#ifdef HAVE_IBXM
+         return audio_mixer_decode_mod(voice);
+#else
+         break;
+#endif
+      default:
+         break;
+   }
+
+   return false;
+}
+
+/* Frees whatever decoding state a voice was left with. The voice must
+ * be stopped, with s_decoder_lock held. */
+static void audio_mixer_release(audio_mixer_voice_t *voice)
+{
+   switch (voice->stream.type)
+   {
+      case AUDIO_MIXER_TYPE_OGG:
+#ifdef HAVE_STB_VORBIS
+         stb_vorbis_close(voice->types.ogg.stream);
+         if (voice->types.ogg.resampler)
+            voice->types.ogg.resampler->free(voice->types.ogg.resampler_data);
+         if (voice->types.ogg.buffer)
+            memalign_free(voice->types.ogg.buffer);
+#endif
+         break;
+      case AUDIO_MIXER_TYPE_MOD:
+#ifdef HAVE_IBXM
+         dispose_replay(voice->types.mod.stream);
+         dispose_module(voice->types.mod.module);
+         memalign_free(voice->types.mod.buffer);
+#endif
+         break;
+      default:
+         break;
+   }
+
+   if (voice->stream.ring)
+      memalign_free(voice->stream.ring);
+
+   memset(&voice->stream, 0, sizeof(voice->stream));
+}
+
+#ifdef AUDIO_MIXER_HAVE_DECODER
+static void audio_mixer_decoder_wake(void)
+{
+   slock_lock(s_decoder_wait);
+   scond_signal(s_decoder_cond);
+   slock_unlock(s_decoder_wait);
+}
+
+/* Keeps the rings of every playing stream topped up, a chunk per
+ * voice at a time, then sleeps until the mixer has used some up. */
+static void audio_mixer_decoder(void *data)
+{
+   slock_lock(s_decoder_wait);
+
+   while (!s_decoder_quit)
+   {
+      unsigned i;
+      unsigned types[AUDIO_MIXER_MAX_VOICES];
+      bool busy = false;
+
+      slock_unlock(s_decoder_wait);
+
+      slock_lock(s_decoder_lock);
+
+      slock_lock(s_locker);
+      for (i = 0; i < AUDIO_MIXER_MAX_VOICES; i++)
+         types[i] = s_voices[i].type;
+      slock_unlock(s_locker);
+
+      for (i = 0; i < AUDIO_MIXER_MAX_VOICES; i++)
+      {
+         audio_mixer_voice_t *voice = &s_voices[i];
+
+         /* Clean up after voices that have finished playing */
+         if (types[i] == AUDIO_MIXER_TYPE_NONE)
+         {
+            if (voice->stream.type != AUDIO_MIXER_TYPE_NONE)
+               audio_mixer_release(voice);
+            continue;
+         }
+
+         busy |= audio_mixer_decode(voice);
+      }
+      slock_unlock(s_decoder_lock);
+
+      slock_lock(s_decoder_wait);
+      if (!busy && !s_decoder_quit)
+         scond_wait_timeout(s_decoder_cond, s_decoder_wait,
+               AUDIO_MIXER_DECODER_IDLE_US);
+   }
+
+   slock_unlock(s_decoder_wait);
+}
+#endif
+
 void audio_mixer_init(unsigned rate)
 {
    unsigned i;
@@ -259,7 +546,16 @@ void audio_mixer_init(unsigned rate)
       s_voices[i].type = AUDIO_MIXER_TYPE_NONE;
 
 #ifdef HAVE_THREADS
-   s_locker = slock_new();
+   s_locker       = slock_new();
+   s_decoder_lock = slock_new();
+#endif
+
+#ifdef AUDIO_MIXER_HAVE_DECODER
+   s_decoder_quit = false;
+   s_decoder_wait = slock_new();
+   s_decoder_cond = scond_new();
+   if (s_decoder_wait && s_decoder_cond)
+      s_decoder   = sthread_create(audio_mixer_decoder, NULL);
 #endif
 }
 
@@ -267,14 +563,39 @@ void audio_mixer_done(void)
 {
    unsigned i;
 
-#ifdef HAVE_THREADS
-   /* Dont call audio mixer functions after this point */
-   slock_free(s_locker);
-   s_locker = NULL;
+#ifdef AUDIO_MIXER_HAVE_DECODER
+   if (s_decoder)
+   {
+      slock_lock(s_decoder_wait);
+      s_decoder_quit = true;
+      scond_signal(s_decoder_cond);
+      slock_unlock(s_decoder_wait);
+
+      sthread_join(s_decoder);
+      s_decoder = NULL;
+   }
+
+   if (s_decoder_cond)
+      scond_free(s_decoder_cond);
+   if (s_decoder_wait)
+      slock_free(s_decoder_wait);
+   s_decoder_cond = NULL;
+   s_decoder_wait = NULL;
 #endif
 
    for (i = 0; i < AUDIO_MIXER_MAX_VOICES; i++)
+   {
       s_voices[i].type = AUDIO_MIXER_TYPE_NONE;
+      audio_mixer_release(&s_voices[i]);
+   }
+
+#ifdef HAVE_THREADS
+   /* Dont call audio mixer functions after this point */
+   slock_free(s_decoder_lock);
+   slock_free(s_locker);
+   s_decoder_lock = NULL;
+   s_locker       = NULL;
+#endif
 }
 
 audio_mixer_sound_t* audio_mixer_load_wav(void *buffer, int32_t size)
@@ -403,6 +724,27 @@ static bool audio_mixer_play_wav(audio_mixer_sound_t* sound,
    return true;
 }
 
+#if defined(HAVE_STB_VORBIS) || defined(HAVE_IBXM)
+/* Hands a streamed voice's decoding state over to the stream, gets its
+ * ring ready and decodes the first couple of chunks into it, so that it
+ * doesn't start out with an underrun. On failure, the state is left for
+ * audio_mixer_release. */
+static bool audio_mixer_stream_start(audio_mixer_voice_t* voice,
+      unsigned type)
+{
+   voice->stream.type = type;
+   voice->stream.ring = (float*)memalign_alloc(16,
+         AUDIO_MIXER_RING_SAMPLES * sizeof(float));
+
+   if (!voice->stream.ring)
+      return false;
+
+   audio_mixer_decode(voice);
+   audio_mixer_decode(voice);
+   return true;
+}
+#endif
+
 #ifdef HAVE_STB_VORBIS
 static bool audio_mixer_play_ogg(
       audio_mixer_sound_t* sound,
@@ -412,7 +754,8 @@ static bool audio_mixer_play_ogg(
 {
    stb_vorbis_info info;
    int res                         = 0;
-   float ratio                     = 0.0f;
+   float ratio                     = 1.0f;
+   unsigned frames                 = AUDIO_MIXER_DECODE_FRAMES;
    unsigned samples                = 0;
    void *ogg_buffer                = NULL;
    void *resampler_data            = NULL;
@@ -426,6 +769,7 @@ static bool audio_mixer_play_ogg(
 
    info                    = stb_vorbis_get_info(stb_vorbis);
 
+   /* At the output rate, the decoded PCM goes straight into the ring */
    if (info.sample_rate != s_rate)
    {
       ratio = (double)s_rate / (double)info.sample_rate;
@@ -434,35 +778,40 @@ static bool audio_mixer_play_ogg(
                &resamp, NULL, RESAMPLER_QUALITY_DONTCARE,
                ratio))
          goto error;
-   }
 
-   samples                         = (unsigned)(AUDIO_MIXER_TEMP_OGG_BUFFER * ratio);
-   ogg_buffer                      = (float*)memalign_alloc(16,
-         ((samples + 15) & ~15) * sizeof(float));
+      /* A chunk must never resample to more than half the ring */
+      if (frames * ratio > AUDIO_MIXER_STREAM_FRAMES / 2)
+         frames = (unsigned)(AUDIO_MIXER_STREAM_FRAMES / 2 / ratio);
 
-   if (!ogg_buffer)
-   {
-      resamp->free(resampler_data);
-      goto error;
+      /* Same safeguard as one_shot_resample */
+      samples    = (unsigned)(frames * ratio) * 2 + 4;
+      ogg_buffer = memalign_alloc(16,
+            ((samples + 15) & ~15) * sizeof(float));
+
+      if (!ogg_buffer)
+      {
+         resamp->free(resampler_data);
+         goto error;
+      }
    }
+   else
+      samples = frames * 2;
 
    voice->types.ogg.resampler      = resamp;
    voice->types.ogg.resampler_data = resampler_data;
    voice->types.ogg.buffer         = (float*)ogg_buffer;
+   voice->types.ogg.decode_frames  = frames;
    voice->types.ogg.buf_samples    = samples;
    voice->types.ogg.ratio          = ratio;
    voice->types.ogg.stream         = stb_vorbis;
-   voice->types.ogg.position       = 0;
-   voice->types.ogg.samples        = 0;
 
-   return true;
+   return audio_mixer_stream_start(voice, AUDIO_MIXER_TYPE_OGG);
 
 error:
    stb_vorbis_close(stb_vorbis);
    return false;
 }
 #endif
-
 #ifdef HAVE_IBXM
 static bool audio_mixer_play_mod(
       audio_mixer_sound_t* sound,
@@ -473,7 +822,6 @@ static bool audio_mixer_play_mod(
    struct data data;
    char message[64];
    int buf_samples               = 0;
-   int samples                   = 0;
    void *mod_buffer              = NULL;
    struct module* module         = NULL;
    struct replay* replay         = NULL;
@@ -505,25 +853,19 @@ static bool audio_mixer_play_mod(
       goto error;
    }
 
-   samples = replay_calculate_duration(replay);
-
-   if (!samples)
-   {
-      printf("audio_mixer_play_mod cannot retrieve duration !\n");
-      goto error;
-   }
-
    voice->types.mod.buffer         = (int*)mod_buffer;
-   voice->types.mod.buf_samples    = buf_samples;
+   /* The most a tick (at the slowest tempo) can produce, in samples */
+   voice->types.mod.buf_samples    = (buf_samples / 4 - 65) * 2;
    voice->types.mod.stream         = replay;
-   voice->types.mod.position       = 0;
-    voice->types.mod.samples       = 0; /* samples; */
+   voice->types.mod.module         = module;
 
-   return true;
+   return audio_mixer_stream_start(voice, AUDIO_MIXER_TYPE_MOD);
 
 error:
    if (mod_buffer)
       memalign_free(mod_buffer);
+   if (replay)
+      dispose_replay(replay);
    if (module)
       dispose_module(module);
    return false;
@@ -542,13 +884,27 @@ audio_mixer_voice_t* audio_mixer_play(audio_mixer_sound_t* sound, bool repeat,
       return NULL;
 
 #ifdef HAVE_THREADS
+   slock_lock(s_decoder_lock);
    slock_lock(s_locker);
 #endif
 
    for (i = 0; i < AUDIO_MIXER_MAX_VOICES; i++, voice++)
+      if (voice->type == AUDIO_MIXER_TYPE_NONE)
+         break;
+
+#ifdef HAVE_THREADS
+   slock_unlock(s_locker);
+#endif
+
+   if (i < AUDIO_MIXER_MAX_VOICES)
    {
-      if (voice->type != AUDIO_MIXER_TYPE_NONE)
-         continue;
+      /* Whatever played here last may not have been cleaned up yet */
+      audio_mixer_release(voice);
+
+      voice->repeat   = repeat;
+      voice->volume   = volume;
+      voice->sound    = sound;
+      voice->stop_cb  = stop_cb;
 
       switch (sound->type)
       {
@@ -568,23 +924,32 @@ audio_mixer_voice_t* audio_mixer_play(audio_mixer_sound_t* sound, bool repeat,
          case AUDIO_MIXER_TYPE_NONE:
             break;
       }
-
-      break;
    }
 
    if (res)
    {
-      voice->type     = sound->type;
-      voice->repeat   = repeat;
-      voice->volume   = volume;
-      voice->sound    = sound;
-      voice->stop_cb  = stop_cb;
+#ifdef HAVE_THREADS
+      slock_lock(s_locker);
+#endif
+      voice->type = sound->type;
+#ifdef HAVE_THREADS
+      slock_unlock(s_locker);
+#endif
    }
    else
+   {
+      if (i < AUDIO_MIXER_MAX_VOICES)
+         audio_mixer_release(voice);
       voice = NULL;
+   }
 
 #ifdef HAVE_THREADS
-   slock_unlock(s_locker);
+   slock_unlock(s_decoder_lock);
+#endif
+
+#ifdef AUDIO_MIXER_HAVE_DECODER
+   if (res && s_decoder && voice->stream.ring)
+      audio_mixer_decoder_wake();
 #endif
 
    return voice;
@@ -601,6 +966,7 @@ void audio_mixer_stop(audio_mixer_voice_t* voice)
       sound   = voice->sound;
 
 #ifdef HAVE_THREADS
+      slock_lock(s_decoder_lock);
       slock_lock(s_locker);
 #endif
 
@@ -610,6 +976,12 @@ void audio_mixer_stop(audio_mixer_voice_t* voice)
       slock_unlock(s_locker);
 #endif
 
+      audio_mixer_release(voice);
+
+#ifdef HAVE_THREADS
+      slock_unlock(s_decoder_lock);
+#endif
+
       if (stop_cb)
          stop_cb(sound, AUDIO_MIXER_SOUND_STOPPED);
    }
@@ -659,152 +1031,65 @@ again:
    }
 }
 
-#ifdef HAVE_STB_VORBIS
-static void audio_mixer_mix_ogg(float* buffer, size_t num_frames,
+static void audio_mixer_mix_stream(float* buffer, size_t num_frames,
       audio_mixer_voice_t* voice,
       float volume)
 {
-   int i;
-   struct resampler_data info;
-   float temp_buffer[AUDIO_MIXER_TEMP_OGG_BUFFER];
-   unsigned buf_free                = num_frames * 2;
-   unsigned temp_samples            = 0;
-   float* pcm                       = NULL;
-
-   if (voice->types.ogg.position == voice->types.ogg.samples)
+   unsigned i, pos, first, mixed, available;
+   struct audio_mixer_stream *stream = &voice->stream;
+   unsigned buf_free                 = (unsigned)(num_frames * 2);
+   const float* pcm                  = NULL;
+
+   /* Without a decoder thread to do it ahead of time, decode here */
+#ifdef AUDIO_MIXER_HAVE_DECODER
+   if (!s_decoder)
+#endif
    {
-again:
-      temp_samples = stb_vorbis_get_samples_float_interleaved(
-            voice->types.ogg.stream, 2, temp_buffer,
-            AUDIO_MIXER_TEMP_OGG_BUFFER) * 2;
-
-      if (temp_samples == 0)
-      {
-         if (voice->repeat)
-         {
-            if (voice->stop_cb)
-               voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_REPEATED);
-
-            stb_vorbis_seek_start(voice->types.ogg.stream);
-            goto again;
-         }
-         else
-         {
-            if (voice->stop_cb)
-               voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_FINISHED);
-
-            voice->type = AUDIO_MIXER_TYPE_NONE;
-            return;
-         }
-      }
-
-      info.data_in              = temp_buffer;
-      info.data_out             = voice->types.ogg.buffer;
-      info.input_frames         = temp_samples / 2;
-      info.output_frames        = 0;
-      info.ratio                = voice->types.ogg.ratio;
-
-      voice->types.ogg.resampler->process(voice->types.ogg.resampler_data, &info);
-      voice->types.ogg.position = 0;
-      voice->types.ogg.samples  = voice->types.ogg.buf_samples;
+      while (stream->write_ptr - stream->read_ptr < buf_free)
+         if (!audio_mixer_decode(voice))
+            break;
    }
 
-   pcm = voice->types.ogg.buffer + voice->types.ogg.position;
-
-   if (voice->types.ogg.samples < buf_free)
-   {
-      for (i = voice->types.ogg.samples; i != 0; i--)
-         *buffer++ += *pcm++ * volume;
-
-      buf_free -= voice->types.ogg.samples;
-      goto again;
-   }
-   else
-   {
-      int i;
-      for (i = buf_free; i != 0; --i )
-         *buffer++ += *pcm++ * volume;
+   available = AUDIO_MIXER_LOAD(stream->write_ptr) - stream->read_ptr;
+   mixed     = MIN(available, buf_free);
+   pos       = stream->read_ptr & AUDIO_MIXER_RING_MASK;
+   first     = MIN(mixed, AUDIO_MIXER_RING_SAMPLES - pos);
 
-      voice->types.ogg.position += buf_free;
-      voice->types.ogg.samples  -= buf_free;
-   }
-}
-#endif
+   for (i = first, pcm = stream->ring + pos; i != 0; i--)
+      *buffer++ += *pcm++ * volume;
+   for (i = mixed - first, pcm = stream->ring; i != 0; i--)
+      *buffer++ += *pcm++ * volume;
 
-#ifdef HAVE_IBXM
-static void audio_mixer_mix_mod(float* buffer, size_t num_frames,
-      audio_mixer_voice_t* voice,
-      float volume)
-{
-   int i;
-   float samplef                    = 0.0f;
-   int samplei                      = 0;
-   unsigned temp_samples            = 0;
-   unsigned buf_free                = num_frames * 2;
-   int* pcm                         = NULL;
+   AUDIO_MIXER_STORE(stream->read_ptr, stream->read_ptr + mixed);
 
-   if (voice->types.mod.position == voice->types.mod.samples)
+   /* The callbacks are still made from here, not from the decoder */
+   if (AUDIO_MIXER_LOAD(stream->repeats) != stream->repeats_seen)
    {
-again:
-      temp_samples = replay_get_audio(
-            voice->types.mod.stream, voice->types.mod.buffer );
-
-      temp_samples *= 2; /* stereo */
-
-      if (temp_samples == 0)
-      {
-         if (voice->repeat)
-         {
-            if (voice->stop_cb)
-               voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_REPEATED);
-
-            replay_seek( voice->types.mod.stream, 0);
-            goto again;
-         }
-         else
-         {
-            if (voice->stop_cb)
-               voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_FINISHED);
-
-            voice->type = AUDIO_MIXER_TYPE_NONE;
-            return;
-         }
-      }
-
-      voice->types.mod.position = 0;
-      voice->types.mod.samples  = temp_samples;
+      stream->repeats_seen = stream->repeats;
+      if (voice->stop_cb)
+         voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_REPEATED);
    }
-   pcm = voice->types.mod.buffer + voice->types.mod.position;
 
-   if (voice->types.mod.samples < buf_free)
+   if (mixed < buf_free)
    {
-      for (i = voice->types.mod.samples; i != 0; i--)
+      /* Either it's over, or the decoder has fallen behind and this
+       * voice stays quiet until it catches up */
+      if (AUDIO_MIXER_LOAD(stream->eof) &&
+            AUDIO_MIXER_LOAD(stream->write_ptr) == stream->read_ptr)
       {
-         samplei     = *pcm++ * volume;
-         samplef     = (float)((int)samplei + 32768) / 65535.0f;
-         samplef     = samplef * 2.0f - 1.0f;
-         *buffer++  += samplef;
-      }
+         if (voice->stop_cb)
+            voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_FINISHED);
 
-      buf_free -= voice->types.mod.samples;
-      goto again;
-   }
-   else
-   {
-      int i;
-      for (i = buf_free; i != 0; --i )
-      {
-         samplei     = *pcm++ * volume;
-         samplef     = (float)((int)samplei + 32768) / 65535.0f;
-         samplef     = samplef * 2.0f - 1.0f;
-         *buffer++  += samplef;
+         voice->type = AUDIO_MIXER_TYPE_NONE;
+         return;
       }
-
-      voice->types.mod.position += buf_free;
-      voice->types.mod.samples  -= buf_free;
    }
-}
+
+#ifdef AUDIO_MIXER_HAVE_DECODER
+   if (s_decoder && available - mixed < AUDIO_MIXER_RING_SAMPLES / 2)
+      scond_signal(s_decoder_cond);
 #endif
+}
 
 void audio_mixer_mix(float* buffer, size_t num_frames, float volume_override, bool override)
 {
@@ -827,14 +1112,8 @@ void audio_mixer_mix(float* buffer, size_t num_frames, float volume_override, bo
             audio_mixer_mix_wav(buffer, num_frames, voice, volume);
             break;
          case AUDIO_MIXER_TYPE_OGG:
-#ifdef HAVE_STB_VORBIS
-            audio_mixer_mix_ogg(buffer, num_frames, voice, volume);
-#endif
-            break;
          case AUDIO_MIXER_TYPE_MOD:
-#ifdef HAVE_IBXM
-            audio_mixer_mix_mod(buffer, num_frames, voice, volume);
-#endif
+            audio_mixer_mix_stream(buffer, num_frames, voice, volume);
             break;
          case AUDIO_MIXER_TYPE_NONE:
             break;
@@ -0,0 +1,108 @@
+/* Copyright  (C) 2010-2017 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (audio_pipeline.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <audio/audio_pipeline.h>
+#include <audio/conversion/s16_to_float.h>
+#include <audio/conversion/float_to_s16.h>
+
+/* The SIMD conversions work on groups of 8 samples and handle the rest
+ * with scalar code, which doesn't necessarily round the same way. Only
+ * ever converting whole groups until the very end keeps the output
+ * identical to a single conversion of the whole batch. */
+#define AUDIO_PIPELINE_SIMD_SAMPLES 8
+
+/**
+ * audio_pipeline_process:
+ * @data              : pipeline state and buffers
+ *
+ * Converts, filters, resamples and (optionally) converts back
+ * a batch of interleaved stereo s16 samples, one block at a time.
+ * The result is identical to running each stage over the whole
+ * batch in turn.
+ **/
+void audio_pipeline_process(struct audio_pipeline_data *data)
+{
+   const int16_t *input  = data->input;
+   size_t frames         = data->input_frames;
+   size_t out_samples    = 0;
+   size_t conv_samples   = 0;
+
+   while (frames)
+   {
+      struct resampler_data src_data;
+      size_t block         = frames < AUDIO_PIPELINE_BLOCK_FRAMES ?
+         frames : AUDIO_PIPELINE_BLOCK_FRAMES;
+
+      convert_s16_to_float(data->scratch, input, block * 2, data->gain);
+
+      src_data.data_in       = data->scratch;
+      src_data.input_frames  = block;
+
+      if (data->dsp)
+      {
+         struct retro_dsp_data dsp_data;
+
+         dsp_data.input         = data->scratch;
+         dsp_data.input_frames  = (unsigned)block;
+         dsp_data.output        = NULL;
+         dsp_data.output_frames = 0;
+
+         retro_dsp_filter_process(data->dsp, &dsp_data);
+
+         if (dsp_data.output)
+         {
+            src_data.data_in      = dsp_data.output;
+            src_data.input_frames = dsp_data.output_frames;
+         }
+      }
+
+      src_data.data_out      = data->output + out_samples;
+      src_data.output_frames = 0;
+      src_data.ratio         = data->ratio;
+
+      data->resampler->process(data->resampler_data, &src_data);
+
+      out_samples           += src_data.output_frames * 2;
+
+      if (data->output_s16)
+      {
+         size_t ready = (out_samples - conv_samples) &
+            ~(size_t)(AUDIO_PIPELINE_SIMD_SAMPLES - 1);
+
+         if (ready)
+         {
+            convert_float_to_s16(data->output_s16 + conv_samples,
+                  data->output + conv_samples, ready);
+            conv_samples += ready;
+         }
+      }
+
+      input                 += block * 2;
+      frames                -= block;
+   }
+
+   if (data->output_s16 && conv_samples < out_samples)
+      convert_float_to_s16(data->output_s16 + conv_samples,
+            data->output + conv_samples, out_samples - conv_samples);
+
+   data->output_frames = out_samples / 2;
+}
@@ -0,0 +1,22 @@
+filters = 1
+filter0 = convolution
+
+# Convolves the sound with an impulse response, e.g. one recorded in a
+# real room or through a speaker cabinet.
+
+# A WAV file to load the impulse response from, 8 or 16 bit, mono or stereo.
+# It is resampled to the output rate if needed.
+# Without one, a synthetic room is used instead.
+# convolution_impulse_response = "/path/to/response.wav"
+
+# Length in seconds of the synthetic room's reverb tail.
+# convolution_length = 1.0
+
+# Gains for the untouched and the convolved signal.
+# convolution_dry = 1.0
+# convolution_wet = 0.3
+
+# The response is processed in blocks of this many frames, and the output
+# is delayed by one block. Smaller blocks mean less latency but more CPU
+# time per frame, roughly in proportion to response length / block size.
+# convolution_block_size_log2 = 8
@@ -7,6 +7,10 @@ filter0 = iir
 #iir_gain = 0.0
 #iir_type = LPF
 
+# How many times the filter is applied in a row.
+# Each stage makes the slope 12 dB/octave steeper.
+#iir_stages = 1
+
 # Filter types:
 # LPF: Low-pass
 # HPF: High-pass
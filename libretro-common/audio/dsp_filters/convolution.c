@@ -0,0 +1,464 @@
+/* Copyright  (C) 2010-2017 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (convolution.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <retro_inline.h>
+#include <retro_miscellaneous.h>
+#include <libretro_dspfilter.h>
+
+#ifdef HAVE_FILTERS_BUILTIN
+#include <formats/rwav.h>
+#include "fft/fft.h"
+#else
+#include "../../formats/wav/rwav.c"
+#include "fft/fft.c"
+#endif
+#include "kernels/kernels.h"
+
+/* Uniformly partitioned convolution with an impulse response.
+ *
+ * The response is cut into blocks of block_size frames. Each block of
+ * input gets transformed once and kept around, and every output block
+ * is the sum of the past input blocks' spectra times the matching
+ * response blocks' spectra (overlap-save). So the latency is a single
+ * block however long the response is, and the cost per frame only
+ * grows with the number of blocks. */
+struct convolution_data
+{
+   fft_t *fft;
+
+   /* Spectra are kept split, with the real parts of every bin and then
+    * the imaginary parts, each padded out to stride floats. */
+
+   /* Spectra of the response blocks, per channel, times the wet gain. */
+   float *filter[2];
+
+   /* Spectra of the last few input blocks, per channel. A ring of
+    * num_blocks entries, newest at history_ptr. */
+   float *history[2];
+   float *accum;
+
+   /* For the FFTs. */
+   fft_complex_t *spectrum;
+
+   /* The previous input block, then the one being filled. */
+   float *input;
+   /* What came out of the previous block. The first half is the
+    * wrapped around part overlap-save throws away. */
+   float *output;
+
+   unsigned block_size;
+   unsigned bins;
+   unsigned stride;
+   unsigned num_blocks;
+   unsigned history_ptr;
+   unsigned block_ptr;
+
+   float dry;
+};
+
+static void convolution_free(void *data)
+{
+   unsigned c;
+   struct convolution_data *conv = (struct convolution_data*)data;
+   if (!conv)
+      return;
+
+   fft_free(conv->fft);
+   for (c = 0; c < 2; c++)
+   {
+      free(conv->filter[c]);
+      free(conv->history[c]);
+   }
+   free(conv->accum);
+   free(conv->spectrum);
+   free(conv->input);
+   free(conv->output);
+   free(conv);
+}
+
+static void convolution_split(float *out, const fft_complex_t *in,
+      unsigned bins, unsigned stride)
+{
+   unsigned i;
+   for (i = 0; i < bins; i++)
+   {
+      out[i]          = in[i].real;
+      out[stride + i] = in[i].imag;
+   }
+}
+
+static void convolution_join(fft_complex_t *out, const float *in,
+      unsigned bins, unsigned stride)
+{
+   unsigned i;
+   for (i = 0; i < bins; i++)
+   {
+      out[i].real = in[i];
+      out[i].imag = in[stride + i];
+   }
+}
+
+static INLINE void convolution_block(struct convolution_data *conv,
+      void (*complex_mac)(float *out, const float *a,
+         const float *b, unsigned n))
+{
+   unsigned c, i;
+   unsigned size = 2 * conv->stride;
+
+   for (c = 0; c < 2; c++)
+   {
+      float *history       = conv->history[c];
+      const float *filter  = conv->filter[c];
+      unsigned h           = conv->history_ptr;
+
+      fft_process_forward_real(conv->fft, conv->spectrum,
+            conv->input + c, 2);
+      convolution_split(history + h * size, conv->spectrum,
+            conv->bins, conv->stride);
+
+      memset(conv->accum, 0, size * sizeof(*conv->accum));
+      for (i = 0; i < conv->num_blocks; i++)
+      {
+         complex_mac(conv->accum, history + h * size, filter + i * size,
+               conv->stride);
+         h = h ? h - 1 : conv->num_blocks - 1;
+      }
+
+      convolution_join(conv->spectrum, conv->accum, conv->bins, conv->stride);
+      fft_process_inverse_real(conv->fft, conv->output + c,
+            conv->spectrum, 2);
+   }
+
+   memcpy(conv->input, conv->input + 2 * conv->block_size,
+         2 * conv->block_size * sizeof(float));
+   conv->history_ptr = (conv->history_ptr + 1) % conv->num_blocks;
+}
+
+static INLINE void convolution_process_blocks(struct convolution_data *conv,
+      struct dspfilter_output *output, const struct dspfilter_input *input,
+      void (*complex_mac)(float *out, const float *a,
+         const float *b, unsigned n))
+{
+   float *out;
+   unsigned frames;
+
+   output->samples = input->samples;
+   output->frames  = input->frames;
+
+   out             = output->samples;
+   frames          = input->frames;
+
+   /* Everything comes out one block late, the dry signal included,
+    * so that the two stay lined up. */
+   while (frames)
+   {
+      unsigned i;
+      unsigned avail   = conv->block_size - conv->block_ptr;
+      const float *dry = conv->input + 2 * conv->block_ptr;
+      const float *wet = conv->output +
+         2 * (conv->block_size + conv->block_ptr);
+
+      if (frames < avail)
+         avail = frames;
+
+      memcpy(conv->input + 2 * (conv->block_size + conv->block_ptr), out,
+            2 * avail * sizeof(float));
+
+      for (i = 0; i < 2 * avail; i++)
+         out[i] = conv->dry * dry[i] + wet[i];
+
+      out             += 2 * avail;
+      frames          -= avail;
+      conv->block_ptr += avail;
+
+      if (conv->block_ptr == conv->block_size)
+      {
+         convolution_block(conv, complex_mac);
+         conv->block_ptr = 0;
+      }
+   }
+}
+
+static void convolution_process(void *data, struct dspfilter_output *output,
+      const struct dspfilter_input *input)
+{
+   convolution_process_blocks((struct convolution_data*)data,
+         output, input, dsp_split_complex_mac_c);
+}
+
+#ifdef DSP_KERNELS_SIMD
+static void convolution_process_simd(void *data,
+      struct dspfilter_output *output, const struct dspfilter_input *input)
+{
+   convolution_process_blocks((struct convolution_data*)data,
+         output, input, dsp_split_complex_mac_simd);
+}
+#endif
+
+/* Reads a WAV file as interleaved stereo at the given rate. Mono files
+ * go to both channels; any channels past the second are dropped. */
+static float *convolution_load_response(const char *path,
+      float rate, unsigned *frames)
+{
+   unsigned i, c;
+   long size;
+   double ratio;
+   rwav_t wav;
+   float *response = NULL;
+   void *buf       = NULL;
+   FILE *file      = fopen(path, "rb");
+
+   if (!file)
+      return NULL;
+
+   fseek(file, 0, SEEK_END);
+   size = ftell(file);
+   fseek(file, 0, SEEK_SET);
+
+   if (size <= 0 || !(buf = malloc(size)) ||
+         fread(buf, 1, size, file) != (size_t)size)
+   {
+      fclose(file);
+      free(buf);
+      return NULL;
+   }
+   fclose(file);
+
+   if (rwav_load(&wav, buf, size) != RWAV_ITERATE_DONE)
+   {
+      free(buf);
+      rwav_free(&wav);
+      return NULL;
+   }
+   free(buf);
+
+   if (!wav.numsamples || !wav.numchannels || !wav.samplerate)
+      goto end;
+
+   /* Resample to our rate, linearly. Good enough for a response. */
+   ratio   = (double)wav.samplerate / rate;
+   *frames = (unsigned)(wav.numsamples / ratio);
+   if (!*frames)
+      goto end;
+
+   response = (float*)malloc(*frames * 2 * sizeof(float));
+   if (!response)
+      goto end;
+
+   for (i = 0; i < *frames; i++)
+   {
+      double pos   = i * ratio;
+      size_t index = (size_t)pos;
+      float frac   = (float)(pos - index);
+
+      for (c = 0; c < 2; c++)
+      {
+         unsigned chan = MIN(c, wav.numchannels - 1);
+         size_t a      = index * wav.numchannels + chan;
+         size_t b      = index + 1 < wav.numsamples ?
+            a + wav.numchannels : a;
+         float sa, sb;
+
+         if (wav.bitspersample == 8)
+         {
+            const uint8_t *samples = (const uint8_t*)wav.samples;
+            sa = (samples[a] - 128) / 128.0f;
+            sb = (samples[b] - 128) / 128.0f;
+         }
+         else
+         {
+            const int16_t *samples = (const int16_t*)wav.samples;
+            sa = samples[a] / 32768.0f;
+            sb = samples[b] / 32768.0f;
+         }
+
+         response[i * 2 + c] = sa + (sb - sa) * frac;
+      }
+   }
+
+end:
+   rwav_free(&wav);
+   return response;
+}
+
+/* A stand-in room when there's no response to load: stereo noise,
+ * dying away by 60 dB over the given length, with unit energy. */
+static float *convolution_synth_response(float rate, float length,
+      unsigned *frames)
+{
+   unsigned i;
+   float *response;
+   double energy = 0.0;
+   uint32_t seed = 0x1234567;
+
+   *frames  = (unsigned)(rate * length);
+   if (!*frames)
+      return NULL;
+
+   response = (float*)malloc(*frames * 2 * sizeof(float));
+   if (!response)
+      return NULL;
+
+   for (i = 0; i < *frames * 2; i++)
+   {
+      float noise;
+
+      seed  = seed * 1664525u + 1013904223u;
+      noise = (int32_t)seed / 2147483648.0f;
+
+      response[i] = noise * exp(-6.9 * (i >> 1) / *frames);
+      energy     += response[i] * response[i];
+   }
+
+   for (i = 0; i < *frames * 2; i++)
+      response[i] *= sqrt(2.0 / energy);
+
+   return response;
+}
+
+static void *convolution_init(const struct dspfilter_info *info,
+      const struct dspfilter_config *config, void *userdata)
+{
+   unsigned c, i, frames = 0;
+   int size_log2;
+   float wet, length;
+   float *response    = NULL;
+   float *block       = NULL;
+   char *path         = NULL;
+   struct convolution_data *conv = (struct convolution_data*)
+      calloc(1, sizeof(*conv));
+   if (!conv)
+      return NULL;
+
+   config->get_int(userdata, "block_size_log2", &size_log2, 8);
+   config->get_float(userdata, "dry", &conv->dry, 1.0f);
+   config->get_float(userdata, "wet", &wet, 0.3f);
+   config->get_float(userdata, "length", &length, 1.0f);
+
+   if (config->get_string(userdata, "impulse_response", &path, "") &&
+         *path)
+      response = convolution_load_response(path, info->input_rate, &frames);
+   else
+      response = convolution_synth_response(info->input_rate, length, &frames);
+   config->free(path);
+
+   if (!response)
+      goto error;
+
+   size_log2        = MAX(4, MIN(size_log2, 13));
+   conv->block_size = 1 << size_log2;
+   conv->bins       = conv->block_size + 1;
+   conv->stride     = (conv->bins + 3) & ~3;
+   conv->num_blocks = (frames + conv->block_size - 1) / conv->block_size;
+
+   /* Transforms are of two blocks, so that a block convolved with a
+    * block doesn't wrap around into the half we keep. */
+   conv->fft      = fft_new(size_log2 + 1);
+   conv->accum    = (float*)calloc(2 * conv->stride, sizeof(*conv->accum));
+   conv->spectrum = (fft_complex_t*)calloc(conv->bins,
+         sizeof(*conv->spectrum));
+   conv->input    = (float*)calloc(2 * conv->block_size, 2 * sizeof(float));
+   conv->output   = (float*)calloc(2 * conv->block_size, 2 * sizeof(float));
+   block          = (float*)calloc(2 * conv->block_size, sizeof(float));
+
+   if (!conv->fft || !conv->accum || !conv->spectrum ||
+         !conv->input || !conv->output || !block)
+      goto error;
+
+   for (c = 0; c < 2; c++)
+   {
+      conv->filter[c]  = (float*)calloc(conv->num_blocks * 2 * conv->stride,
+            sizeof(*conv->filter[c]));
+      conv->history[c] = (float*)calloc(conv->num_blocks * 2 * conv->stride,
+            sizeof(*conv->history[c]));
+      if (!conv->filter[c] || !conv->history[c])
+         goto error;
+
+      for (i = 0; i < conv->num_blocks; i++)
+      {
+         unsigned j;
+         unsigned start = i * conv->block_size;
+         unsigned len   = MIN(conv->block_size, frames - start);
+
+         for (j = 0; j < len; j++)
+            block[j] = wet * response[(start + j) * 2 + c];
+         memset(block + len, 0, (2 * conv->block_size - len) * sizeof(float));
+
+         fft_process_forward_real(conv->fft, conv->spectrum, block, 1);
+         convolution_split(conv->filter[c] + i * 2 * conv->stride,
+               conv->spectrum, conv->bins, conv->stride);
+      }
+   }
+
+   free(response);
+   free(block);
+   return conv;
+
+error:
+   free(response);
+   free(block);
+   convolution_free(conv);
+   return NULL;
+}
+
+static const struct dspfilter_implementation convolution_plug = {
+   convolution_init,
+   convolution_process,
+   convolution_free,
+
+   DSPFILTER_API_VERSION,
+   "Partitioned Convolution",
+   "convolution",
+};
+
+#ifdef DSP_KERNELS_SIMD
+static const struct dspfilter_implementation convolution_plug_simd = {
+   convolution_init,
+   convolution_process_simd,
+   convolution_free,
+
+   DSPFILTER_API_VERSION,
+   "Partitioned Convolution",
+   "convolution",
+};
+#endif
+
+#ifdef HAVE_FILTERS_BUILTIN
+#define dspfilter_get_implementation convolution_dspfilter_get_implementation
+#endif
+
+const struct dspfilter_implementation *dspfilter_get_implementation(dspfilter_simd_mask_t mask)
+{
+#ifdef DSP_KERNELS_SIMD
+   if (mask & DSP_KERNELS_SIMD)
+      return &convolution_plug_simd;
+#endif
+   (void)mask;
+   return &convolution_plug;
+}
+
+#undef dspfilter_get_implementation
@@ -28,10 +28,12 @@
 #include <retro_miscellaneous.h>
 #include <libretro_dspfilter.h>
 
+#include "kernels/kernels.h"
+
 struct delta_data
 {
-   float intensity;
-   float old[2];
+   /* in + (in - last in) * intensity, as a two-tap FIR */
+   struct dsp_fir fir;
 };
 
 static void delta_free(void *data)
@@ -42,30 +44,37 @@ static void delta_free(void *data)
 static void delta_process(void *data, struct dspfilter_output *output,
       const struct dspfilter_input *input)
 {
-   unsigned i, c;
    struct delta_data *d = (struct delta_data*)data;
-   float *out             = output->samples;
-   output->samples        = input->samples;
-   output->frames         = input->frames;
-
-   for (i = 0; i < input->frames; i++)
-   {
-      for (c = 0; c < 2; c++)
-      {
-           float current = *out;
-           *out++ = current + (current - d->old[c]) * d->intensity;
-           d->old[c] = current;
-      }
-   }
+   output->samples      = input->samples;
+   output->frames       = input->frames;
+
+   dsp_fir_process_c(&d->fir, output->samples, output->frames);
 }
 
+#ifdef DSP_KERNELS_SIMD
+static void delta_process_simd(void *data, struct dspfilter_output *output,
+      const struct dspfilter_input *input)
+{
+   struct delta_data *d = (struct delta_data*)data;
+   output->samples      = input->samples;
+   output->frames       = input->frames;
+
+   dsp_fir_process_simd(&d->fir, output->samples, output->frames);
+}
+#endif
+
 static void *delta_init(const struct dspfilter_info *info,
       const struct dspfilter_config *config, void *userdata)
 {
+   float intensity;
    struct delta_data *d = (struct delta_data*)calloc(1, sizeof(*d));
    if (!d)
       return NULL;
-   config->get_float(userdata, "intensity", &d->intensity, 5.0f);
+   config->get_float(userdata, "intensity", &intensity, 5.0f);
+
+   d->fir.taps      = 2;
+   d->fir.coeffs[0] = 1.0f + intensity;
+   d->fir.coeffs[1] = -intensity;
    return d;
 }
 
@@ -78,12 +87,27 @@ static const struct dspfilter_implementation delta_plug = {
    "crystalizer",
 };
 
+#ifdef DSP_KERNELS_SIMD
+static const struct dspfilter_implementation delta_plug_simd = {
+   delta_init,
+   delta_process_simd,
+   delta_free,
+   DSPFILTER_API_VERSION,
+   "Delta Sharpening",
+   "crystalizer",
+};
+#endif
+
 #ifdef HAVE_FILTERS_BUILTIN
-#define dspfilter_get_implementation delta_dspfilter_get_implementation
+#define dspfilter_get_implementation crystalizer_dspfilter_get_implementation
 #endif
 
 const struct dspfilter_implementation *dspfilter_get_implementation(dspfilter_simd_mask_t mask)
 {
+#ifdef DSP_KERNELS_SIMD
+   if (mask & DSP_KERNELS_SIMD)
+      return &delta_plug_simd;
+#endif
    (void)mask;
    return &delta_plug;
 }
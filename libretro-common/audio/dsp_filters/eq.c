@@ -29,7 +29,12 @@
 #include <filters.h>
 #include <libretro_dspfilter.h>
 
+#ifdef HAVE_FILTERS_BUILTIN
+#include "fft/fft.h"
+#else
 #include "fft/fft.c"
+#endif
+#include "kernels/kernels.h"
 
 struct eq_data
 {
@@ -64,13 +69,14 @@ static void eq_free(void *data)
    free(eq);
 }
 
-static void eq_process(void *data, struct dspfilter_output *output,
-      const struct dspfilter_input *input)
+static INLINE void eq_process_blocks(struct eq_data *eq,
+      struct dspfilter_output *output, const struct dspfilter_input *input,
+      void (*complex_mul)(fft_complex_t *out, const fft_complex_t *a,
+         const fft_complex_t *b, unsigned n))
 {
    float *out;
    const float *in;
    unsigned input_frames;
-   struct eq_data *eq = (struct eq_data*)data;
 
    output->samples    = eq->buffer;
    output->frames     = 0;
@@ -100,8 +106,8 @@ static void eq_process(void *data, struct dspfilter_output *output,
          for (c = 0; c < 2; c++)
          {
             fft_process_forward(eq->fft, eq->fftblock, eq->block + c, 2);
-            for (i = 0; i < 2 * eq->block_size; i++)
-               eq->fftblock[i] = fft_complex_mul(eq->fftblock[i], eq->filter[i]);
+            complex_mul(eq->fftblock, eq->fftblock, eq->filter,
+                  2 * eq->block_size);
             fft_process_inverse(eq->fft, out + c, eq->fftblock, 2);
          }
 
@@ -119,6 +125,21 @@ static void eq_process(void *data, struct dspfilter_output *output,
    }
 }
 
+static void eq_process(void *data, struct dspfilter_output *output,
+      const struct dspfilter_input *input)
+{
+   eq_process_blocks((struct eq_data*)data, output, input, dsp_complex_mul_c);
+}
+
+#ifdef DSP_KERNELS_SIMD
+static void eq_process_simd(void *data, struct dspfilter_output *output,
+      const struct dspfilter_input *input)
+{
+   eq_process_blocks((struct eq_data*)data, output, input,
+         dsp_complex_mul_simd);
+}
+#endif
+
 static int gains_cmp(const void *a_, const void *b_)
 {
    const struct eq_gain *a = (const struct eq_gain*)a_;
@@ -338,12 +359,28 @@ static const struct dspfilter_implementation eq_plug = {
    "eq",
 };
 
+#ifdef DSP_KERNELS_SIMD
+static const struct dspfilter_implementation eq_plug_simd = {
+   eq_init,
+   eq_process_simd,
+   eq_free,
+
+   DSPFILTER_API_VERSION,
+   "Linear-Phase FFT Equalizer",
+   "eq",
+};
+#endif
+
 #ifdef HAVE_FILTERS_BUILTIN
 #define dspfilter_get_implementation eq_dspfilter_get_implementation
 #endif
 
 const struct dspfilter_implementation *dspfilter_get_implementation(dspfilter_simd_mask_t mask)
 {
+#ifdef DSP_KERNELS_SIMD
+   if (mask & DSP_KERNELS_SIMD)
+      return &eq_plug_simd;
+#endif
    (void)mask;
    return &eq_plug;
 }
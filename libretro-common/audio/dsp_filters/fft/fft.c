@@ -27,10 +27,20 @@
 
 #include <retro_miscellaneous.h>
 
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+/* Iterative radix-2 decimation in time, with the stages done two at a
+ * time as radix-4 passes so the data only gets walked half as often.
+ *
+ * The twiddles for the stage that combines blocks of size h sit at
+ * twiddles[h + j], j < h. They only depend on h, so the same tables
+ * serve the half size FFT that the real transforms run on. */
 struct fft
 {
    fft_complex_t *interleave_buffer;
-   fft_complex_t *phase_lut;
+   fft_complex_t *twiddles[2]; /* Forward, inverse. */
    unsigned *bitinverse_buffer;
    unsigned size;
 };
@@ -58,21 +68,21 @@ static fft_complex_t exp_imag(double phase)
    return out;
 }
 
-static void build_phase_lut(fft_complex_t *out, int size)
+static void build_twiddles(fft_complex_t *out, int phase_dir, unsigned size)
 {
-   int i;
-   out += size;
-   for (i = -size; i <= size; i++)
-      out[i] = exp_imag((M_PI * i) / size);
+   unsigned h, j;
+   for (h = 1; h < size; h <<= 1)
+      for (j = 0; j < h; j++)
+         out[h + j] = exp_imag((M_PI * phase_dir * (int)(j * (size / h))) / size);
 }
 
-static void interleave_complex(const unsigned *bitinverse,
+static void interleave_complex(const unsigned *bitinverse, unsigned shift,
       fft_complex_t *out, const fft_complex_t *in,
       unsigned samples, unsigned step)
 {
    unsigned i;
    for (i = 0; i < samples; i++, in += step)
-      out[bitinverse[i]] = *in;
+      out[bitinverse[i] >> shift] = *in;
 }
 
 static void interleave_float(const unsigned *bitinverse,
@@ -106,15 +116,18 @@ fft_t *fft_new(unsigned block_size_log2)
    size                   = 1 << block_size_log2;
    fft->interleave_buffer = (fft_complex_t*)calloc(size, sizeof(*fft->interleave_buffer));
    fft->bitinverse_buffer = (unsigned*)calloc(size, sizeof(*fft->bitinverse_buffer));
-   fft->phase_lut         = (fft_complex_t*)calloc(2 * size + 1, sizeof(*fft->phase_lut));
+   fft->twiddles[0]       = (fft_complex_t*)calloc(size, sizeof(*fft->twiddles[0]));
+   fft->twiddles[1]       = (fft_complex_t*)calloc(size, sizeof(*fft->twiddles[1]));
 
-   if (!fft->interleave_buffer || !fft->bitinverse_buffer || !fft->phase_lut)
+   if (!fft->interleave_buffer || !fft->bitinverse_buffer ||
+         !fft->twiddles[0] || !fft->twiddles[1])
       goto error;
 
    fft->size = size;
 
    build_bitinverse(fft->bitinverse_buffer, block_size_log2);
-   build_phase_lut(fft->phase_lut, size);
+   build_twiddles(fft->twiddles[0], -1, size);
+   build_twiddles(fft->twiddles[1],  1, size);
    return fft;
 
 error:
@@ -129,77 +142,207 @@ void fft_free(fft_t *fft)
 
    free(fft->interleave_buffer);
    free(fft->bitinverse_buffer);
-   free(fft->phase_lut);
+   free(fft->twiddles[0]);
+   free(fft->twiddles[1]);
    free(fft);
 }
 
-static void butterfly(fft_complex_t *a, fft_complex_t *b, fft_complex_t mod)
+/* The first stage has no twiddles to apply. */
+static void butterflies_radix2(fft_complex_t *buf, unsigned samples)
 {
-   mod = fft_complex_mul(mod, *b);
-   *b  = fft_complex_sub(*a, mod);
-   *a  = fft_complex_add(*a, mod);
+   unsigned i;
+   for (i = 0; i < samples; i += 2)
+   {
+      fft_complex_t a = buf[i];
+      fft_complex_t b = buf[i + 1];
+      buf[i]          = fft_complex_add(a, b);
+      buf[i + 1]      = fft_complex_sub(a, b);
+   }
 }
 
-static void butterflies(fft_complex_t *butterfly_buf,
-      const fft_complex_t *phase_lut,
-      int phase_dir, unsigned step_size, unsigned samples)
+#if defined(__SSE__)
+/* Two complex multiplies, in the same order as fft_complex_mul(). */
+static INLINE __m128 fft_complex_mul_sse(__m128 w, __m128 x)
+{
+   const __m128 sign = _mm_set_ps(0.0f, -0.0f, 0.0f, -0.0f);
+   __m128 wre        = _mm_shuffle_ps(w, w, _MM_SHUFFLE(2, 2, 0, 0));
+   __m128 wim        = _mm_shuffle_ps(w, w, _MM_SHUFFLE(3, 3, 1, 1));
+   __m128 xs         = _mm_shuffle_ps(x, x, _MM_SHUFFLE(2, 3, 0, 1));
+   return _mm_add_ps(_mm_mul_ps(x, wre),
+         _mm_xor_ps(_mm_mul_ps(xs, wim), sign));
+}
+#endif
+
+/* Two radix-2 stages in one go: one combining blocks of size h,
+ * then one combining blocks of size 2h. */
+static void butterflies_radix4(fft_complex_t *buf,
+      const fft_complex_t *twiddles, unsigned h, unsigned samples)
 {
    unsigned i, j;
-   for (i = 0; i < samples; i += step_size << 1)
+   const fft_complex_t *w1 = twiddles + h;
+   const fft_complex_t *w2 = twiddles + 2 * h;
+   const fft_complex_t *w3 = twiddles + 3 * h;
+
+   for (i = 0; i < samples; i += h << 2)
    {
-      int phase_step = (int)samples * phase_dir / (int)step_size;
-      for (j = i; j < i + step_size; j++)
-         butterfly(&butterfly_buf[j], &butterfly_buf[j + step_size],
-               phase_lut[phase_step * (int)(j - i)]);
+      fft_complex_t *a = buf + i;
+
+      j = 0;
+#if defined(__SSE__)
+      /* Two butterflies per register. Same arithmetic as below. */
+      for (; j + 2 <= h; j += 2)
+      {
+         __m128 vw1 = _mm_loadu_ps(&w1[j].real);
+         __m128 x0  = _mm_loadu_ps(&a[j].real);
+         __m128 x1  = fft_complex_mul_sse(vw1, _mm_loadu_ps(&a[j + h].real));
+         __m128 x2  = _mm_loadu_ps(&a[j + 2 * h].real);
+         __m128 x3  = fft_complex_mul_sse(vw1, _mm_loadu_ps(&a[j + 3 * h].real));
+         __m128 t0  = _mm_add_ps(x0, x1);
+         __m128 t1  = _mm_sub_ps(x0, x1);
+         __m128 t2  = fft_complex_mul_sse(_mm_loadu_ps(&w2[j].real),
+               _mm_add_ps(x2, x3));
+         __m128 t3  = fft_complex_mul_sse(_mm_loadu_ps(&w3[j].real),
+               _mm_sub_ps(x2, x3));
+
+         _mm_storeu_ps(&a[j].real,         _mm_add_ps(t0, t2));
+         _mm_storeu_ps(&a[j + 2 * h].real, _mm_sub_ps(t0, t2));
+         _mm_storeu_ps(&a[j + h].real,     _mm_add_ps(t1, t3));
+         _mm_storeu_ps(&a[j + 3 * h].real, _mm_sub_ps(t1, t3));
+      }
+#endif
+
+      for (; j < h; j++)
+      {
+         fft_complex_t x0 = a[j];
+         fft_complex_t x1 = fft_complex_mul(w1[j], a[j + h]);
+         fft_complex_t x2 = a[j + 2 * h];
+         fft_complex_t x3 = fft_complex_mul(w1[j], a[j + 3 * h]);
+         fft_complex_t t0 = fft_complex_add(x0, x1);
+         fft_complex_t t1 = fft_complex_sub(x0, x1);
+         fft_complex_t t2 = fft_complex_mul(w2[j], fft_complex_add(x2, x3));
+         fft_complex_t t3 = fft_complex_mul(w3[j], fft_complex_sub(x2, x3));
+
+         a[j]         = fft_complex_add(t0, t2);
+         a[j + 2 * h] = fft_complex_sub(t0, t2);
+         a[j + h]     = fft_complex_add(t1, t3);
+         a[j + 3 * h] = fft_complex_sub(t1, t3);
+      }
    }
 }
 
-void fft_process_forward_complex(fft_t *fft,
-      fft_complex_t *out, const fft_complex_t *in, unsigned step)
+static void butterflies(fft_complex_t *buf,
+      const fft_complex_t *twiddles, unsigned samples)
 {
-   unsigned step_size;
-   unsigned samples = fft->size;
-   interleave_complex(fft->bitinverse_buffer, out, in, samples, step);
+   unsigned h = 1;
 
-   for (step_size = 1; step_size < samples; step_size <<= 1)
+   /* An odd number of stages leaves one over for radix-2. */
+   if (samples & 0xAAAAAAAAu)
    {
-      butterflies(out,
-            fft->phase_lut + samples,
-            -1, step_size, samples);
+      butterflies_radix2(buf, samples);
+      h = 2;
    }
+
+   for (; h < samples; h <<= 2)
+      butterflies_radix4(buf, twiddles, h, samples);
+}
+
+void fft_process_forward_complex(fft_t *fft,
+      fft_complex_t *out, const fft_complex_t *in, unsigned step)
+{
+   unsigned samples = fft->size;
+   interleave_complex(fft->bitinverse_buffer, 0, out, in, samples, step);
+   butterflies(out, fft->twiddles[0], samples);
 }
 
 void fft_process_forward(fft_t *fft,
       fft_complex_t *out, const float *in, unsigned step)
 {
-   unsigned step_size;
    unsigned samples = fft->size;
    interleave_float(fft->bitinverse_buffer, out, in, samples, step);
-
-   for (step_size = 1; step_size < fft->size; step_size <<= 1)
-   {
-      butterflies(out,
-            fft->phase_lut + samples,
-            -1, step_size, samples);
-   }
+   butterflies(out, fft->twiddles[0], samples);
 }
 
 void fft_process_inverse(fft_t *fft,
       float *out, const fft_complex_t *in, unsigned step)
 {
-   unsigned step_size;
    unsigned samples = fft->size;
 
-   interleave_complex(fft->bitinverse_buffer, fft->interleave_buffer,
+   interleave_complex(fft->bitinverse_buffer, 0, fft->interleave_buffer,
          in, samples, 1);
+   butterflies(fft->interleave_buffer, fft->twiddles[1], samples);
+
+   resolve_float(out, fft->interleave_buffer, samples, 1.0f / samples, step);
+}
+
+/* The real transforms pack even samples into the real parts and odd
+ * samples into the imaginary parts of a half size complex FFT, then
+ * split the result apart with the twiddles of the last stage. */
+void fft_process_forward_real(fft_t *fft,
+      fft_complex_t *out, const float *in, unsigned step)
+{
+   unsigned i, k;
+   unsigned half          = fft->size >> 1;
+   const fft_complex_t *w = fft->twiddles[0] + half;
 
-   for (step_size = 1; step_size < samples; step_size <<= 1)
+   for (i = 0; i < half; i++, in += 2 * step)
    {
-      butterflies(fft->interleave_buffer,
-            fft->phase_lut + samples,
-            1, step_size, samples);
+      unsigned inv_i  = fft->bitinverse_buffer[i] >> 1;
+      out[inv_i].real = in[0];
+      out[inv_i].imag = in[step];
    }
 
-   resolve_float(out, fft->interleave_buffer, samples, 1.0f / samples, step);
+   butterflies(out, fft->twiddles[0], half);
+
+   /* X[k] = (Z[k] + Z*[n - k]) / 2 - i * w^k * (Z[k] - Z*[n - k]) / 2 */
+   for (k = 1; k <= half >> 1; k++)
+   {
+      fft_complex_t a  = out[k];
+      fft_complex_t b  = fft_complex_conj(out[half - k]);
+      fft_complex_t ev = fft_complex_add(a, b);
+      fft_complex_t od = fft_complex_sub(a, b);
+      fft_complex_t oa = { 0.5f * od.imag, -0.5f * od.real };
+
+      ev.real *= 0.5f;
+      ev.imag *= 0.5f;
+
+      out[k]        = fft_complex_add(ev, fft_complex_mul(w[k], oa));
+      out[half - k] = fft_complex_conj(
+            fft_complex_sub(ev, fft_complex_mul(w[k], oa)));
+   }
+
+   out[half].real = out[0].real - out[0].imag;
+   out[half].imag = 0.0f;
+   out[0].real    = out[0].real + out[0].imag;
+   out[0].imag    = 0.0f;
 }
 
+void fft_process_inverse_real(fft_t *fft,
+      float *out, const fft_complex_t *in, unsigned step)
+{
+   unsigned i, k;
+   unsigned half          = fft->size >> 1;
+   const fft_complex_t *w = fft->twiddles[1] + half;
+   fft_complex_t *buf     = fft->interleave_buffer;
+   float gain             = 1.0f / fft->size;
+
+   /* Z[k] = X[k] + X*[n - k] + i * w^-k * (X[k] - X*[n - k]) */
+   for (k = 0; k < half; k++)
+   {
+      fft_complex_t a  = in[k];
+      fft_complex_t b  = fft_complex_conj(in[half - k]);
+      fft_complex_t od = fft_complex_mul(w[k], fft_complex_sub(a, b));
+      fft_complex_t z  = fft_complex_add(a, b);
+
+      z.real -= od.imag;
+      z.imag += od.real;
+      buf[fft->bitinverse_buffer[k] >> 1] = z;
+   }
+
+   butterflies(buf, fft->twiddles[1], half);
+
+   for (i = 0; i < half; i++, out += 2 * step)
+   {
+      out[0]    = gain * buf[i].real;
+      out[step] = gain * buf[i].imag;
+   }
+}
@@ -41,6 +41,15 @@ void fft_process_forward(fft_t *fft,
 void fft_process_inverse(fft_t *fft,
       float *out, const fft_complex_t *in, unsigned step);
 
+/* Transforms of real signals, at half the cost of the complex ones.
+ * The spectrum only holds the size / 2 + 1 bins from DC to Nyquist;
+ * the rest are their complex conjugates. */
+void fft_process_forward_real(fft_t *fft,
+      fft_complex_t *out, const float *in, unsigned step);
+
+void fft_process_inverse_real(fft_t *fft,
+      float *out, const fft_complex_t *in, unsigned step);
+
 
 #endif
 
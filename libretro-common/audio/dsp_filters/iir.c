@@ -28,6 +28,8 @@
 #include <libretro_dspfilter.h>
 #include <string/stdstring.h>
 
+#include "kernels/kernels.h"
+
 #define sqr(a) ((a) * (a))
 
 /* filter types */
@@ -49,14 +51,7 @@ enum IIRFilter
 
 struct iir_data
 {
-   float b0, b1, b2;
-   float a0, a1, a2;
-
-   struct
-   {
-      float xn1, xn2;
-      float yn1, yn2;
-   } l, r;
+   struct dsp_biquad biquad;
 };
 
 static void iir_free(void *data)
@@ -67,62 +62,26 @@ static void iir_free(void *data)
 static void iir_process(void *data, struct dspfilter_output *output,
       const struct dspfilter_input *input)
 {
-   unsigned i;
    struct iir_data *iir = (struct iir_data*)data;
-   float *out           = output->samples;
-
-   float b0             = iir->b0;
-   float b1             = iir->b1;
-   float b2             = iir->b2;
-   float a0             = iir->a0;
-   float a1             = iir->a1;
-   float a2             = iir->a2;
-
-   float xn1_l          = iir->l.xn1;
-   float xn2_l          = iir->l.xn2;
-   float yn1_l          = iir->l.yn1;
-   float yn2_l          = iir->l.yn2;
-
-   float xn1_r          = iir->r.xn1;
-   float xn2_r          = iir->r.xn2;
-   float yn1_r          = iir->r.yn1;
-   float yn2_r          = iir->r.yn2;
 
    output->samples      = input->samples;
    output->frames       = input->frames;
 
-   for (i = 0; i < input->frames; i++, out += 2)
-   {
-      float in_l = out[0];
-      float in_r = out[1];
-
-      float l    = (b0 * in_l + b1 * xn1_l + b2 * xn2_l - a1 * yn1_l - a2 * yn2_l) / a0;
-      float r    = (b0 * in_r + b1 * xn1_r + b2 * xn2_r - a1 * yn1_r - a2 * yn2_r) / a0;
-
-      xn2_l      = xn1_l;
-      xn1_l      = in_l;
-      yn2_l      = yn1_l;
-      yn1_l      = l;
-
-      xn2_r      = xn1_r;
-      xn1_r      = in_r;
-      yn2_r      = yn1_r;
-      yn1_r      = r;
+   dsp_biquad_process_c(&iir->biquad, output->samples, output->frames);
+}
 
-      out[0]     = l;
-      out[1]     = r;
-   }
+#ifdef DSP_KERNELS_SIMD
+static void iir_process_simd(void *data, struct dspfilter_output *output,
+      const struct dspfilter_input *input)
+{
+   struct iir_data *iir = (struct iir_data*)data;
 
-   iir->l.xn1 = xn1_l;
-   iir->l.xn2 = xn2_l;
-   iir->l.yn1 = yn1_l;
-   iir->l.yn2 = yn2_l;
+   output->samples      = input->samples;
+   output->frames       = input->frames;
 
-   iir->r.xn1 = xn1_r;
-   iir->r.xn2 = xn2_r;
-   iir->r.yn1 = yn1_r;
-   iir->r.yn2 = yn2_r;
+   dsp_biquad_process_simd(&iir->biquad, output->samples, output->frames);
 }
+#endif
 
 #define CHECK(x) if (string_is_equal(str, #x)) return x
 static enum IIRFilter str_to_type(const char *str)
@@ -158,7 +117,8 @@ static void make_poly_from_roots(
 }
 
 static void iir_filter_init(struct iir_data *iir,
-      float sample_rate, float freq, float qual, float gain, enum IIRFilter filter_type)
+      float sample_rate, float freq, float qual, float gain, enum IIRFilter filter_type,
+      unsigned stages)
 {
 	double omega = 2.0 * M_PI * freq / sample_rate;
    double cs    = cos(omega);
@@ -317,18 +277,15 @@ static void iir_filter_init(struct iir_data *iir,
          break;
    }
 
-   iir->b0 = b0;
-   iir->b1 = b1;
-   iir->b2 = b2;
-   iir->a0 = a0;
-   iir->a1 = a1;
-   iir->a2 = a2;
+   while (stages--)
+      dsp_biquad_set(&iir->biquad, stages, b0, b1, b2, a0, a1, a2);
 }
 
 static void *iir_init(const struct dspfilter_info *info,
       const struct dspfilter_config *config, void *userdata)
 {
    float freq, qual, gain;
+   int stages;
    enum IIRFilter filter  = LPF;
    char           *type   = NULL;
    struct iir_data *iir   = (struct iir_data*)calloc(1, sizeof(*iir));
@@ -338,13 +295,16 @@ static void *iir_init(const struct dspfilter_info *info,
    config->get_float(userdata, "frequency", &freq, 1024.0f);
    config->get_float(userdata, "quality", &qual, 0.707f);
    config->get_float(userdata, "gain", &gain, 0.0f);
+   config->get_int(userdata, "stages", &stages, 1);
 
    config->get_string(userdata, "type", &type, "LPF");
 
    filter = str_to_type(type);
    config->free(type);
 
-   iir_filter_init(iir, info->input_rate, freq, qual, gain, filter);
+   stages = MAX(1, MIN(stages, DSP_BIQUAD_MAX_SECTIONS));
+
+   iir_filter_init(iir, info->input_rate, freq, qual, gain, filter, stages);
    return iir;
 }
 
@@ -358,12 +318,28 @@ static const struct dspfilter_implementation iir_plug = {
    "iir",
 };
 
+#ifdef DSP_KERNELS_SIMD
+static const struct dspfilter_implementation iir_plug_simd = {
+   iir_init,
+   iir_process_simd,
+   iir_free,
+
+   DSPFILTER_API_VERSION,
+   "IIR",
+   "iir",
+};
+#endif
+
 #ifdef HAVE_FILTERS_BUILTIN
 #define dspfilter_get_implementation iir_dspfilter_get_implementation
 #endif
 
 const struct dspfilter_implementation *dspfilter_get_implementation(dspfilter_simd_mask_t mask)
 {
+#ifdef DSP_KERNELS_SIMD
+   if (mask & DSP_KERNELS_SIMD)
+      return &iir_plug_simd;
+#endif
    (void)mask;
    return &iir_plug;
 }
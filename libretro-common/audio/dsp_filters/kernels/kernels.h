@@ -0,0 +1,574 @@
+/* Copyright  (C) 2010-2017 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (kernels.h).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef RARCH_DSP_KERNELS_H__
+#define RARCH_DSP_KERNELS_H__
+
+/* Filter kernels shared by the DSP plugins. Samples are interleaved
+ * stereo throughout, filtered in place.
+ *
+ * Every kernel comes in a plain C version and, where the plugin is built
+ * for SSE or NEON, a SIMD version. Both do the same arithmetic in the
+ * same order, so they give the same output (short of NEON flushing
+ * denormals to zero on ARMv7). A plugin picks one from the SIMD mask
+ * it's handed in dspfilter_get_implementation(). */
+
+#include <stdint.h>
+#include <string.h>
+
+#include <retro_inline.h>
+#include <math/complex.h>
+#include <libretro_dspfilter.h>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#define DSP_KERNELS_SIMD DSPFILTER_SIMD_SSE
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define DSP_KERNELS_SIMD DSPFILTER_SIMD_NEON
+#endif
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+#define DSP_BIQUAD_MAX_SECTIONS 8
+#define DSP_FIR_MAX_TAPS        16
+
+/* A cascade of biquads, in direct form I. Both channels go through a
+ * section side by side, and each frame goes through every section
+ * before the next one is read. */
+struct dsp_biquad
+{
+   unsigned sections;
+
+   /* Normalised so that a0 is 1. */
+   struct
+   {
+      float b0, b1, b2;
+      float a1, a2;
+   } coeffs[DSP_BIQUAD_MAX_SECTIONS];
+
+   /* Last two frames into each section: L[n-1], R[n-1], L[n-2], R[n-2].
+    * What goes into a section is what came out of the one before, so
+    * the last entry holds the cascade's own output. */
+   float hist[DSP_BIQUAD_MAX_SECTIONS + 1][4];
+};
+
+/* A short FIR filter, y[n] = sum(coeffs[k] * x[n - k]). */
+struct dsp_fir
+{
+   unsigned taps;
+   float coeffs[DSP_FIR_MAX_TAPS];
+
+   /* The last taps - 1 input frames, oldest first. */
+   float hist[(DSP_FIR_MAX_TAPS - 1) * 2];
+};
+
+/**
+ * dsp_biquad_set:
+ * @bq                : biquad cascade
+ * @section           : which section to set
+ *
+ * Sets up a section from unnormalised coefficients,
+ * and grows the cascade to include it.
+ **/
+static INLINE void dsp_biquad_set(struct dsp_biquad *bq, unsigned section,
+      float b0, float b1, float b2, float a0, float a1, float a2)
+{
+   bq->coeffs[section].b0 = b0 / a0;
+   bq->coeffs[section].b1 = b1 / a0;
+   bq->coeffs[section].b2 = b2 / a0;
+   bq->coeffs[section].a1 = a1 / a0;
+   bq->coeffs[section].a2 = a2 / a0;
+
+   if (bq->sections <= section)
+      bq->sections = section + 1;
+}
+
+static INLINE void dsp_biquad_process_c(struct dsp_biquad *bq,
+      float *samples, unsigned frames)
+{
+   unsigned i, s;
+
+   for (i = 0; i < frames; i++, samples += 2)
+   {
+      float l = samples[0];
+      float r = samples[1];
+
+      for (s = 0; s < bq->sections; s++)
+      {
+         float *x  = bq->hist[s];
+         float *y  = bq->hist[s + 1];
+         float b0  = bq->coeffs[s].b0;
+         float b1  = bq->coeffs[s].b1;
+         float b2  = bq->coeffs[s].b2;
+         float a1  = bq->coeffs[s].a1;
+         float a2  = bq->coeffs[s].a2;
+         float out_l = b0 * l + b1 * x[0] + b2 * x[2] - a1 * y[0] - a2 * y[2];
+         float out_r = b0 * r + b1 * x[1] + b2 * x[3] - a1 * y[1] - a2 * y[3];
+
+         x[2] = x[0];
+         x[3] = x[1];
+         x[0] = l;
+         x[1] = r;
+
+         l    = out_l;
+         r    = out_r;
+      }
+
+      bq->hist[s][2] = bq->hist[s][0];
+      bq->hist[s][3] = bq->hist[s][1];
+      bq->hist[s][0] = l;
+      bq->hist[s][1] = r;
+
+      samples[0] = l;
+      samples[1] = r;
+   }
+}
+
+static INLINE float dsp_fir_frame_c(const struct dsp_fir *fir,
+      const float *samples, int frame, unsigned channel)
+{
+   unsigned k;
+   float out = 0.0f;
+
+   for (k = 0; k < fir->taps; k++)
+   {
+      int j         = frame - (int)k;
+      const float x = j >= 0 ? samples[j * 2 + channel] :
+         fir->hist[((int)fir->taps - 1 + j) * 2 + channel];
+
+      out = k ? out + fir->coeffs[k] * x : fir->coeffs[k] * x;
+   }
+
+   return out;
+}
+
+/* Frames are filtered from the last one back, so that every frame's
+ * input is still there when it's needed. The history for the next call
+ * has to be picked out before any of it is overwritten. */
+static INLINE void dsp_fir_save_history(const struct dsp_fir *fir,
+      const float *samples, unsigned frames, float *hist)
+{
+   int j;
+   int keep = (int)fir->taps - 1;
+
+   for (j = 0; j < keep; j++)
+   {
+      int src        = (int)frames - keep + j;
+      const float *x = src >= 0 ? samples + src * 2 :
+         fir->hist + (keep + src) * 2;
+
+      hist[j * 2 + 0] = x[0];
+      hist[j * 2 + 1] = x[1];
+   }
+}
+
+static INLINE void dsp_fir_process_c(struct dsp_fir *fir,
+      float *samples, unsigned frames)
+{
+   int i;
+   float hist[(DSP_FIR_MAX_TAPS - 1) * 2];
+
+   int first = (int)fir->taps - 1;
+
+   dsp_fir_save_history(fir, samples, frames, hist);
+
+   for (i = (int)frames - 1; i >= first; i--)
+   {
+      unsigned k;
+      float *out = samples + i * 2;
+      float l    = fir->coeffs[0] * out[0];
+      float r    = fir->coeffs[0] * out[1];
+
+      for (k = 1; k < fir->taps; k++)
+      {
+         l += fir->coeffs[k] * out[-(int)k * 2 + 0];
+         r += fir->coeffs[k] * out[-(int)k * 2 + 1];
+      }
+
+      out[0] = l;
+      out[1] = r;
+   }
+
+   /* The first few frames reach back into the history. */
+   for (; i >= 0; i--)
+   {
+      float l = dsp_fir_frame_c(fir, samples, i, 0);
+      float r = dsp_fir_frame_c(fir, samples, i, 1);
+
+      samples[i * 2 + 0] = l;
+      samples[i * 2 + 1] = r;
+   }
+
+   memcpy(fir->hist, hist, (fir->taps - 1) * 2 * sizeof(float));
+}
+
+static INLINE void dsp_complex_mul_c(fft_complex_t *out,
+      const fft_complex_t *a, const fft_complex_t *b, unsigned n)
+{
+   unsigned i;
+   for (i = 0; i < n; i++)
+      out[i] = fft_complex_mul(a[i], b[i]);
+}
+
+/* Multiply-accumulate of spectra kept in split form: n real parts,
+ * then n imaginary parts. out += a * b. */
+static INLINE void dsp_split_complex_mac_c(float *out,
+      const float *a, const float *b, unsigned n)
+{
+   unsigned i;
+   for (i = 0; i < n; i++)
+   {
+      float re = a[i] * b[i] - a[n + i] * b[n + i];
+      float im = a[n + i] * b[i] + a[i] * b[n + i];
+      out[i]     += re;
+      out[n + i] += im;
+   }
+}
+
+#if defined(DSP_KERNELS_SIMD) && defined(__SSE__)
+static INLINE void dsp_biquad_process_simd(struct dsp_biquad *bq,
+      float *samples, unsigned frames)
+{
+   unsigned i, s;
+   unsigned sections = bq->sections;
+   __m128 b0[DSP_BIQUAD_MAX_SECTIONS], b1[DSP_BIQUAD_MAX_SECTIONS];
+   __m128 b2[DSP_BIQUAD_MAX_SECTIONS], a1[DSP_BIQUAD_MAX_SECTIONS];
+   __m128 a2[DSP_BIQUAD_MAX_SECTIONS];
+   __m128 n1[DSP_BIQUAD_MAX_SECTIONS + 1], n2[DSP_BIQUAD_MAX_SECTIONS + 1];
+
+   for (s = 0; s < sections; s++)
+   {
+      b0[s] = _mm_set1_ps(bq->coeffs[s].b0);
+      b1[s] = _mm_set1_ps(bq->coeffs[s].b1);
+      b2[s] = _mm_set1_ps(bq->coeffs[s].b2);
+      a1[s] = _mm_set1_ps(bq->coeffs[s].a1);
+      a2[s] = _mm_set1_ps(bq->coeffs[s].a2);
+   }
+
+   for (s = 0; s <= sections; s++)
+   {
+      n1[s] = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)&bq->hist[s][0]);
+      n2[s] = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)&bq->hist[s][2]);
+   }
+
+   /* Left and right in the two low lanes. */
+   for (i = 0; i < frames; i++, samples += 2)
+   {
+      __m128 x = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)samples);
+
+      for (s = 0; s < sections; s++)
+      {
+         __m128 y = _mm_mul_ps(b0[s], x);
+         y        = _mm_add_ps(y, _mm_mul_ps(b1[s], n1[s]));
+         y        = _mm_add_ps(y, _mm_mul_ps(b2[s], n2[s]));
+         y        = _mm_sub_ps(y, _mm_mul_ps(a1[s], n1[s + 1]));
+         y        = _mm_sub_ps(y, _mm_mul_ps(a2[s], n2[s + 1]));
+
+         n2[s]    = n1[s];
+         n1[s]    = x;
+         x        = y;
+      }
+
+      n2[sections] = n1[sections];
+      n1[sections] = x;
+
+      _mm_storel_pi((__m64*)samples, x);
+   }
+
+   for (s = 0; s <= sections; s++)
+   {
+      _mm_storel_pi((__m64*)&bq->hist[s][0], n1[s]);
+      _mm_storel_pi((__m64*)&bq->hist[s][2], n2[s]);
+   }
+}
+
+static INLINE void dsp_fir_process_simd(struct dsp_fir *fir,
+      float *samples, unsigned frames)
+{
+   unsigned k;
+   float hist[(DSP_FIR_MAX_TAPS - 1) * 2];
+   int i     = (int)frames - 1;
+   int first = (int)fir->taps - 1;
+
+   dsp_fir_save_history(fir, samples, frames, hist);
+
+   if (i >= first)
+   {
+#if defined(__AVX__)
+      /* Four frames at a time */
+      const int width = 4;
+      __m256 h[DSP_FIR_MAX_TAPS];
+
+      for (k = 0; k < fir->taps; k++)
+         h[k] = _mm256_set1_ps(fir->coeffs[k]);
+#else
+      /* Two frames at a time */
+      const int width = 2;
+      __m128 h[DSP_FIR_MAX_TAPS];
+
+      for (k = 0; k < fir->taps; k++)
+         h[k] = _mm_set1_ps(fir->coeffs[k]);
+#endif
+
+      /* The odd ones out at the end go first. */
+      for (; (i - first + 1) % width; i--)
+      {
+         float l = dsp_fir_frame_c(fir, samples, i, 0);
+         float r = dsp_fir_frame_c(fir, samples, i, 1);
+         samples[i * 2 + 0] = l;
+         samples[i * 2 + 1] = r;
+      }
+
+      for (; i >= first + width - 1; i -= width)
+      {
+         float *out = samples + (i - width + 1) * 2;
+#if defined(__AVX__)
+         __m256 y   = _mm256_mul_ps(h[0], _mm256_loadu_ps(out));
+
+         for (k = 1; k < fir->taps; k++)
+            y = _mm256_add_ps(y,
+                  _mm256_mul_ps(h[k], _mm256_loadu_ps(out - k * 2)));
+
+         _mm256_storeu_ps(out, y);
+#else
+         __m128 y   = _mm_mul_ps(h[0], _mm_loadu_ps(out));
+
+         for (k = 1; k < fir->taps; k++)
+            y = _mm_add_ps(y, _mm_mul_ps(h[k], _mm_loadu_ps(out - k * 2)));
+
+         _mm_storeu_ps(out, y);
+#endif
+      }
+   }
+
+   /* The first few frames reach back into the history. */
+   for (; i >= 0; i--)
+   {
+      float l = dsp_fir_frame_c(fir, samples, i, 0);
+      float r = dsp_fir_frame_c(fir, samples, i, 1);
+      samples[i * 2 + 0] = l;
+      samples[i * 2 + 1] = r;
+   }
+
+   memcpy(fir->hist, hist, (fir->taps - 1) * 2 * sizeof(float));
+}
+
+static INLINE void dsp_complex_mul_simd(fft_complex_t *out,
+      const fft_complex_t *a, const fft_complex_t *b, unsigned n)
+{
+   unsigned i = 0;
+   /* Flips the sign of the real parts */
+   const __m128 sign = _mm_set_ps(0.0f, -0.0f, 0.0f, -0.0f);
+
+   for (; i + 2 <= n; i += 2)
+   {
+      __m128 va  = _mm_loadu_ps(&a[i].real);
+      __m128 vb  = _mm_loadu_ps(&b[i].real);
+      /* re re, im im */
+      __m128 bre = _mm_shuffle_ps(vb, vb, _MM_SHUFFLE(2, 2, 0, 0));
+      __m128 bim = _mm_shuffle_ps(vb, vb, _MM_SHUFFLE(3, 3, 1, 1));
+      /* im re */
+      __m128 vas = _mm_shuffle_ps(va, va, _MM_SHUFFLE(2, 3, 0, 1));
+      __m128 t1  = _mm_mul_ps(va, bre);
+      __m128 t2  = _mm_xor_ps(_mm_mul_ps(vas, bim), sign);
+
+      _mm_storeu_ps(&out[i].real, _mm_add_ps(t1, t2));
+   }
+
+   for (; i < n; i++)
+      out[i] = fft_complex_mul(a[i], b[i]);
+}
+
+static INLINE void dsp_split_complex_mac_simd(float *out,
+      const float *a, const float *b, unsigned n)
+{
+   unsigned i = 0;
+
+   for (; i + 4 <= n; i += 4)
+   {
+      __m128 are = _mm_loadu_ps(a + i);
+      __m128 aim = _mm_loadu_ps(a + n + i);
+      __m128 bre = _mm_loadu_ps(b + i);
+      __m128 bim = _mm_loadu_ps(b + n + i);
+      __m128 re  = _mm_sub_ps(_mm_mul_ps(are, bre), _mm_mul_ps(aim, bim));
+      __m128 im  = _mm_add_ps(_mm_mul_ps(aim, bre), _mm_mul_ps(are, bim));
+
+      _mm_storeu_ps(out + i,     _mm_add_ps(_mm_loadu_ps(out + i), re));
+      _mm_storeu_ps(out + n + i, _mm_add_ps(_mm_loadu_ps(out + n + i), im));
+   }
+
+   for (; i < n; i++)
+   {
+      float re = a[i] * b[i] - a[n + i] * b[n + i];
+      float im = a[n + i] * b[i] + a[i] * b[n + i];
+      out[i]     += re;
+      out[n + i] += im;
+   }
+}
+#elif defined(DSP_KERNELS_SIMD)
+static INLINE void dsp_biquad_process_simd(struct dsp_biquad *bq,
+      float *samples, unsigned frames)
+{
+   unsigned i, s;
+   unsigned sections = bq->sections;
+   float32x2_t n1[DSP_BIQUAD_MAX_SECTIONS + 1], n2[DSP_BIQUAD_MAX_SECTIONS + 1];
+
+   for (s = 0; s <= sections; s++)
+   {
+      n1[s] = vld1_f32(&bq->hist[s][0]);
+      n2[s] = vld1_f32(&bq->hist[s][2]);
+   }
+
+   /* Left and right in the two lanes. Separate multiplies and adds,
+    * since a fused multiply-add would round differently from C. */
+   for (i = 0; i < frames; i++, samples += 2)
+   {
+      float32x2_t x = vld1_f32(samples);
+
+      for (s = 0; s < sections; s++)
+      {
+         float32x2_t y = vmul_n_f32(x, bq->coeffs[s].b0);
+         y             = vadd_f32(y, vmul_n_f32(n1[s], bq->coeffs[s].b1));
+         y             = vadd_f32(y, vmul_n_f32(n2[s], bq->coeffs[s].b2));
+         y             = vsub_f32(y, vmul_n_f32(n1[s + 1], bq->coeffs[s].a1));
+         y             = vsub_f32(y, vmul_n_f32(n2[s + 1], bq->coeffs[s].a2));
+
+         n2[s]         = n1[s];
+         n1[s]         = x;
+         x             = y;
+      }
+
+      n2[sections] = n1[sections];
+      n1[sections] = x;
+
+      vst1_f32(samples, x);
+   }
+
+   for (s = 0; s <= sections; s++)
+   {
+      vst1_f32(&bq->hist[s][0], n1[s]);
+      vst1_f32(&bq->hist[s][2], n2[s]);
+   }
+}
+
+static INLINE void dsp_fir_process_simd(struct dsp_fir *fir,
+      float *samples, unsigned frames)
+{
+   unsigned k;
+   float hist[(DSP_FIR_MAX_TAPS - 1) * 2];
+   int i     = (int)frames - 1;
+   int first = (int)fir->taps - 1;
+
+   dsp_fir_save_history(fir, samples, frames, hist);
+
+   if (i >= first)
+   {
+      /* The odd one out at the end goes first, then two frames at a time. */
+      if ((i - first + 1) & 1)
+      {
+         float l = dsp_fir_frame_c(fir, samples, i, 0);
+         float r = dsp_fir_frame_c(fir, samples, i, 1);
+         samples[i * 2 + 0] = l;
+         samples[i * 2 + 1] = r;
+         i--;
+      }
+
+      for (; i >= first + 1; i -= 2)
+      {
+         float *out    = samples + (i - 1) * 2;
+         float32x4_t y = vmulq_n_f32(vld1q_f32(out), fir->coeffs[0]);
+
+         for (k = 1; k < fir->taps; k++)
+            y = vaddq_f32(y, vmulq_n_f32(vld1q_f32(out - k * 2),
+                     fir->coeffs[k]));
+
+         vst1q_f32(out, y);
+      }
+   }
+
+   /* The first few frames reach back into the history. */
+   for (; i >= 0; i--)
+   {
+      float l = dsp_fir_frame_c(fir, samples, i, 0);
+      float r = dsp_fir_frame_c(fir, samples, i, 1);
+      samples[i * 2 + 0] = l;
+      samples[i * 2 + 1] = r;
+   }
+
+   memcpy(fir->hist, hist, (fir->taps - 1) * 2 * sizeof(float));
+}
+
+static INLINE void dsp_complex_mul_simd(fft_complex_t *out,
+      const fft_complex_t *a, const fft_complex_t *b, unsigned n)
+{
+   unsigned i = 0;
+
+   for (; i + 4 <= n; i += 4)
+   {
+      float32x4x2_t va = vld2q_f32(&a[i].real);
+      float32x4x2_t vb = vld2q_f32(&b[i].real);
+      float32x4x2_t res;
+
+      res.val[0] = vsubq_f32(vmulq_f32(va.val[0], vb.val[0]),
+            vmulq_f32(va.val[1], vb.val[1]));
+      res.val[1] = vaddq_f32(vmulq_f32(va.val[1], vb.val[0]),
+            vmulq_f32(va.val[0], vb.val[1]));
+
+      vst2q_f32(&out[i].real, res);
+   }
+
+   for (; i < n; i++)
+      out[i] = fft_complex_mul(a[i], b[i]);
+}
+
+static INLINE void dsp_split_complex_mac_simd(float *out,
+      const float *a, const float *b, unsigned n)
+{
+   unsigned i = 0;
+
+   for (; i + 4 <= n; i += 4)
+   {
+      float32x4_t are = vld1q_f32(a + i);
+      float32x4_t aim = vld1q_f32(a + n + i);
+      float32x4_t bre = vld1q_f32(b + i);
+      float32x4_t bim = vld1q_f32(b + n + i);
+      float32x4_t re  = vsubq_f32(vmulq_f32(are, bre), vmulq_f32(aim, bim));
+      float32x4_t im  = vaddq_f32(vmulq_f32(aim, bre), vmulq_f32(are, bim));
+
+      vst1q_f32(out + i,     vaddq_f32(vld1q_f32(out + i), re));
+      vst1q_f32(out + n + i, vaddq_f32(vld1q_f32(out + n + i), im));
+   }
+
+   for (; i < n; i++)
+   {
+      float re = a[i] * b[i] - a[n + i] * b[n + i];
+      float im = a[n + i] * b[i] + a[i] * b[n + i];
+      out[i]     += re;
+      out[n + i] += im;
+   }
+}
+#endif
+
+#endif
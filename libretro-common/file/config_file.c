@@ -42,21 +42,36 @@
 #include <compat/msvc.h>
 #include <file/config_file.h>
 #include <file/file_path.h>
-#include <lists/string_list.h>
 #include <string/stdstring.h>
 #include <streams/file_stream.h>
 
 #define MAX_INCLUDE_DEPTH 16
 
+/* Allocations of at least this size get a block of their own */
+#define CONFIG_ARENA_BLOCK_SIZE 4096
+
 struct config_entry_list
 {
    /* If we got this from an #include,
     * do not allow overwrite. */
    bool readonly;
 
+   uint32_t hash;
    char *key;
    char *value;
    struct config_entry_list *next;
+   /* Next in the same index bucket */
+   struct config_entry_list *hash_next;
+};
+
+/* Entries and their strings are carved out of a list of
+ * blocks owned by the config file. Nothing in there is
+ * freed on its own, the blocks go away in config_file_free. */
+struct config_arena
+{
+   struct config_arena *next;
+   size_t used;
+   size_t size;
 };
 
 struct config_include_list
@@ -68,6 +83,222 @@ struct config_include_list
 static config_file_t *config_file_new_internal(
       const char *path, unsigned depth);
 
+static void *config_arena_alloc(config_file_t *conf, size_t size)
+{
+   char *ptr                  = NULL;
+   struct config_arena *block = conf->arena;
+
+   size = (size + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+
+   if (size >= CONFIG_ARENA_BLOCK_SIZE / 2)
+   {
+      /* Keep filling the current block after this one */
+      block = (struct config_arena*)malloc(sizeof(*block) + size);
+      if (!block)
+         return NULL;
+
+      block->used = size;
+      block->size = size;
+
+      if (conf->arena)
+      {
+         block->next       = conf->arena->next;
+         conf->arena->next = block;
+      }
+      else
+      {
+         block->next       = NULL;
+         conf->arena       = block;
+      }
+
+      return block + 1;
+   }
+
+   if (!block || block->size - block->used < size)
+   {
+      block = (struct config_arena*)malloc(
+            sizeof(*block) + CONFIG_ARENA_BLOCK_SIZE);
+      if (!block)
+         return NULL;
+
+      block->next = conf->arena;
+      block->used = 0;
+      block->size = CONFIG_ARENA_BLOCK_SIZE;
+      conf->arena = block;
+   }
+
+   ptr          = (char*)(block + 1) + block->used;
+   block->used += size;
+
+   return ptr;
+}
+
+static char *config_arena_strdup(config_file_t *conf, const char *str)
+{
+   size_t len = strlen(str) + 1;
+   char  *dst = (char*)config_arena_alloc(conf, len);
+
+   if (dst)
+      memcpy(dst, str, len);
+   return dst;
+}
+
+/* Hands the blocks of 'src' over to 'dst' */
+static void config_arena_move(config_file_t *dst, config_file_t *src)
+{
+   struct config_arena *last = src->arena;
+
+   if (!last)
+      return;
+
+   while (last->next)
+      last = last->next;
+
+   if (dst->arena)
+   {
+      last->next       = dst->arena->next;
+      dst->arena->next = src->arena;
+   }
+   else
+      dst->arena       = src->arena;
+
+   src->arena          = NULL;
+}
+
+static uint32_t config_hash(const char *key)
+{
+   uint32_t hash = 5381;
+
+   while (*key)
+      hash = (hash << 5) + hash + (uint8_t)*key++;
+
+   return hash;
+}
+
+/* The index holds the first entry of every key in list
+ * order, which is the one the getters have to return.
+ * Without an index (out of memory) the list is searched. */
+static struct config_entry_list *config_get_entry(
+      const config_file_t *conf, const char *key)
+{
+   uint32_t hash;
+   struct config_entry_list *entry = NULL;
+
+   if (!key)
+      return NULL;
+
+   hash = config_hash(key);
+
+   if (!conf->index)
+   {
+      for (entry = conf->entries; entry; entry = entry->next)
+         if (entry->hash == hash && string_is_equal(key, entry->key))
+            return entry;
+      return NULL;
+   }
+
+   for (entry = conf->index[hash & conf->index_mask];
+         entry; entry = entry->hash_next)
+      if (entry->hash == hash && string_is_equal(key, entry->key))
+         return entry;
+
+   return NULL;
+}
+
+static void config_index_insert(config_file_t *conf,
+      struct config_entry_list *entry)
+{
+   struct config_entry_list **bucket = NULL;
+
+   if (config_get_entry(conf, entry->key))
+      return;
+
+   bucket           = &conf->index[entry->hash & conf->index_mask];
+   entry->hash_next = *bucket;
+   *bucket          = entry;
+   conf->index_count++;
+}
+
+/* Reindexes the whole list, into 'buckets' buckets */
+static bool config_index_rebuild(config_file_t *conf, size_t buckets)
+{
+   struct config_entry_list *entry = NULL;
+
+   if (buckets != conf->index_mask + 1 || !conf->index)
+   {
+      struct config_entry_list **index = (struct config_entry_list**)
+         calloc(buckets, sizeof(*index));
+
+      if (!index)
+         return false;
+
+      free(conf->index);
+      conf->index      = index;
+      conf->index_mask = buckets - 1;
+   }
+   else
+      memset(conf->index, 0, buckets * sizeof(*conf->index));
+
+   conf->index_count = 0;
+
+   for (entry = conf->entries; entry; entry = entry->next)
+      config_index_insert(conf, entry);
+
+   return true;
+}
+
+/* Indexes an entry that was just appended to the list */
+static void config_index_add(config_file_t *conf,
+      struct config_entry_list *entry)
+{
+   if (!conf->index || conf->index_count >= conf->index_mask + 1)
+   {
+      size_t buckets = conf->index ? (conf->index_mask + 1) * 2 : 16;
+
+      if (config_index_rebuild(conf, buckets))
+         return;
+      if (!conf->index)
+         return;
+   }
+
+   config_index_insert(conf, entry);
+}
+
+static void config_index_remove(config_file_t *conf,
+      struct config_entry_list *entry)
+{
+   struct config_entry_list **link = NULL;
+
+   if (!conf->index)
+      return;
+
+   for (link = &conf->index[entry->hash & conf->index_mask];
+         *link; link = &(*link)->hash_next)
+   {
+      if (*link != entry)
+         continue;
+
+      *link = entry->hash_next;
+      conf->index_count--;
+      break;
+   }
+}
+
+static void config_append_entry(config_file_t *conf,
+      struct config_entry_list *entry)
+{
+   entry->next = NULL;
+
+   if (conf->entries)
+      conf->tail->next = entry;
+   else
+      conf->entries    = entry;
+
+   conf->tail          = entry;
+
+   config_index_add(conf, entry);
+}
+
 static char *strip_comment(char *str)
 {
    /* Remove everything after comment.
@@ -140,7 +371,7 @@ static char *extract_value(char *line, bool is_value)
       tok = strtok_r(line, " \n\t\f\r\v", &save);
 
    if (tok && *tok)
-      return strdup(tok);
+      return tok;
    return NULL;
 }
 
@@ -148,45 +379,21 @@ static char *extract_value(char *line, bool is_value)
 static void add_child_list(config_file_t *parent, config_file_t *child)
 {
    struct config_entry_list *list = child->entries;
-   if (parent->entries)
-   {
-      struct config_entry_list *head = parent->entries;
-      while (head->next)
-         head = head->next;
 
-      /* set list readonly */
-      while (list)
-      {
-         list->readonly = true;
-         list           = list->next;
-      }
-      head->next        = child->entries;
-   }
-   else
+   /* set list readonly */
+   while (list)
    {
-      /* set list readonly */
-      while (list)
-      {
-         list->readonly = true;
-         list           = list->next;
-      }
-      parent->entries   = child->entries;
+      struct config_entry_list *next = list->next;
+
+      list->readonly = true;
+      config_append_entry(parent, list);
+      list           = next;
    }
 
    child->entries = NULL;
+   child->tail    = NULL;
 
-   /* Rebase tail. */
-   if (parent->entries)
-   {
-      struct config_entry_list *head =
-         (struct config_entry_list*)parent->entries;
-
-      while (head->next)
-         head = head->next;
-      parent->tail = head;
-   }
-   else
-      parent->tail = NULL;
+   config_arena_move(parent, child);
 }
 
 static void add_sub_conf(config_file_t *conf, char *path)
@@ -245,19 +452,14 @@ static void add_sub_conf(config_file_t *conf, char *path)
    config_file_free(sub_conf);
 }
 
+/* Splits a line into its key and value in place,
+ * they end up pointing into 'line'. */
 static bool parse_line(config_file_t *conf,
       struct config_entry_list *list, char *line)
 {
-   char *comment   = NULL;
-   char *key_tmp   = NULL;
-   size_t cur_size = 8;
-   size_t idx      = 0;
-   char *key       = (char*)malloc(9);
-
-   if (!key)
-      return false;
-
-   comment = strip_comment(line);
+   char *key     = NULL;
+   char *key_end = NULL;
+   char *comment = strip_comment(line);
 
    /* Starting line with #include includes config files. */
    if (comment == line)
@@ -274,9 +476,8 @@ static bool parse_line(config_file_t *conf,
                fprintf(stderr, "!!! #include depth exceeded for config. Might be a cycle.\n");
             else
                add_sub_conf(conf, path);
-            free(path);
          }
-         goto error;
+         return false;
       }
    }
 
@@ -284,53 +485,73 @@ static bool parse_line(config_file_t *conf,
    while (isspace((int)*line))
       line++;
 
+   key = line;
    while (isgraph((int)*line))
-   {
-      if (idx == cur_size)
-      {
-         cur_size *= 2;
-         key_tmp = (char*)realloc(key, cur_size + 1);
+      line++;
+   key_end     = line;
 
-         if (!key_tmp)
-            goto error;
+   list->value = extract_value(line, true);
 
-         key = key_tmp;
-      }
+   if (!list->value)
+      return false;
 
-      key[idx++] = *line++;
-   }
-   key[idx]      = '\0';
-   list->key     = key;
+   /* Only whitespace was there, the value starts after it */
+   *key_end    = '\0';
+   list->key   = key;
+   list->hash  = config_hash(key);
 
-   list->value   = extract_value(line, true);
+   return true;
+}
 
-   if (!list->value)
+/* Parses 'len' bytes of NUL terminated text in place.
+ * 'buf' has to live as long as the config file. */
+static bool config_file_parse(config_file_t *conf, char *buf, size_t len)
+{
+   char *end = buf + len;
+
+   while (buf < end)
    {
-      list->key = NULL;
-      goto error;
+      struct config_entry_list tmp;
+      struct config_entry_list *list = NULL;
+      char *line                     = buf;
+      char *eol                      = (char*)memchr(buf, '\n', end - buf);
+
+      if (eol)
+      {
+         *eol = '\0';
+         buf  = eol + 1;
+      }
+      else
+         buf  = end;
+
+      if (!*line || !parse_line(conf, &tmp, line))
+         continue;
+
+      list = (struct config_entry_list*)config_arena_alloc(conf, sizeof(*list));
+      if (!list)
+         return false;
+
+      list->readonly = false;
+      list->hash     = tmp.hash;
+      list->key      = tmp.key;
+      list->value    = tmp.value;
+
+      config_append_entry(conf, list);
    }
 
    return true;
-
-error:
-   free(key);
-   return false;
 }
 
 static config_file_t *config_file_new_internal(
       const char *path, unsigned depth)
 {
-   RFILE              *file = NULL;
-   struct config_file *conf = (struct config_file*)malloc(sizeof(*conf));
+   int64_t size              = 0;
+   char *buf                 = NULL;
+   RFILE              *file  = NULL;
+   struct config_file *conf  = (struct config_file*)calloc(1, sizeof(*conf));
    if (!conf)
       return NULL;
 
-   conf->path          = NULL;
-   conf->entries       = NULL;
-   conf->tail          = NULL;
-   conf->includes      = NULL;
-   conf->include_depth = 0;
-
    if (!path || !*path)
       return conf;
 
@@ -347,58 +568,35 @@ static config_file_t *config_file_new_internal(
          RETRO_VFS_FILE_ACCESS_HINT_NONE);
 
    if (!file)
-   {
-      free(conf->path);
       goto error;
-   }
-
-   while (!filestream_eof(file))
-   {
-      char *line                     = NULL;
-      struct config_entry_list *list = (struct config_entry_list*)malloc(sizeof(*list));
-
-      if (!list)
-      {
-         config_file_free(conf);
-         filestream_close(file);
-         return NULL;
-      }
-
-      list->readonly  = false;
-      list->key       = NULL;
-      list->value     = NULL;
-      list->next      = NULL;
-
-      line            = filestream_getline(file);
-
-      if (!line)
-      {
-         free(list);
-         continue;
-      }
 
-      if (*line && parse_line(conf, list, line))
-      {
-         if (conf->entries)
-            conf->tail->next = list;
-         else
-            conf->entries = list;
+   /* The whole file goes into the arena in one go,
+    * the entries point into it. */
+   size = filestream_get_size(file);
+   if (size < 0 || (uint64_t)size >= SIZE_MAX)
+      goto error;
 
-         conf->tail = list;
-      }
+   buf  = (char*)config_arena_alloc(conf, (size_t)size + 1);
+   if (!buf)
+      goto error;
 
-      free(line);
+   if (size && filestream_read(file, buf, size) != size)
+      goto error;
 
-      if (list != conf->tail)
-         free(list);
-   }
+   buf[size] = '\0';
 
    filestream_close(file);
+   file = NULL;
+
+   if (!config_file_parse(conf, buf, (size_t)size))
+      goto error;
 
    return conf;
 
 error:
-   free(conf);
+   if (file)
+      filestream_close(file);
+   config_file_free(conf);
 
    return NULL;
 }
@@ -406,27 +604,14 @@ error:
 void config_file_free(config_file_t *conf)
 {
    struct config_include_list *inc_tmp = NULL;
-   struct config_entry_list *tmp       = NULL;
    if (!conf)
       return;
 
-   tmp = conf->entries;
-   while (tmp)
+   while (conf->arena)
    {
-      struct config_entry_list *hold = NULL;
-      if (tmp->key)
-         free(tmp->key);
-      if (tmp->value)
-         free(tmp->value);
-
-      tmp->value = NULL;
-      tmp->key   = NULL;
-
-      hold       = tmp;
-      tmp        = tmp->next;
-
-      if (hold)
-         free(hold);
+      struct config_arena *next = conf->arena->next;
+      free(conf->arena);
+      conf->arena = next;
    }
 
    inc_tmp = (struct config_include_list*)conf->includes;
@@ -439,6 +624,8 @@ void config_file_free(config_file_t *conf)
       free(hold);
    }
 
+   free(conf->index);
+
    if (conf->path)
       free(conf->path);
    free(conf);
@@ -454,7 +641,20 @@ bool config_append_file(config_file_t *conf, const char *path)
    {
       new_conf->tail->next = conf->entries;
       conf->entries        = new_conf->entries; /* Pilfer. */
+      if (!conf->tail)
+         conf->tail        = new_conf->tail;
       new_conf->entries    = NULL;
+      new_conf->tail       = NULL;
+
+      config_arena_move(conf, new_conf);
+
+      /* The new entries come first now and take over the keys */
+      if (!config_index_rebuild(conf, conf->index
+               ? conf->index_mask + 1 : 16))
+      {
+         free(conf->index);
+         conf->index = NULL;
+      }
    }
 
    config_file_free(new_conf);
@@ -464,61 +664,32 @@ bool config_append_file(config_file_t *conf, const char *path)
 
 config_file_t *config_file_new_from_string(const char *from_string)
 {
-   size_t i;
-   struct string_list *lines = NULL;
-   struct config_file *conf = (struct config_file*)malloc(sizeof(*conf));
+   char *buf                = NULL;
+   size_t len               = 0;
+   struct config_file *conf = (struct config_file*)calloc(1, sizeof(*conf));
    if (!conf)
       return NULL;
 
    if (!from_string)
       return conf;
 
-   conf->path          = NULL;
-   conf->entries       = NULL;
-   conf->tail          = NULL;
-   conf->includes      = NULL;
-   conf->include_depth = 0;
-
-   lines = string_split(from_string, "\n");
-   if (!lines)
-      return conf;
+   len = strlen(from_string);
+   buf = (char*)config_arena_alloc(conf, len + 1);
 
-   for (i = 0; i < lines->size; i++)
+   if (!buf)
    {
-      struct config_entry_list *list = (struct config_entry_list*)malloc(sizeof(*list));
-      char                    *line  = lines->elems[i].data;
-
-      if (!list)
-      {
-         string_list_free(lines);
-         config_file_free(conf);
-         return NULL;
-      }
-
-      list->readonly  = false;
-      list->key       = NULL;
-      list->value     = NULL;
-      list->next      = NULL;
+      config_file_free(conf);
+      return NULL;
+   }
 
-      if (line && conf)
-      {
-         if (*line && parse_line(conf, list, line))
-         {
-            if (conf->entries)
-               conf->tail->next = list;
-            else
-               conf->entries = list;
+   memcpy(buf, from_string, len + 1);
 
-            conf->tail = list;
-         }
-      }
-
-      if (list != conf->tail)
-         free(list);
+   if (!config_file_parse(conf, buf, len))
+   {
+      config_file_free(conf);
+      return NULL;
    }
 
-   string_list_free(lines);
-
    return conf;
 }
 
@@ -527,29 +698,9 @@ config_file_t *config_file_new(const char *path)
    return config_file_new_internal(path, 0);
 }
 
-static struct config_entry_list *config_get_entry(const config_file_t *conf,
-      const char *key, struct config_entry_list **prev)
-{
-   struct config_entry_list *entry    = NULL;
-   struct config_entry_list *previous = prev ? *prev : NULL;
-
-   for (entry = conf->entries; entry; entry = entry->next)
-   {
-      if (string_is_equal(key, entry->key))
-         return entry;
-
-      previous = entry;
-   }
-
-   if (prev)
-      *prev = previous;
-
-   return NULL;
-}
-
 bool config_get_double(config_file_t *conf, const char *key, double *in)
 {
-   const struct config_entry_list *entry = config_get_entry(conf, key, NULL);
+   const struct config_entry_list *entry = config_get_entry(conf, key);
 
    if (entry)
    {
@@ -562,7 +713,7 @@ bool config_get_double(config_file_t *conf, const char *key, double *in)
 
 bool config_get_float(config_file_t *conf, const char *key, float *in)
 {
-   const struct config_entry_list *entry = config_get_entry(conf, key, NULL);
+   const struct config_entry_list *entry = config_get_entry(conf, key);
 
    if (entry)
    {
@@ -575,7 +726,7 @@ bool config_get_float(config_file_t *conf, const char *key, float *in)
 
 bool config_get_int(config_file_t *conf, const char *key, int *in)
 {
-   const struct config_entry_list *entry = config_get_entry(conf, key, NULL);
+   const struct config_entry_list *entry = config_get_entry(conf, key);
    errno = 0;
 
    if (entry)
@@ -595,7 +746,7 @@ bool config_get_int(config_file_t *conf, const char *key, int *in)
 #if defined(__STDC_VERSION__) && __STDC_VERSION__>=199901L
 bool config_get_uint64(config_file_t *conf, const char *key, uint64_t *in)
 {
-   const struct config_entry_list *entry = config_get_entry(conf, key, NULL);
+   const struct config_entry_list *entry = config_get_entry(conf, key);
    errno = 0;
 
    if (entry)
@@ -614,7 +765,7 @@ bool config_get_uint64(config_file_t *conf, const char *key, uint64_t *in)
 
 bool config_get_uint(config_file_t *conf, const char *key, unsigned *in)
 {
-   const struct config_entry_list *entry = config_get_entry(conf, key, NULL);
+   const struct config_entry_list *entry = config_get_entry(conf, key);
    errno = 0;
 
    if (entry)
@@ -633,7 +784,7 @@ bool config_get_uint(config_file_t *conf, const char *key, unsigned *in)
 
 bool config_get_hex(config_file_t *conf, const char *key, unsigned *in)
 {
-   const struct config_entry_list *entry = config_get_entry(conf, key, NULL);
+   const struct config_entry_list *entry = config_get_entry(conf, key);
    errno = 0;
 
    if (entry)
@@ -652,7 +803,7 @@ bool config_get_hex(config_file_t *conf, const char *key, unsigned *in)
 
 bool config_get_char(config_file_t *conf, const char *key, char *in)
 {
-   const struct config_entry_list *entry = config_get_entry(conf, key, NULL);
+   const struct config_entry_list *entry = config_get_entry(conf, key);
 
    if (entry)
    {
@@ -668,7 +819,7 @@ bool config_get_char(config_file_t *conf, const char *key, char *in)
 
 bool config_get_string(config_file_t *conf, const char *key, char **str)
 {
-   const struct config_entry_list *entry = config_get_entry(conf, key, NULL);
+   const struct config_entry_list *entry = config_get_entry(conf, key);
 
    if (entry)
    {
@@ -689,7 +840,7 @@ bool config_get_config_path(config_file_t *conf, char *s, size_t len)
 bool config_get_array(config_file_t *conf, const char *key,
       char *buf, size_t size)
 {
-   const struct config_entry_list *entry = config_get_entry(conf, key, NULL);
+   const struct config_entry_list *entry = config_get_entry(conf, key);
 
    if (entry)
       return strlcpy(buf, entry->value, size) < size;
@@ -703,7 +854,7 @@ bool config_get_path(config_file_t *conf, const char *key,
    if (config_get_array(conf, key, buf, size))
       return true;
 #else
-   const struct config_entry_list *entry = config_get_entry(conf, key, NULL);
+   const struct config_entry_list *entry = config_get_entry(conf, key);
 
    if (entry)
    {
@@ -716,7 +867,7 @@ bool config_get_path(config_file_t *conf, const char *key,
 
 bool config_get_bool(config_file_t *conf, const char *key, bool *in)
 {
-   const struct config_entry_list *entry = config_get_entry(conf, key, NULL);
+   const struct config_entry_list *entry = config_get_entry(conf, key);
 
    if (entry)
    {
@@ -737,46 +888,73 @@ bool config_get_bool(config_file_t *conf, const char *key, bool *in)
 
 void config_set_string(config_file_t *conf, const char *key, const char *val)
 {
-   struct config_entry_list *last  = conf->entries;
-   struct config_entry_list *entry = config_get_entry(conf, key, &last);
+   struct config_entry_list *entry = config_get_entry(conf, key);
+
+   if (!val)
+      return;
 
    if (entry && !entry->readonly)
    {
-      free(entry->value);
-      entry->value = strdup(val);
-      return;
-   }
+      size_t len = strlen(val);
 
-   if (!val)
+      if (val == entry->value)
+         return;
+
+      /* Reuse the old storage when the new value fits */
+      if (len <= strlen(entry->value))
+         memmove(entry->value, val, len + 1);
+      else if ((val = config_arena_strdup(conf, val)))
+         entry->value = (char*)val;
       return;
+   }
 
-   entry = (struct config_entry_list*)malloc(sizeof(*entry));
+   entry = (struct config_entry_list*)config_arena_alloc(conf, sizeof(*entry));
    if (!entry)
       return;
 
    entry->readonly  = false;
-   entry->key       = strdup(key);
-   entry->value     = strdup(val);
-   entry->next      = NULL;
+   entry->hash      = config_hash(key);
+   entry->key       = config_arena_strdup(conf, key);
+   entry->value     = config_arena_strdup(conf, val);
 
-   if (last)
-      last->next    = entry;
-   else
-      conf->entries = entry;
+   if (!entry->key || !entry->value)
+      return;
+
+   config_append_entry(conf, entry);
 }
 
 void config_unset(config_file_t *conf, const char *key)
 {
-   struct config_entry_list *last  = conf->entries;
-   struct config_entry_list *entry = config_get_entry(conf, key, &last);
+   struct config_entry_list *prev  = NULL;
+   struct config_entry_list *dup   = NULL;
+   struct config_entry_list *entry = config_get_entry(conf, key);
 
    if (!entry)
       return;
 
-   entry->key   = NULL;
-   entry->value = NULL;
-   free(entry->key);
-   free(entry->value);
+   if (entry != conf->entries)
+   {
+      for (prev = conf->entries; prev->next != entry; prev = prev->next);
+      prev->next    = entry->next;
+   }
+   else
+      conf->entries = entry->next;
+
+   if (conf->tail == entry)
+      conf->tail    = prev;
+
+   config_index_remove(conf, entry);
+
+   /* A later entry with the same key is the first one now */
+   for (dup = entry->next; dup; dup = dup->next)
+   {
+      if (dup->hash == entry->hash && string_is_equal(dup->key, entry->key))
+      {
+         if (conf->index)
+            config_index_insert(conf, dup);
+         break;
+      }
+   }
 }
 
 void config_set_path(config_file_t *conf, const char *entry, const char *val)
@@ -905,16 +1083,7 @@ void config_file_dump(config_file_t *conf, FILE *file)
 
 bool config_entry_exists(config_file_t *conf, const char *entry)
 {
-   struct config_entry_list *list = conf->entries;
-
-   while (list)
-   {
-      if (string_is_equal(entry, list->key))
-         return true;
-      list = list->next;
-   }
-
-   return false;
+   return config_get_entry(conf, entry) != NULL;
 }
 
 bool config_get_entry_list_head(config_file_t *conf,
@@ -51,6 +51,10 @@
 #include <LzmaDec.h>
 #include <retro_inline.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
 #define TRUE 1
 #define FALSE 0
 
@@ -280,6 +284,10 @@ struct _chd_file
 #ifdef NEED_CACHE_HUNK
 	UINT32					maxhunk;		/* maximum hunk accessed */
 #endif
+
+#ifdef HAVE_THREADS
+	slock_t *				filelock;		/* serializes file access of chd_read_hunks workers */
+#endif
 };
 
 /***************************************************************************
@@ -302,6 +310,11 @@ static chd_error header_read(chd_file *chd, chd_header *header);
 static chd_error hunk_read_into_cache(chd_file *chd, UINT32 hunknum);
 #endif
 static chd_error hunk_read_into_memory(chd_file *chd, UINT32 hunknum, UINT8 *dest);
+static chd_error hunk_read_file(chd_file *chd, UINT64 offset, UINT8 *dest, UINT32 length);
+
+/* internal codec setup */
+static chd_error codecs_init(chd_file *chd);
+static void codecs_free(chd_file *chd);
 
 /* internal map access */
 static chd_error map_read(chd_file *chd);
@@ -1317,7 +1330,6 @@ chd_error chd_open_file(core_file *file, int mode, chd_file *parent, chd_file **
 {
 	chd_file *newchd = NULL;
 	chd_error err;
-	int intfnum;
 
 	/* verify parameters */
 	if (file == NULL)
@@ -1402,22 +1414,46 @@ chd_error chd_open_file(core_file *file, int mode, chd_file *parent, chd_file **
 	if (newchd->compressed == NULL)
 		EARLY_EXIT(err = CHDERR_OUT_OF_MEMORY);
 
-	/* find the codec interface */
-	if (newchd->header.version < 5)
+	/* find the codec interfaces and initialize them */
+	err = codecs_init(newchd);
+	if (err != CHDERR_NONE)
+		EARLY_EXIT(err);
+
+	/* all done */
+	*chd = newchd;
+	return CHDERR_NONE;
+
+cleanup:
+	if (newchd != NULL)
+		chd_close(newchd);
+	return err;
+}
+
+/*-------------------------------------------------
+    codecs_init - find the codec interfaces
+    and initialize the codec data
+-------------------------------------------------*/
+
+static chd_error codecs_init(chd_file *chd)
+{
+	chd_error err;
+	int intfnum;
+
+	if (chd->header.version < 5)
 	{
 		for (intfnum = 0; intfnum < ARRAY_LENGTH(codec_interfaces); intfnum++)
-			if (codec_interfaces[intfnum].compression == newchd->header.compression[0])
+			if (codec_interfaces[intfnum].compression == chd->header.compression[0])
 			{
-				newchd->codecintf[0] = &codec_interfaces[intfnum];
+				chd->codecintf[0] = &codec_interfaces[intfnum];
 				break;
 			}
 		if (intfnum == ARRAY_LENGTH(codec_interfaces))
-			EARLY_EXIT(err = CHDERR_UNSUPPORTED_FORMAT);
+			return CHDERR_UNSUPPORTED_FORMAT;
 
 		/* initialize the codec */
-		if (newchd->codecintf[0]->init != NULL)
+		if (chd->codecintf[0]->init != NULL)
         {
-			err = (*newchd->codecintf[0]->init)(&newchd->zlib_codec_data, newchd->header.hunkbytes);
+			err = (*chd->codecintf[0]->init)(&chd->zlib_codec_data, chd->header.hunkbytes);
             (void)err;
         }
 	}
@@ -1425,40 +1461,40 @@ chd_error chd_open_file(core_file *file, int mode, chd_file *parent, chd_file **
 	{
 		int i, decompnum;
 		/* verify the compression types and initialize the codecs */
-		for (decompnum = 0; decompnum < ARRAY_LENGTH(newchd->header.compression); decompnum++)
+		for (decompnum = 0; decompnum < ARRAY_LENGTH(chd->header.compression); decompnum++)
 		{
 			for (i = 0 ; i < ARRAY_LENGTH(codec_interfaces) ; i++)
 			{
-				if (codec_interfaces[i].compression == newchd->header.compression[decompnum])
+				if (codec_interfaces[i].compression == chd->header.compression[decompnum])
 				{
-					newchd->codecintf[decompnum] = &codec_interfaces[i];
-					if (newchd->codecintf[decompnum] == NULL && newchd->header.compression[decompnum] != 0)
+					chd->codecintf[decompnum] = &codec_interfaces[i];
+					if (chd->codecintf[decompnum] == NULL && chd->header.compression[decompnum] != 0)
                     {
 						err = CHDERR_UNSUPPORTED_FORMAT;
                         (void)err;
                     }
 
 					/* initialize the codec */
-					if (newchd->codecintf[decompnum]->init != NULL)
+					if (chd->codecintf[decompnum]->init != NULL)
 					{
 						void* codec = NULL;
-						switch (newchd->header.compression[decompnum])
+						switch (chd->header.compression[decompnum])
 						{
 							case CHD_CODEC_CD_ZLIB:
-								codec = &newchd->cdzl_codec_data;
+								codec = &chd->cdzl_codec_data;
 								break;
 
 							case CHD_CODEC_CD_LZMA:
-								codec = &newchd->cdlz_codec_data;
+								codec = &chd->cdlz_codec_data;
 								break;
 
 							case CHD_CODEC_CD_FLAC:
-								codec = &newchd->cdfl_codec_data;
+								codec = &chd->cdfl_codec_data;
 								break;
 						}
 						if (codec != NULL)
                         {
-							err = (*newchd->codecintf[decompnum]->init)(codec, newchd->header.hunkbytes);
+							err = (*chd->codecintf[decompnum]->init)(codec, chd->header.hunkbytes);
                             (void)err;
                         }
 					}
@@ -1471,17 +1507,50 @@ chd_error chd_open_file(core_file *file, int mode, chd_file *parent, chd_file **
 #if 0
 	/* HACK */
 	if (err != CHDERR_NONE)
-		EARLY_EXIT(err);
+		return err;
 #endif
 
-	/* all done */
-	*chd = newchd;
 	return CHDERR_NONE;
+}
 
-cleanup:
-	if (newchd != NULL)
-		chd_close(newchd);
-	return err;
+/*-------------------------------------------------
+    codecs_free - free the codec data
+-------------------------------------------------*/
+
+static void codecs_free(chd_file *chd)
+{
+	if (chd->header.version < 5)
+	{
+		if (chd->codecintf[0] != NULL && chd->codecintf[0]->free != NULL)
+			(*chd->codecintf[0]->free)(&chd->zlib_codec_data);
+	}
+	else
+	{
+		int i;
+		/* Free the codecs */
+		for (i = 0 ; i < 4 ; i++)
+		{
+			void* codec = NULL;
+			switch (chd->codecintf[i]->compression)
+			{
+				case CHD_CODEC_CD_LZMA:
+					codec = &chd->cdlz_codec_data;
+					break;
+
+				case CHD_CODEC_CD_ZLIB:
+					codec = &chd->cdzl_codec_data;
+					break;
+
+				case CHD_CODEC_CD_FLAC:
+					codec = &chd->cdfl_codec_data;
+					break;
+			}
+			if (codec)
+			{
+				(*chd->codecintf[i]->free)(codec);
+			}
+		}
+	}
 }
 
 /*-------------------------------------------------
@@ -1537,39 +1606,11 @@ void chd_close(chd_file *chd)
 	if (chd == NULL || chd->cookie != COOKIE_VALUE)
 		return;
 
-	/* deinit the codec */
-	if (chd->header.version < 5)
-	{
-		if (chd->codecintf[0] != NULL && chd->codecintf[0]->free != NULL)
-			(*chd->codecintf[0]->free)(&chd->zlib_codec_data);
-	}
-	else
-	{
-		int i;
-		/* Free the codecs */
-		for (i = 0 ; i < 4 ; i++)
-		{
-			void* codec = NULL;
-			switch (chd->codecintf[i]->compression)
-			{
-				case CHD_CODEC_CD_LZMA:
-					codec = &chd->cdlz_codec_data;
-					break;
-
-				case CHD_CODEC_CD_ZLIB:
-					codec = &chd->cdzl_codec_data;
-					break;
-
-				case CHD_CODEC_CD_FLAC:
-					codec = &chd->cdfl_codec_data;
-					break;
-			}
-			if (codec)
-			{
-				(*chd->codecintf[i]->free)(codec);
-			}
-		}
+	/* deinit the codecs */
+	codecs_free(chd);
 
+	if (chd->header.version >= 5)
+	{
 		/* Free the raw map */
 		if (chd->header.rawmap != NULL)
 			free(chd->header.rawmap);
@@ -1691,6 +1732,263 @@ chd_error chd_read(chd_file *chd, UINT32 hunknum, void *buffer)
 	return hunk_read_into_memory(chd, hunknum, (UINT8 *)buffer);
 }
 
+#ifdef HAVE_THREADS
+/* one decompressed hunk on its way to the callback */
+typedef struct _read_hunks_slot read_hunks_slot;
+struct _read_hunks_slot
+{
+	UINT8 *					data;			/* decompressed hunk */
+	chd_error				err;			/* result of the read */
+	UINT8					done;			/* set once a worker is finished with it */
+};
+
+/* state shared by chd_read_hunks and its workers */
+typedef struct _read_hunks_state read_hunks_state;
+struct _read_hunks_state
+{
+	chd_file *				chd;			/* file being read */
+	slock_t *				lock;			/* protects everything below */
+	scond_t *				cond;			/* signalled whenever a slot changes */
+	slock_t *				filelock;		/* shared by the worker clones */
+	read_hunks_slot *		slots;			/* hunk N goes to slots[N % numslots] */
+	UINT32					numslots;		/* number of slots */
+	UINT32					next;			/* next hunk for a worker */
+	UINT32					end;			/* one past the last hunk */
+	UINT32					consumed;		/* next hunk for the callback */
+	UINT8					quit;			/* set to stop the workers early */
+};
+
+/*-------------------------------------------------
+    read_hunks_free_clone - free a worker copy
+    made by read_hunks_clone
+-------------------------------------------------*/
+
+static void read_hunks_free_clone(chd_file *clone)
+{
+	codecs_free(clone);
+	if (clone->compressed != NULL)
+		free(clone->compressed);
+	free(clone);
+}
+
+/*-------------------------------------------------
+    read_hunks_clone - make a copy of a CHD that
+    shares the map and file of the original but
+    has codecs of its own
+-------------------------------------------------*/
+
+static chd_file *read_hunks_clone(chd_file *chd, slock_t *filelock)
+{
+	chd_file *clone = (chd_file *)malloc(sizeof(*clone));
+	if (clone == NULL)
+		return NULL;
+
+	memcpy(clone, chd, sizeof(*clone));
+	memset(&clone->zlib_codec_data, 0, sizeof(clone->zlib_codec_data));
+	memset(&clone->cdzl_codec_data, 0, sizeof(clone->cdzl_codec_data));
+	memset(&clone->cdlz_codec_data, 0, sizeof(clone->cdlz_codec_data));
+	memset(&clone->cdfl_codec_data, 0, sizeof(clone->cdfl_codec_data));
+	clone->owns_file = FALSE;
+	clone->filelock = filelock;
+#ifdef NEED_CACHE_HUNK
+	clone->cache = NULL;
+	clone->compare = NULL;
+#endif
+
+	clone->compressed = (UINT8 *)malloc(chd->header.hunkbytes);
+	if (clone->compressed == NULL || codecs_init(clone) != CHDERR_NONE)
+	{
+		read_hunks_free_clone(clone);
+		return NULL;
+	}
+
+	return clone;
+}
+
+/*-------------------------------------------------
+    read_hunks_worker - decompress hunks into
+    free slots until the range is done
+-------------------------------------------------*/
+
+static void read_hunks_worker(void *param)
+{
+	read_hunks_state *state = (read_hunks_state *)param;
+	chd_file *clone = read_hunks_clone(state->chd, state->filelock);
+
+	slock_lock(state->lock);
+
+	while (!state->quit && state->next < state->end)
+	{
+		UINT32 hunknum;
+		chd_error err;
+		read_hunks_slot *slot;
+
+		/* wait for the callback to give back the slot */
+		if (state->next - state->consumed >= state->numslots)
+		{
+			scond_wait(state->cond, state->lock);
+			continue;
+		}
+
+		hunknum = state->next++;
+		slot = &state->slots[hunknum % state->numslots];
+		slock_unlock(state->lock);
+
+		if (clone != NULL)
+			err = hunk_read_into_memory(clone, hunknum, slot->data);
+		else
+			err = CHDERR_OUT_OF_MEMORY;
+
+		slock_lock(state->lock);
+		slot->err = err;
+		slot->done = TRUE;
+		scond_broadcast(state->cond);
+	}
+
+	slock_unlock(state->lock);
+
+	if (clone != NULL)
+		read_hunks_free_clone(clone);
+}
+
+/*-------------------------------------------------
+    read_hunks_threaded - chd_read_hunks with a
+    pool of worker threads
+-------------------------------------------------*/
+
+static chd_error read_hunks_threaded(chd_file *chd, UINT32 first, UINT32 count, UINT32 threads, chd_read_hunks_callback callback, void *param)
+{
+	read_hunks_state state;
+	sthread_t **workers;
+	chd_error err = CHDERR_NONE;
+	UINT32 started = 0;
+	UINT32 i;
+
+	memset(&state, 0, sizeof(state));
+	state.chd = chd;
+	state.next = first;
+	state.end = first + count;
+	state.consumed = first;
+	/* two hunks per worker so none of them waits on the callback */
+	state.numslots = threads * 2;
+	state.lock = slock_new();
+	state.cond = scond_new();
+	state.filelock = slock_new();
+	state.slots = (read_hunks_slot *)calloc(state.numslots, sizeof(*state.slots));
+	workers = (sthread_t **)calloc(threads, sizeof(*workers));
+
+	if (state.lock == NULL || state.cond == NULL || state.filelock == NULL || state.slots == NULL || workers == NULL)
+		EARLY_EXIT(err = CHDERR_OUT_OF_MEMORY);
+
+	for (i = 0; i < state.numslots; i++)
+		if ((state.slots[i].data = (UINT8 *)malloc(chd->header.hunkbytes)) == NULL)
+			EARLY_EXIT(err = CHDERR_OUT_OF_MEMORY);
+
+	for (started = 0; started < threads; started++)
+		if ((workers[started] = sthread_create(read_hunks_worker, &state)) == NULL)
+			break;
+	if (started == 0)
+		EARLY_EXIT(err = CHDERR_OUT_OF_MEMORY);
+
+	/* hand the hunks to the callback in order as they come in */
+	while (state.consumed < state.end)
+	{
+		read_hunks_slot *slot = &state.slots[state.consumed % state.numslots];
+
+		slock_lock(state.lock);
+		while (!slot->done)
+			scond_wait(state.cond, state.lock);
+		slock_unlock(state.lock);
+
+		err = slot->err;
+		if (err == CHDERR_NONE)
+			err = (*callback)(state.consumed, slot->data, param);
+
+		slock_lock(state.lock);
+		slot->done = FALSE;
+		state.consumed++;
+		if (err != CHDERR_NONE)
+			state.quit = TRUE;
+		scond_broadcast(state.cond);
+		slock_unlock(state.lock);
+
+		if (err != CHDERR_NONE)
+			break;
+	}
+
+cleanup:
+	if (state.lock != NULL && state.cond != NULL)
+	{
+		slock_lock(state.lock);
+		state.quit = TRUE;
+		scond_broadcast(state.cond);
+		slock_unlock(state.lock);
+	}
+	for (i = 0; i < started; i++)
+		sthread_join(workers[i]);
+	if (workers != NULL)
+		free(workers);
+	if (state.slots != NULL)
+	{
+		for (i = 0; i < state.numslots; i++)
+			if (state.slots[i].data != NULL)
+				free(state.slots[i].data);
+		free(state.slots);
+	}
+	if (state.filelock != NULL)
+		slock_free(state.filelock);
+	if (state.cond != NULL)
+		scond_free(state.cond);
+	if (state.lock != NULL)
+		slock_free(state.lock);
+	return err;
+}
+#endif
+
+/*-------------------------------------------------
+    chd_read_hunks - read a range of hunks,
+    decompressing up to 'threads' of them at once,
+    and pass them to the callback in order
+-------------------------------------------------*/
+
+chd_error chd_read_hunks(chd_file *chd, UINT32 first, UINT32 count, UINT32 threads, chd_read_hunks_callback callback, void *param)
+{
+	chd_error err = CHDERR_NONE;
+	UINT8 *data;
+	UINT32 hunknum;
+
+	/* punt if NULL or invalid */
+	if (chd == NULL || chd->cookie != COOKIE_VALUE || callback == NULL)
+		return CHDERR_INVALID_PARAMETER;
+
+	/* return an error if out of range */
+	if (first > chd->header.totalhunks || count > chd->header.totalhunks - first)
+		return CHDERR_HUNK_OUT_OF_RANGE;
+
+#ifdef HAVE_THREADS
+	if (threads > count)
+		threads = count;
+
+	/* the parent is read through a single handle, so keep it on one thread */
+	if (threads > 1 && chd->parent == NULL)
+		return read_hunks_threaded(chd, first, count, threads, callback, param);
+#endif
+
+	data = (UINT8 *)malloc(chd->header.hunkbytes);
+	if (data == NULL)
+		return CHDERR_OUT_OF_MEMORY;
+
+	for (hunknum = first; hunknum < first + count && err == CHDERR_NONE; hunknum++)
+	{
+		err = hunk_read_into_memory(chd, hunknum, data);
+		if (err == CHDERR_NONE)
+			err = (*callback)(hunknum, data, param);
+	}
+
+	free(data);
+	return err;
+}
+
 /***************************************************************************
     METADATA MANAGEMENT
 ***************************************************************************/
@@ -2034,6 +2332,31 @@ static chd_error hunk_read_into_cache(chd_file *chd, UINT32 hunknum)
 }
 #endif
 
+/*-------------------------------------------------
+    hunk_read_file - read raw hunk data from
+    the file at the given offset
+-------------------------------------------------*/
+
+static chd_error hunk_read_file(chd_file *chd, UINT64 offset, UINT8 *dest, UINT32 length)
+{
+	chd_error err = CHDERR_NONE;
+
+#ifdef HAVE_THREADS
+	if (chd->filelock != NULL)
+		slock_lock(chd->filelock);
+#endif
+
+	if (core_fseek(chd->file, offset, SEEK_SET) != 0 || core_fread(chd->file, dest, length) != length)
+		err = CHDERR_READ_ERROR;
+
+#ifdef HAVE_THREADS
+	if (chd->filelock != NULL)
+		slock_unlock(chd->filelock);
+#endif
+
+	return err;
+}
+
 /*-------------------------------------------------
     hunk_read_into_memory - read a hunk into
     memory at the given location
@@ -2067,11 +2390,9 @@ static chd_error hunk_read_into_memory(chd_file *chd, UINT32 hunknum, UINT8 *des
 			case V34_MAP_ENTRY_TYPE_COMPRESSED:
 
 				/* read it into the decompression buffer */
-				if (core_fseek(chd->file, entry->offset, SEEK_SET) != 0)
-					return CHDERR_READ_ERROR;
-				bytes = core_fread(chd->file, chd->compressed, entry->length);
-				if (bytes != entry->length)
-					return CHDERR_READ_ERROR;
+				err = hunk_read_file(chd, entry->offset, chd->compressed, entry->length);
+				if (err != CHDERR_NONE)
+					return err;
 
 				/* now decompress using the codec */
 				err   = CHDERR_NONE;
@@ -2084,11 +2405,9 @@ static chd_error hunk_read_into_memory(chd_file *chd, UINT32 hunknum, UINT8 *des
 
 			/* uncompressed data */
 			case V34_MAP_ENTRY_TYPE_UNCOMPRESSED:
-				if (core_fseek(chd->file, entry->offset, SEEK_SET) != 0)
-					return CHDERR_READ_ERROR;
-				bytes = core_fread(chd->file, dest, chd->header.hunkbytes);
-				if (bytes != chd->header.hunkbytes)
-					return CHDERR_READ_ERROR;
+				err = hunk_read_file(chd, entry->offset, dest, chd->header.hunkbytes);
+				if (err != CHDERR_NONE)
+					return err;
 				break;
 
 			/* mini-compressed data */
@@ -2155,10 +2474,9 @@ static chd_error hunk_read_into_memory(chd_file *chd, UINT32 hunknum, UINT8 *des
 			case COMPRESSION_TYPE_1:
 			case COMPRESSION_TYPE_2:
 			case COMPRESSION_TYPE_3:
-				if (core_fseek(chd->file, blockoffs, SEEK_SET) != 0)
-					return CHDERR_READ_ERROR;
-				if(core_fread(chd->file, chd->compressed, blocklen) != blocklen)
-					return CHDERR_READ_ERROR;
+				err = hunk_read_file(chd, blockoffs, chd->compressed, blocklen);
+				if (err != CHDERR_NONE)
+					return err;
 
 				switch (chd->codecintf[rawmap[0]]->compression)
 				{
@@ -2186,10 +2504,9 @@ static chd_error hunk_read_into_memory(chd_file *chd, UINT32 hunknum, UINT8 *des
 				return CHDERR_NONE;
 
 			case COMPRESSION_NONE:
-				if (core_fseek(chd->file, blockoffs, SEEK_SET) != 0)
-					return CHDERR_READ_ERROR;
-				if (core_fread(chd->file, dest, chd->header.hunkbytes) != chd->header.hunkbytes)
-					return CHDERR_READ_ERROR;
+				err = hunk_read_file(chd, blockoffs, dest, chd->header.hunkbytes);
+				if (err != CHDERR_NONE)
+					return err;
 #ifdef VERIFY_BLOCK_CRC
 				if (crc16(dest, chd->header.hunkbytes) != blockcrc)
 					return CHDERR_DECOMPRESSION_ERROR;
@@ -29,7 +29,15 @@
 #include <malloc.h>
 #endif
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define RPNG_NEON
+#endif
+
 #include <boolean.h>
+#include <retro_inline.h>
 #include <formats/image.h>
 #include <formats/rpng.h>
 #include <streams/trans_stream.h>
@@ -55,6 +63,10 @@ enum png_line_filter
    PNG_FILTER_PAETH
 };
 
+/* Non-interlaced images are inflated this many scanlines
+ * ahead of the reverse filter, instead of all at once. */
+#define RPNG_INFLATE_ROWS 16
+
 enum png_chunk_type
 {
    PNG_CHUNK_NOOP = 0,
@@ -231,11 +243,28 @@ end:
 static void png_reverse_filter_copy_line_rgb(uint32_t *data,
       const uint8_t *decoded, unsigned width, unsigned bpp)
 {
-   unsigned i;
+   unsigned i = 0;
 
    bpp /= 8;
 
-   for (i = 0; i < width; i++)
+#if defined(RPNG_NEON) && !defined(MSB_FIRST)
+   if (bpp == 1)
+   {
+      for (; i + 8 <= width; i += 8, decoded += 24)
+      {
+         uint8x8x3_t rgb = vld3_u8(decoded);
+         uint8x8x4_t out;
+
+         out.val[0] = rgb.val[2];
+         out.val[1] = rgb.val[1];
+         out.val[2] = rgb.val[0];
+         out.val[3] = vdup_n_u8(0xff);
+         vst4_u8((uint8_t*)(data + i), out);
+      }
+   }
+#endif
+
+   for (; i < width; i++)
    {
       uint32_t r, g, b;
 
@@ -252,11 +281,44 @@ static void png_reverse_filter_copy_line_rgb(uint32_t *data,
 static void png_reverse_filter_copy_line_rgba(uint32_t *data,
       const uint8_t *decoded, unsigned width, unsigned bpp)
 {
-   unsigned i;
+   unsigned i = 0;
 
    bpp /= 8;
 
-   for (i = 0; i < width; i++)
+#if defined(__SSE2__)
+   if (bpp == 1)
+   {
+      /* RGBA bytes read as a little endian dword are ABGR,
+       * so only R and B need to trade places. */
+      const __m128i ag_mask = _mm_set1_epi32(0xff00ff00);
+      const __m128i rb_mask = _mm_set1_epi32(0x00ff00ff);
+
+      for (; i + 4 <= width; i += 4, decoded += 16)
+      {
+         __m128i v  = _mm_loadu_si128((const __m128i*)decoded);
+         __m128i ag = _mm_and_si128(v, ag_mask);
+         __m128i rb = _mm_and_si128(v, rb_mask);
+
+         rb = _mm_or_si128(_mm_slli_epi32(rb, 16), _mm_srli_epi32(rb, 16));
+         _mm_storeu_si128((__m128i*)(data + i), _mm_or_si128(ag, rb));
+      }
+   }
+#elif defined(RPNG_NEON) && !defined(MSB_FIRST)
+   if (bpp == 1)
+   {
+      for (; i + 8 <= width; i += 8, decoded += 32)
+      {
+         uint8x8x4_t px = vld4_u8(decoded);
+         uint8x8_t   r  = px.val[0];
+
+         px.val[0] = px.val[2];
+         px.val[2] = r;
+         vst4_u8((uint8_t*)(data + i), px);
+      }
+   }
+#endif
+
+   for (; i < width; i++)
    {
       uint32_t r, g, b, a;
       r        = *decoded;
@@ -498,6 +560,10 @@ static void png_reverse_filter_deinit(struct rpng_process *pngp)
       free(pngp->prev_scanline);
    pngp->prev_scanline    = NULL;
 
+   if (pngp->stream)
+      pngp->stream_backend->stream_free(pngp->stream);
+   pngp->stream           = NULL;
+
    pngp->pass_initialized = false;
    pngp->h                = 0;
 }
@@ -557,7 +623,8 @@ static int png_reverse_filter_init(const struct png_ihdr *ihdr,
 
    png_pass_geom(ihdr, ihdr->width, ihdr->height, &pngp->bpp, &pngp->pitch, &pass_size);
 
-   if (pngp->total_out < pass_size)
+   /* A still open stream is inflated as the lines are needed. */
+   if (!pngp->stream && pngp->total_out < pass_size)
       return -1;
 
    pngp->restore_buf_size      = 0;
@@ -578,44 +645,251 @@ error:
    return -1;
 }
 
+#if defined(__SSE2__) || defined(RPNG_NEON)
+/* The Sub, Average and Paeth filters depend on the pixel to the
+ * left, so they are vectorized across the channels of one pixel
+ * rather than across pixels. 'bpp' is 3 or 4, and a constant
+ * once these are inlined. */
+static INLINE uint32_t png_load_pixel(const uint8_t *p, unsigned bpp)
+{
+   uint32_t v = 0;
+   memcpy(&v, p, bpp);
+   return v;
+}
+
+static INLINE void png_store_pixel(uint8_t *p, uint32_t v, unsigned bpp)
+{
+   memcpy(p, &v, bpp);
+}
+#endif
+
+#if defined(__SSE2__)
+static INLINE void png_reverse_filter_sub_simd(uint8_t *out,
+      const uint8_t *in, unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+   __m128i a = _mm_setzero_si128();
+
+   for (i = 0; i < pitch; i += bpp)
+   {
+      a = _mm_add_epi8(a, _mm_cvtsi32_si128(png_load_pixel(in + i, bpp)));
+      png_store_pixel(out + i, _mm_cvtsi128_si32(a), bpp);
+   }
+}
+
+static INLINE void png_reverse_filter_avg_simd(uint8_t *out,
+      const uint8_t *prev, const uint8_t *in, unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+   const __m128i one = _mm_set1_epi8(1);
+   __m128i a         = _mm_setzero_si128();
+
+   for (i = 0; i < pitch; i += bpp)
+   {
+      __m128i b   = _mm_cvtsi32_si128(png_load_pixel(prev + i, bpp));
+      __m128i x   = _mm_cvtsi32_si128(png_load_pixel(in + i, bpp));
+      /* _mm_avg_epu8 rounds up, PNG rounds down. */
+      __m128i avg = _mm_sub_epi8(_mm_avg_epu8(a, b),
+            _mm_and_si128(_mm_xor_si128(a, b), one));
+
+      a = _mm_add_epi8(x, avg);
+      png_store_pixel(out + i, _mm_cvtsi128_si32(a), bpp);
+   }
+}
+
+static INLINE __m128i png_abs_epi16(__m128i x)
+{
+   return _mm_max_epi16(x, _mm_sub_epi16(_mm_setzero_si128(), x));
+}
+
+static INLINE void png_reverse_filter_paeth_simd(uint8_t *out,
+      const uint8_t *prev, const uint8_t *in, unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+   const __m128i zero = _mm_setzero_si128();
+   __m128i a          = zero;
+   __m128i c          = zero;
+
+   for (i = 0; i < pitch; i += bpp)
+   {
+      __m128i b = _mm_unpacklo_epi8(
+            _mm_cvtsi32_si128(png_load_pixel(prev + i, bpp)), zero);
+      __m128i x = _mm_cvtsi32_si128(png_load_pixel(in + i, bpp));
+      /* Same choice as paeth(): pa = |p - a| = |b - c|,
+       * pb = |p - b| = |a - c|, pc = |p - c|. */
+      __m128i pa   = _mm_sub_epi16(b, c);
+      __m128i pb   = _mm_sub_epi16(a, c);
+      __m128i pc   = png_abs_epi16(_mm_add_epi16(pa, pb));
+      __m128i use_c, use_bc, pred;
+
+      pa     = png_abs_epi16(pa);
+      pb     = png_abs_epi16(pb);
+      use_c  = _mm_cmpgt_epi16(pb, pc);
+      use_bc = _mm_cmpgt_epi16(pa, _mm_min_epi16(pb, pc));
+      pred   = _mm_or_si128(_mm_andnot_si128(use_c, b),
+            _mm_and_si128(use_c, c));
+      pred   = _mm_or_si128(_mm_andnot_si128(use_bc, a),
+            _mm_and_si128(use_bc, pred));
+
+      x      = _mm_add_epi8(_mm_packus_epi16(pred, pred), x);
+      png_store_pixel(out + i, _mm_cvtsi128_si32(x), bpp);
+
+      a      = _mm_unpacklo_epi8(x, zero);
+      c      = b;
+   }
+}
+#elif defined(RPNG_NEON)
+static INLINE uint8x8_t png_load_pixel_neon(const uint8_t *p, unsigned bpp)
+{
+   return vreinterpret_u8_u32(vdup_n_u32(png_load_pixel(p, bpp)));
+}
+
+static INLINE void png_reverse_filter_sub_simd(uint8_t *out,
+      const uint8_t *in, unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+   uint8x8_t a = vdup_n_u8(0);
+
+   for (i = 0; i < pitch; i += bpp)
+   {
+      a = vadd_u8(a, png_load_pixel_neon(in + i, bpp));
+      png_store_pixel(out + i,
+            vget_lane_u32(vreinterpret_u32_u8(a), 0), bpp);
+   }
+}
+
+static INLINE void png_reverse_filter_avg_simd(uint8_t *out,
+      const uint8_t *prev, const uint8_t *in, unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+   uint8x8_t a = vdup_n_u8(0);
+
+   for (i = 0; i < pitch; i += bpp)
+   {
+      /* vhadd rounds down, like PNG. */
+      uint8x8_t avg = vhadd_u8(a, png_load_pixel_neon(prev + i, bpp));
+
+      a = vadd_u8(png_load_pixel_neon(in + i, bpp), avg);
+      png_store_pixel(out + i,
+            vget_lane_u32(vreinterpret_u32_u8(a), 0), bpp);
+   }
+}
+
+static INLINE void png_reverse_filter_paeth_simd(uint8_t *out,
+      const uint8_t *prev, const uint8_t *in, unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+   uint8x8_t a = vdup_n_u8(0);
+   uint8x8_t c = vdup_n_u8(0);
+
+   for (i = 0; i < pitch; i += bpp)
+   {
+      uint8x8_t b      = png_load_pixel_neon(prev + i, bpp);
+      /* Same choice as paeth(): pa = |b - c|, pb = |a - c|,
+       * pc = |(b - c) + (a - c)|. */
+      uint16x8_t pa    = vabdl_u8(b, c);
+      uint16x8_t pb    = vabdl_u8(a, c);
+      uint16x8_t pc    = vreinterpretq_u16_s16(vabsq_s16(vaddq_s16(
+                  vreinterpretq_s16_u16(vsubl_u8(b, c)),
+                  vreinterpretq_s16_u16(vsubl_u8(a, c)))));
+      uint8x8_t use_c  = vmovn_u16(vcgtq_u16(pb, pc));
+      uint8x8_t use_bc = vmovn_u16(vcgtq_u16(pa, vminq_u16(pb, pc)));
+      uint8x8_t pred   = vbsl_u8(use_bc, vbsl_u8(use_c, c, b), a);
+
+      a = vadd_u8(pred, png_load_pixel_neon(in + i, bpp));
+      png_store_pixel(out + i,
+            vget_lane_u32(vreinterpret_u32_u8(a), 0), bpp);
+      c = b;
+   }
+}
+#endif
+
 static int png_reverse_filter_copy_line(uint32_t *data, const struct png_ihdr *ihdr,
       struct rpng_process *pngp, unsigned filter)
 {
    unsigned i;
 
+   uint8_t *swap;
+   uint8_t *out        = pngp->decoded_scanline;
+   const uint8_t *prev = pngp->prev_scanline;
+   const uint8_t *in   = pngp->inflate_buf;
+   unsigned bpp        = pngp->bpp;
+   unsigned pitch      = pngp->pitch;
+   /* 8-bit RGB(A) (or 16-bit gray+alpha), one pixel per vector. */
+   bool simd_pixel     = (bpp == 3 || bpp == 4) && !(pitch % bpp);
+
    switch (filter)
    {
       case PNG_FILTER_NONE:
-         memcpy(pngp->decoded_scanline, pngp->inflate_buf, pngp->pitch);
+         memcpy(out, in, pitch);
          break;
       case PNG_FILTER_SUB:
-         for (i = 0; i < pngp->bpp; i++)
-            pngp->decoded_scanline[i] = pngp->inflate_buf[i];
-         for (i = pngp->bpp; i < pngp->pitch; i++)
-            pngp->decoded_scanline[i] = pngp->decoded_scanline[i - pngp->bpp] + pngp->inflate_buf[i];
+#if defined(__SSE2__) || defined(RPNG_NEON)
+         if (simd_pixel)
+         {
+            if (bpp == 4)
+               png_reverse_filter_sub_simd(out, in, pitch, 4);
+            else
+               png_reverse_filter_sub_simd(out, in, pitch, 3);
+            break;
+         }
+#endif
+         for (i = 0; i < bpp; i++)
+            out[i] = in[i];
+         for (i = bpp; i < pitch; i++)
+            out[i] = out[i - bpp] + in[i];
          break;
       case PNG_FILTER_UP:
-         for (i = 0; i < pngp->pitch; i++)
-            pngp->decoded_scanline[i] = pngp->prev_scanline[i] + pngp->inflate_buf[i];
+         i = 0;
+#if defined(__SSE2__)
+         for (; i + 16 <= pitch; i += 16)
+            _mm_storeu_si128((__m128i*)(out + i), _mm_add_epi8(
+                     _mm_loadu_si128((const __m128i*)(prev + i)),
+                     _mm_loadu_si128((const __m128i*)(in + i))));
+#elif defined(RPNG_NEON)
+         for (; i + 16 <= pitch; i += 16)
+            vst1q_u8(out + i, vaddq_u8(vld1q_u8(prev + i), vld1q_u8(in + i)));
+#endif
+         for (; i < pitch; i++)
+            out[i] = prev[i] + in[i];
          break;
       case PNG_FILTER_AVERAGE:
-         for (i = 0; i < pngp->bpp; i++)
+#if defined(__SSE2__) || defined(RPNG_NEON)
+         if (simd_pixel)
          {
-            uint8_t avg = pngp->prev_scanline[i] >> 1;
-            pngp->decoded_scanline[i] = avg + pngp->inflate_buf[i];
+            if (bpp == 4)
+               png_reverse_filter_avg_simd(out, prev, in, pitch, 4);
+            else
+               png_reverse_filter_avg_simd(out, prev, in, pitch, 3);
+            break;
          }
-         for (i = pngp->bpp; i < pngp->pitch; i++)
+#endif
+         for (i = 0; i < bpp; i++)
+         {
+            uint8_t avg = prev[i] >> 1;
+            out[i] = avg + in[i];
+         }
+         for (i = bpp; i < pitch; i++)
          {
-            uint8_t avg = (pngp->decoded_scanline[i - pngp->bpp] + pngp->prev_scanline[i]) >> 1;
-            pngp->decoded_scanline[i] = avg + pngp->inflate_buf[i];
+            uint8_t avg = (out[i - bpp] + prev[i]) >> 1;
+            out[i] = avg + in[i];
          }
          break;
       case PNG_FILTER_PAETH:
-         for (i = 0; i < pngp->bpp; i++)
-            pngp->decoded_scanline[i] = paeth(0, pngp->prev_scanline[i], 0) + pngp->inflate_buf[i];
-         for (i = pngp->bpp; i < pngp->pitch; i++)
-            pngp->decoded_scanline[i] = paeth(pngp->decoded_scanline[i - pngp->bpp],
-                  pngp->prev_scanline[i], pngp->prev_scanline[i - pngp->bpp]) + pngp->inflate_buf[i];
+#if defined(__SSE2__) || defined(RPNG_NEON)
+         if (simd_pixel)
+         {
+            if (bpp == 4)
+               png_reverse_filter_paeth_simd(out, prev, in, pitch, 4);
+            else
+               png_reverse_filter_paeth_simd(out, prev, in, pitch, 3);
+            break;
+         }
+#endif
+         for (i = 0; i < bpp; i++)
+            out[i] = paeth(0, prev[i], 0) + in[i];
+         for (i = bpp; i < pitch; i++)
+            out[i] = paeth(out[i - bpp], prev[i], prev[i - bpp]) + in[i];
          break;
 
       default:
@@ -643,17 +917,62 @@ static int png_reverse_filter_copy_line(uint32_t *data, const struct png_ihdr *i
          break;
    }
 
-   memcpy(pngp->prev_scanline, pngp->decoded_scanline, pngp->pitch);
+   /* This line is the previous one for the next line. */
+   swap                    = pngp->prev_scanline;
+   pngp->prev_scanline     = pngp->decoded_scanline;
+   pngp->decoded_scanline  = swap;
 
    return IMAGE_PROCESS_NEXT;
 }
 
+/* Inflates up to RPNG_INFLATE_ROWS lines ahead, so that at least
+ * 'needed' bytes of the image are available. Filtering the lines
+ * right after they were inflated keeps them in the cache. */
+static bool png_reverse_filter_inflate_ahead(struct rpng_process *pngp,
+      size_t needed)
+{
+   uint8_t *start = pngp->inflate_buf - pngp->restore_buf_size;
+
+   while (pngp->total_out < needed)
+   {
+      uint32_t rd                  = 0;
+      uint32_t wn                  = 0;
+      enum trans_stream_error terr = TRANS_STREAM_ERROR_NONE;
+      size_t chunk                 = (pngp->pitch + 1) * RPNG_INFLATE_ROWS;
+
+      if (chunk > pngp->inflate_buf_size - pngp->total_out)
+         chunk = pngp->inflate_buf_size - pngp->total_out;
+      if (!chunk)
+         return false;
+
+      pngp->stream_backend->set_out(pngp->stream,
+            start + pngp->total_out, (uint32_t)chunk);
+
+      if (!pngp->stream_backend->trans(pngp->stream, false, &rd, &wn, &terr)
+            && terr != TRANS_STREAM_ERROR_BUFFER_FULL)
+         return false;
+
+      /* Truncated data. */
+      if (!rd && !wn)
+         return false;
+
+      pngp->avail_in  -= rd;
+      pngp->total_out += wn;
+   }
+
+   return true;
+}
+
 static int png_reverse_filter_regular_iterate(uint32_t **data, const struct png_ihdr *ihdr,
       struct rpng_process *pngp)
 {
    int ret = IMAGE_PROCESS_END;
 
-   if (pngp->h < ihdr->height)
+   if (pngp->h < ihdr->height && pngp->stream &&
+         !png_reverse_filter_inflate_ahead(pngp,
+            (size_t)(pngp->h + 1) * (pngp->pitch + 1)))
+      ret = IMAGE_PROCESS_ERROR_END;
+   else if (pngp->h < ihdr->height)
    {
       unsigned filter = *pngp->inflate_buf++;
       pngp->restore_buf_size += 1;
@@ -778,6 +1097,11 @@ static int rpng_load_image_argb_process_inflate_init(rpng_t *rpng,
    bool to_continue        = (process->avail_in > 0
          && process->avail_out > 0);
 
+   /* Non-interlaced images are inflated while the lines are
+    * filtered, see png_reverse_filter_inflate_ahead. */
+   if (!rpng->ihdr.interlace)
+      goto start;
+
    if (!to_continue)
       goto end;
 
@@ -797,6 +1121,7 @@ end:
    process->stream_backend->stream_free(process->stream);
    process->stream = NULL;
 
+start:
    *width  = rpng->ihdr.width;
    *height = rpng->ihdr.height;
 #ifdef GEKKO
@@ -0,0 +1,82 @@
+/* Copyright  (C) 2010-2017 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (audio_pipeline.h).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __LIBRETRO_SDK_AUDIO_PIPELINE_H
+#define __LIBRETRO_SDK_AUDIO_PIPELINE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <retro_common_api.h>
+
+#include <audio/audio_resampler.h>
+#include <audio/dsp_filter.h>
+
+RETRO_BEGIN_DECLS
+
+/* Stereo frames pushed through every stage at a time. Small enough for
+ * the converted input and the DSP's working set to stay in L1, and a
+ * multiple of the SIMD conversion width so that splitting a batch into
+ * blocks doesn't change a single output sample. */
+#define AUDIO_PIPELINE_BLOCK_FRAMES 256
+
+struct audio_pipeline_data
+{
+   const int16_t *input;
+   size_t input_frames;
+   float gain;
+
+   /* Optional. */
+   retro_dsp_filter_t *dsp;
+
+   const retro_resampler_t *resampler;
+   void *resampler_data;
+   double ratio;
+
+   /* At least AUDIO_PIPELINE_BLOCK_FRAMES * 2 floats. */
+   float *scratch;
+
+   /* Resampled output, as large as the whole batch needs. */
+   float *output;
+
+   /* Optional. If set, the output is also converted to s16 here while
+    * it's still in cache. Must not overlap the input. */
+   int16_t *output_s16;
+
+   /* Set by audio_pipeline_process(). */
+   size_t output_frames;
+};
+
+/**
+ * audio_pipeline_process:
+ * @data              : pipeline state and buffers
+ *
+ * Converts, filters, resamples and (optionally) converts back
+ * a batch of interleaved stereo s16 samples, one block at a time.
+ * The result is identical to running each stage over the whole
+ * batch in turn.
+ **/
+void audio_pipeline_process(struct audio_pipeline_data *data);
+
+RETRO_END_DECLS
+
+#endif
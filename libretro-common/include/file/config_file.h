@@ -60,6 +60,14 @@ struct config_file
    unsigned include_depth;
 
    struct config_include_list *includes;
+
+   /* Hash buckets of the first entry of each key */
+   struct config_entry_list **index;
+   size_t index_mask;
+   size_t index_count;
+
+   /* Backing storage of the entries and their strings */
+   struct config_arena *arena;
 };
 
 
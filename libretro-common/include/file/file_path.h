@@ -484,6 +484,10 @@ bool path_is_valid(const char *path);
 
 int32_t path_get_size(const char *path);
 
+/* Last modification time in seconds since the epoch,
+ * -1 if the path can't be stat'ed. */
+int64_t path_get_mtime(const char *path);
+
 RETRO_END_DECLS
 
 #endif
@@ -375,6 +375,12 @@ const chd_header *chd_get_header(chd_file *chd);
 /* read one hunk from the CHD file */
 chd_error chd_read(chd_file *chd, UINT32 hunknum, void *buffer);
 
+/* receives the hunks of chd_read_hunks in order, anything but CHDERR_NONE stops the read */
+typedef chd_error (*chd_read_hunks_callback)(UINT32 hunknum, UINT8 *data, void *param);
+
+/* read a range of hunks, decompressing up to 'threads' of them in parallel */
+chd_error chd_read_hunks(chd_file *chd, UINT32 first, UINT32 count, UINT32 threads, chd_read_hunks_callback callback, void *param);
+
 
 
 /* ----- metadata management ----- */
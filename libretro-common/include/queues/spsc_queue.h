@@ -0,0 +1,143 @@
+/* Copyright  (C) 2010-2017 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (spsc_queue.h).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __LIBRETRO_SDK_SPSC_QUEUE_H
+#define __LIBRETRO_SDK_SPSC_QUEUE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <boolean.h>
+#include <retro_common_api.h>
+
+RETRO_BEGIN_DECLS
+
+/* A byte FIFO shared by exactly one writing thread and one reading
+ * thread. Neither side ever takes a lock or waits for the other to
+ * read or write, so a descheduled thread can't hold up the other one.
+ *
+ * The writer may only call spsc_write, spsc_write_avail and
+ * spsc_wait_write; the reader only spsc_read, spsc_read_avail and
+ * spsc_wait_read. spsc_wake may be called from any thread. */
+typedef struct spsc_buffer spsc_buffer_t;
+
+/**
+ * spsc_new:
+ * @size              : how many bytes the queue holds
+ *
+ * Creates a queue. The storage is rounded up to a power of two, but
+ * no more than @size bytes are ever queued.
+ *
+ * Returns: NULL if allocation error, pointer to a queue if successful.
+ * Has to be freed with spsc_free.
+ **/
+spsc_buffer_t *spsc_new(size_t size);
+
+/**
+ * spsc_free:
+ * @buffer            : pointer to queue object
+ *
+ * Frees a queue. Neither side may be using it any more.
+ **/
+void spsc_free(spsc_buffer_t *buffer);
+
+/**
+ * spsc_write:
+ * @buffer            : pointer to queue object
+ * @data              : bytes to queue
+ * @size              : how many bytes to queue
+ *
+ * Queues as much of @data as there's room for.
+ *
+ * Returns: how many bytes were queued.
+ **/
+size_t spsc_write(spsc_buffer_t *buffer, const void *data, size_t size);
+
+/**
+ * spsc_read:
+ * @buffer            : pointer to queue object
+ * @data              : where to put the bytes
+ * @size              : how many bytes to take
+ *
+ * Takes up to @size bytes off the queue.
+ *
+ * Returns: how many bytes were taken.
+ **/
+size_t spsc_read(spsc_buffer_t *buffer, void *data, size_t size);
+
+/**
+ * spsc_write_avail:
+ * @buffer            : pointer to queue object
+ *
+ * Returns: how many bytes could be written right now. Only the writer
+ * gets an exact answer; from anywhere else it's a snapshot.
+ **/
+size_t spsc_write_avail(spsc_buffer_t *buffer);
+
+/**
+ * spsc_read_avail:
+ * @buffer            : pointer to queue object
+ *
+ * Returns: how many bytes could be read right now. Only the reader
+ * gets an exact answer; from anywhere else it's a snapshot.
+ **/
+size_t spsc_read_avail(spsc_buffer_t *buffer);
+
+/**
+ * spsc_wait_write:
+ * @buffer            : pointer to queue object
+ * @size              : how much room to wait for, in bytes
+ * @timeout_us        : how long to wait, in microseconds, or -1 to wait
+ *                      until there's room or spsc_wake is called
+ *
+ * Sleeps until @size bytes can be written. Uses a futex on Linux,
+ * otherwise a condition variable. The reader only makes a system call
+ * to wake the writer when the writer is actually asleep.
+ *
+ * Returns: true if there's room, false on timeout or wakeup.
+ **/
+bool spsc_wait_write(spsc_buffer_t *buffer, size_t size, int64_t timeout_us);
+
+/**
+ * spsc_wait_read:
+ * @buffer            : pointer to queue object
+ * @size              : how many bytes to wait for
+ * @timeout_us        : how long to wait, in microseconds, or -1 to wait
+ *                      until there's data or spsc_wake is called
+ *
+ * Sleeps until @size bytes can be read, like spsc_wait_write.
+ *
+ * Returns: true if the bytes are there, false on timeout or wakeup.
+ **/
+bool spsc_wait_read(spsc_buffer_t *buffer, size_t size, int64_t timeout_us);
+
+/**
+ * spsc_wake:
+ * @buffer            : pointer to queue object
+ *
+ * Wakes up both sides if they're waiting, e.g. before shutting down.
+ **/
+void spsc_wake(spsc_buffer_t *buffer);
+
+RETRO_END_DECLS
+
+#endif
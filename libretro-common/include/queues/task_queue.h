@@ -42,6 +42,17 @@ enum task_type
    TASK_TYPE_BLOCKING
 };
 
+/* Only honoured by the threaded implementation, which
+ * always picks the highest priority work first. */
+enum task_priority
+{
+   TASK_PRIORITY_NORMAL = 0,
+   /* Results the user is looking at, i.e. menu images */
+   TASK_PRIORITY_HIGH,
+   /* Long running background work, i.e. database scans */
+   TASK_PRIORITY_LOW
+};
+
 
 typedef struct retro_task retro_task_t;
 typedef void (*retro_task_callback_t)(void *task_data,
@@ -110,6 +121,13 @@ struct retro_task
 
    enum task_type type;
 
+   enum task_priority priority;
+
+   /* set by the creator if the handler touches state shared with
+    * other tasks. Serial tasks never run concurrently with each
+    * other, like they did before there was more than one worker. */
+   bool serial;
+
    /* don't touch this. */
    retro_task_t *next;
 };
@@ -233,6 +251,13 @@ void task_queue_deinit(void);
  * This must only be called from the main thread. */
 void task_queue_init(bool threaded, retro_task_queue_msg_t msg_push);
 
+/* Sets the number of worker threads used by the
+ * threaded implementation (defaults to one).
+ * Takes effect on the next task_queue_init.
+ *
+ * This must only be called from the main thread. */
+void task_queue_set_worker_count(unsigned count);
+
 RETRO_END_DECLS
 
 #endif
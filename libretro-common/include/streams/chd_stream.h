@@ -27,6 +27,7 @@
 #include <stddef.h>
 
 #include <retro_common_api.h>
+#include <boolean.h>
 
 RETRO_BEGIN_DECLS
 
@@ -39,12 +40,25 @@ typedef struct chdstream chdstream_t;
 /* Primary (largest) data track, used for CRC identification purposes */
 #define CHDSTREAM_TRACK_PRIMARY (-3)
 
+/* Decompressed hunks kept per stream */
+#define CHDSTREAM_DEFAULT_CACHE_HUNKS 16
+/* Hunks decompressed ahead of sequential reads, needs HAVE_THREADS */
+#define CHDSTREAM_DEFAULT_PREFETCH_HUNKS 4
+
+void chdstream_set_cache(unsigned hunks, unsigned prefetch);
+
 chdstream_t *chdstream_open(const char *path, int32_t track);
 
 void chdstream_close(chdstream_t *stream);
 
 ssize_t chdstream_read(chdstream_t *stream, void *data, size_t bytes);
 
+typedef bool (*chdstream_consumer_t)(const uint8_t *data, size_t len,
+      void *userdata);
+
+bool chdstream_read_track(chdstream_t *stream, unsigned threads,
+      chdstream_consumer_t consumer, void *userdata);
+
 int chdstream_getc(chdstream_t *stream);
 
 char *chdstream_gets(chdstream_t *stream, char *buffer, size_t len);
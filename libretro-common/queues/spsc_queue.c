@@ -0,0 +1,396 @@
+/* Copyright  (C) 2010-2017 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (spsc_queue.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <queues/spsc_queue.h>
+#include <features/features_cpu.h>
+#include <retro_miscellaneous.h>
+#include <memalign.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
+/* The two positions live on cache lines of their own, so that the
+ * writer and the reader don't keep stealing each other's line. Each
+ * side also keeps its own copy of where the other one was last seen,
+ * and only goes to look again when that copy says it's out of room. */
+#define SPSC_CACHE_LINE 64
+
+#if defined(__GNUC__) || defined(__clang__)
+#define SPSC_LOAD(b, x)      __atomic_load_n(&(x), __ATOMIC_ACQUIRE)
+#define SPSC_STORE(b, x, v)  __atomic_store_n(&(x), (v), __ATOMIC_RELEASE)
+#define SPSC_EXCHANGE(b, x, v) __atomic_exchange_n(&(x), (v), __ATOMIC_SEQ_CST)
+#define SPSC_INC(b, x)       __atomic_add_fetch(&(x), 1, __ATOMIC_SEQ_CST)
+#define SPSC_FENCE()         __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#if defined(__linux__)
+#define SPSC_HAVE_FUTEX 1
+#endif
+#elif defined(_MSC_VER) && _MSC_VER >= 1400 && !defined(_XBOX)
+#include <intrin.h>
+/* The interlocked operations are full barriers */
+#define SPSC_LOAD(b, x)      ((uint32_t)_InterlockedCompareExchange((volatile long*)&(x), 0, 0))
+#define SPSC_STORE(b, x, v)  _InterlockedExchange((volatile long*)&(x), (long)(v))
+#define SPSC_EXCHANGE(b, x, v) ((uint32_t)_InterlockedExchange((volatile long*)&(x), (long)(v)))
+#define SPSC_INC(b, x)       _InterlockedIncrement((volatile long*)&(x))
+#define SPSC_FENCE()
+#elif defined(HAVE_THREADS)
+/* No atomics to be had, so a lock stands in for them */
+#define SPSC_USE_LOCK 1
+#define SPSC_LOAD(b, x)      spsc_locked_swap(b, &(x), 0, false)
+#define SPSC_STORE(b, x, v)  spsc_locked_swap(b, &(x), (v), true)
+#define SPSC_EXCHANGE(b, x, v) spsc_locked_swap(b, &(x), (v), true)
+#define SPSC_INC(b, x)       spsc_locked_swap(b, &(x), SPSC_LOAD(b, x) + 1, true)
+#define SPSC_FENCE()
+#else
+/* Without threads, there's nobody to race with */
+#define SPSC_LOAD(b, x)      (x)
+#define SPSC_STORE(b, x, v)  ((x) = (v))
+#define SPSC_INC(b, x)       (++(x))
+#define SPSC_FENCE()
+#endif
+
+#ifdef SPSC_HAVE_FUTEX
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+
+struct spsc_side
+{
+   /* Only ever written by this side */
+   uint32_t pos;
+   /* Where this side last saw the other one */
+   uint32_t other;
+   uint8_t pad[SPSC_CACHE_LINE - 2 * sizeof(uint32_t)];
+};
+
+/* What a side sleeps on. Only written when it goes to sleep or is
+ * woken, so checking on it is normally a read from a shared line. */
+struct spsc_sleeper
+{
+   uint32_t waiting;
+   /* Bumped to wake the side up */
+   uint32_t seq;
+   /* Set by spsc_wake, until the side's next wait picks it up */
+   uint32_t woken;
+};
+
+struct spsc_buffer
+{
+   struct spsc_side writer;
+   struct spsc_side reader;
+
+   struct spsc_sleeper writer_sleep;
+   struct spsc_sleeper reader_sleep;
+   uint8_t pad[SPSC_CACHE_LINE - 2 * sizeof(struct spsc_sleeper)];
+
+   uint8_t *data;
+   uint32_t capacity;
+   uint32_t mask;
+
+#if defined(HAVE_THREADS) && !defined(SPSC_HAVE_FUTEX)
+   slock_t *wait_lock;
+   scond_t *wait_cond;
+#endif
+#ifdef SPSC_USE_LOCK
+   slock_t *lock;
+#endif
+};
+
+#ifdef SPSC_USE_LOCK
+static uint32_t spsc_locked_swap(spsc_buffer_t *buffer, uint32_t *x,
+      uint32_t v, bool store)
+{
+   uint32_t old;
+   slock_lock(buffer->lock);
+   old = *x;
+   if (store)
+      *x = v;
+   slock_unlock(buffer->lock);
+   return old;
+}
+#endif
+
+spsc_buffer_t *spsc_new(size_t size)
+{
+   size_t storage        = 1;
+   spsc_buffer_t *buffer = NULL;
+
+   if (!size || size > 0x40000000)
+      return NULL;
+
+   while (storage < size)
+      storage <<= 1;
+
+   buffer = (spsc_buffer_t*)memalign_alloc(SPSC_CACHE_LINE, sizeof(*buffer));
+   if (!buffer)
+      return NULL;
+
+   memset(buffer, 0, sizeof(*buffer));
+
+   buffer->data     = (uint8_t*)malloc(storage);
+   buffer->capacity = (uint32_t)size;
+   buffer->mask     = (uint32_t)(storage - 1);
+
+#if defined(HAVE_THREADS) && !defined(SPSC_HAVE_FUTEX)
+   buffer->wait_lock = slock_new();
+   buffer->wait_cond = scond_new();
+   if (!buffer->wait_lock || !buffer->wait_cond)
+      goto error;
+#endif
+#ifdef SPSC_USE_LOCK
+   if (!(buffer->lock = slock_new()))
+      goto error;
+#endif
+
+   if (!buffer->data)
+      goto error;
+
+   return buffer;
+
+error:
+   spsc_free(buffer);
+   return NULL;
+}
+
+void spsc_free(spsc_buffer_t *buffer)
+{
+   if (!buffer)
+      return;
+
+#if defined(HAVE_THREADS) && !defined(SPSC_HAVE_FUTEX)
+   if (buffer->wait_lock)
+      slock_free(buffer->wait_lock);
+   if (buffer->wait_cond)
+      scond_free(buffer->wait_cond);
+#endif
+#ifdef SPSC_USE_LOCK
+   if (buffer->lock)
+      slock_free(buffer->lock);
+#endif
+
+   free(buffer->data);
+   memalign_free(buffer);
+}
+
+/* Wakes up the other side if it's asleep. The fence orders our store
+ * of the position before the look at the flag, against the sleeper
+ * setting the flag before its last look at the position. */
+static void spsc_notify(spsc_buffer_t *buffer, struct spsc_sleeper *sleeper)
+{
+   SPSC_FENCE();
+
+   if (!SPSC_LOAD(buffer, sleeper->waiting))
+      return;
+
+   SPSC_STORE(buffer, sleeper->waiting, 0);
+   SPSC_INC(buffer, sleeper->seq);
+
+#if defined(SPSC_HAVE_FUTEX)
+   syscall(SYS_futex, &sleeper->seq, FUTEX_WAKE_PRIVATE, INT_MAX,
+         NULL, NULL, 0);
+#elif defined(HAVE_THREADS)
+   slock_lock(buffer->wait_lock);
+   scond_broadcast(buffer->wait_cond);
+   slock_unlock(buffer->wait_lock);
+#endif
+}
+
+size_t spsc_write(spsc_buffer_t *buffer, const void *data, size_t size)
+{
+   uint32_t offset, first;
+   uint32_t pos  = buffer->writer.pos;
+   uint32_t room = buffer->capacity - (pos - buffer->writer.other);
+
+   if (room < size)
+   {
+      buffer->writer.other = SPSC_LOAD(buffer, buffer->reader.pos);
+      room                 = buffer->capacity - (pos - buffer->writer.other);
+   }
+
+   size = MIN(size, room);
+   if (!size)
+      return 0;
+
+   offset = pos & buffer->mask;
+   first  = MIN((uint32_t)size, buffer->mask + 1 - offset);
+
+   memcpy(buffer->data + offset, data, first);
+   memcpy(buffer->data, (const uint8_t*)data + first, size - first);
+
+   SPSC_STORE(buffer, buffer->writer.pos, pos + (uint32_t)size);
+   spsc_notify(buffer, &buffer->reader_sleep);
+   return size;
+}
+
+size_t spsc_read(spsc_buffer_t *buffer, void *data, size_t size)
+{
+   uint32_t offset, first;
+   uint32_t pos   = buffer->reader.pos;
+   uint32_t avail = buffer->reader.other - pos;
+
+   if (avail < size)
+   {
+      buffer->reader.other = SPSC_LOAD(buffer, buffer->writer.pos);
+      avail                = buffer->reader.other - pos;
+   }
+
+   size = MIN(size, avail);
+   if (!size)
+      return 0;
+
+   offset = pos & buffer->mask;
+   first  = MIN((uint32_t)size, buffer->mask + 1 - offset);
+
+   memcpy(data, buffer->data + offset, first);
+   memcpy((uint8_t*)data + first, buffer->data, size - first);
+
+   SPSC_STORE(buffer, buffer->reader.pos, pos + (uint32_t)size);
+   spsc_notify(buffer, &buffer->writer_sleep);
+   return size;
+}
+
+size_t spsc_write_avail(spsc_buffer_t *buffer)
+{
+   return buffer->capacity - (SPSC_LOAD(buffer, buffer->writer.pos) -
+         SPSC_LOAD(buffer, buffer->reader.pos));
+}
+
+size_t spsc_read_avail(spsc_buffer_t *buffer)
+{
+   return SPSC_LOAD(buffer, buffer->writer.pos) -
+      SPSC_LOAD(buffer, buffer->reader.pos);
+}
+
+/* Sleeps until ready() says so, spsc_wake is called or time runs out */
+static bool spsc_wait(spsc_buffer_t *buffer, struct spsc_sleeper *sleeper,
+      size_t (*ready)(spsc_buffer_t*), size_t size, int64_t timeout_us)
+{
+#ifdef HAVE_THREADS
+   retro_time_t deadline = 0;
+#endif
+
+   if (size > buffer->capacity)
+      return false;
+   if (ready(buffer) >= size)
+      return true;
+
+#ifdef HAVE_THREADS
+   if (timeout_us >= 0)
+      deadline = cpu_features_get_time_usec() + timeout_us;
+
+   for (;;)
+   {
+      uint32_t seq      = SPSC_LOAD(buffer, sleeper->seq);
+      retro_time_t left = -1;
+
+      if (SPSC_EXCHANGE(buffer, sleeper->woken, 0))
+         return false;
+
+      SPSC_STORE(buffer, sleeper->waiting, 1);
+      SPSC_FENCE();
+
+      if (ready(buffer) >= size)
+      {
+         SPSC_STORE(buffer, sleeper->waiting, 0);
+         return true;
+      }
+
+      if (timeout_us >= 0)
+      {
+         left = deadline - cpu_features_get_time_usec();
+         if (left <= 0)
+         {
+            SPSC_STORE(buffer, sleeper->waiting, 0);
+            return false;
+         }
+      }
+
+#ifdef SPSC_HAVE_FUTEX
+      {
+         struct timespec ts;
+         struct timespec *tsp = NULL;
+
+         if (left >= 0)
+         {
+            ts.tv_sec  = (time_t)(left / 1000000);
+            ts.tv_nsec = (long)(left % 1000000) * 1000;
+            tsp        = &ts;
+         }
+
+         /* Returns at once if seq has moved on since we looked */
+         syscall(SYS_futex, &sleeper->seq, FUTEX_WAIT_PRIVATE, seq,
+               tsp, NULL, 0);
+      }
+#else
+      slock_lock(buffer->wait_lock);
+      if (SPSC_LOAD(buffer, sleeper->seq) == seq)
+      {
+         if (left >= 0)
+            scond_wait_timeout(buffer->wait_cond, buffer->wait_lock, left);
+         else
+            scond_wait(buffer->wait_cond, buffer->wait_lock);
+      }
+      slock_unlock(buffer->wait_lock);
+#endif
+
+      if (ready(buffer) >= size)
+      {
+         SPSC_STORE(buffer, sleeper->waiting, 0);
+         return true;
+      }
+   }
+#else
+   return false;
+#endif
+}
+
+bool spsc_wait_write(spsc_buffer_t *buffer, size_t size, int64_t timeout_us)
+{
+   return spsc_wait(buffer, &buffer->writer_sleep, spsc_write_avail,
+         size, timeout_us);
+}
+
+bool spsc_wait_read(spsc_buffer_t *buffer, size_t size, int64_t timeout_us)
+{
+   return spsc_wait(buffer, &buffer->reader_sleep, spsc_read_avail,
+         size, timeout_us);
+}
+
+static void spsc_wake_sleeper(spsc_buffer_t *buffer,
+      struct spsc_sleeper *sleeper)
+{
+   SPSC_STORE(buffer, sleeper->woken, 1);
+   SPSC_STORE(buffer, sleeper->waiting, 1);
+   spsc_notify(buffer, sleeper);
+}
+
+void spsc_wake(spsc_buffer_t *buffer)
+{
+   spsc_wake_sleeper(buffer, &buffer->writer_sleep);
+   spsc_wake_sleeper(buffer, &buffer->reader_sleep);
+}
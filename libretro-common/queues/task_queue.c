@@ -285,60 +285,261 @@ static struct retro_task_impl impl_regular = {
 };
 
 #ifdef HAVE_THREADS
+/* The threaded implementation is a small work-stealing pool.
+ *
+ * tasks_running stays the registry of every live task (find,
+ * cancel, retrieve and progress reporting walk it), while the
+ * tasks themselves are handed to the workers through per-worker
+ * deques, one per priority level. A worker pops from the front
+ * of its own deque and puts unfinished tasks back at the end of
+ * it, so a worker round-robins over the tasks it owns. An idle
+ * worker steals from the back of the other workers' deques.
+ * Higher priority work is always searched first, both locally
+ * and when stealing.
+ *
+ * Serial tasks go to a separate set of deques that only the
+ * first worker takes from and nobody steals from, so they run
+ * one at a time, like they all did on the old single worker. */
+#define TASK_POOL_PRIORITIES 3
+#define TASK_POOL_DEQUE_MIN  16
+
+typedef struct
+{
+   slock_t *lock;
+   retro_task_t **tasks;
+   size_t head;
+   size_t count;
+   size_t capacity;
+} task_deque_t;
+
+typedef struct
+{
+   sthread_t *thread;
+   task_deque_t deques[TASK_POOL_PRIORITIES];
+   unsigned id;
+} task_worker_t;
+
 static slock_t *running_lock    = NULL;
 static slock_t *finished_lock   = NULL;
 static slock_t *property_lock   = NULL;
 static slock_t *queue_lock      = NULL;
 static scond_t *worker_cond     = NULL;
-static sthread_t *worker_thread = NULL;
-static bool worker_continue     = true; /* use running_lock when touching it */
 
+/* use task_pool_lock when touching the next two,
+ * and when taking tasks out of the deques */
+static slock_t *task_pool_lock          = NULL;
+static unsigned task_pool_next          = 0;
+static bool worker_continue             = true;
+
+static task_worker_t *task_pool_workers = NULL;
+static task_deque_t task_pool_serial[TASK_POOL_PRIORITIES];
+static unsigned task_pool_count         = 0;
+static unsigned task_pool_target        = 1;
+
+/* Caller must hold running_lock and queue_lock */
 static void task_queue_remove(task_queue_t *queue, retro_task_t *task)
 {
-   retro_task_t     *t = NULL;
-   retro_task_t *front = NULL;
+   retro_task_t *prev = NULL;
+   retro_task_t *t    = queue->front;
+
+   for (; t; prev = t, t = t->next)
+   {
+      if (t != task)
+         continue;
+
+      if (prev)
+         prev->next   = t->next;
+      else
+         queue->front = t->next;
+
+      if (queue->back == t)
+         queue->back  = prev;
+
+      t->next         = NULL;
+      break;
+   }
+}
+
+static unsigned task_pool_slot(retro_task_t *task)
+{
+   switch (task->priority)
+   {
+      case TASK_PRIORITY_HIGH:
+         return 0;
+      case TASK_PRIORITY_LOW:
+         return 2;
+      case TASK_PRIORITY_NORMAL:
+      default:
+         break;
+   }
+
+   return 1;
+}
+
+static bool task_deque_push(task_deque_t *deque, retro_task_t *task)
+{
+   bool ret = true;
+
+   slock_lock(deque->lock);
+
+   if (deque->count == deque->capacity)
+   {
+      size_t i;
+      size_t capacity       = deque->capacity ?
+         deque->capacity * 2 : TASK_POOL_DEQUE_MIN;
+      retro_task_t **tasks  = (retro_task_t**)
+         malloc(capacity * sizeof(*tasks));
+
+      if (!tasks)
+      {
+         ret = false;
+         goto end;
+      }
+
+      for (i = 0; i < deque->count; i++)
+         tasks[i] = deque->tasks[(deque->head + i) % deque->capacity];
+
+      free(deque->tasks);
+      deque->tasks    = tasks;
+      deque->head     = 0;
+      deque->capacity = capacity;
+   }
+
+   deque->tasks[(deque->head + deque->count) % deque->capacity] = task;
+   deque->count++;
+
+end:
+   slock_unlock(deque->lock);
+   return ret;
+}
+
+static retro_task_t *task_deque_pop_front(task_deque_t *deque)
+{
+   retro_task_t *task = NULL;
+
+   slock_lock(deque->lock);
+   if (deque->count)
+   {
+      task        = deque->tasks[deque->head];
+      deque->head = (deque->head + 1) % deque->capacity;
+      deque->count--;
+   }
+   slock_unlock(deque->lock);
+
+   return task;
+}
 
+static retro_task_t *task_deque_pop_back(task_deque_t *deque)
+{
+   retro_task_t *task = NULL;
+
+   slock_lock(deque->lock);
+   if (deque->count)
+   {
+      deque->count--;
+      task = deque->tasks[(deque->head + deque->count) % deque->capacity];
+   }
+   slock_unlock(deque->lock);
+
+   return task;
+}
+
+/* Moves a task out of the registry and hands it
+ * over to the main thread for its callback. */
+static void task_pool_retire(retro_task_t *task)
+{
+   slock_lock(running_lock);
    slock_lock(queue_lock);
-   front = queue->front;
+   task_queue_remove(&tasks_running, task);
    slock_unlock(queue_lock);
+   slock_unlock(running_lock);
+
+   slock_lock(finished_lock);
+   task_queue_put(&tasks_finished, task);
+   slock_unlock(finished_lock);
+}
 
-   /* Remove first element if needed */
-   if (task == front)
+static void task_pool_enqueue(unsigned id, retro_task_t *task, bool wake)
+{
+   unsigned slot       = task_pool_slot(task);
+   task_deque_t *deque = task->serial
+      ? &task_pool_serial[slot]
+      : &task_pool_workers[id].deques[slot];
+
+   if (!task_deque_push(deque, task))
    {
-      slock_lock(queue_lock);
-      queue->front = task->next;
-      slock_unlock(queue_lock);
-      task->next   = NULL;
+      /* Out of memory, the task can't be scheduled. */
+      slock_lock(property_lock);
+      task->cancelled = true;
+      task->finished  = true;
+      slock_unlock(property_lock);
 
+      task_pool_retire(task);
       return;
    }
 
-   /* Parse queue */
-   t = front;
+   if (!wake)
+      return;
 
-   while (t && t->next)
+   /* Any worker can run a regular task, but only
+    * the first one can run a serial task. */
+   slock_lock(task_pool_lock);
+   if (task->serial)
+      scond_broadcast(worker_cond);
+   else
+      scond_signal(worker_cond);
+   slock_unlock(task_pool_lock);
+}
+
+/* Own deque first, then the serial one if it's ours,
+ * then the other workers', one priority level at a time.
+ * Caller must hold task_pool_lock. */
+static retro_task_t *task_pool_take(unsigned id)
+{
+   unsigned slot;
+
+   for (slot = 0; slot < TASK_POOL_PRIORITIES; slot++)
    {
-      /* Remove task and update queue */
-      if (t->next == task)
+      unsigned i;
+      retro_task_t *task = task_deque_pop_front(
+            &task_pool_workers[id].deques[slot]);
+
+      if (task)
+         return task;
+
+      if (id == 0 && (task = task_deque_pop_front(&task_pool_serial[slot])))
+         return task;
+
+      for (i = 1; i < task_pool_count; i++)
       {
-         t->next    = task->next;
-         task->next = NULL;
-         break;
-      }
+         unsigned victim = (id + i) % task_pool_count;
 
-      /* Update iterator */
-      t = t->next;
+         task = task_deque_pop_back(
+               &task_pool_workers[victim].deques[slot]);
+
+         if (task)
+            return task;
+      }
    }
+
+   return NULL;
 }
 
 static void retro_task_threaded_push_running(retro_task_t *task)
 {
+   unsigned id;
+
    slock_lock(running_lock);
    slock_lock(queue_lock);
    task_queue_put(&tasks_running, task);
-   scond_signal(worker_cond);
    slock_unlock(queue_lock);
    slock_unlock(running_lock);
+
+   slock_lock(task_pool_lock);
+   id = task_pool_next++ % task_pool_count;
+   slock_unlock(task_pool_lock);
+
+   task_pool_enqueue(id, task, true);
 }
 
 static void retro_task_threaded_cancel(void *task)
@@ -436,28 +637,25 @@ static void retro_task_threaded_retrieve(task_retriever_data_t *data)
 
 static void threaded_worker(void *userdata)
 {
-   (void)userdata;
+   task_worker_t *worker = (task_worker_t*)userdata;
 
    for (;;)
    {
       retro_task_t *task  = NULL;
       bool finished = false;
 
-      if (!worker_continue)
-         break; /* should we keep running until all tasks finished? */
+      slock_lock(task_pool_lock);
 
-      slock_lock(running_lock);
+      /* Pushes signal under task_pool_lock after the task is
+       * in its deque, so nothing is missed between the take
+       * and the wait. */
+      while (worker_continue && !(task = task_pool_take(worker->id)))
+         scond_wait(worker_cond, task_pool_lock);
 
-      /* Get first task to run */
-      task = tasks_running.front;
-      if (task == NULL)
-      {
-         scond_wait(worker_cond, running_lock);
-         slock_unlock(running_lock);
-         continue;
-      }
+      slock_unlock(task_pool_lock);
 
-      slock_unlock(running_lock);
+      if (!task)
+         break; /* should we keep running until all tasks finished? */
 
       task->handler(task);
 
@@ -465,57 +663,110 @@ static void threaded_worker(void *userdata)
       finished = task->finished;
       slock_unlock(property_lock);
 
-      slock_lock(running_lock);
-      task_queue_remove(&tasks_running, task);
-      slock_unlock(running_lock);
-
       /* Update queue */
       if (!finished)
       {
-         /* Re-add task to running queue */
-         retro_task_threaded_push_running(task);
+         /* Re-add task to our own deque, no need to
+          * wake anybody since we will pick it up again. */
+         task_pool_enqueue(worker->id, task, false);
       }
       else
-      {
-         /* Add task to finished queue */
-         slock_lock(finished_lock);
-         task_queue_put(&tasks_finished, task);
-         slock_unlock(finished_lock);
-      }
+         task_pool_retire(task);
    }
 }
 
 static void retro_task_threaded_init(void)
 {
-   running_lock  = slock_new();
-   finished_lock = slock_new();
-   property_lock = slock_new();
-   queue_lock    = slock_new();
-   worker_cond   = scond_new();
+   unsigned i, slot;
+   retro_task_t *task = NULL;
+   retro_task_t *next = NULL;
 
-   slock_lock(running_lock);
-   worker_continue = true;
-   slock_unlock(running_lock);
+   running_lock   = slock_new();
+   finished_lock  = slock_new();
+   property_lock  = slock_new();
+   queue_lock     = slock_new();
+   worker_cond    = scond_new();
+   task_pool_lock = slock_new();
+
+   task_pool_count   = task_pool_target ? task_pool_target : 1;
+   task_pool_workers = (task_worker_t*)
+      calloc(task_pool_count, sizeof(*task_pool_workers));
 
-   worker_thread = sthread_create(threaded_worker, NULL);
+   for (i = 0; i < task_pool_count; i++)
+   {
+      task_pool_workers[i].id = i;
+      for (slot = 0; slot < TASK_POOL_PRIORITIES; slot++)
+         task_pool_workers[i].deques[slot].lock = slock_new();
+   }
+
+   for (slot = 0; slot < TASK_POOL_PRIORITIES; slot++)
+      task_pool_serial[slot].lock = slock_new();
+
+   slock_lock(task_pool_lock);
+   worker_continue  = true;
+   task_pool_next   = 0;
+   slock_unlock(task_pool_lock);
+
+   /* Reschedule the tasks left on hold by task_queue_deinit */
+   for (task = tasks_running.front; task; task = next)
+   {
+      next = task->next;
+      task_pool_enqueue(task_pool_next++ % task_pool_count, task, false);
+   }
+
+   for (i = 0; i < task_pool_count; i++)
+      task_pool_workers[i].thread = sthread_create(
+            threaded_worker, &task_pool_workers[i]);
 }
 
 static void retro_task_threaded_deinit(void)
 {
-   slock_lock(running_lock);
+   unsigned i, slot;
+
+   slock_lock(task_pool_lock);
    worker_continue = false;
-   scond_signal(worker_cond);
-   slock_unlock(running_lock);
+   scond_broadcast(worker_cond);
+   slock_unlock(task_pool_lock);
+
+   for (i = 0; i < task_pool_count; i++)
+      sthread_join(task_pool_workers[i].thread);
+
+   /* Whatever is left in the deques is still
+    * referenced by tasks_running. */
+   for (i = 0; i < task_pool_count; i++)
+   {
+      for (slot = 0; slot < TASK_POOL_PRIORITIES; slot++)
+      {
+         slock_free(task_pool_workers[i].deques[slot].lock);
+         free(task_pool_workers[i].deques[slot].tasks);
+      }
+   }
 
-   sthread_join(worker_thread);
+   for (slot = 0; slot < TASK_POOL_PRIORITIES; slot++)
+   {
+      task_deque_t *deque = &task_pool_serial[slot];
+
+      slock_free(deque->lock);
+      free(deque->tasks);
+      deque->lock     = NULL;
+      deque->tasks    = NULL;
+      deque->head     = 0;
+      deque->count    = 0;
+      deque->capacity = 0;
+   }
+
+   free(task_pool_workers);
 
    scond_free(worker_cond);
+   slock_free(task_pool_lock);
    slock_free(running_lock);
    slock_free(finished_lock);
    slock_free(property_lock);
    slock_free(queue_lock);
 
-   worker_thread = NULL;
+   task_pool_workers = NULL;
+   task_pool_count   = 0;
+   task_pool_lock    = NULL;
    worker_cond   = NULL;
    running_lock  = NULL;
    finished_lock = NULL;
@@ -566,6 +817,13 @@ void task_queue_init(bool threaded, retro_task_queue_msg_t msg_push)
    impl_current->init();
 }
 
+void task_queue_set_worker_count(unsigned count)
+{
+#ifdef HAVE_THREADS
+   task_pool_target = count ? count : 1;
+#endif
+}
+
 void task_queue_set_threaded(void)
 {
    task_threaded_enable = true;
@@ -0,0 +1,207 @@
+/* Copyright  (C) 2010-2017 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (crc32_bench.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/* Checks every CRC32 implementation available on this machine
+ * against a plain bytewise reference (odd lengths, misaligned
+ * starts, chained calls) and reports their throughput in MB/s
+ * for a range of buffer sizes. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <features/features_cpu.h>
+
+#include "../../../encodings/encoding_crc32.c"
+
+struct crc32_variant
+{
+   const char *name;
+   crc32_func_t func;
+};
+
+static uint32_t crc32_bytewise(uint32_t crc, const uint8_t *buf, size_t len)
+{
+   while (len--)
+      crc = crc32_table[0][(crc ^ *buf++) & 0xff] ^ (crc >> 8);
+   return crc;
+}
+
+static uint32_t crc32_dispatched(uint32_t crc, const uint8_t *buf, size_t len)
+{
+   return encoding_crc32(crc ^ 0xffffffff, buf, len) ^ 0xffffffff;
+}
+
+static struct crc32_variant variants[4];
+static unsigned variant_count = 0;
+
+static void add_variant(const char *name, crc32_func_t func)
+{
+   variants[variant_count].name = name;
+   variants[variant_count].func = func;
+   variant_count++;
+}
+
+static uint32_t rng_state = 0x12345678;
+
+static uint32_t rng(void)
+{
+   rng_state ^= rng_state << 13;
+   rng_state ^= rng_state >> 17;
+   rng_state ^= rng_state << 5;
+   return rng_state;
+}
+
+static bool verify(const uint8_t *data, size_t size)
+{
+   unsigned i, v;
+
+   /* Known answer for "123456789" */
+   for (v = 0; v < variant_count; v++)
+   {
+      uint32_t crc = variants[v].func(0xffffffff,
+            (const uint8_t*)"123456789", 9) ^ 0xffffffff;
+      if (crc != 0xcbf43926)
+      {
+         printf("%s: check value %08x\n", variants[v].name, crc);
+         return false;
+      }
+   }
+
+   for (i = 0; i < 20000; i++)
+   {
+      size_t len    = (i < 300) ? i : rng() % (i & 1 ? 300 : 70000);
+      size_t offset = rng() % 64;
+      size_t split  = len ? rng() % len : 0;
+      uint32_t seed = (i & 3) ? rng() : 0xffffffff;
+      uint32_t ref  = crc32_bytewise(seed, data + offset, len);
+
+      if (offset + len > size)
+         continue;
+
+      for (v = 0; v < variant_count; v++)
+      {
+         crc32_func_t f = variants[v].func;
+         uint32_t crc   = f(seed, data + offset, len);
+         uint32_t part  = f(f(seed, data + offset, split),
+               data + offset + split, len - split);
+
+         if (crc != ref || part != ref)
+         {
+            printf("%s: mismatch, len %u offset %u split %u: "
+                  "%08x / %08x, expected %08x\n", variants[v].name,
+                  (unsigned)len, (unsigned)offset, (unsigned)split,
+                  crc, part, ref);
+            return false;
+         }
+      }
+   }
+
+   return true;
+}
+
+static void bench(const uint8_t *data, size_t size, size_t total)
+{
+   unsigned v;
+
+   printf("%9u", (unsigned)size);
+
+   for (v = 0; v < variant_count; v++)
+   {
+      size_t done;
+      retro_time_t start, end;
+      uint32_t crc = 0;
+
+      start = cpu_features_get_time_usec();
+      for (done = 0; done < total; done += size)
+         crc = variants[v].func(crc, data, size);
+      end = cpu_features_get_time_usec();
+
+      if (end <= start)
+         end = start + 1;
+
+      /* Print something derived from crc so the loop stays */
+      printf(" %10.1f%c", (double)done / (end - start),
+            crc == 0x5eed ? '*' : ' ');
+   }
+
+   printf("\n");
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned v;
+   size_t i, size;
+   size_t total   = 256 * 1024 * 1024;
+   size_t max     = 4 * 1024 * 1024;
+   uint8_t *data  = NULL;
+
+   if (argc > 1)
+      total = (size_t)strtoul(argv[1], NULL, 0) * 1024 * 1024;
+
+   if (!total)
+   {
+      fprintf(stderr, "Usage: %s [MB per measurement]\n", argv[0]);
+      return 1;
+   }
+
+   data = (uint8_t*)malloc(max + 64);
+   if (!data)
+      return 1;
+
+   for (i = 0; i < max + 64; i++)
+      data[i] = (uint8_t)rng();
+
+   add_variant("bytewise", crc32_bytewise);
+   add_variant("slice-8", crc32_slice8);
+#ifdef CRC32_PCLMUL
+   if (crc32_has_pclmul())
+      add_variant("pclmul", crc32_pclmul);
+#endif
+#if defined(CRC32_ARMV8_HWCAP)
+   if (getauxval(AT_HWCAP) & HWCAP_CRC32)
+      add_variant("armv8", crc32_armv8);
+#elif defined(CRC32_ARMV8)
+   add_variant("armv8", crc32_armv8);
+#endif
+   add_variant("dispatch", crc32_dispatched);
+
+   if (!verify(data, max + 64))
+   {
+      printf("FAILED\n");
+      free(data);
+      return 1;
+   }
+
+   printf("All implementations match the bytewise reference.\n\n");
+   printf("Throughput in MB/s\n%9s", "size");
+   for (v = 0; v < variant_count; v++)
+      printf(" %11s", variants[v].name);
+   printf("\n");
+
+   for (size = 16; size <= max; size *= 4)
+      bench(data, size, total);
+
+   free(data);
+   return 0;
+}
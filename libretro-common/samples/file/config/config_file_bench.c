@@ -0,0 +1,312 @@
+/* Copyright  (C) 2010-2017 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (config_file_bench.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/* Benchmarks config_file on the two workloads the frontend puts on
+ * it: reading (and saving) a full retroarch.cfg, and reading every
+ * core .info file the way core_info_list_new does.
+ *
+ * Without -c or -i, a synthetic config of ~2000 keys (a saved
+ * retroarch.cfg has ~2800) and 400 .info files are generated in the
+ * current directory and removed afterwards. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <retro_miscellaneous.h>
+#include <file/config_file.h>
+#include <file/file_path.h>
+#include <lists/dir_list.h>
+#include <lists/string_list.h>
+#include <features/features_cpu.h>
+
+static const char *info_keys[] = {
+   "display_name", "corename", "systemname", "manufacturer",
+   "supported_extensions", "authors", "permissions", "license",
+   "categories", "database", "notes", "supports_no_game",
+   "database_match_archive_member", "firmware_count", "display_version"
+};
+
+static void write_config(const char *path)
+{
+   unsigned i, j;
+   static const char *buttons[] = {
+      "a", "b", "x", "y", "l", "r", "l2", "r2", "l3", "r3",
+      "start", "select", "up", "down", "left", "right" };
+   FILE *file = fopen(path, "w");
+
+   if (!file)
+      return;
+
+   for (i = 0; i < 600; i++)
+      fprintf(file, "setting_number_%u = \"%u\"\n", i, i * 7);
+   for (i = 0; i < 200; i++)
+      fprintf(file, "some_directory_%u = \"~/.config/retroarch/dir%u\"\n", i, i);
+
+   /* The per-player binds make up most of a real config */
+   for (i = 1; i <= 16; i++)
+      for (j = 0; j < 16; j++)
+      {
+         fprintf(file, "input_player%u_%s = \"nul\"\n", i, buttons[j]);
+         fprintf(file, "input_player%u_%s_btn = \"%u\"\n", i, buttons[j], j);
+         fprintf(file, "input_player%u_%s_axis = \"nul\"\n", i, buttons[j]);
+         fprintf(file, "input_player%u_%s_mbtn = \"nul\"\n", i, buttons[j]);
+         if (j < 8)
+            fprintf(file, "input_player%u_%s_analog = \"nul\"\n", i, buttons[j]);
+      }
+
+   fclose(file);
+}
+
+static void write_info(const char *dir, unsigned count)
+{
+   unsigned i, j;
+   char path[PATH_MAX_LENGTH];
+
+   path_mkdir(dir);
+
+   for (i = 0; i < count; i++)
+   {
+      FILE *file = NULL;
+
+      snprintf(path, sizeof(path), "%s/core%u_libretro.info", dir, i);
+      if (!(file = fopen(path, "w")))
+         continue;
+
+      fprintf(file, "# Software Information\n");
+      fprintf(file, "display_name = \"Manufacturer - System (Core %u)\"\n", i);
+      fprintf(file, "authors = \"Author A|Author B\"\n");
+      fprintf(file, "supported_extensions = \"bin|rom|zip|%u\"\n", i);
+      fprintf(file, "corename = \"Core %u\"\n", i);
+      fprintf(file, "manufacturer = \"Manufacturer\"\n");
+      fprintf(file, "categories = \"Emulator\"\n");
+      fprintf(file, "systemname = \"System %u\"\n", i % 40);
+      fprintf(file, "systemid = \"system_%u\"\n", i % 40);
+      fprintf(file, "database = \"Manufacturer - System %u\"\n", i % 40);
+      fprintf(file, "license = \"GPLv2\"\n");
+      fprintf(file, "permissions = \"\"\n");
+      fprintf(file, "display_version = \"v1.%u\"\n", i);
+      fprintf(file, "supports_no_game = \"false\"\n\n");
+      fprintf(file, "# Hardware Information\n");
+      for (j = 0; j < 12; j++)
+         fprintf(file, "savestate_feature_%u = \"true\"\n", j);
+      fprintf(file, "firmware_count = 3\n");
+      for (j = 0; j < 3; j++)
+      {
+         fprintf(file, "firmware%u_desc = \"bios%u.bin (BIOS)\"\n", j, j);
+         fprintf(file, "firmware%u_path = \"bios%u.bin\"\n", j, j);
+         fprintf(file, "firmware%u_opt = \"true\"\n", j);
+      }
+      fprintf(file, "notes = \"(!) bios0.bin (md5): 0123456789abcdef|(!) bios1.bin\"\n");
+      fclose(file);
+   }
+}
+
+/* Reads every key of the config, like config_load_file does */
+static double bench_config(const char *path, unsigned iterations,
+      unsigned *keys)
+{
+   unsigned i;
+   retro_time_t start;
+   struct string_list *names = string_list_new();
+   union string_list_elem_attr attr;
+   config_file_t *conf       = config_file_new(path);
+   struct config_file_entry entry;
+
+   attr.i = 0;
+
+   if (!conf || !names)
+      return -1;
+
+   if (config_get_entry_list_head(conf, &entry))
+      do
+      {
+         string_list_append(names, entry.key, attr);
+      } while (config_get_entry_list_next(&entry));
+
+   config_file_free(conf);
+
+   *keys = (unsigned)names->size;
+   start = cpu_features_get_time_usec();
+
+   for (i = 0; i < iterations; i++)
+   {
+      size_t j;
+      char buf[PATH_MAX_LENGTH];
+
+      conf = config_file_new(path);
+      for (j = 0; j < names->size; j++)
+         config_get_array(conf, names->elems[j].data, buf, sizeof(buf));
+      config_file_free(conf);
+   }
+
+   string_list_free(names);
+
+   return (cpu_features_get_time_usec() - start) / 1000.0 / iterations;
+}
+
+/* Sets every key again and writes the config out */
+static double bench_save(const char *path, const char *out,
+      unsigned iterations)
+{
+   unsigned i;
+   retro_time_t start = cpu_features_get_time_usec();
+
+   for (i = 0; i < iterations; i++)
+   {
+      struct config_file_entry entry;
+      config_file_t *conf = config_file_new(path);
+      config_file_t *copy = config_file_new(NULL);
+
+      if (config_get_entry_list_head(conf, &entry))
+         do
+         {
+            config_set_string(copy, entry.key, entry.value);
+            config_set_string(conf, entry.key, "changed");
+         } while (config_get_entry_list_next(&entry));
+
+      config_file_write(copy, out);
+      config_file_free(copy);
+      config_file_free(conf);
+   }
+
+   return (cpu_features_get_time_usec() - start) / 1000.0 / iterations;
+}
+
+static double bench_info(const char *dir, unsigned iterations,
+      unsigned *files)
+{
+   unsigned i;
+   retro_time_t start;
+   struct string_list *list = dir_list_new(dir, "info",
+         false, false, false, false);
+
+   if (!list)
+      return -1;
+
+   *files = (unsigned)list->size;
+   start  = cpu_features_get_time_usec();
+
+   for (i = 0; i < iterations; i++)
+   {
+      size_t j;
+
+      for (j = 0; j < list->size; j++)
+      {
+         unsigned k;
+         config_file_t *conf = config_file_new(list->elems[j].data);
+
+         if (!conf)
+            continue;
+
+         for (k = 0; k < sizeof(info_keys) / sizeof(info_keys[0]); k++)
+         {
+            char *tmp = NULL;
+            if (config_get_string(conf, info_keys[k], &tmp))
+               free(tmp);
+         }
+
+         config_file_free(conf);
+      }
+   }
+
+   dir_list_free(list);
+
+   return (cpu_features_get_time_usec() - start) / 1000.0 / iterations;
+}
+
+int main(int argc, char *argv[])
+{
+   int i;
+   double ms;
+   unsigned count          = 0;
+   unsigned iterations     = 20;
+   const char *config      = NULL;
+   const char *info        = NULL;
+   bool own_config         = false;
+   bool own_info           = false;
+
+   for (i = 1; i < argc; i++)
+   {
+      if (!strcmp(argv[i], "-c") && i + 1 < argc)
+         config = argv[++i];
+      else if (!strcmp(argv[i], "-i") && i + 1 < argc)
+         info = argv[++i];
+      else if (!strcmp(argv[i], "-n") && i + 1 < argc)
+         iterations = (unsigned)strtoul(argv[++i], NULL, 0);
+      else
+      {
+         fprintf(stderr, "Usage: %s [-c config] [-i info dir] [-n iterations]\n",
+               argv[0]);
+         return 1;
+      }
+   }
+
+   if (!iterations)
+      return 1;
+
+   if (!config)
+   {
+      config     = "config_file_bench.cfg";
+      own_config = true;
+      write_config(config);
+   }
+
+   if (!info)
+   {
+      info       = "config_file_bench_info";
+      own_info   = true;
+      write_info(info, 400);
+   }
+
+   ms = bench_config(config, iterations, &count);
+   printf("config: %u keys, load + get all: %8.3f ms\n", count, ms);
+
+   ms = bench_save(config, "config_file_bench.out", iterations);
+   printf("config: %u keys, set all + write: %7.3f ms\n", count, ms);
+   remove("config_file_bench.out");
+
+   ms = bench_info(info, iterations, &count);
+   printf("info: %u files, load + get %u keys each: %8.3f ms\n", count,
+         (unsigned)(sizeof(info_keys) / sizeof(info_keys[0])), ms);
+
+   if (own_config)
+      remove(config);
+
+   if (own_info)
+   {
+      struct string_list *list = dir_list_new(info, "info",
+            false, false, false, false);
+
+      if (list)
+      {
+         size_t j;
+         for (j = 0; j < list->size; j++)
+            remove(list->elems[j].data);
+         dir_list_free(list);
+      }
+      remove(info);
+   }
+
+   return 0;
+}
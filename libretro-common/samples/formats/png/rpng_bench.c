@@ -0,0 +1,250 @@
+/* Copyright  (C) 2010-2017 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (rpng_bench.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Decodes a corpus of PNG files from memory, the way task_image
+ * does, and reports the decode rate and a checksum of the pixels.
+ *
+ * Usage: rpng_bench [-n iterations] [-g count] [file.png ...]
+ *
+ * -g writes 'count' synthetic thumbnail-sized PNGs (RGB and RGBA,
+ * boxart-like gradients with noise) to the current directory and
+ * adds them to the corpus. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <formats/rpng.h>
+#include <formats/image.h>
+#include <streams/file_stream.h>
+#include <encodings/crc32.h>
+#include <features/features_cpu.h>
+
+struct bench_file
+{
+   char path[256];
+   void *buf;
+   ssize_t len;
+};
+
+static uint32_t bench_rand_state = 1;
+
+static uint32_t bench_rand(void)
+{
+   bench_rand_state = bench_rand_state * 1103515245 + 12345;
+   return bench_rand_state >> 8;
+}
+
+static bool bench_generate(const char *path, unsigned index)
+{
+   unsigned x, y;
+   bool ret         = false;
+   unsigned width   = 512 - (index % 4) * 64;
+   unsigned height  = 384 + (index % 3) * 64;
+   uint32_t *pixels = (uint32_t*)malloc(width * height * sizeof(uint32_t));
+
+   if (!pixels)
+      return false;
+
+   for (y = 0; y < height; y++)
+   {
+      for (x = 0; x < width; x++)
+      {
+         /* Smooth areas with some noise, roughly like scans of
+          * game boxes; rpng_encode picks a filter per line. */
+         uint32_t noise = bench_rand() & 0x0f;
+         uint32_t r     = (x * 255 / width + noise) & 0xff;
+         uint32_t g     = (y * 255 / height + index * 16) & 0xff;
+         uint32_t b     = ((x ^ y) + noise) & 0xff;
+         uint32_t a     = (x < 16 || y < 16) ? 0x80 : 0xff;
+
+         pixels[y * width + x] = (a << 24) | (r << 16) | (g << 8) | b;
+      }
+   }
+
+   if (index & 1)
+      ret = rpng_save_image_argb(path, pixels, width, height,
+            width * sizeof(uint32_t));
+   else
+   {
+      /* 24-bit BGR, like screenshots. */
+      uint8_t *bgr = (uint8_t*)malloc(width * height * 3);
+
+      if (bgr)
+      {
+         for (y = 0; y < width * height; y++)
+         {
+            bgr[y * 3 + 0] = pixels[y] & 0xff;
+            bgr[y * 3 + 1] = (pixels[y] >> 8) & 0xff;
+            bgr[y * 3 + 2] = (pixels[y] >> 16) & 0xff;
+         }
+         ret = rpng_save_image_bgr24(path, bgr, width, height, width * 3);
+         free(bgr);
+      }
+   }
+
+   free(pixels);
+   return ret;
+}
+
+static bool bench_decode(void *buf, uint32_t **data,
+      unsigned *width, unsigned *height)
+{
+   int retval;
+   bool ret   = true;
+   rpng_t *rpng = rpng_alloc();
+
+   if (!rpng)
+      return false;
+
+   if (!rpng_set_buf_ptr(rpng, (uint8_t*)buf) || !rpng_start(rpng))
+   {
+      ret = false;
+      goto end;
+   }
+
+   while (rpng_iterate_image(rpng));
+
+   if (!rpng_is_valid(rpng))
+   {
+      ret = false;
+      goto end;
+   }
+
+   do
+   {
+      retval = rpng_process_image(rpng,
+            (void**)data, 0, width, height);
+   }while(retval == IMAGE_PROCESS_NEXT);
+
+   if (retval == IMAGE_PROCESS_ERROR || retval == IMAGE_PROCESS_ERROR_END)
+      ret = false;
+
+end:
+   rpng_free(rpng);
+   return ret;
+}
+
+int main(int argc, char *argv[])
+{
+   int i;
+   unsigned j, k;
+   retro_time_t elapsed      = 0;
+   uint64_t pixels           = 0;
+   uint64_t bytes_in         = 0;
+   uint32_t checksum         = 0;
+   unsigned iterations       = 20;
+   unsigned generate         = 0;
+   unsigned num_files        = 0;
+   struct bench_file *files  = (struct bench_file*)calloc(argc + 1024,
+         sizeof(*files));
+
+   if (!files)
+      return 1;
+
+   for (i = 1; i < argc; i++)
+   {
+      if (!strcmp(argv[i], "-n") && i + 1 < argc)
+         iterations = strtoul(argv[++i], NULL, 0);
+      else if (!strcmp(argv[i], "-g") && i + 1 < argc)
+      {
+         generate = strtoul(argv[++i], NULL, 0);
+         if (generate > 1024)
+            generate = 1024;
+      }
+      else
+         snprintf(files[num_files++].path, sizeof(files[0].path),
+               "%s", argv[i]);
+   }
+
+   for (j = 0; j < generate; j++)
+   {
+      struct bench_file *file = &files[num_files];
+
+      snprintf(file->path, sizeof(file->path), "rpng_bench_%u.png", j);
+      if (!bench_generate(file->path, j))
+      {
+         fprintf(stderr, "Could not write %s.\n", file->path);
+         return 1;
+      }
+      num_files++;
+   }
+
+   if (!num_files)
+   {
+      fprintf(stderr, "Usage: %s [-n iterations] [-g count] "
+            "[file.png ...]\n", argv[0]);
+      return 1;
+   }
+
+   for (j = 0; j < num_files; j++)
+   {
+      if (!filestream_read_file(files[j].path, &files[j].buf, &files[j].len))
+      {
+         fprintf(stderr, "Could not read %s.\n", files[j].path);
+         return 1;
+      }
+      bytes_in += files[j].len;
+   }
+
+   for (k = 0; k < iterations; k++)
+   {
+      for (j = 0; j < num_files; j++)
+      {
+         uint32_t *data  = NULL;
+         unsigned width  = 0;
+         unsigned height = 0;
+         retro_time_t start = cpu_features_get_time_usec();
+         bool ok = bench_decode(files[j].buf, &data, &width, &height);
+
+         elapsed += cpu_features_get_time_usec() - start;
+
+         if (!ok)
+         {
+            fprintf(stderr, "Could not decode %s.\n", files[j].path);
+            free(data);
+            return 1;
+         }
+
+         pixels += width * height;
+         if (!k)
+            checksum = encoding_crc32(checksum, (const uint8_t*)data,
+                  width * height * sizeof(uint32_t));
+         free(data);
+      }
+   }
+
+   printf("%u images, %u iterations: %.3f ms per image, "
+         "%.1f Mpixels/s, %.1f MB/s compressed in, checksum %08x\n",
+         num_files, iterations,
+         elapsed / (1000.0 * num_files * iterations),
+         (double)pixels / (elapsed ? elapsed : 1),
+         (double)bytes_in * iterations / (elapsed ? elapsed : 1),
+         checksum);
+
+   for (j = 0; j < num_files; j++)
+      free(files[j].buf);
+   free(files);
+
+   return 0;
+}
@@ -0,0 +1,300 @@
+/* Copyright  (C) 2010-2017 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (task_queue_test.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Stress test for the threaded task queue.
+ *
+ * Pushes a burst of synthetic incremental tasks (a mix of high,
+ * normal and low priority), drains the queue from the "main thread"
+ * and reports throughput plus push-to-callback latency percentiles
+ * for every worker count from 1 up to the number of cores.
+ * Every task must complete exactly once, and no two serial tasks
+ * may ever run at the same time, otherwise the test fails. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <queues/task_queue.h>
+#include <features/features_cpu.h>
+#include <rthreads/rthreads.h>
+#include <retro_timers.h>
+
+struct stress_task
+{
+   retro_time_t pushed;
+   retro_time_t done;
+   unsigned slices;
+   unsigned completions;
+   uint32_t sink;
+};
+
+static struct stress_task *stress_tasks = NULL;
+static unsigned stress_slices           = 8;
+static unsigned stress_work             = 2000;
+static unsigned stress_done             = 0;
+
+/* use stress_serial_lock when touching the next two */
+static slock_t *stress_serial_lock      = NULL;
+static unsigned stress_serial_running   = 0;
+static unsigned stress_serial_overlaps  = 0;
+
+static void stress_handler(retro_task_t *task)
+{
+   unsigned i;
+   struct stress_task *st = (struct stress_task*)task->state;
+   uint32_t x             = st->sink | 1;
+
+   if (task->serial)
+   {
+      slock_lock(stress_serial_lock);
+      if (stress_serial_running++)
+         stress_serial_overlaps++;
+      slock_unlock(stress_serial_lock);
+   }
+
+   /* xorshift, just something the compiler can't drop */
+   for (i = 0; i < stress_work; i++)
+   {
+      x ^= x << 13;
+      x ^= x >> 17;
+      x ^= x << 5;
+   }
+
+   st->sink = x;
+
+   if (task->serial)
+   {
+      slock_lock(stress_serial_lock);
+      stress_serial_running--;
+      slock_unlock(stress_serial_lock);
+   }
+
+   if (++st->slices >= stress_slices)
+      task_set_finished(task, true);
+}
+
+static void stress_callback(void *task_data, void *user_data,
+      const char *error)
+{
+   struct stress_task *st = (struct stress_task*)user_data;
+
+   st->done = cpu_features_get_time_usec();
+   st->completions++;
+   stress_done++;
+}
+
+static enum task_priority stress_priority(unsigned i)
+{
+   /* 10% high, 30% low, the rest normal */
+   switch (i % 10)
+   {
+      case 0:
+         return TASK_PRIORITY_HIGH;
+      case 1:
+      case 4:
+      case 7:
+         return TASK_PRIORITY_LOW;
+      default:
+         break;
+   }
+   return TASK_PRIORITY_NORMAL;
+}
+
+static int compare_time(const void *a, const void *b)
+{
+   retro_time_t x = *(const retro_time_t*)a;
+   retro_time_t y = *(const retro_time_t*)b;
+   return (x > y) - (x < y);
+}
+
+static void print_latency(const char *label, retro_time_t *lat, unsigned count)
+{
+   if (!count)
+      return;
+
+   qsort(lat, count, sizeof(*lat), compare_time);
+   printf("   %-7s p50 %8.2f ms  p90 %8.2f ms  p99 %8.2f ms\n", label,
+         lat[count * 50 / 100] / 1000.0,
+         lat[count * 90 / 100] / 1000.0,
+         lat[count * 99 / 100] / 1000.0);
+}
+
+static bool run(unsigned workers, unsigned count)
+{
+   unsigned i;
+   unsigned n[3];
+   retro_time_t start, end;
+   retro_time_t *lat[3];
+   bool ok = true;
+
+   memset(stress_tasks, 0, count * sizeof(*stress_tasks));
+   stress_done            = 0;
+   stress_serial_overlaps = 0;
+
+   task_queue_set_worker_count(workers);
+   task_queue_init(true, NULL);
+
+   start = cpu_features_get_time_usec();
+
+   for (i = 0; i < count; i++)
+   {
+      retro_task_t *task = (retro_task_t*)calloc(1, sizeof(*task));
+
+      task->handler         = stress_handler;
+      task->callback        = stress_callback;
+      task->state           = &stress_tasks[i];
+      task->user_data       = &stress_tasks[i];
+      task->priority        = stress_priority(i);
+      /* every fifth task pretends to share state */
+      task->serial          = (i % 5) == 2;
+      stress_tasks[i].sink  = i;
+      stress_tasks[i].pushed = cpu_features_get_time_usec();
+
+      task_queue_push(task);
+   }
+
+   while (stress_done < count)
+   {
+      task_queue_check();
+      retro_sleep(1);
+   }
+
+   end = cpu_features_get_time_usec();
+
+   task_queue_deinit();
+
+   for (i = 0; i < 3; i++)
+   {
+      lat[i] = (retro_time_t*)malloc(count * sizeof(retro_time_t));
+      n[i]   = 0;
+   }
+
+   for (i = 0; i < count; i++)
+   {
+      struct stress_task *st = &stress_tasks[i];
+      unsigned slot          = 0;
+
+      if (st->completions != 1 || st->slices != stress_slices)
+      {
+         printf("task %u: %u completions, %u slices\n",
+               i, st->completions, st->slices);
+         ok = false;
+      }
+
+      switch (stress_priority(i))
+      {
+         case TASK_PRIORITY_HIGH:
+            slot = 0;
+            break;
+         case TASK_PRIORITY_NORMAL:
+            slot = 1;
+            break;
+         case TASK_PRIORITY_LOW:
+            slot = 2;
+            break;
+      }
+
+      lat[slot][n[slot]++] = st->done - st->pushed;
+   }
+
+   if (stress_serial_overlaps)
+   {
+      printf("serial tasks ran concurrently %u times\n",
+            stress_serial_overlaps);
+      ok = false;
+   }
+
+   printf("%2u worker(s): %8.0f tasks/s (%u tasks in %.3f s)\n",
+         workers, count * 1000000.0 / (end - start),
+         count, (end - start) / 1000000.0);
+   print_latency("high", lat[0], n[0]);
+   print_latency("normal", lat[1], n[1]);
+   print_latency("low", lat[2], n[2]);
+
+   for (i = 0; i < 3; i++)
+      free(lat[i]);
+
+   return ok;
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned workers;
+   unsigned count     = 4000;
+   unsigned cores     = cpu_features_get_core_amount();
+   unsigned max       = cores;
+   bool ok            = true;
+   int i;
+
+   for (i = 1; i < argc; i++)
+   {
+      if (!strcmp(argv[i], "-n") && i + 1 < argc)
+         count = (unsigned)strtoul(argv[++i], NULL, 0);
+      else if (!strcmp(argv[i], "-s") && i + 1 < argc)
+         stress_slices = (unsigned)strtoul(argv[++i], NULL, 0);
+      else if (!strcmp(argv[i], "-w") && i + 1 < argc)
+         stress_work = (unsigned)strtoul(argv[++i], NULL, 0);
+      else if (!strcmp(argv[i], "-j") && i + 1 < argc)
+         max = (unsigned)strtoul(argv[++i], NULL, 0);
+      else
+      {
+         fprintf(stderr, "Usage: %s [-n tasks] [-s slices] [-w work] [-j max workers]\n",
+               argv[0]);
+         return 1;
+      }
+   }
+
+   if (!count || !stress_slices || !max)
+      return 1;
+
+   stress_tasks       = (struct stress_task*)calloc(count, sizeof(*stress_tasks));
+   stress_serial_lock = slock_new();
+   if (!stress_tasks || !stress_serial_lock)
+      return 1;
+
+   printf("%u tasks, %u slices of %u iterations each, %u core(s)\n",
+         count, stress_slices, stress_work, cores);
+
+   /* 1, 2, 4, ... and finally max */
+   for (workers = 1; ; workers *= 2)
+   {
+      if (workers > max)
+         workers = max;
+
+      ok = run(workers, count) && ok;
+
+      if (workers == max)
+         break;
+   }
+
+   free(stress_tasks);
+   slock_free(stress_serial_lock);
+
+   if (!ok)
+   {
+      printf("FAILED\n");
+      return 1;
+   }
+
+   printf("OK\n");
+   return 0;
+}
@@ -0,0 +1,532 @@
+/* Copyright  (C) 2010-2017 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (chd_stream_bench.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Replays sector read patterns against chdstream with different
+ * cache settings:
+ *
+ *  sequential   the whole track, one sector after the other
+ *  random       sectors picked at random over the whole track
+ *  interleaved  two sequential readers taking turns, like a game
+ *               streaming audio from one file while loading another
+ *
+ * The first setting is a single hunk without read-ahead, which is
+ * how chdstream used to behave. Every setting has to return the
+ * same data.
+ *
+ * Then the CRC32 of the whole track is taken the way the database
+ * scanner does, first through chdstream_read and then through
+ * chdstream_read_track with a growing number of threads, and the
+ * throughput of each is reported.
+ *
+ * Without arguments a zlib compressed CD image is written first,
+ * otherwise the primary track of the given .chd file is used. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <zlib.h>
+
+#include <boolean.h>
+#include <compat/strl.h>
+#include <encodings/crc32.h>
+#include <retro_miscellaneous.h>
+#include <features/features_cpu.h>
+#include <streams/chd_stream.h>
+#include <libchdr/chd.h>
+
+#define BENCH_SECTOR_SIZE     2352
+#define BENCH_FRAME_SIZE      2448
+#define BENCH_FRAMES_PER_HUNK 8
+#define BENCH_HUNK_BYTES      (BENCH_FRAME_SIZE * BENCH_FRAMES_PER_HUNK)
+#define BENCH_V4_HEADER_SIZE  108
+#define BENCH_MAP_ENTRY_SIZE  16
+
+struct bench_config
+{
+   const char *name;
+   unsigned hunks;
+   unsigned prefetch;
+};
+
+struct bench_pattern
+{
+   const char *name;
+   uint32_t *sectors;
+   unsigned count;
+};
+
+static const struct bench_config bench_configs[] = {
+   { "1 hunk",          1, 0 },
+   { "16 hunks",       16, 0 },
+   { "16 + prefetch 4", 16, 4 },
+   { "64 + prefetch 8", 64, 8 },
+};
+
+static uint32_t bench_rand_state = 0x2545f491;
+
+static uint32_t bench_rand(void)
+{
+   bench_rand_state ^= bench_rand_state << 13;
+   bench_rand_state ^= bench_rand_state >> 17;
+   bench_rand_state ^= bench_rand_state << 5;
+   return bench_rand_state;
+}
+
+/* Low entropy on purpose, so it compresses about as well as
+ * a real disc and decompression costs about the same */
+static void bench_frame(uint32_t frame, uint8_t *out)
+{
+   unsigned i;
+   uint32_t x = frame * 2654435761U + 1;
+
+   for (i = 0; i < BENCH_FRAME_SIZE; i++)
+   {
+      x ^= x << 13;
+      x ^= x >> 17;
+      x ^= x << 5;
+      out[i] = (uint8_t)(0x40 | (x & 0x0f));
+   }
+}
+
+static void bench_put_be(uint8_t *out, uint64_t value, unsigned bytes)
+{
+   while (bytes--)
+   {
+      out[bytes] = (uint8_t)value;
+      value    >>= 8;
+   }
+}
+
+static bool bench_write_chd(const char *path, uint32_t hunks)
+{
+   char meta[256];
+   uint8_t header[BENCH_V4_HEADER_SIZE];
+   uint8_t meta_header[16];
+   z_stream z;
+   uint32_t h, f;
+   size_t meta_len;
+   uint64_t offset;
+   uint8_t *map   = NULL;
+   uint8_t *raw   = NULL;
+   uint8_t *comp  = NULL;
+   bool ok        = false;
+   FILE *fp       = fopen(path, "wb");
+
+   if (!fp)
+      return false;
+
+   memset(&z, 0, sizeof(z));
+   if (deflateInit2(&z, 1, Z_DEFLATED, -MAX_WBITS, 8,
+            Z_DEFAULT_STRATEGY) != Z_OK)
+   {
+      fclose(fp);
+      return false;
+   }
+
+   map  = (uint8_t*)calloc(hunks, BENCH_MAP_ENTRY_SIZE);
+   raw  = (uint8_t*)malloc(BENCH_HUNK_BYTES);
+   comp = (uint8_t*)malloc(BENCH_HUNK_BYTES);
+   if (!map || !raw || !comp)
+      goto end;
+
+   meta_len = (size_t)snprintf(meta, sizeof(meta),
+         CDROM_TRACK_METADATA2_FORMAT, 1, "MODE1_RAW", "NONE",
+         (int)(hunks * BENCH_FRAMES_PER_HUNK), 0, "MODE1", "RW", 0) + 1;
+
+   memset(header, 0, sizeof(header));
+   memcpy(header, "MComprHD", 8);
+   bench_put_be(header +  8, BENCH_V4_HEADER_SIZE, 4);
+   bench_put_be(header + 12, 4, 4);
+   bench_put_be(header + 20, CHDCOMPRESSION_ZLIB, 4);
+   bench_put_be(header + 24, hunks, 4);
+   bench_put_be(header + 28, (uint64_t)hunks * BENCH_HUNK_BYTES, 8);
+   offset = BENCH_V4_HEADER_SIZE + (uint64_t)hunks * BENCH_MAP_ENTRY_SIZE + 16;
+   bench_put_be(header + 36, offset, 8);
+   bench_put_be(header + 44, BENCH_HUNK_BYTES, 4);
+
+   memset(meta_header, 0, sizeof(meta_header));
+   bench_put_be(meta_header + 0, CDROM_TRACK_METADATA2_TAG, 4);
+   bench_put_be(meta_header + 4, meta_len, 4);
+
+   /* Header and map go in again once the hunk offsets are known */
+   if (     fwrite(header, 1, sizeof(header), fp) != sizeof(header)
+         || fwrite(map, BENCH_MAP_ENTRY_SIZE, hunks, fp) != hunks
+         || fwrite("EndOfListCookie", 1, 16, fp) != 16
+         || fwrite(meta_header, 1, sizeof(meta_header), fp) != sizeof(meta_header)
+         || fwrite(meta, 1, meta_len, fp) != meta_len)
+      goto end;
+
+   offset += sizeof(meta_header) + meta_len;
+
+   for (h = 0; h < hunks; h++)
+   {
+      uint8_t *entry = map + h * BENCH_MAP_ENTRY_SIZE;
+      uint8_t *data  = comp;
+      uint32_t len;
+
+      for (f = 0; f < BENCH_FRAMES_PER_HUNK; f++)
+         bench_frame(h * BENCH_FRAMES_PER_HUNK + f,
+               raw + f * BENCH_FRAME_SIZE);
+
+      deflateReset(&z);
+      z.next_in   = raw;
+      z.avail_in  = BENCH_HUNK_BYTES;
+      z.next_out  = comp;
+      z.avail_out = BENCH_HUNK_BYTES;
+
+      if (deflate(&z, Z_FINISH) == Z_STREAM_END)
+      {
+         len       = (uint32_t)z.total_out;
+         entry[15] = 1; /* compressed */
+      }
+      else
+      {
+         data      = raw;
+         len       = BENCH_HUNK_BYTES;
+         entry[15] = 2; /* uncompressed */
+      }
+
+      bench_put_be(entry + 0, offset, 8);
+      bench_put_be(entry + 8, crc32(0, raw, BENCH_HUNK_BYTES), 4);
+      bench_put_be(entry + 12, len & 0xffff, 2);
+      entry[14] = (uint8_t)(len >> 16);
+
+      if (fwrite(data, 1, len, fp) != len)
+         goto end;
+      offset += len;
+   }
+
+   if (     fseek(fp, 0, SEEK_SET) != 0
+         || fwrite(header, 1, sizeof(header), fp) != sizeof(header)
+         || fwrite(map, BENCH_MAP_ENTRY_SIZE, hunks, fp) != hunks)
+      goto end;
+
+   ok = true;
+
+end:
+   deflateEnd(&z);
+   free(map);
+   free(raw);
+   free(comp);
+   if (fclose(fp) != 0)
+      ok = false;
+   return ok;
+}
+
+static uint32_t bench_fold(uint32_t sum, const uint8_t *data, size_t len)
+{
+   size_t i;
+
+   for (i = 0; i < len; i++)
+      sum = (sum ^ data[i]) * 16777619U;
+
+   return sum;
+}
+
+/* Checksum of what the pattern should read from the synthetic image */
+static uint32_t bench_expected(const struct bench_pattern *pattern)
+{
+   unsigned i;
+   uint8_t frame[BENCH_FRAME_SIZE];
+   uint32_t sum = 2166136261U;
+
+   for (i = 0; i < pattern->count; i++)
+   {
+      bench_frame(pattern->sectors[i], frame);
+      sum = bench_fold(sum, frame, BENCH_SECTOR_SIZE);
+   }
+
+   return sum;
+}
+
+static bool bench_run(const char *path, const struct bench_config *config,
+      const struct bench_pattern *pattern, retro_time_t *usec, uint32_t *sum)
+{
+   unsigned i;
+   uint8_t sector[BENCH_SECTOR_SIZE];
+   retro_time_t start  = cpu_features_get_time_usec();
+   chdstream_t *stream = NULL;
+
+   chdstream_set_cache(config->hunks, config->prefetch);
+
+   if (!(stream = chdstream_open(path, CHDSTREAM_TRACK_PRIMARY)))
+      return false;
+
+   *sum = 2166136261U;
+
+   for (i = 0; i < pattern->count; i++)
+   {
+      if (     chdstream_seek(stream,
+                  (ssize_t)pattern->sectors[i] * BENCH_SECTOR_SIZE,
+                  SEEK_SET) != 0
+            || chdstream_read(stream, sector, sizeof(sector))
+            != (ssize_t)sizeof(sector))
+      {
+         chdstream_close(stream);
+         return false;
+      }
+
+      *sum = bench_fold(*sum, sector, sizeof(sector));
+   }
+
+   chdstream_close(stream);
+   *usec += cpu_features_get_time_usec() - start;
+   return true;
+}
+
+static bool bench_crc_consumer(const uint8_t *data, size_t len,
+      void *userdata)
+{
+   uint32_t *crc = (uint32_t*)userdata;
+   *crc          = encoding_crc32(*crc, data, len);
+   return true;
+}
+
+/* threads == 0 hashes through chdstream_read in 64 KB reads */
+static bool bench_hash(const char *path, unsigned threads,
+      retro_time_t *usec, uint32_t *crc)
+{
+   retro_time_t start  = cpu_features_get_time_usec();
+   chdstream_t *stream = chdstream_open(path, CHDSTREAM_TRACK_PRIMARY);
+   bool ok             = stream != NULL;
+
+   *crc = 0;
+
+   if (ok && threads)
+      ok = chdstream_read_track(stream, threads, bench_crc_consumer, crc);
+   else if (ok)
+   {
+      ssize_t read;
+      uint8_t *buffer = (uint8_t*)malloc(64 * 1024);
+
+      if (!(ok = buffer != NULL))
+         goto end;
+
+      while ((read = chdstream_read(stream, buffer, 64 * 1024)) > 0)
+         *crc = encoding_crc32(*crc, buffer, read);
+
+      ok = read == 0;
+      free(buffer);
+   }
+
+end:
+   if (stream)
+      chdstream_close(stream);
+   *usec += cpu_features_get_time_usec() - start;
+   return ok;
+}
+
+int main(int argc, char *argv[])
+{
+   int i;
+   unsigned k, c, r;
+   struct bench_pattern patterns[3];
+   uint32_t frames;
+   chdstream_t *stream   = NULL;
+   unsigned hunks        = 1024;
+   unsigned runs         = 3;
+   const char *path      = NULL;
+   bool ok               = true;
+   char tmp[]            = "chd_stream_bench.chd";
+
+   for (i = 1; i < argc; i++)
+   {
+      if (!strcmp(argv[i], "-n") && i + 1 < argc)
+         hunks = (unsigned)strtoul(argv[++i], NULL, 0);
+      else if (!strcmp(argv[i], "-r") && i + 1 < argc)
+         runs = (unsigned)strtoul(argv[++i], NULL, 0);
+      else if (argv[i][0] != '-' && !path)
+         path = argv[i];
+      else
+      {
+         fprintf(stderr, "Usage: %s [-n hunks] [-r runs] [chd file]\n",
+               argv[0]);
+         return 1;
+      }
+   }
+
+   if (!runs || hunks < 2)
+      return 1;
+
+   if (!path)
+   {
+      if (!bench_write_chd(tmp, hunks))
+      {
+         fprintf(stderr, "Could not write %s\n", tmp);
+         return 1;
+      }
+      path = tmp;
+   }
+
+   if (!(stream = chdstream_open(path, CHDSTREAM_TRACK_PRIMARY)))
+   {
+      fprintf(stderr, "Could not open %s\n", path);
+      ok = false;
+      goto end;
+   }
+   chdstream_seek(stream, 0, SEEK_END);
+   frames = (uint32_t)(chdstream_tell(stream) / BENCH_SECTOR_SIZE);
+   chdstream_close(stream);
+
+   if (frames < 2)
+   {
+      ok = false;
+      goto end;
+   }
+
+   patterns[0].name    = "sequential";
+   patterns[0].count   = frames;
+   patterns[0].sectors = (uint32_t*)malloc(frames * sizeof(uint32_t));
+   for (k = 0; k < frames; k++)
+      patterns[0].sectors[k] = k;
+
+   patterns[1].name    = "random";
+   patterns[1].count   = MIN(frames, 4096);
+   patterns[1].sectors = (uint32_t*)malloc(patterns[1].count * sizeof(uint32_t));
+   for (k = 0; k < patterns[1].count; k++)
+      patterns[1].sectors[k] = bench_rand() % frames;
+
+   patterns[2].name    = "interleaved";
+   patterns[2].count   = frames & ~1U;
+   patterns[2].sectors = (uint32_t*)malloc(patterns[2].count * sizeof(uint32_t));
+   for (k = 0; k < patterns[2].count / 2; k++)
+   {
+      patterns[2].sectors[k * 2 + 0] = k;
+      patterns[2].sectors[k * 2 + 1] = frames / 2 + k;
+   }
+
+   printf("%s, %u sectors, %u run(s), ms per pattern\n", path, frames, runs);
+   printf("%-12s", "pattern");
+   for (c = 0; c < ARRAY_SIZE(bench_configs); c++)
+      printf(" %16s", bench_configs[c].name);
+   printf("\n");
+
+   for (k = 0; k < ARRAY_SIZE(patterns); k++)
+   {
+      uint32_t expected = 0;
+
+      printf("%-12s", patterns[k].name);
+
+      for (c = 0; c < ARRAY_SIZE(bench_configs); c++)
+      {
+         retro_time_t usec = 0;
+         uint32_t sum      = 0;
+
+         for (r = 0; r < runs; r++)
+         {
+            if (!bench_run(path, &bench_configs[c], &patterns[k], &usec, &sum))
+            {
+               printf("\n%s: read error with %s\n", patterns[k].name,
+                     bench_configs[c].name);
+               ok = false;
+               break;
+            }
+         }
+
+         if (c == 0)
+            expected = path == tmp ? bench_expected(&patterns[k]) : sum;
+
+         if (sum != expected)
+         {
+            printf("\n%s: %s read the wrong data\n", patterns[k].name,
+                  bench_configs[c].name);
+            ok = false;
+         }
+
+         printf(" %16.2f", usec / 1000.0 / runs);
+         fflush(stdout);
+      }
+
+      printf("\n");
+   }
+
+   for (k = 0; k < ARRAY_SIZE(patterns); k++)
+      free(patterns[k].sectors);
+
+   printf("\n%-12s %10s %10s %10s\n", "crc32", "ms", "MB/s", "crc");
+
+   {
+      unsigned threads[6];
+      unsigned num_threads = 0;
+      unsigned cores       = cpu_features_get_core_amount();
+      uint32_t expected    = 0;
+
+      threads[num_threads++] = 0;
+      for (c = 1; c <= 8; c *= 2)
+         threads[num_threads++] = c;
+      if (cores > 8)
+         threads[num_threads++] = cores;
+
+      for (c = 0; c < num_threads; c++)
+      {
+         char name[32];
+         retro_time_t usec = 0;
+         uint32_t crc      = 0;
+         bool failed       = false;
+
+         for (r = 0; r < runs && !failed; r++)
+            failed = !bench_hash(path, threads[c], &usec, &crc);
+
+         if (threads[c])
+            snprintf(name, sizeof(name), "%u thread(s)", threads[c]);
+         else
+            strlcpy(name, "read", sizeof(name));
+
+         if (failed)
+         {
+            printf("%-12s read error\n", name);
+            ok = false;
+            continue;
+         }
+
+         if (c == 0)
+            expected = crc;
+         else if (crc != expected)
+         {
+            printf("%-12s got crc %08x instead of %08x\n", name,
+                  crc, expected);
+            ok = false;
+         }
+
+         printf("%-12s %10.2f %10.2f   %08x\n", name, usec / 1000.0 / runs,
+               (double)frames * BENCH_SECTOR_SIZE * runs / usec, crc);
+         fflush(stdout);
+      }
+   }
+
+end:
+   chdstream_set_cache(CHDSTREAM_DEFAULT_CACHE_HUNKS,
+         CHDSTREAM_DEFAULT_PREFETCH_HUNKS);
+
+   if (path == tmp)
+      remove(tmp);
+
+   if (!ok)
+   {
+      printf("FAILED\n");
+      return 1;
+   }
+
+   printf("OK\n");
+   return 0;
+}
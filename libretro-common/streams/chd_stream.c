@@ -27,12 +27,44 @@
 
 #include <streams/chd_stream.h>
 #include <retro_endianness.h>
+#include <retro_miscellaneous.h>
 #include <libchdr/chd.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
 #define SECTOR_SIZE 2352
 #define SUBCODE_SIZE 96
 #define TRACK_PAD 4
 
+/* Sequential hunk loads in a row before the prefetcher kicks in */
+#define PREFETCH_STREAK 2
+
+enum chdstream_hunk_state
+{
+   CHDSTREAM_HUNK_EMPTY = 0,
+   CHDSTREAM_HUNK_READY,
+   /* Being decompressed, by the reader or the prefetcher */
+   CHDSTREAM_HUNK_BUSY
+};
+
+struct chdstream_hunk
+{
+   uint8_t *data;
+   uint32_t hunknum;
+   /* Last use, the smallest one is replaced first */
+   uint32_t used;
+   enum chdstream_hunk_state state;
+};
+
+static unsigned chdstream_cache_hunks    = CHDSTREAM_DEFAULT_CACHE_HUNKS;
+#ifdef HAVE_THREADS
+static unsigned chdstream_prefetch_hunks = CHDSTREAM_DEFAULT_PREFETCH_HUNKS;
+#else
+static unsigned chdstream_prefetch_hunks = 0;
+#endif
+
 struct chdstream
 {
    chd_file *chd;
@@ -52,10 +84,32 @@ struct chdstream
    size_t track_end;
    /* Byte offset of read cursor */
    size_t offset;
-   /* Loaded hunk number */
+   /* Hunk the read cursor is in, it is never replaced */
    int32_t hunknum;
-   /* Loaded hunk */
+   /* Its data */
    uint8_t *hunkmem;
+   /* Decompressed hunks */
+   struct chdstream_hunk *hunks;
+   unsigned num_hunks;
+   uint32_t clock;
+   /* Number of hunks in the chd */
+   uint32_t total_hunks;
+   /* For spotting sequential reads */
+   uint32_t last_hunk;
+   unsigned streak;
+   /* Hunks to decompress ahead of a sequential reader */
+   unsigned prefetch;
+#ifdef HAVE_THREADS
+   /* The prefetcher opens its own chd_file from here */
+   char *path;
+   slock_t *lock;
+   scond_t *cond;
+   sthread_t *thread;
+   /* Hunks the prefetcher still has to look at */
+   uint32_t prefetch_next;
+   uint32_t prefetch_end;
+   bool quit;
+#endif
 };
 
 typedef struct metadata {
@@ -198,6 +252,42 @@ chdstream_find_track(chd_file *fd, int32_t track, metadata_t *meta)
    return chdstream_find_track_number(fd, track, meta);
 }
 
+static bool chdstream_init_cache(chdstream_t *stream, const char *path,
+      uint32_t hunkbytes)
+{
+   unsigned i;
+
+   stream->num_hunks = chdstream_cache_hunks;
+   stream->prefetch  = chdstream_prefetch_hunks;
+
+   /* The reader pins one hunk and the prefetcher fills another */
+   if (stream->prefetch + 2 > stream->num_hunks)
+      stream->prefetch = stream->num_hunks > 2 ? stream->num_hunks - 2 : 0;
+
+   stream->hunks = (struct chdstream_hunk*)calloc(stream->num_hunks,
+         sizeof(*stream->hunks));
+   if (!stream->hunks)
+      return false;
+
+   for (i = 0; i < stream->num_hunks; i++)
+      if (!(stream->hunks[i].data = (uint8_t*)malloc(hunkbytes)))
+         return false;
+
+#ifdef HAVE_THREADS
+   if (stream->prefetch)
+   {
+      stream->path = strdup(path);
+      stream->lock = slock_new();
+      stream->cond = scond_new();
+
+      if (!stream->path || !stream->lock || !stream->cond)
+         return false;
+   }
+#endif
+
+   return true;
+}
+
 chdstream_t *chdstream_open(const char *path, int32_t track)
 {
    metadata_t meta;
@@ -217,9 +307,9 @@ chdstream_t *chdstream_open(const char *path, int32_t track)
    if (!stream)
       goto error;
 
-   hd              = chd_get_header(chd);
-   stream->hunkmem = (uint8_t*)malloc(hd->hunkbytes);
-   if (!stream->hunkmem)
+   hd = chd_get_header(chd);
+
+   if (!chdstream_init_cache(stream, path, hd->hunkbytes))
       goto error;
 
    if (!strcmp(meta.type, "MODE1_RAW"))
@@ -259,6 +349,7 @@ chdstream_t *chdstream_open(const char *path, int32_t track)
       (size_t) meta.frames * stream->frame_size;
    stream->offset          = 0;
    stream->hunknum         = -1;
+   stream->total_hunks     = hd->totalhunks;
 
    return stream;
 
@@ -274,40 +365,281 @@ error:
 
 void chdstream_close(chdstream_t *stream)
 {
-   if (stream)
+   unsigned i;
+
+   if (!stream)
+      return;
+
+#ifdef HAVE_THREADS
+   if (stream->thread)
    {
-      if (stream->hunkmem)
-         free(stream->hunkmem);
-      if (stream->chd)
-         chd_close(stream->chd);
-      free(stream);
+      slock_lock(stream->lock);
+      stream->quit = true;
+      scond_broadcast(stream->cond);
+      slock_unlock(stream->lock);
+      sthread_join(stream->thread);
    }
+   if (stream->cond)
+      scond_free(stream->cond);
+   if (stream->lock)
+      slock_free(stream->lock);
+   if (stream->path)
+      free(stream->path);
+#endif
+
+   if (stream->hunks)
+   {
+      for (i = 0; i < stream->num_hunks; i++)
+         free(stream->hunks[i].data);
+      free(stream->hunks);
+   }
+   if (stream->chd)
+      chd_close(stream->chd);
+   free(stream);
 }
 
-static bool
-chdstream_load_hunk(chdstream_t *stream, uint32_t hunknum)
+/**
+ * chdstream_set_cache:
+ * @hunks               : Decompressed hunks kept per stream.
+ * @prefetch            : Hunks decompressed ahead of sequential
+ *                        reads on a worker thread, 0 to disable.
+ *
+ * Only affects streams opened afterwards.
+ **/
+void chdstream_set_cache(unsigned hunks, unsigned prefetch)
+{
+   chdstream_cache_hunks    = MAX(hunks, 1);
+#ifdef HAVE_THREADS
+   chdstream_prefetch_hunks = prefetch;
+#endif
+}
+
+static void chdstream_lock(chdstream_t *stream)
+{
+#ifdef HAVE_THREADS
+   if (stream->lock)
+      slock_lock(stream->lock);
+#endif
+}
+
+static void chdstream_unlock(chdstream_t *stream)
+{
+#ifdef HAVE_THREADS
+   if (stream->lock)
+      slock_unlock(stream->lock);
+#endif
+}
+
+static void chdstream_swab(chdstream_t *stream, chd_file *chd, uint8_t *hunk)
 {
-   chd_error err;
-   uint16_t *array;
    uint32_t i;
    uint32_t count;
+   uint16_t *array;
+
+   if (!stream->swab)
+      return;
+
+   count = chd_get_header(chd)->hunkbytes / 2;
+   array = (uint16_t*)hunk;
+   for (i = 0; i < count; ++i)
+      array[i] = SWAP16(array[i]);
+}
+
+static bool
+chdstream_decompress(chdstream_t *stream, chd_file *chd,
+      uint32_t hunknum, uint8_t *dest)
+{
+   if (chd_read(chd, hunknum, dest) != CHDERR_NONE)
+      return false;
+
+   chdstream_swab(stream, chd, dest);
+   return true;
+}
+
+/* Slot holding @hunknum, ready or on its way. Call with the lock held. */
+static int chdstream_find_hunk(chdstream_t *stream, uint32_t hunknum)
+{
+   unsigned i;
+
+   for (i = 0; i < stream->num_hunks; i++)
+      if (     stream->hunks[i].state != CHDSTREAM_HUNK_EMPTY
+            && stream->hunks[i].hunknum == hunknum)
+         return (int)i;
+
+   return -1;
+}
+
+/* Least recently used slot that is neither pinned by the reader
+ * nor being filled. Call with the lock held. */
+static int chdstream_victim(chdstream_t *stream)
+{
+   unsigned i;
+   int victim = -1;
+
+   for (i = 0; i < stream->num_hunks; i++)
+   {
+      const struct chdstream_hunk *hunk = &stream->hunks[i];
+
+      if (hunk->state == CHDSTREAM_HUNK_EMPTY)
+         return (int)i;
+
+      if (     hunk->state == CHDSTREAM_HUNK_BUSY
+            || (stream->hunknum >= 0 && hunk->data == stream->hunkmem))
+         continue;
+
+      if (victim < 0 || hunk->used < stream->hunks[victim].used)
+         victim = (int)i;
+   }
+
+   return victim;
+}
+
+#ifdef HAVE_THREADS
+static void chdstream_prefetch_thread(void *data)
+{
+   chdstream_t *stream = (chdstream_t*)data;
+   chd_file *chd       = NULL;
+
+   slock_lock(stream->lock);
+
+   while (!stream->quit)
+   {
+      int slot;
+      bool ok;
+      uint32_t hunknum;
+
+      if (stream->prefetch_next >= stream->prefetch_end)
+      {
+         scond_wait(stream->cond, stream->lock);
+         continue;
+      }
+
+      hunknum = stream->prefetch_next++;
+
+      if (chdstream_find_hunk(stream, hunknum) >= 0)
+         continue;
+
+      if ((slot = chdstream_victim(stream)) < 0)
+      {
+         stream->prefetch_next = stream->prefetch_end;
+         continue;
+      }
+
+      stream->hunks[slot].state   = CHDSTREAM_HUNK_BUSY;
+      stream->hunks[slot].hunknum = hunknum;
+      slock_unlock(stream->lock);
+
+      /* A handle of our own, chd_read is not reentrant */
+      if (!chd && chd_open(stream->path, CHD_OPEN_READ, NULL, &chd)
+            != CHDERR_NONE)
+         chd = NULL;
+
+      ok = chd && chdstream_decompress(stream, chd, hunknum,
+            stream->hunks[slot].data);
+
+      slock_lock(stream->lock);
+      stream->hunks[slot].state = ok
+         ? CHDSTREAM_HUNK_READY : CHDSTREAM_HUNK_EMPTY;
+      stream->hunks[slot].used  = ++stream->clock;
+      scond_broadcast(stream->cond);
+
+      /* Leave it to the reader from now on */
+      if (!chd)
+         stream->prefetch = 0;
+   }
+
+   slock_unlock(stream->lock);
+
+   if (chd)
+      chd_close(chd);
+}
+
+/* Call with the lock held */
+static void chdstream_prefetch(chdstream_t *stream, uint32_t hunknum)
+{
+   uint32_t end = MIN(hunknum + 1 + stream->prefetch, stream->total_hunks);
+
+   if (     stream->prefetch_next <= hunknum
+         || stream->prefetch_next >  end)
+      stream->prefetch_next = hunknum + 1;
+   stream->prefetch_end = end;
+
+   if (!stream->thread)
+      stream->thread = sthread_create(chdstream_prefetch_thread, stream);
+
+   if (!stream->thread)
+      stream->prefetch = 0;
+   else
+      scond_signal(stream->cond);
+}
+#endif
+
+static bool
+chdstream_load_hunk(chdstream_t *stream, uint32_t hunknum)
+{
+   int slot;
 
    if (hunknum == stream->hunknum)
       return true;
 
-   err = chd_read(stream->chd, hunknum, stream->hunkmem);
-   if (err != CHDERR_NONE)
-      return false;
+   chdstream_lock(stream);
 
-   if (stream->swab)
+   stream->hunknum = -1;
+
+   while ((slot = chdstream_find_hunk(stream, hunknum)) < 0
+         || stream->hunks[slot].state != CHDSTREAM_HUNK_READY)
    {
-      count = chd_get_header(stream->chd)->hunkbytes / 2;
-      array = (uint16_t*) stream->hunkmem;
-      for (i = 0; i < count; ++i)
-         array[i] = SWAP16(array[i]);
+      bool ok;
+
+#ifdef HAVE_THREADS
+      /* The prefetcher is already at it */
+      if (slot >= 0)
+      {
+         scond_wait(stream->cond, stream->lock);
+         continue;
+      }
+#endif
+
+      if ((slot = chdstream_victim(stream)) < 0)
+      {
+         chdstream_unlock(stream);
+         return false;
+      }
+
+      stream->hunks[slot].state   = CHDSTREAM_HUNK_BUSY;
+      stream->hunks[slot].hunknum = hunknum;
+      chdstream_unlock(stream);
+
+      ok = chdstream_decompress(stream, stream->chd, hunknum,
+            stream->hunks[slot].data);
+
+      chdstream_lock(stream);
+      stream->hunks[slot].state = ok
+         ? CHDSTREAM_HUNK_READY : CHDSTREAM_HUNK_EMPTY;
+
+      if (!ok)
+      {
+         chdstream_unlock(stream);
+         return false;
+      }
    }
 
-   stream->hunknum = hunknum;
+   stream->hunks[slot].used = ++stream->clock;
+   stream->hunkmem          = stream->hunks[slot].data;
+   stream->hunknum          = hunknum;
+
+   if (hunknum == stream->last_hunk + 1)
+      stream->streak++;
+   else
+      stream->streak = 0;
+   stream->last_hunk = hunknum;
+
+#ifdef HAVE_THREADS
+   if (stream->prefetch && stream->streak >= PREFETCH_STREAK)
+      chdstream_prefetch(stream, hunknum);
+#endif
+
+   chdstream_unlock(stream);
    return true;
 }
 
@@ -360,6 +692,100 @@ ssize_t chdstream_read(chdstream_t *stream, void *data, size_t bytes)
    return bytes;
 }
 
+struct chdstream_track_reader
+{
+   chdstream_t *stream;
+   chdstream_consumer_t consumer;
+   void *userdata;
+   /* Track frames are [first_frame, end_frame) in the chd */
+   uint32_t first_frame;
+   uint32_t end_frame;
+};
+
+static chd_error chdstream_track_hunk(UINT32 hunknum, UINT8 *data,
+      void *param)
+{
+   struct chdstream_track_reader *reader =
+      (struct chdstream_track_reader*)param;
+   chdstream_t *stream  = reader->stream;
+   const chd_header *hd = chd_get_header(stream->chd);
+   uint32_t frame       = hunknum * stream->frames_per_hunk;
+   uint32_t start       = MAX(frame, reader->first_frame) - frame;
+   uint32_t end         = MIN(frame + stream->frames_per_hunk,
+         reader->end_frame) - frame;
+
+   chdstream_swab(stream, stream->chd, data);
+
+   /* Whole frames are contiguous, hand them over in one go */
+   if (stream->frame_size == hd->unitbytes)
+   {
+      if (!reader->consumer(data + start * hd->unitbytes,
+               (end - start) * hd->unitbytes, reader->userdata))
+         return CHDERR_INVALID_STATE;
+      return CHDERR_NONE;
+   }
+
+   for (; start < end; start++)
+      if (!reader->consumer(data + start * hd->unitbytes
+               + stream->frame_offset, stream->frame_size,
+               reader->userdata))
+         return CHDERR_INVALID_STATE;
+
+   return CHDERR_NONE;
+}
+
+/**
+ * chdstream_read_track:
+ * @stream              : CHD stream.
+ * @threads             : Hunks decompressed in parallel.
+ * @consumer            : Gets the track data in order, returns
+ *                        false to stop.
+ * @userdata            : Passed to @consumer.
+ *
+ * Reads the whole track, pregap included, in the same byte
+ * order chdstream_read would return it. Meant for hashing and
+ * extraction, the read cursor and hunk cache are left alone.
+ *
+ * Returns: true if the whole track was read.
+ **/
+bool chdstream_read_track(chdstream_t *stream, unsigned threads,
+      chdstream_consumer_t consumer, void *userdata)
+{
+   struct chdstream_track_reader reader;
+   uint32_t first_hunk;
+   uint32_t last_hunk;
+   size_t pregap = stream->track_start;
+
+   if (pregap)
+   {
+      uint8_t *zero = (uint8_t*)calloc(1, stream->frame_size);
+      bool ok       = zero != NULL;
+
+      for (; ok && pregap; pregap -= stream->frame_size)
+         ok = consumer(zero, stream->frame_size, userdata);
+
+      free(zero);
+      if (!ok)
+         return false;
+   }
+
+   reader.stream      = stream;
+   reader.consumer    = consumer;
+   reader.userdata    = userdata;
+   reader.first_frame = stream->track_frame;
+   reader.end_frame   = stream->track_frame + (uint32_t)
+      ((stream->track_end - stream->track_start) / stream->frame_size);
+
+   if (reader.end_frame == reader.first_frame)
+      return true;
+
+   first_hunk = reader.first_frame / stream->frames_per_hunk;
+   last_hunk  = (reader.end_frame - 1) / stream->frames_per_hunk;
+
+   return chd_read_hunks(stream->chd, first_hunk, last_hunk - first_hunk + 1,
+         MAX(threads, 1), chdstream_track_hunk, &reader) == CHDERR_NONE;
+}
+
 int chdstream_getc(chdstream_t *stream)
 {
    char c = 0;
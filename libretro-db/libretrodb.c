@@ -32,8 +32,18 @@
 #include <sys/stat.h>
 #include <stdlib.h>
 
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef HAVE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#endif
+
 #include <streams/file_stream.h>
 #include <retro_endianness.h>
+#include <retro_miscellaneous.h>
 #include <string/stdstring.h>
 #include <compat/strl.h>
 
@@ -48,10 +58,22 @@
 
 struct node_iter_ctx
 {
-	libretrodb_t *db;
+	RFILE *fd;
 	libretrodb_index_t *idx;
 };
 
+/* An index as stored after the metadata: count entries of
+ * key_size key bytes followed by a big endian record offset,
+ * sorted by key. */
+struct libretrodb_index_table
+{
+   char name[50];
+   uint64_t key_size;
+   uint64_t count;
+   const uint8_t *entries;
+   uint8_t *buff;
+};
+
 struct libretrodb
 {
 	RFILE *fd;
@@ -59,6 +81,17 @@ struct libretrodb
 	uint64_t count;
 	uint64_t first_index_offset;
    char *path;
+
+   /* Whole file when opened with libretrodb_open_mapped,
+    * mmap'd if possible, otherwise read in one go */
+   uint8_t *data;
+   size_t size;
+   int is_mapped;
+
+   /* Index tables, parsed on the first lookup */
+   struct libretrodb_index_table *tables;
+   unsigned num_tables;
+   int tables_loaded;
 };
 
 struct libretrodb_index
@@ -83,9 +116,24 @@ struct libretrodb_cursor
 {
 	int is_valid;
    RFILE *fd;
+   size_t pos;
 	int eof;
 	libretrodb_query_t *query;
 	libretrodb_t *db;
+
+   /* Projection, NULL returns every field */
+   char **fields;
+   unsigned num_fields;
+
+   /* Only decode the fields the query and the projection need */
+   int partial;
+
+   /* Set when the query planner answered the query from an index,
+    * at most one record (at index_offset) can match then */
+   int use_index;
+   int index_hit;
+   int index_done;
+   uint64_t index_offset;
 };
 
 static struct rmsgpack_dom_value sentinal;
@@ -173,8 +221,8 @@ int libretrodb_create(RFILE *fd, libretrodb_value_provider value_provider,
    if ((rv = rmsgpack_dom_write(fd, &sentinal)) < 0)
       goto clean;
 
-   header.metadata_offset = swap_if_little64(filestream_seek(
-            fd, 0, RETRO_VFS_SEEK_POSITION_CURRENT));
+   /* filestream_seek returns 0 on success, not the position */
+   header.metadata_offset = swap_if_little64(filestream_tell(fd));
    md.count = item_count;
    libretrodb_write_metadata(fd, &md);
    filestream_seek(fd, root, RETRO_VFS_SEEK_POSITION_START);
@@ -204,14 +252,40 @@ static void libretrodb_write_index_header(RFILE *fd, libretrodb_index_t *idx)
    rmsgpack_write_uint(fd, idx->next);
 }
 
+static void libretrodb_free_tables(libretrodb_t *db)
+{
+   unsigned i;
+
+   for (i = 0; i < db->num_tables; i++)
+      free(db->tables[i].buff);
+
+   free(db->tables);
+   db->tables        = NULL;
+   db->num_tables    = 0;
+   db->tables_loaded = 0;
+}
+
 void libretrodb_close(libretrodb_t *db)
 {
    if (db->fd)
       filestream_close(db->fd);
    if (!string_is_empty(db->path))
       free(db->path);
-   db->path = NULL;
-   db->fd   = NULL;
+#ifdef HAVE_MMAP
+   if (db->is_mapped)
+      munmap(db->data, db->size);
+   else
+#endif
+   if (db->data)
+      free(db->data);
+
+   libretrodb_free_tables(db);
+
+   db->path      = NULL;
+   db->fd        = NULL;
+   db->data      = NULL;
+   db->size      = 0;
+   db->is_mapped = 0;
 }
 
 int libretrodb_open(const char *path, libretrodb_t *db)
@@ -238,7 +312,8 @@ int libretrodb_open(const char *path, libretrodb_t *db)
       goto error;
    }
 
-   if (strncmp(header.magic_number, MAGIC_NUMBER, sizeof(MAGIC_NUMBER)) != 0)
+   if (strncmp(header.magic_number, MAGIC_NUMBER,
+            sizeof(header.magic_number)) != 0)
    {
       rv = -EINVAL;
       goto error;
@@ -265,91 +340,315 @@ error:
    return rv;
 }
 
-static int libretrodb_find_index(libretrodb_t *db, const char *index_name,
-      libretrodb_index_t *idx)
+static int libretrodb_map_file(libretrodb_t *db, const char *path)
 {
-   ssize_t eof    = filestream_get_size(db->fd);
-   ssize_t offset = filestream_seek(db->fd,
-         (ssize_t)db->first_index_offset,
-         RETRO_VFS_SEEK_POSITION_START);
+   void *buff  = NULL;
+   ssize_t len = 0;
+#ifdef HAVE_MMAP
+   struct stat st;
+   int fd      = open(path, O_RDONLY);
 
-   /* TODO: this should use filestream_eof instead */
-   while (offset < eof)
+   if (fd >= 0)
    {
-      libretrodb_read_index_header(db->fd, idx);
+      if (fstat(fd, &st) == 0 && st.st_size > 0)
+      {
+         buff = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+         if (buff != MAP_FAILED)
+         {
+            /* the mapping outlives the descriptor */
+            close(fd);
+            db->data      = (uint8_t*)buff;
+            db->size      = (size_t)st.st_size;
+            db->is_mapped = 1;
+            return 0;
+         }
+      }
+      close(fd);
+   }
+   buff = NULL;
+#endif
+
+   if (!filestream_read_file(path, &buff, &len) || len <= 0)
+   {
+      free(buff);
+      return -1;
+   }
 
-      if (strncmp(index_name, idx->name, strlen(idx->name)) == 0)
-         return 0;
+   db->data      = (uint8_t*)buff;
+   db->size      = (size_t)len;
+   db->is_mapped = 0;
+   return 0;
+}
 
-      filestream_seek(db->fd, (ssize_t)idx->next,
-            RETRO_VFS_SEEK_POSITION_CURRENT);
-      offset = filestream_tell(db->fd);
+static const struct rmsgpack_dom_value *libretrodb_view_value(
+      const struct rmsgpack_dom_value *map, const char *key)
+{
+   unsigned i;
+   size_t len = strlen(key);
+
+   if (map->type != RDT_MAP)
+      return NULL;
+
+   for (i = 0; i < map->val.map.len; i++)
+   {
+      const struct rmsgpack_dom_value *k = &map->val.map.items[i].key;
+
+      if (     k->type == RDT_STRING
+            && k->val.string.len == len
+            && !memcmp(k->val.string.buff, key, len))
+         return &map->val.map.items[i].value;
    }
 
-   return -1;
+   return NULL;
 }
 
-static int binsearch(const void *buff, const void *item,
-      uint64_t count, uint8_t field_size, uint64_t *offset)
+/**
+ * libretrodb_open_mapped:
+ * @path                : Path to the database.
+ * @db                  : Handle to database.
+ *
+ * Read-only variant of libretrodb_open. The file is memory mapped
+ * (or read in one go where mmap is not available), cursors and
+ * lookups then decode straight from memory.
+ *
+ * Returns: 0 if successful, otherwise negative.
+ **/
+int libretrodb_open_mapped(const char *path, libretrodb_t *db)
 {
-   int mid            = (int)(count / 2);
-   int item_size      = field_size + sizeof(uint64_t);
-   uint64_t *current  = (uint64_t *)buff + (mid * item_size);
-   int rv             = memcmp(current, item, field_size);
+   libretrodb_header_t header;
+   struct rmsgpack_dom_value md;
+   const struct rmsgpack_dom_value *count = NULL;
+   size_t pos                             = 0;
+
+   if (libretrodb_map_file(db, path) != 0)
+      return -EINVAL;
 
-   if (rv == 0)
+   if (db->size < sizeof(header))
+      goto error;
+
+   memcpy(&header, db->data, sizeof(header));
+
+   if (strncmp(header.magic_number, MAGIC_NUMBER,
+            sizeof(header.magic_number)) != 0)
+      goto error;
+
+   pos = (size_t)swap_if_little64(header.metadata_offset);
+
+   if (rmsgpack_dom_read_view(db->data, db->size, &pos, &md) < 0)
+      goto error;
+
+   count = libretrodb_view_value(&md, "count");
+
+   if (!count || count->type != RDT_UINT)
    {
-      *offset = *(uint64_t *)(current + field_size);
-      return 0;
+      rmsgpack_dom_view_free(&md);
+      goto error;
    }
 
-   if (count == 0)
-      return -1;
+   if (!string_is_empty(db->path))
+      free(db->path);
+
+   db->path               = strdup(path);
+   db->root               = 0;
+   db->count              = count->val.uint_;
+   db->first_index_offset = pos;
 
-   if (rv > 0)
-      return binsearch(buff, item, mid, field_size, offset);
+   rmsgpack_dom_view_free(&md);
+   return 0;
 
-   return binsearch(current + item_size, item,
-         count - mid, field_size, offset);
+error:
+   libretrodb_close(db);
+   return -EINVAL;
 }
 
-int libretrodb_find_entry(libretrodb_t *db, const char *index_name,
-      const void *key, struct rmsgpack_dom_value *out)
+static int libretrodb_add_table(libretrodb_t *db,
+      const struct libretrodb_index_table *table)
 {
-   libretrodb_index_t idx;
-   int rv;
-   void *buff;
-   uint64_t offset;
-   ssize_t bufflen, nread = 0;
+   struct libretrodb_index_table *tables = (struct libretrodb_index_table*)
+      realloc(db->tables, (db->num_tables + 1) * sizeof(*tables));
 
-   if (libretrodb_find_index(db, index_name, &idx) < 0)
-      return -1;
+   if (!tables)
+      return -ENOMEM;
 
-   bufflen = idx.next;
-   buff = malloc(bufflen);
+   db->tables                   = tables;
+   db->tables[db->num_tables++] = *table;
+   return 0;
+}
 
-   if (!buff)
-      return -ENOMEM;
+/* Walks the index header chain once, the tables stay around
+ * until the database is closed. */
+static void libretrodb_load_tables(libretrodb_t *db)
+{
+   db->tables_loaded = 1;
 
-   while (nread < bufflen)
+   if (db->data)
    {
-      void *buff_ = (uint64_t *)buff + nread;
-      rv = (int)filestream_read(db->fd, buff_, bufflen - nread);
+      size_t pos = (size_t)db->first_index_offset;
 
-      if (rv <= 0)
+      while (pos < db->size)
       {
-         free(buff);
-         return -errno;
+         struct rmsgpack_dom_value hdr;
+         struct libretrodb_index_table table = {{0}};
+         const struct rmsgpack_dom_value *name, *key_size, *next;
+
+         if (rmsgpack_dom_read_view(db->data, db->size, &pos, &hdr) < 0)
+            break;
+
+         name     = libretrodb_view_value(&hdr, "name");
+         key_size = libretrodb_view_value(&hdr, "key_size");
+         next     = libretrodb_view_value(&hdr, "next");
+
+         if (     !name     || name->type     != RDT_STRING
+               || !key_size || key_size->type != RDT_UINT
+               || !next     || next->type     != RDT_UINT
+               || next->val.uint_ > db->size - pos)
+         {
+            rmsgpack_dom_view_free(&hdr);
+            break;
+         }
+
+         strlcpy(table.name, name->val.string.buff,
+               MIN(sizeof(table.name), name->val.string.len + 1));
+         table.key_size = key_size->val.uint_;
+         table.count    = next->val.uint_ / (table.key_size + sizeof(uint64_t));
+         table.entries  = db->data + pos;
+         pos           += (size_t)next->val.uint_;
+
+         rmsgpack_dom_view_free(&hdr);
+
+         if (libretrodb_add_table(db, &table) < 0)
+            break;
       }
-      nread += rv;
    }
+   else
+   {
+      ssize_t eof    = filestream_get_size(db->fd);
+      ssize_t offset = (ssize_t)db->first_index_offset;
 
-   rv = binsearch(buff, key, db->count, (ssize_t)idx.key_size, &offset);
-   free(buff);
+      filestream_seek(db->fd, offset, RETRO_VFS_SEEK_POSITION_START);
 
-   if (rv == 0)
-      filestream_seek(db->fd, (ssize_t)offset,
-            RETRO_VFS_SEEK_POSITION_START);
+      while (offset < eof)
+      {
+         libretrodb_index_t idx;
+         struct libretrodb_index_table table = {{0}};
+
+         if (libretrodb_read_index_header(db->fd, &idx) < 0)
+            break;
+
+         offset = filestream_tell(db->fd);
+
+         if ((ssize_t)idx.next < 0 || (ssize_t)idx.next > eof - offset)
+            break;
+
+         memcpy(table.name, idx.name, sizeof(table.name));
+         table.name[sizeof(table.name) - 1] = '\0';
+         table.key_size = idx.key_size;
+         table.count    = idx.next / (idx.key_size + sizeof(uint64_t));
+         table.buff     = (uint8_t*)malloc(idx.next ? (size_t)idx.next : 1);
+
+         if (!table.buff || filestream_read(db->fd, table.buff,
+                  (ssize_t)idx.next) != (ssize_t)idx.next)
+         {
+            free(table.buff);
+            break;
+         }
+
+         table.entries = table.buff;
+         offset       += (ssize_t)idx.next;
+
+         if (libretrodb_add_table(db, &table) < 0)
+         {
+            free(table.buff);
+            break;
+         }
+      }
+   }
+}
+
+static const struct libretrodb_index_table *libretrodb_find_index(
+      libretrodb_t *db, const char *index_name)
+{
+   unsigned i;
+
+   if (!db->tables_loaded)
+      libretrodb_load_tables(db);
+
+   for (i = 0; i < db->num_tables; i++)
+      if (string_is_equal(db->tables[i].name, index_name))
+         return &db->tables[i];
+
+   return NULL;
+}
+
+static const uint8_t *libretrodb_binsearch(
+      const struct libretrodb_index_table *table, const void *key)
+{
+   size_t entry_size = (size_t)table->key_size + sizeof(uint64_t);
+   uint64_t lo       = 0;
+   uint64_t hi       = table->count;
+
+   while (lo < hi)
+   {
+      uint64_t mid         = lo + (hi - lo) / 2;
+      const uint8_t *entry = table->entries + mid * entry_size;
+      int rv               = memcmp(entry, key, (size_t)table->key_size);
+
+      if (rv == 0)
+         return entry;
+
+      if (rv < 0)
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
+
+   return NULL;
+}
+
+static uint64_t libretrodb_entry_offset(
+      const struct libretrodb_index_table *table, const uint8_t *entry)
+{
+   unsigned i;
+   uint64_t offset = 0;
+
+   for (i = 0; i < sizeof(uint64_t); i++)
+      offset = (offset << 8) | entry[table->key_size + i];
+
+   return offset;
+}
+
+/**
+ * libretrodb_find_entry:
+ * @db                  : Handle to database.
+ * @index_name          : Name of an index made by libretrodb_create_index.
+ * @key                 : Key to look for, as many bytes as the index keys.
+ * @out                 : Matching record.
+ *
+ * Returns: 0 if found, otherwise negative.
+ **/
+int libretrodb_find_entry(libretrodb_t *db, const char *index_name,
+      const void *key, struct rmsgpack_dom_value *out)
+{
+   uint64_t offset                            = 0;
+   const uint8_t *entry                       = NULL;
+   const struct libretrodb_index_table *table =
+      libretrodb_find_index(db, index_name);
+
+   if (!table || !(entry = libretrodb_binsearch(table, key)))
+      return -1;
+
+   offset = libretrodb_entry_offset(table, entry);
+
+   if (db->data)
+   {
+      size_t pos = (size_t)offset;
+      return rmsgpack_dom_read_buf(db->data, db->size, &pos, out);
+   }
+
+   if (filestream_seek(db->fd, (ssize_t)offset,
+            RETRO_VFS_SEEK_POSITION_START) < 0)
+      return -1;
 
    return rmsgpack_dom_read(db->fd, out);
 }
@@ -364,22 +663,101 @@ int libretrodb_find_entry(libretrodb_t *db, const char *index_name,
  **/
 int libretrodb_cursor_reset(libretrodb_cursor_t *cursor)
 {
-   cursor->eof = 0;
+   cursor->eof        = 0;
+   cursor->index_done = 0;
+   cursor->pos = (size_t)(cursor->db->root + sizeof(libretrodb_header_t));
+
+   if (!cursor->fd)
+      return 0;
+
    return (int)filestream_seek(cursor->fd,
          (ssize_t)(cursor->db->root + sizeof(libretrodb_header_t)),
          RETRO_VFS_SEEK_POSITION_START);
 }
 
+static int libretrodb_cursor_wants(const char *key, uint32_t len, void *data)
+{
+   unsigned i;
+   libretrodb_cursor_t *cursor = (libretrodb_cursor_t*)data;
+
+   if (cursor->query && libretrodb_query_references(cursor->query, key, len))
+      return 1;
+
+   for (i = 0; i < cursor->num_fields; i++)
+      if (     strlen(cursor->fields[i]) == len
+            && !memcmp(cursor->fields[i], key, len))
+         return 1;
+
+   return 0;
+}
+
+/* Drops the fields that were only decoded for the query */
+static void libretrodb_cursor_project(libretrodb_cursor_t *cursor,
+      struct rmsgpack_dom_value *v)
+{
+   unsigned i, j;
+   uint32_t kept = 0;
+
+   if (!cursor->fields || v->type != RDT_MAP)
+      return;
+
+   for (i = 0; i < v->val.map.len; i++)
+   {
+      struct rmsgpack_dom_pair *pair = &v->val.map.items[i];
+      int wanted                     = 0;
+
+      if (pair->key.type == RDT_STRING)
+         for (j = 0; j < cursor->num_fields && !wanted; j++)
+            wanted = string_is_equal(cursor->fields[j],
+                  pair->key.val.string.buff);
+
+      if (!wanted)
+      {
+         rmsgpack_dom_value_free(&pair->key);
+         rmsgpack_dom_value_free(&pair->value);
+         continue;
+      }
+
+      v->val.map.items[kept++] = *pair;
+   }
+
+   v->val.map.len = kept;
+}
+
 int libretrodb_cursor_read_item(libretrodb_cursor_t *cursor,
       struct rmsgpack_dom_value *out)
 {
    int rv;
+   size_t start;
 
    if (cursor->eof)
       return EOF;
 
 retry:
-   rv = rmsgpack_dom_read(cursor->fd, out);
+   if (cursor->use_index)
+   {
+      if (cursor->index_done || !cursor->index_hit)
+      {
+         cursor->eof = 1;
+         return EOF;
+      }
+
+      cursor->index_done = 1;
+
+      if (libretrodb_cursor_seek(cursor, cursor->index_offset) != 0)
+         return -1;
+   }
+
+   start = cursor->pos;
+
+   if (cursor->partial)
+      rv = rmsgpack_dom_read_fields(cursor->db->data, cursor->db->size,
+            &cursor->pos, libretrodb_cursor_wants, cursor, out);
+   else if (cursor->db->data)
+      rv = rmsgpack_dom_read_buf(cursor->db->data, cursor->db->size,
+            &cursor->pos, out);
+   else
+      rv = rmsgpack_dom_read(cursor->fd, out);
    if (rv < 0)
       return rv;
 
@@ -398,9 +776,108 @@ retry:
       }
    }
 
+   /* A match without projection wants the whole record after all */
+   if (cursor->partial && !cursor->fields)
+   {
+      rmsgpack_dom_value_free(out);
+      return rmsgpack_dom_read_buf(cursor->db->data, cursor->db->size,
+            &start, out);
+   }
+
+   libretrodb_cursor_project(cursor, out);
+
    return 0;
 }
 
+/**
+ * libretrodb_cursor_tell:
+ * @cursor              : Handle to database cursor.
+ *
+ * Returns: file offset of the item the next
+ * libretrodb_cursor_read_item will decode.
+ **/
+uint64_t libretrodb_cursor_tell(libretrodb_cursor_t *cursor)
+{
+   if (!cursor->fd)
+      return cursor->pos;
+   return (uint64_t)filestream_tell(cursor->fd);
+}
+
+/**
+ * libretrodb_cursor_seek:
+ * @cursor              : Handle to database cursor.
+ * @offset              : Offset returned by libretrodb_cursor_tell.
+ *
+ * Moves the cursor so the next read decodes the item at @offset.
+ *
+ * Returns: 0 if successful, otherwise negative.
+ **/
+int libretrodb_cursor_seek(libretrodb_cursor_t *cursor, uint64_t offset)
+{
+   cursor->eof = 0;
+
+   if (!cursor->fd)
+   {
+      if (offset >= cursor->db->size)
+         return -1;
+      cursor->pos = (size_t)offset;
+      return 0;
+   }
+
+   if (filestream_seek(cursor->fd, (ssize_t)offset,
+            RETRO_VFS_SEEK_POSITION_START) < 0)
+      return -1;
+   return 0;
+}
+
+/**
+ * libretrodb_cursor_read_item_view:
+ * @cursor              : Handle to database cursor.
+ * @out                 : Decoded item.
+ *
+ * Zero-copy variant of libretrodb_cursor_read_item for databases
+ * opened with libretrodb_open_mapped: strings and binaries point
+ * into the mapping and are not NUL terminated. The cursor query
+ * is not applied. Free @out with rmsgpack_dom_view_free.
+ *
+ * Returns: 0 if successful, EOF at the end, otherwise negative.
+ **/
+int libretrodb_cursor_read_item_view(libretrodb_cursor_t *cursor,
+      struct rmsgpack_dom_value *out)
+{
+   int rv;
+
+   if (cursor->eof)
+      return EOF;
+
+   if (!cursor->db->data)
+      return -EINVAL;
+
+   if ((rv = rmsgpack_dom_read_view(cursor->db->data, cursor->db->size,
+               &cursor->pos, out)) < 0)
+      return rv;
+
+   if (out->type == RDT_NULL)
+   {
+      cursor->eof = 1;
+      return EOF;
+   }
+
+   return 0;
+}
+
+static void libretrodb_cursor_free_fields(libretrodb_cursor_t *cursor)
+{
+   unsigned i;
+
+   for (i = 0; i < cursor->num_fields; i++)
+      free(cursor->fields[i]);
+   free(cursor->fields);
+
+   cursor->fields     = NULL;
+   cursor->num_fields = 0;
+}
+
 /**
  * libretrodb_cursor_close:
  * @cursor              : Handle to database cursor.
@@ -418,11 +895,54 @@ void libretrodb_cursor_close(libretrodb_cursor_t *cursor)
    if (cursor->query)
       libretrodb_query_free(cursor->query);
 
-   cursor->is_valid = 0;
-   cursor->eof      = 1;
-   cursor->fd       = NULL;
-   cursor->db       = NULL;
-   cursor->query    = NULL;
+   libretrodb_cursor_free_fields(cursor);
+
+   cursor->is_valid  = 0;
+   cursor->eof       = 1;
+   cursor->fd        = NULL;
+   cursor->db        = NULL;
+   cursor->query     = NULL;
+   cursor->partial   = 0;
+   cursor->use_index = 0;
+}
+
+/* Picks how the cursor walks the database. Equality on a field
+ * with an index of the same name goes straight to the one record
+ * that can match, the rest of the query is still checked on it.
+ * Table queries on mapped databases only decode the fields they
+ * look at. */
+static void libretrodb_cursor_plan(libretrodb_cursor_t *cursor)
+{
+   unsigned i;
+   libretrodb_t *db = cursor->db;
+
+   cursor->partial  = db->data
+      && libretrodb_query_is_table(cursor->query);
+
+   if (!db->tables_loaded)
+      libretrodb_load_tables(db);
+
+   for (i = 0; i < db->num_tables; i++)
+   {
+      const uint8_t *entry                       = NULL;
+      const struct libretrodb_index_table *table = &db->tables[i];
+      const struct rmsgpack_dom_value *value     =
+         libretrodb_query_equals(cursor->query, table->name);
+
+      /* indexes are only ever built over binary fields */
+      if (     !value
+            || value->type != RDT_BINARY
+            || value->val.binary.len != table->key_size)
+         continue;
+
+      entry                = libretrodb_binsearch(table,
+            value->val.binary.buff);
+      cursor->use_index    = 1;
+      cursor->index_hit    = entry != NULL;
+      cursor->index_offset = entry
+         ? libretrodb_entry_offset(table, entry) : 0;
+      break;
+   }
 }
 
 /**
@@ -431,7 +951,9 @@ void libretrodb_cursor_close(libretrodb_cursor_t *cursor)
  * @cursor              : Handle to database cursor.
  * @q                   : Query to execute.
  *
- * Opens cursor to database based on query @q.
+ * Opens cursor to database based on query @q. An equality
+ * on a field that has an index of the same name is answered
+ * from the index instead of walking every record.
  *
  * Returns: 0 if successful, otherwise negative.
  **/
@@ -442,22 +964,72 @@ int libretrodb_cursor_open(libretrodb_t *db, libretrodb_cursor_t *cursor,
    if (!db || string_is_empty(db->path))
       return -errno;
 
-   fd = filestream_open(db->path,
-         RETRO_VFS_FILE_ACCESS_READ,
-         RETRO_VFS_FILE_ACCESS_HINT_NONE);
+   /* Mapped databases are read straight from memory */
+   if (!db->data)
+   {
+      fd = filestream_open(db->path,
+            RETRO_VFS_FILE_ACCESS_READ,
+            RETRO_VFS_FILE_ACCESS_HINT_NONE);
 
-   if (!fd)
-      return -errno;
+      if (!fd)
+         return -errno;
+   }
 
-   cursor->fd       = fd;
-   cursor->db       = db;
-   cursor->is_valid = 1;
+   cursor->fd        = fd;
+   cursor->db        = db;
+   cursor->is_valid  = 1;
+   cursor->partial   = 0;
+   cursor->use_index = 0;
    libretrodb_cursor_reset(cursor);
-   cursor->query    = q;
+   cursor->query     = q;
 
    if (q)
+   {
       libretrodb_query_inc_ref(q);
+      libretrodb_cursor_plan(cursor);
+   }
+
+   return 0;
+}
+
+/**
+ * libretrodb_cursor_set_fields:
+ * @cursor              : Handle to an open database cursor.
+ * @fields              : Names of the fields to return.
+ * @num_fields          : Number of @fields, 0 to return all of them.
+ *
+ * Restricts the records libretrodb_cursor_read_item returns to the
+ * given top-level fields. On mapped databases the other fields are
+ * not even decoded.
+ *
+ * Returns: 0 if successful, otherwise negative.
+ **/
+int libretrodb_cursor_set_fields(libretrodb_cursor_t *cursor,
+      const char **fields, unsigned num_fields)
+{
+   unsigned i;
 
+   libretrodb_cursor_free_fields(cursor);
+
+   if (num_fields)
+   {
+      cursor->fields = (char**)calloc(num_fields, sizeof(*cursor->fields));
+      if (!cursor->fields)
+         return -ENOMEM;
+
+      for (i = 0; i < num_fields; i++)
+      {
+         if (!(cursor->fields[i] = strdup(fields[i])))
+         {
+            libretrodb_cursor_free_fields(cursor);
+            return -ENOMEM;
+         }
+         cursor->num_fields++;
+      }
+   }
+
+   cursor->partial = cursor->db && cursor->db->data && (cursor->fields
+         || (cursor->query && libretrodb_query_is_table(cursor->query)));
    return 0;
 }
 
@@ -465,36 +1037,39 @@ static int node_iter(void *value, void *ctx)
 {
    struct node_iter_ctx *nictx = (struct node_iter_ctx*)ctx;
 
-   if (filestream_write(nictx->db->fd, value,
+   if (filestream_write(nictx->fd, value,
             (ssize_t)(nictx->idx->key_size + sizeof(uint64_t))) > 0)
       return 0;
 
    return -1;
 }
 
-static uint64_t libretrodb_tell(libretrodb_t *db)
+static int node_compare(const void *a, const void *b, void *ctx)
 {
-   return filestream_tell(db->fd);
+   return memcmp(a, b, *(uint8_t *)ctx);
 }
 
-static int node_compare(const void *a, const void *b, void *ctx)
+/* bintree_free leaves the values alone */
+static int node_free(void *value, void *ctx)
 {
-   return memcmp(a, b, *(uint8_t *)ctx);
+   free(value);
+   return 0;
 }
 
 int libretrodb_create_index(libretrodb_t *db,
       const char *name, const char *field_name)
 {
+   unsigned i;
    struct node_iter_ctx nictx;
    struct rmsgpack_dom_value key;
    libretrodb_index_t idx;
    struct rmsgpack_dom_value item;
    libretrodb_cursor_t cur          = {0};
    struct rmsgpack_dom_value *field = NULL;
-   void *buff                       = NULL;
-   uint64_t *buff_u64               = NULL;
+   RFILE *fd                        = NULL;
+   uint8_t *buff                    = NULL;
    uint8_t field_size               = 0;
-   uint64_t item_loc                = libretrodb_tell(db);
+   uint64_t item_loc                = 0;
    bintree_t *tree                  = bintree_new(node_compare, &field_size);
 
    item.type                        = RDT_NULL;
@@ -502,6 +1077,8 @@ int libretrodb_create_index(libretrodb_t *db,
    if (!tree || (libretrodb_cursor_open(db, &cur, NULL) != 0))
       goto clean;
 
+   item_loc = libretrodb_cursor_tell(&cur);
+
    key.type            = RDT_STRING;
    key.val.string.len  = (uint32_t)strlen(field_name);
    key.val.string.buff = (char *) field_name;   /* We know we aren't going to change it */
@@ -542,15 +1119,15 @@ int libretrodb_create_index(libretrodb_t *db,
          goto clean;
       }
 
-      buff = malloc(field_size + sizeof(uint64_t));
+      buff = (uint8_t*)malloc(field_size + sizeof(uint64_t));
       if (!buff)
          goto clean;
 
       memcpy(buff, field->val.binary.buff, field_size);
 
-      buff_u64 = (uint64_t *)buff + field_size;
-
-      memcpy(buff_u64, &item_loc, sizeof(uint64_t));
+      /* record offset, big endian */
+      for (i = 0; i < sizeof(uint64_t); i++)
+         buff[field_size + i] = (uint8_t)(item_loc >> (56 - i * 8));
 
       if (bintree_insert(tree, buff) != 0)
       {
@@ -561,22 +1138,35 @@ int libretrodb_create_index(libretrodb_t *db,
       }
       buff     = NULL;
       rmsgpack_dom_value_free(&item);
-      item_loc = libretrodb_tell(db);
+      item_loc = libretrodb_cursor_tell(&cur);
    }
 
-   filestream_seek(db->fd, 0, RETRO_VFS_SEEK_POSITION_END);
+   /* The handle itself is read-only, append through a new one */
+   fd = filestream_open(db->path,
+         RETRO_VFS_FILE_ACCESS_READ_WRITE | RETRO_VFS_FILE_ACCESS_UPDATE_EXISTING,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (!fd)
+      goto clean;
+
+   filestream_seek(fd, 0, RETRO_VFS_SEEK_POSITION_END);
 
    strncpy(idx.name, name, 50);
 
    idx.name[49] = '\0';
    idx.key_size = field_size;
    idx.next     = db->count * (field_size + sizeof(uint64_t));
-   libretrodb_write_index_header(db->fd, &idx);
+   libretrodb_write_index_header(fd, &idx);
 
-   nictx.db  = db;
+   nictx.fd  = fd;
    nictx.idx = &idx;
    bintree_iterate(tree, node_iter, &nictx);
 
+   filestream_close(fd);
+
+   /* A mapped handle does not see the new index, reopen it */
+   libretrodb_free_tables(db);
+
 clean:
    rmsgpack_dom_value_free(&item);
    if (buff)
@@ -584,7 +1174,10 @@ clean:
    if (cur.is_valid)
       libretrodb_cursor_close(&cur);
    if (tree)
+   {
+      bintree_iterate(tree, node_free, NULL);
       bintree_free(tree);
+   }
    free(tree);
    return 0;
 }
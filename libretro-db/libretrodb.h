@@ -51,9 +51,34 @@ void libretrodb_close(libretrodb_t *db);
 
 int libretrodb_open(const char *path, libretrodb_t *db);
 
+/**
+ * libretrodb_open_mapped:
+ * @path                : Path to the database.
+ * @db                  : Handle to database.
+ *
+ * Read-only variant of libretrodb_open. The file is memory mapped
+ * (or read in one go where mmap is not available), cursors and
+ * lookups then decode straight from memory.
+ *
+ * Returns: 0 if successful, otherwise negative.
+ **/
+int libretrodb_open_mapped(const char *path, libretrodb_t *db);
+
 int libretrodb_create_index(libretrodb_t *db, const char *name,
       const char *field_name);
 
+/**
+ * libretrodb_find_entry:
+ * @db                  : Handle to database.
+ * @index_name          : Name of an index made by libretrodb_create_index.
+ * @key                 : Key to look for, as many bytes as the index keys.
+ * @out                 : Matching record.
+ *
+ * Index tables are parsed on the first call and kept
+ * until the database is closed.
+ *
+ * Returns: 0 if found, otherwise negative.
+ **/
 int libretrodb_find_entry(libretrodb_t *db, const char *index_name,
         const void *key, struct rmsgpack_dom_value *out);
 
@@ -71,7 +96,9 @@ void libretrodb_cursor_free(libretrodb_cursor_t *dbc);
  * @cursor              : Handle to database cursor.
  * @q                   : Query to execute.
  *
- * Opens cursor to database based on query @q.
+ * Opens cursor to database based on query @q. An equality
+ * on a field that has an index of the same name is answered
+ * from the index instead of walking every record.
  *
  * Returns: 0 if successful, otherwise negative.
  **/
@@ -89,6 +116,26 @@ int libretrodb_cursor_open(libretrodb_t *db,
  **/
 int libretrodb_cursor_reset(libretrodb_cursor_t *cursor);
 
+/**
+ * libretrodb_cursor_tell:
+ * @cursor              : Handle to database cursor.
+ *
+ * Returns: file offset of the item the next
+ * libretrodb_cursor_read_item will decode.
+ **/
+uint64_t libretrodb_cursor_tell(libretrodb_cursor_t *cursor);
+
+/**
+ * libretrodb_cursor_seek:
+ * @cursor              : Handle to database cursor.
+ * @offset              : Offset returned by libretrodb_cursor_tell.
+ *
+ * Moves the cursor so the next read decodes the item at @offset.
+ *
+ * Returns: 0 if successful, otherwise negative.
+ **/
+int libretrodb_cursor_seek(libretrodb_cursor_t *cursor, uint64_t offset);
+
 /**
  * libretrodb_cursor_close:
  * @cursor              : Handle to database cursor.
@@ -105,6 +152,36 @@ void libretrodb_query_free(void *q);
 int libretrodb_cursor_read_item(libretrodb_cursor_t *cursor,
       struct rmsgpack_dom_value *out);
 
+/**
+ * libretrodb_cursor_set_fields:
+ * @cursor              : Handle to an open database cursor.
+ * @fields              : Names of the fields to return.
+ * @num_fields          : Number of @fields, 0 to return all of them.
+ *
+ * Restricts the records libretrodb_cursor_read_item returns to the
+ * given top-level fields. On mapped databases the other fields are
+ * not even decoded.
+ *
+ * Returns: 0 if successful, otherwise negative.
+ **/
+int libretrodb_cursor_set_fields(libretrodb_cursor_t *cursor,
+      const char **fields, unsigned num_fields);
+
+/**
+ * libretrodb_cursor_read_item_view:
+ * @cursor              : Handle to database cursor.
+ * @out                 : Decoded item.
+ *
+ * Zero-copy variant of libretrodb_cursor_read_item for databases
+ * opened with libretrodb_open_mapped: strings and binaries point
+ * into the mapping and are not NUL terminated. The cursor query
+ * is not applied. Free @out with rmsgpack_dom_view_free.
+ *
+ * Returns: 0 if successful, EOF at the end, otherwise negative.
+ **/
+int libretrodb_cursor_read_item_view(libretrodb_cursor_t *cursor,
+      struct rmsgpack_dom_value *out);
+
 RETRO_END_DECLS
 
 #endif
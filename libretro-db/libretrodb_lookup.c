@@ -0,0 +1,539 @@
+/* Copyright  (C) 2010-2017 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (libretrodb_lookup.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <boolean.h>
+#include <string/stdstring.h>
+
+#include "libretrodb.h"
+#include "libretrodb_lookup.h"
+
+/* A slot holds record + 1, zero marks an empty slot. Serial slots
+ * also point at the serial bytes in the pool so a hash hit can be
+ * confirmed without touching the file. */
+struct lookup_crc_slot
+{
+   uint32_t crc;
+   uint32_t record;
+};
+
+struct lookup_serial_slot
+{
+   uint32_t hash;
+   uint32_t record;
+   uint32_t offset;
+   uint32_t len;
+};
+
+struct libretrodb_lookup_db
+{
+   struct libretrodb_lookup *owner;
+   char *path;
+   uint32_t path_hash;
+   uint32_t count;
+   uint64_t *offsets;
+   size_t offsets_cap;
+
+   struct lookup_crc_slot *crc;
+   size_t crc_mask;
+   size_t crc_count;
+
+   struct lookup_serial_slot *serial;
+   size_t serial_mask;
+   size_t serial_count;
+
+   char *pool;
+   size_t pool_size;
+   size_t pool_cap;
+};
+
+struct libretrodb_lookup
+{
+   libretrodb_lookup_db_t **dbs;
+   size_t count;
+   size_t cap;
+
+   /* The last database a record was read from stays open,
+    * matches tend to come from the same database in a row. */
+   libretrodb_lookup_db_t *open_db;
+   libretrodb_t *db;
+   libretrodb_cursor_t *cur;
+};
+
+static uint32_t lookup_hash(const char *s, size_t len)
+{
+   /* FNV-1a */
+   size_t i;
+   uint32_t hash = 2166136261U;
+
+   for (i = 0; i < len; i++)
+   {
+      hash ^= (uint8_t)s[i];
+      hash *= 16777619U;
+   }
+
+   return hash;
+}
+
+static size_t lookup_crc_slot_find(const struct lookup_crc_slot *slots,
+      size_t mask, uint32_t crc)
+{
+   size_t i = (crc * 2654435761U) & mask;
+
+   while (slots[i].record && slots[i].crc != crc)
+      i = (i + 1) & mask;
+
+   return i;
+}
+
+static size_t lookup_serial_slot_find(const libretrodb_lookup_db_t *db,
+      const struct lookup_serial_slot *slots, size_t mask,
+      uint32_t hash, const char *serial, size_t len)
+{
+   size_t i = hash & mask;
+
+   while (slots[i].record)
+   {
+      if (     slots[i].hash == hash
+            && slots[i].len  == len
+            && !memcmp(db->pool + slots[i].offset, serial, len))
+         break;
+      i = (i + 1) & mask;
+   }
+
+   return i;
+}
+
+static bool lookup_crc_grow(libretrodb_lookup_db_t *db)
+{
+   size_t i;
+   size_t cap = db->crc ? (db->crc_mask + 1) * 2 : 256;
+   struct lookup_crc_slot *slots = (struct lookup_crc_slot*)
+      calloc(cap, sizeof(*slots));
+
+   if (!slots)
+      return false;
+
+   if (db->crc)
+   {
+      for (i = 0; i <= db->crc_mask; i++)
+         if (db->crc[i].record)
+            slots[lookup_crc_slot_find(slots, cap - 1, db->crc[i].crc)] =
+               db->crc[i];
+      free(db->crc);
+   }
+
+   db->crc      = slots;
+   db->crc_mask = cap - 1;
+   return true;
+}
+
+static bool lookup_serial_grow(libretrodb_lookup_db_t *db)
+{
+   size_t i;
+   size_t cap = db->serial ? (db->serial_mask + 1) * 2 : 256;
+   struct lookup_serial_slot *slots = (struct lookup_serial_slot*)
+      calloc(cap, sizeof(*slots));
+
+   if (!slots)
+      return false;
+
+   if (db->serial)
+   {
+      for (i = 0; i <= db->serial_mask; i++)
+      {
+         size_t j;
+
+         if (!db->serial[i].record)
+            continue;
+
+         /* keys are unique already, only look for a free slot */
+         j = db->serial[i].hash & (cap - 1);
+         while (slots[j].record)
+            j = (j + 1) & (cap - 1);
+         slots[j] = db->serial[i];
+      }
+      free(db->serial);
+   }
+
+   db->serial      = slots;
+   db->serial_mask = cap - 1;
+   return true;
+}
+
+static bool lookup_add_crc(libretrodb_lookup_db_t *db,
+      uint32_t crc, uint32_t record)
+{
+   size_t i;
+
+   /* keep the load factor below one half */
+   if (!db->crc || (db->crc_count + 1) * 2 > db->crc_mask + 1)
+      if (!lookup_crc_grow(db))
+         return false;
+
+   i = lookup_crc_slot_find(db->crc, db->crc_mask, crc);
+
+   /* the first record with a given crc wins,
+    * same as a cursor walking the file */
+   if (db->crc[i].record)
+      return true;
+
+   db->crc[i].crc    = crc;
+   db->crc[i].record = record + 1;
+   db->crc_count++;
+   return true;
+}
+
+static bool lookup_add_serial(libretrodb_lookup_db_t *db,
+      const char *serial, uint32_t len, uint32_t record)
+{
+   size_t i;
+   uint32_t hash = lookup_hash(serial, len);
+
+   if (!db->serial || (db->serial_count + 1) * 2 > db->serial_mask + 1)
+      if (!lookup_serial_grow(db))
+         return false;
+
+   i = lookup_serial_slot_find(db, db->serial, db->serial_mask,
+         hash, serial, len);
+
+   if (db->serial[i].record)
+      return true;
+
+   if (db->pool_size + len > db->pool_cap)
+   {
+      size_t cap = db->pool_cap ? db->pool_cap * 2 : 4096;
+      char *pool = NULL;
+
+      while (cap < db->pool_size + len)
+         cap *= 2;
+
+      if (!(pool = (char*)realloc(db->pool, cap)))
+         return false;
+
+      db->pool     = pool;
+      db->pool_cap = cap;
+   }
+
+   memcpy(db->pool + db->pool_size, serial, len);
+
+   db->serial[i].hash   = hash;
+   db->serial[i].record = record + 1;
+   db->serial[i].offset = (uint32_t)db->pool_size;
+   db->serial[i].len    = len;
+   db->pool_size       += len;
+   db->serial_count++;
+   return true;
+}
+
+static bool lookup_add_record(libretrodb_lookup_db_t *db,
+      const struct rmsgpack_dom_value *item, uint64_t offset)
+{
+   unsigned i;
+   bool has_crc    = false;
+   bool has_serial = false;
+   uint32_t record = db->count;
+
+   if (db->count == db->offsets_cap)
+   {
+      size_t cap        = db->offsets_cap ? db->offsets_cap * 2 : 1024;
+      uint64_t *offsets = (uint64_t*)realloc(db->offsets,
+            cap * sizeof(*offsets));
+
+      if (!offsets)
+         return false;
+
+      db->offsets     = offsets;
+      db->offsets_cap = cap;
+   }
+
+   db->offsets[db->count++] = offset;
+
+   if (item->type != RDT_MAP)
+      return true;
+
+   /* Only binary values are indexed, that is what the
+    * {crc:b"..."} and {serial:b"..."} queries match against.
+    * The first occurrence of a key wins, like
+    * rmsgpack_dom_value_map_value. */
+   for (i = 0; i < item->val.map.len; i++)
+   {
+      const struct rmsgpack_dom_value *key = &item->val.map.items[i].key;
+      const struct rmsgpack_dom_value *val = &item->val.map.items[i].value;
+
+      if (key->type != RDT_STRING)
+         continue;
+
+      if (     !has_crc
+            && key->val.string.len == 3
+            && !memcmp(key->val.string.buff, "crc", 3))
+      {
+         const uint8_t *b = (const uint8_t*)val->val.binary.buff;
+
+         has_crc = true;
+
+         if (val->type != RDT_BINARY || val->val.binary.len != 4)
+            continue;
+
+         if (!lookup_add_crc(db, ((uint32_t)b[0] << 24)
+                  | ((uint32_t)b[1] << 16)
+                  | ((uint32_t)b[2] <<  8)
+                  |  (uint32_t)b[3], record))
+            return false;
+      }
+      else if (!has_serial
+            && key->val.string.len == 6
+            && !memcmp(key->val.string.buff, "serial", 6))
+      {
+         has_serial = true;
+
+         if (val->type != RDT_BINARY || !val->val.binary.len)
+            continue;
+
+         if (!lookup_add_serial(db, val->val.binary.buff,
+                  val->val.binary.len, record))
+            return false;
+      }
+   }
+
+   return true;
+}
+
+static void lookup_db_free(libretrodb_lookup_db_t *db)
+{
+   if (!db)
+      return;
+
+   free(db->path);
+   free(db->offsets);
+   free(db->crc);
+   free(db->serial);
+   free(db->pool);
+   free(db);
+}
+
+static libretrodb_lookup_db_t *lookup_db_build(const char *path)
+{
+   struct rmsgpack_dom_value item;
+   libretrodb_lookup_db_t *ldb = NULL;
+   libretrodb_t *db            = libretrodb_new();
+   libretrodb_cursor_t *cur    = libretrodb_cursor_new();
+
+   if (!db || !cur)
+      goto error;
+
+   if (libretrodb_open_mapped(path, db) != 0)
+      goto error;
+
+   if (libretrodb_cursor_open(db, cur, NULL) != 0)
+      goto error;
+
+   ldb = (libretrodb_lookup_db_t*)calloc(1, sizeof(*ldb));
+
+   if (!ldb)
+      goto error;
+
+   ldb->path      = strdup(path);
+   ldb->path_hash = lookup_hash(path, strlen(path));
+
+   for (;;)
+   {
+      uint64_t offset = libretrodb_cursor_tell(cur);
+
+      /* keys are copied into the tables, no need for owned strings */
+      if (libretrodb_cursor_read_item_view(cur, &item) != 0)
+         break;
+
+      if (!lookup_add_record(ldb, &item, offset))
+      {
+         rmsgpack_dom_view_free(&item);
+         goto error;
+      }
+
+      rmsgpack_dom_view_free(&item);
+   }
+
+   libretrodb_cursor_close(cur);
+   libretrodb_cursor_free(cur);
+   libretrodb_close(db);
+   libretrodb_free(db);
+
+   return ldb;
+
+error:
+   lookup_db_free(ldb);
+   if (cur)
+   {
+      libretrodb_cursor_close(cur);
+      libretrodb_cursor_free(cur);
+   }
+   if (db)
+   {
+      libretrodb_close(db);
+      libretrodb_free(db);
+   }
+   return NULL;
+}
+
+static void lookup_close_db(libretrodb_lookup_t *lookup)
+{
+   if (lookup->cur)
+   {
+      libretrodb_cursor_close(lookup->cur);
+      libretrodb_cursor_free(lookup->cur);
+   }
+   if (lookup->db)
+   {
+      libretrodb_close(lookup->db);
+      libretrodb_free(lookup->db);
+   }
+
+   lookup->cur     = NULL;
+   lookup->db      = NULL;
+   lookup->open_db = NULL;
+}
+
+libretrodb_lookup_t *libretrodb_lookup_new(void)
+{
+   return (libretrodb_lookup_t*)calloc(1, sizeof(libretrodb_lookup_t));
+}
+
+void libretrodb_lookup_free(libretrodb_lookup_t *lookup)
+{
+   size_t i;
+
+   if (!lookup)
+      return;
+
+   lookup_close_db(lookup);
+
+   for (i = 0; i < lookup->count; i++)
+      lookup_db_free(lookup->dbs[i]);
+
+   free(lookup->dbs);
+   free(lookup);
+}
+
+libretrodb_lookup_db_t *libretrodb_lookup_open(libretrodb_lookup_t *lookup,
+      const char *path)
+{
+   size_t i;
+   uint32_t hash;
+   libretrodb_lookup_db_t *db = NULL;
+
+   if (!lookup || string_is_empty(path))
+      return NULL;
+
+   hash = lookup_hash(path, strlen(path));
+
+   for (i = 0; i < lookup->count; i++)
+      if (     lookup->dbs[i]->path_hash == hash
+            && string_is_equal(lookup->dbs[i]->path, path))
+         return lookup->dbs[i];
+
+   if (lookup->count == lookup->cap)
+   {
+      size_t cap                   = lookup->cap ? lookup->cap * 2 : 16;
+      libretrodb_lookup_db_t **dbs = (libretrodb_lookup_db_t**)
+         realloc(lookup->dbs, cap * sizeof(*dbs));
+
+      if (!dbs)
+         return NULL;
+
+      lookup->dbs = dbs;
+      lookup->cap = cap;
+   }
+
+   if (!(db = lookup_db_build(path)))
+      return NULL;
+
+   db->owner = lookup;
+
+   lookup->dbs[lookup->count++] = db;
+   return db;
+}
+
+int libretrodb_lookup_crc(libretrodb_lookup_db_t *db, uint32_t crc)
+{
+   size_t i;
+
+   if (!db || !db->crc)
+      return -1;
+
+   i = lookup_crc_slot_find(db->crc, db->crc_mask, crc);
+
+   return (int)db->crc[i].record - 1;
+}
+
+int libretrodb_lookup_serial(libretrodb_lookup_db_t *db, const char *serial)
+{
+   size_t i;
+   size_t len;
+
+   if (!db || !db->serial || string_is_empty(serial))
+      return -1;
+
+   len = strlen(serial);
+   i   = lookup_serial_slot_find(db, db->serial, db->serial_mask,
+         lookup_hash(serial, len), serial, len);
+
+   return (int)db->serial[i].record - 1;
+}
+
+int libretrodb_lookup_read(libretrodb_lookup_db_t *db, int record,
+      struct rmsgpack_dom_value *out)
+{
+   libretrodb_lookup_t *lookup = NULL;
+
+   if (!db || record < 0 || (uint32_t)record >= db->count)
+      return -1;
+
+   lookup = db->owner;
+
+   if (lookup->open_db != db)
+   {
+      lookup_close_db(lookup);
+
+      lookup->db  = libretrodb_new();
+      lookup->cur = libretrodb_cursor_new();
+
+      if (     !lookup->db || !lookup->cur
+            || libretrodb_open_mapped(db->path, lookup->db) != 0)
+         goto error;
+
+      if (libretrodb_cursor_open(lookup->db, lookup->cur, NULL) != 0)
+         goto error;
+
+      lookup->open_db = db;
+   }
+
+   if (libretrodb_cursor_seek(lookup->cur, db->offsets[record]) != 0)
+      return -1;
+
+   return libretrodb_cursor_read_item(lookup->cur, out);
+
+error:
+   lookup_close_db(lookup);
+   return -1;
+}
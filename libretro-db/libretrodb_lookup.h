@@ -0,0 +1,98 @@
+/* Copyright  (C) 2010-2017 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (libretrodb_lookup.h).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __LIBRETRODB_LOOKUP_H__
+#define __LIBRETRODB_LOOKUP_H__
+
+#include <stdint.h>
+
+#include <retro_common_api.h>
+
+#include "rmsgpack_dom.h"
+
+RETRO_BEGIN_DECLS
+
+/* In-memory crc/serial index over a set of databases.
+ *
+ * Every database is read once, the first time it is opened, and
+ * only the record offsets plus the crc/serial keys are kept.
+ * Lookups are answered from open-addressing tables and only the
+ * matching record is decoded again from disk. */
+
+typedef struct libretrodb_lookup libretrodb_lookup_t;
+
+typedef struct libretrodb_lookup_db libretrodb_lookup_db_t;
+
+libretrodb_lookup_t *libretrodb_lookup_new(void);
+
+void libretrodb_lookup_free(libretrodb_lookup_t *lookup);
+
+/**
+ * libretrodb_lookup_open:
+ * @lookup              : Handle to lookup engine.
+ * @path                : Path to the database.
+ *
+ * Indexes the database at @path, or returns the index
+ * built by an earlier call with the same path.
+ *
+ * Returns: database index, or NULL if the file could not be read.
+ **/
+libretrodb_lookup_db_t *libretrodb_lookup_open(libretrodb_lookup_t *lookup,
+      const char *path);
+
+/**
+ * libretrodb_lookup_crc:
+ * @db                  : Database index.
+ * @crc                 : CRC32 to look for.
+ *
+ * Returns: number of the first record whose 'crc' field
+ * matches @crc, or -1 if there is none.
+ **/
+int libretrodb_lookup_crc(libretrodb_lookup_db_t *db, uint32_t crc);
+
+/**
+ * libretrodb_lookup_serial:
+ * @db                  : Database index.
+ * @serial              : Serial to look for.
+ *
+ * Returns: number of the first record whose 'serial' field
+ * matches @serial, or -1 if there is none.
+ **/
+int libretrodb_lookup_serial(libretrodb_lookup_db_t *db, const char *serial);
+
+/**
+ * libretrodb_lookup_read:
+ * @db                  : Database index.
+ * @record              : Record number returned by a lookup.
+ * @out                 : Decoded record.
+ *
+ * Decodes a single record. The caller frees @out with
+ * rmsgpack_dom_value_free.
+ *
+ * Returns: 0 if successful, otherwise negative.
+ **/
+int libretrodb_lookup_read(libretrodb_lookup_db_t *db, int record,
+      struct rmsgpack_dom_value *out);
+
+RETRO_END_DECLS
+
+#endif
@@ -0,0 +1,417 @@
+/* Copyright  (C) 2010-2017 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (libretrodb_lookup_bench.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Compares the query path the content scanner used to take, one
+ * {crc:or(...)} or {serial:...} cursor walk per file and database,
+ * against libretrodb_lookup. Both paths must return the very same
+ * record for every crc/serial, half of which are misses.
+ *
+ * Without arguments a synthetic database is written first,
+ * otherwise the given .rdb files are used. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <boolean.h>
+#include <features/features_cpu.h>
+#include <streams/file_stream.h>
+
+#include "libretrodb.h"
+#include "libretrodb_lookup.h"
+
+struct bench_provider
+{
+   unsigned next;
+   unsigned count;
+};
+
+struct bench_key
+{
+   uint32_t crc;
+   char serial[32];
+};
+
+static uint32_t bench_crc(unsigned i)
+{
+   uint32_t x = i * 2654435761U + 0x12345678;
+   x ^= x >> 15;
+   x *= 0x2c1b3c6d;
+   x ^= x >> 12;
+   return x;
+}
+
+static void bench_set_string(struct rmsgpack_dom_value *v, const char *s,
+      enum rmsgpack_dom_type type)
+{
+   v->type            = type;
+   v->val.string.len  = (uint32_t)strlen(s);
+   v->val.string.buff = strdup(s);
+}
+
+static int bench_value_provider(void *ctx, struct rmsgpack_dom_value *out)
+{
+   char buf[64];
+   uint32_t crc;
+   struct bench_provider *p = (struct bench_provider*)ctx;
+   struct rmsgpack_dom_pair *items;
+
+   if (p->next >= p->count)
+      return 1;
+
+   items = (struct rmsgpack_dom_pair*)calloc(5, sizeof(*items));
+
+   out->type          = RDT_MAP;
+   out->val.map.len   = 5;
+   out->val.map.items = items;
+
+   bench_set_string(&items[0].key, "name", RDT_STRING);
+   snprintf(buf, sizeof(buf), "Game %u (Europe)", p->next);
+   bench_set_string(&items[0].value, buf, RDT_STRING);
+
+   bench_set_string(&items[1].key, "rom_name", RDT_STRING);
+   snprintf(buf, sizeof(buf), "Game %u (Europe).bin", p->next);
+   bench_set_string(&items[1].value, buf, RDT_STRING);
+
+   bench_set_string(&items[2].key, "size", RDT_STRING);
+   items[2].value.type     = RDT_UINT;
+   items[2].value.val.uint_ = 1024 * (p->next + 1);
+
+   crc = bench_crc(p->next);
+   bench_set_string(&items[3].key, "crc", RDT_STRING);
+   items[3].value.type            = RDT_BINARY;
+   items[3].value.val.binary.len  = 4;
+   items[3].value.val.binary.buff = (char*)malloc(4);
+   items[3].value.val.binary.buff[0] = (char)(crc >> 24);
+   items[3].value.val.binary.buff[1] = (char)(crc >> 16);
+   items[3].value.val.binary.buff[2] = (char)(crc >>  8);
+   items[3].value.val.binary.buff[3] = (char)(crc >>  0);
+
+   bench_set_string(&items[4].key, "serial", RDT_STRING);
+   snprintf(buf, sizeof(buf), "SLUS-%05u", p->next);
+   bench_set_string(&items[4].value, buf, RDT_BINARY);
+
+   p->next++;
+   return 0;
+}
+
+static bool bench_write_db(const char *path, unsigned count)
+{
+   struct bench_provider p;
+   RFILE *fd = filestream_open(path,
+         RETRO_VFS_FILE_ACCESS_WRITE, RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (!fd)
+      return false;
+
+   p.next  = 0;
+   p.count = count;
+
+   libretrodb_create(fd, bench_value_provider, &p);
+   filestream_close(fd);
+   return true;
+}
+
+/* The old path: compile the query and walk the whole database */
+static bool bench_query(const char *path, const char *query,
+      struct rmsgpack_dom_value *out)
+{
+   struct rmsgpack_dom_value item;
+   const char *error     = NULL;
+   bool found            = false;
+   libretrodb_t *db      = libretrodb_new();
+   libretrodb_cursor_t *cur = libretrodb_cursor_new();
+   libretrodb_query_t *q = NULL;
+
+   if (libretrodb_open(path, db) != 0)
+      goto end;
+
+   q = (libretrodb_query_t*)libretrodb_query_compile(db, query,
+         strlen(query), &error);
+
+   if (error || libretrodb_cursor_open(db, cur, q) != 0)
+      goto end;
+
+   /* the scanner decodes every match, keep the first one */
+   while (libretrodb_cursor_read_item(cur, &item) == 0)
+   {
+      if (!found)
+      {
+         *out  = item;
+         found = true;
+      }
+      else
+         rmsgpack_dom_value_free(&item);
+   }
+
+   libretrodb_cursor_close(cur);
+
+end:
+   if (q)
+      libretrodb_query_free(q);
+   libretrodb_close(db);
+   libretrodb_free(db);
+   libretrodb_cursor_free(cur);
+   return found;
+}
+
+static void bench_hex(char *s, size_t len, const char *serial)
+{
+   size_t i;
+
+   for (i = 0; serial[i] && (i + 1) * 2 < len; i++)
+      snprintf(s + i * 2, 3, "%02X", (uint8_t)serial[i]);
+}
+
+static bool bench_check(bool found_a, struct rmsgpack_dom_value *a,
+      bool found_b, struct rmsgpack_dom_value *b)
+{
+   bool ok = found_a == found_b;
+
+   if (ok && found_a)
+      ok = rmsgpack_dom_value_cmp(a, b) == 0;
+
+   if (found_a)
+      rmsgpack_dom_value_free(a);
+   if (found_b)
+      rmsgpack_dom_value_free(b);
+
+   return ok;
+}
+
+int main(int argc, char *argv[])
+{
+   int i;
+   unsigned k;
+   unsigned records           = 20000;
+   unsigned queries           = 200;
+   const char **paths         = NULL;
+   unsigned num_paths         = 0;
+   bool synthetic             = false;
+   bool ok                    = true;
+   struct bench_key *keys     = NULL;
+   libretrodb_lookup_t *lookup = NULL;
+   retro_time_t start, query_crc, query_serial, build, lookup_crc, lookup_serial;
+   char tmp[] = "libretrodb_lookup_bench.rdb";
+
+   paths = (const char**)calloc(argc, sizeof(*paths));
+
+   for (i = 1; i < argc; i++)
+   {
+      if (!strcmp(argv[i], "-n") && i + 1 < argc)
+         records = (unsigned)strtoul(argv[++i], NULL, 0);
+      else if (!strcmp(argv[i], "-q") && i + 1 < argc)
+         queries = (unsigned)strtoul(argv[++i], NULL, 0);
+      else if (argv[i][0] == '-')
+      {
+         fprintf(stderr, "Usage: %s [-n records] [-q queries] [rdb files...]\n",
+               argv[0]);
+         return 1;
+      }
+      else
+         paths[num_paths++] = argv[i];
+   }
+
+   if (!num_paths)
+   {
+      if (!bench_write_db(tmp, records))
+         return 1;
+      paths[num_paths++] = tmp;
+      synthetic          = true;
+   }
+
+   if (!queries)
+      return 1;
+
+   /* Every other key is a miss */
+   keys = (struct bench_key*)calloc(queries, sizeof(*keys));
+
+   for (k = 0; k < queries; k++)
+   {
+      unsigned r = (k * 7919) % records;
+
+      if (k & 1)
+      {
+         keys[k].crc = bench_crc(r) ^ 0x80000001;
+         snprintf(keys[k].serial, sizeof(keys[k].serial), "SLES-%05u", r);
+      }
+      else
+      {
+         keys[k].crc = bench_crc(r);
+         snprintf(keys[k].serial, sizeof(keys[k].serial), "SLUS-%05u", r);
+      }
+   }
+
+   printf("%u database(s), %u crc and %u serial lookups\n",
+         num_paths, queries, queries);
+
+   /* query path, crc */
+   start = cpu_features_get_time_usec();
+   for (k = 0; k < queries; k++)
+   {
+      unsigned j;
+      for (j = 0; j < num_paths; j++)
+      {
+         char query[50];
+         struct rmsgpack_dom_value out;
+
+         snprintf(query, sizeof(query), "{crc:or(b\"%08X\",b\"%08X\")}",
+               keys[k].crc, 0);
+         if (bench_query(paths[j], query, &out))
+         {
+            rmsgpack_dom_value_free(&out);
+            break;
+         }
+      }
+   }
+   query_crc = cpu_features_get_time_usec() - start;
+
+   /* query path, serial */
+   start = cpu_features_get_time_usec();
+   for (k = 0; k < queries; k++)
+   {
+      unsigned j;
+      for (j = 0; j < num_paths; j++)
+      {
+         char hex[64];
+         char query[100];
+         struct rmsgpack_dom_value out;
+
+         bench_hex(hex, sizeof(hex), keys[k].serial);
+         snprintf(query, sizeof(query), "{'serial': b'%s'}", hex);
+         if (bench_query(paths[j], query, &out))
+         {
+            rmsgpack_dom_value_free(&out);
+            break;
+         }
+      }
+   }
+   query_serial = cpu_features_get_time_usec() - start;
+
+   /* lookup, index build */
+   start  = cpu_features_get_time_usec();
+   lookup = libretrodb_lookup_new();
+   for (k = 0; k < num_paths; k++)
+      libretrodb_lookup_open(lookup, paths[k]);
+   build  = cpu_features_get_time_usec() - start;
+
+   start = cpu_features_get_time_usec();
+   for (k = 0; k < queries; k++)
+   {
+      unsigned j;
+      for (j = 0; j < num_paths; j++)
+      {
+         struct rmsgpack_dom_value out;
+         libretrodb_lookup_db_t *db = libretrodb_lookup_open(lookup, paths[j]);
+         int record                 = libretrodb_lookup_crc(db, keys[k].crc);
+
+         if (record >= 0 && libretrodb_lookup_read(db, record, &out) == 0)
+         {
+            rmsgpack_dom_value_free(&out);
+            break;
+         }
+      }
+   }
+   lookup_crc = cpu_features_get_time_usec() - start;
+
+   start = cpu_features_get_time_usec();
+   for (k = 0; k < queries; k++)
+   {
+      unsigned j;
+      for (j = 0; j < num_paths; j++)
+      {
+         struct rmsgpack_dom_value out;
+         libretrodb_lookup_db_t *db = libretrodb_lookup_open(lookup, paths[j]);
+         int record                 = libretrodb_lookup_serial(db, keys[k].serial);
+
+         if (record >= 0 && libretrodb_lookup_read(db, record, &out) == 0)
+         {
+            rmsgpack_dom_value_free(&out);
+            break;
+         }
+      }
+   }
+   lookup_serial = cpu_features_get_time_usec() - start;
+
+   /* both paths have to agree, untimed */
+   for (k = 0; k < queries; k++)
+   {
+      unsigned j;
+      for (j = 0; j < num_paths; j++)
+      {
+         char hex[64];
+         char query[100];
+         struct rmsgpack_dom_value a, b;
+         bool found_a, found_b;
+         libretrodb_lookup_db_t *db = libretrodb_lookup_open(lookup, paths[j]);
+         int record                 = libretrodb_lookup_crc(db, keys[k].crc);
+
+         snprintf(query, sizeof(query), "{crc:or(b\"%08X\",b\"%08X\")}",
+               keys[k].crc, 0);
+         found_a = bench_query(paths[j], query, &a);
+         found_b = record >= 0 && libretrodb_lookup_read(db, record, &b) == 0;
+
+         if (!bench_check(found_a, &a, found_b, &b))
+         {
+            printf("crc %08X differs in %s\n", keys[k].crc, paths[j]);
+            ok = false;
+         }
+
+         bench_hex(hex, sizeof(hex), keys[k].serial);
+         snprintf(query, sizeof(query), "{'serial': b'%s'}", hex);
+         record  = libretrodb_lookup_serial(db, keys[k].serial);
+         found_a = bench_query(paths[j], query, &a);
+         found_b = record >= 0 && libretrodb_lookup_read(db, record, &b) == 0;
+
+         if (!bench_check(found_a, &a, found_b, &b))
+         {
+            printf("serial %s differs in %s\n", keys[k].serial, paths[j]);
+            ok = false;
+         }
+      }
+   }
+
+   printf("%-8s %12s %12s %12s\n", "", "crc/s", "serial/s", "index ms");
+   printf("%-8s %12.0f %12.0f %12s\n", "query",
+         queries * 1000000.0 / (query_crc ? query_crc : 1),
+         queries * 1000000.0 / (query_serial ? query_serial : 1), "-");
+   printf("%-8s %12.0f %12.0f %12.2f\n", "lookup",
+         queries * 1000000.0 / (lookup_crc ? lookup_crc : 1),
+         queries * 1000000.0 / (lookup_serial ? lookup_serial : 1),
+         build / 1000.0);
+
+   libretrodb_lookup_free(lookup);
+   free(keys);
+   free(paths);
+
+   if (synthetic)
+      remove(tmp);
+
+   if (!ok)
+   {
+      printf("FAILED\n");
+      return 1;
+   }
+
+   printf("OK\n");
+   return 0;
+}
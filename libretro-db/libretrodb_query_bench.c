@@ -0,0 +1,458 @@
+/* Copyright  (C) 2010-2017 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (libretrodb_query_bench.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Times queries three ways:
+ *
+ *  full     file handle, every record decoded whole and then
+ *           filtered, which is what cursors used to do
+ *  planned  mapped database, the cursor picks an index or only
+ *           decodes the fields the query looks at
+ *  project  as planned, but only the 'name' field is returned,
+ *           like the menu lists built from a query
+ *
+ * All three have to return the same records.
+ *
+ * Without arguments a synthetic database (with a 'crc' index) is
+ * written first, otherwise the given .rdb file and queries are
+ * used. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <boolean.h>
+#include <features/features_cpu.h>
+#include <streams/file_stream.h>
+#include <string/stdstring.h>
+
+#include "libretrodb.h"
+#include "query.h"
+
+struct bench_provider
+{
+   unsigned next;
+   unsigned count;
+};
+
+struct bench_result
+{
+   unsigned count;
+   struct rmsgpack_dom_value *items;
+};
+
+static const char *bench_default_queries[] = {
+   "{'developer':'Developer 7'}",
+   "{'releaseyear':1995,'releasemonth':10}",
+   "{'name':glob('Game 12*')}",
+   NULL, /* crc of record 4242, filled in by main */
+   NULL
+};
+
+static uint32_t bench_crc(unsigned i)
+{
+   uint32_t x = i * 2654435761U + 0x12345678;
+   x ^= x >> 15;
+   x *= 0x2c1b3c6d;
+   x ^= x >> 12;
+   return x;
+}
+
+static void bench_set_string(struct rmsgpack_dom_value *v, const char *s,
+      enum rmsgpack_dom_type type)
+{
+   v->type            = type;
+   v->val.string.len  = (uint32_t)strlen(s);
+   v->val.string.buff = strdup(s);
+}
+
+static void bench_set_uint(struct rmsgpack_dom_pair *pair, const char *key,
+      uint64_t value)
+{
+   bench_set_string(&pair->key, key, RDT_STRING);
+   pair->value.type      = RDT_UINT;
+   pair->value.val.uint_ = value;
+}
+
+static void bench_set_binary(struct rmsgpack_dom_pair *pair, const char *key,
+      unsigned seed, unsigned len)
+{
+   unsigned i;
+
+   bench_set_string(&pair->key, key, RDT_STRING);
+   pair->value.type            = RDT_BINARY;
+   pair->value.val.binary.len  = len;
+   pair->value.val.binary.buff = (char*)malloc(len);
+
+   for (i = 0; i < len; i++)
+      pair->value.val.binary.buff[i] = (char)bench_crc(seed * 31 + i);
+}
+
+/* Roughly the shape of a real record, a dozen fields */
+static int bench_value_provider(void *ctx, struct rmsgpack_dom_value *out)
+{
+   char buf[256];
+   uint32_t crc;
+   unsigned i;
+   struct bench_provider *p = (struct bench_provider*)ctx;
+   struct rmsgpack_dom_pair *items;
+
+   if (p->next >= p->count)
+      return 1;
+
+   i     = p->next;
+   items = (struct rmsgpack_dom_pair*)calloc(12, sizeof(*items));
+
+   out->type          = RDT_MAP;
+   out->val.map.len   = 12;
+   out->val.map.items = items;
+
+   bench_set_string(&items[0].key, "name", RDT_STRING);
+   snprintf(buf, sizeof(buf), "Game %u (Europe)", i);
+   bench_set_string(&items[0].value, buf, RDT_STRING);
+
+   bench_set_string(&items[1].key, "description", RDT_STRING);
+   snprintf(buf, sizeof(buf), "Game %u (Europe) (En,Fr,De,Es,It) "
+         "(Rev %u) - a long enough description to be worth skipping",
+         i, i % 3);
+   bench_set_string(&items[1].value, buf, RDT_STRING);
+
+   bench_set_string(&items[2].key, "rom_name", RDT_STRING);
+   snprintf(buf, sizeof(buf), "Game %u (Europe).bin", i);
+   bench_set_string(&items[2].value, buf, RDT_STRING);
+
+   bench_set_string(&items[3].key, "developer", RDT_STRING);
+   snprintf(buf, sizeof(buf), "Developer %u", i % 97);
+   bench_set_string(&items[3].value, buf, RDT_STRING);
+
+   bench_set_string(&items[4].key, "publisher", RDT_STRING);
+   snprintf(buf, sizeof(buf), "Publisher %u", i % 53);
+   bench_set_string(&items[4].value, buf, RDT_STRING);
+
+   bench_set_uint(&items[5], "releaseyear", 1980 + (i % 30));
+   bench_set_uint(&items[6], "releasemonth", 1 + (i % 12));
+   bench_set_uint(&items[7], "size", 1024 * (i + 1));
+
+   crc = bench_crc(i);
+   bench_set_string(&items[8].key, "crc", RDT_STRING);
+   items[8].value.type               = RDT_BINARY;
+   items[8].value.val.binary.len     = 4;
+   items[8].value.val.binary.buff    = (char*)malloc(4);
+   items[8].value.val.binary.buff[0] = (char)(crc >> 24);
+   items[8].value.val.binary.buff[1] = (char)(crc >> 16);
+   items[8].value.val.binary.buff[2] = (char)(crc >>  8);
+   items[8].value.val.binary.buff[3] = (char)(crc >>  0);
+
+   bench_set_binary(&items[9], "md5", i, 16);
+   bench_set_binary(&items[10], "sha1", i + 1, 20);
+
+   bench_set_string(&items[11].key, "serial", RDT_STRING);
+   snprintf(buf, sizeof(buf), "SLUS-%05u", i);
+   bench_set_string(&items[11].value, buf, RDT_BINARY);
+
+   p->next++;
+   return 0;
+}
+
+static bool bench_write_db(const char *path, unsigned count)
+{
+   struct bench_provider p;
+   libretrodb_t *db = NULL;
+   RFILE *fd        = filestream_open(path,
+         RETRO_VFS_FILE_ACCESS_WRITE, RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (!fd)
+      return false;
+
+   p.next  = 0;
+   p.count = count;
+
+   libretrodb_create(fd, bench_value_provider, &p);
+   filestream_close(fd);
+
+   db = libretrodb_new();
+   if (libretrodb_open(path, db) == 0)
+      libretrodb_create_index(db, "crc", "crc");
+   libretrodb_close(db);
+   libretrodb_free(db);
+   return true;
+}
+
+static void bench_result_free(struct bench_result *res)
+{
+   unsigned i;
+
+   for (i = 0; i < res->count; i++)
+      rmsgpack_dom_value_free(&res->items[i]);
+   free(res->items);
+
+   res->count = 0;
+   res->items = NULL;
+}
+
+static void bench_result_add(struct bench_result *res,
+      struct rmsgpack_dom_value *item)
+{
+   res->items = (struct rmsgpack_dom_value*)realloc(res->items,
+         (res->count + 1) * sizeof(*res->items));
+   res->items[res->count++] = *item;
+}
+
+/* The old cursor path, decode all of it and filter afterwards */
+static bool bench_full(const char *path, const char *query,
+      struct bench_result *res)
+{
+   struct rmsgpack_dom_value item;
+   const char *error        = NULL;
+   libretrodb_t *db         = libretrodb_new();
+   libretrodb_cursor_t *cur = libretrodb_cursor_new();
+   libretrodb_query_t *q    = NULL;
+   bool ok                  = false;
+
+   if (libretrodb_open(path, db) != 0)
+      goto end;
+
+   q = (libretrodb_query_t*)libretrodb_query_compile(db, query,
+         strlen(query), &error);
+
+   if (error || libretrodb_cursor_open(db, cur, NULL) != 0)
+      goto end;
+
+   while (libretrodb_cursor_read_item(cur, &item) == 0)
+   {
+      if (libretrodb_query_filter(q, &item))
+         bench_result_add(res, &item);
+      else
+         rmsgpack_dom_value_free(&item);
+   }
+
+   libretrodb_cursor_close(cur);
+   ok = true;
+
+end:
+   if (q)
+      libretrodb_query_free(q);
+   libretrodb_close(db);
+   libretrodb_free(db);
+   libretrodb_cursor_free(cur);
+   return ok;
+}
+
+static bool bench_planned(const char *path, const char *query,
+      bool project, struct bench_result *res)
+{
+   struct rmsgpack_dom_value item;
+   const char *fields[]     = { "name" };
+   const char *error        = NULL;
+   libretrodb_t *db         = libretrodb_new();
+   libretrodb_cursor_t *cur = libretrodb_cursor_new();
+   libretrodb_query_t *q    = NULL;
+   bool ok                  = false;
+
+   if (libretrodb_open_mapped(path, db) != 0)
+      goto end;
+
+   q = (libretrodb_query_t*)libretrodb_query_compile(db, query,
+         strlen(query), &error);
+
+   if (error || libretrodb_cursor_open(db, cur, q) != 0)
+      goto end;
+
+   if (project)
+      libretrodb_cursor_set_fields(cur, fields, 1);
+
+   while (libretrodb_cursor_read_item(cur, &item) == 0)
+      bench_result_add(res, &item);
+
+   libretrodb_cursor_close(cur);
+   ok = true;
+
+end:
+   if (q)
+      libretrodb_query_free(q);
+   libretrodb_close(db);
+   libretrodb_free(db);
+   libretrodb_cursor_free(cur);
+   return ok;
+}
+
+static const struct rmsgpack_dom_value *bench_name(
+      const struct rmsgpack_dom_value *item)
+{
+   struct rmsgpack_dom_value key;
+
+   key.type            = RDT_STRING;
+   key.val.string.len  = 4;
+   key.val.string.buff = (char*)"name";
+
+   return rmsgpack_dom_value_map_value(item, &key);
+}
+
+static bool bench_same(const struct bench_result *a,
+      const struct bench_result *b, bool project)
+{
+   unsigned i;
+
+   if (a->count != b->count)
+      return false;
+
+   for (i = 0; i < a->count; i++)
+   {
+      if (project)
+      {
+         const struct rmsgpack_dom_value *x = bench_name(&a->items[i]);
+         const struct rmsgpack_dom_value *y = bench_name(&b->items[i]);
+
+         if (b->items[i].val.map.len != (x ? 1 : 0))
+            return false;
+         if (x && (!y || rmsgpack_dom_value_cmp(x, y) != 0))
+            return false;
+      }
+      else if (rmsgpack_dom_value_cmp(&a->items[i], &b->items[i]) != 0)
+         return false;
+   }
+
+   return true;
+}
+
+int main(int argc, char *argv[])
+{
+   int i;
+   unsigned k, r;
+   char crc_query[64];
+   unsigned records      = 50000;
+   unsigned runs         = 3;
+   const char *path      = NULL;
+   const char **queries  = NULL;
+   unsigned num_queries  = 0;
+   bool ok               = true;
+   char tmp[]            = "libretrodb_query_bench.rdb";
+
+   queries = (const char**)calloc(argc + 4, sizeof(*queries));
+
+   for (i = 1; i < argc; i++)
+   {
+      if (!strcmp(argv[i], "-n") && i + 1 < argc)
+         records = (unsigned)strtoul(argv[++i], NULL, 0);
+      else if (!strcmp(argv[i], "-r") && i + 1 < argc)
+         runs = (unsigned)strtoul(argv[++i], NULL, 0);
+      else if (argv[i][0] == '-')
+      {
+         fprintf(stderr, "Usage: %s [-n records] [-r runs] [rdb file [queries...]]\n",
+               argv[0]);
+         return 1;
+      }
+      else if (!path)
+         path = argv[i];
+      else
+         queries[num_queries++] = argv[i];
+   }
+
+   if (!runs)
+      return 1;
+
+   if (!path)
+   {
+      if (!records || !bench_write_db(tmp, records))
+         return 1;
+      path = tmp;
+   }
+
+   if (!num_queries)
+   {
+      snprintf(crc_query, sizeof(crc_query), "{'crc':b'%08X'}",
+            bench_crc(4242 % (records ? records : 1)));
+      bench_default_queries[3] = crc_query;
+
+      for (k = 0; bench_default_queries[k]; k++)
+         queries[num_queries++] = bench_default_queries[k];
+   }
+
+   printf("%s, %u run(s) per query, ms per query\n", path, runs);
+   printf("%-40s %8s %10s %10s %10s\n", "query", "matches",
+         "full", "planned", "project");
+
+   for (k = 0; k < num_queries; k++)
+   {
+      retro_time_t start;
+      retro_time_t t[3] = {0};
+      struct bench_result res[3];
+
+      memset(res, 0, sizeof(res));
+
+      for (r = 0; r < runs; r++)
+      {
+         unsigned m;
+
+         for (m = 0; m < 3; m++)
+            bench_result_free(&res[m]);
+
+         start = cpu_features_get_time_usec();
+         if (!bench_full(path, queries[k], &res[0]))
+         {
+            printf("%s: could not run the query\n", queries[k]);
+            ok = false;
+            break;
+         }
+         t[0] += cpu_features_get_time_usec() - start;
+
+         start = cpu_features_get_time_usec();
+         bench_planned(path, queries[k], false, &res[1]);
+         t[1] += cpu_features_get_time_usec() - start;
+
+         start = cpu_features_get_time_usec();
+         bench_planned(path, queries[k], true, &res[2]);
+         t[2] += cpu_features_get_time_usec() - start;
+      }
+
+      printf("%-40s %8u %10.2f %10.2f %10.2f\n", queries[k], res[0].count,
+            t[0] / 1000.0 / runs, t[1] / 1000.0 / runs, t[2] / 1000.0 / runs);
+
+      if (!bench_same(&res[0], &res[1], false))
+      {
+         printf("%s: planned results differ\n", queries[k]);
+         ok = false;
+      }
+
+      if (!bench_same(&res[0], &res[2], true))
+      {
+         printf("%s: projected results differ\n", queries[k]);
+         ok = false;
+      }
+
+      for (r = 0; r < 3; r++)
+         bench_result_free(&res[r]);
+   }
+
+   free(queries);
+
+   if (path == tmp)
+      remove(tmp);
+
+   if (!ok)
+   {
+      printf("FAILED\n");
+      return 1;
+   }
+
+   printf("OK\n");
+   return 0;
+}
@@ -21,19 +21,138 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
+#include <features/features_cpu.h>
 #include <string/stdstring.h>
 
 #include "libretrodb.h"
 #include "rmsgpack_dom.h"
 
+/* Times @lookups find_entry calls cycling through @keys */
+static double bench_lookups(libretrodb_t *db, const char *index_name,
+      const uint8_t *keys, size_t key_size, size_t num_keys,
+      unsigned lookups, unsigned *found)
+{
+   unsigned i;
+   retro_time_t start = cpu_features_get_time_usec();
+
+   *found = 0;
+
+   for (i = 0; i < lookups; i++)
+   {
+      struct rmsgpack_dom_value item;
+
+      if (libretrodb_find_entry(db, index_name,
+               keys + (i % num_keys) * key_size, &item) == 0)
+      {
+         rmsgpack_dom_value_free(&item);
+         (*found)++;
+      }
+   }
+
+   return (cpu_features_get_time_usec() - start) / 1000000.0;
+}
+
+static int bench(const char *path, libretrodb_t *db, libretrodb_cursor_t *cur,
+      const char *index_name, const char *field_name, unsigned lookups)
+{
+   unsigned found;
+   double secs;
+   struct rmsgpack_dom_value item;
+   struct rmsgpack_dom_value key;
+   uint8_t *keys          = NULL;
+   size_t key_size        = 0;
+   size_t num_keys        = 0;
+   size_t cap             = 0;
+   libretrodb_t *mapped   = NULL;
+   int rv                 = 1;
+
+   key.type               = RDT_STRING;
+   key.val.string.len     = (uint32_t)strlen(field_name);
+   key.val.string.buff    = (char*)field_name;
+
+   /* Every key present in the database, in file order */
+   if (libretrodb_cursor_open(db, cur, NULL) != 0)
+      return 1;
+
+   while (libretrodb_cursor_read_item(cur, &item) == 0)
+   {
+      struct rmsgpack_dom_value *field = rmsgpack_dom_value_map_value(&item, &key);
+
+      if (field && field->type == RDT_BINARY && field->val.binary.len
+            && (!key_size || field->val.binary.len == key_size))
+      {
+         key_size = field->val.binary.len;
+
+         if (num_keys == cap)
+         {
+            uint8_t *tmp = (uint8_t*)realloc(keys,
+                  (cap = cap ? cap * 2 : 1024) * key_size);
+            if (!tmp)
+            {
+               rmsgpack_dom_value_free(&item);
+               goto end;
+            }
+            keys = tmp;
+         }
+
+         memcpy(keys + num_keys++ * key_size, field->val.binary.buff, key_size);
+      }
+
+      rmsgpack_dom_value_free(&item);
+   }
+
+   libretrodb_cursor_close(cur);
+
+   if (!num_keys)
+   {
+      printf("No binary '%s' field found\n", field_name);
+      goto end;
+   }
+
+   printf("%u keys of %u bytes, %u lookups\n",
+         (unsigned)num_keys, (unsigned)key_size, lookups);
+
+   secs = bench_lookups(db, index_name, keys, key_size, num_keys,
+         lookups, &found);
+   printf("%-8s %12.0f lookups/s  (%u found)\n", "file",
+         lookups / (secs > 0 ? secs : 1e-9), found);
+
+   if (!found)
+   {
+      printf("Index '%s' missing? See create-index.\n", index_name);
+      goto end;
+   }
+
+   mapped = libretrodb_new();
+   if (!mapped || libretrodb_open_mapped(path, mapped) != 0)
+      goto end;
+
+   secs = bench_lookups(mapped, index_name, keys, key_size, num_keys,
+         lookups, &found);
+   printf("%-8s %12.0f lookups/s  (%u found)\n", "mapped",
+         lookups / (secs > 0 ? secs : 1e-9), found);
+
+   rv = 0;
+
+end:
+   if (mapped)
+   {
+      libretrodb_close(mapped);
+      libretrodb_free(mapped);
+   }
+   free(keys);
+   return rv;
+}
+
 int main(int argc, char ** argv)
 {
    int rv;
    libretrodb_t *db;
    libretrodb_cursor_t *cur;
-   libretrodb_query_t *q;
+   libretrodb_query_t *q = NULL;
    struct rmsgpack_dom_value item;
    const char *command, *path, *query_exp, *error;
 
@@ -45,6 +164,7 @@ int main(int argc, char ** argv)
       printf("\tcreate-index <index name> <field name>\n");
       printf("\tfind <query expression>\n");
       printf("\tget-names <query expression>\n");
+      printf("\tbench <index name> <field name> [lookups]\n");
       return 1;
    }
 
@@ -156,6 +276,17 @@ int main(int argc, char ** argv)
          rmsgpack_dom_value_free(&item);
       }
    }
+   else if (memcmp(command, "bench", 5) == 0)
+   {
+      if (argc != 5 && argc != 6)
+      {
+         printf("Usage: %s <db file> bench <index name> <field name> [lookups]\n", argv[0]);
+         goto error;
+      }
+
+      bench(path, db, cur, argv[3], argv[4],
+            argc == 6 ? (unsigned)strtoul(argv[5], NULL, 0) : 1000000);
+   }
    else if (memcmp(command, "create-index", 12) == 0)
    {
       const char * index_name, * field_name;
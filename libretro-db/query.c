@@ -977,3 +977,82 @@ int libretrodb_query_filter(libretrodb_query_t *q,
    struct rmsgpack_dom_value res = inv.func(*v, inv.argc, inv.argv);
    return (res.type == RDT_BOOL && res.val.bool_);
 }
+
+/**
+ * libretrodb_query_is_table:
+ * @q                   : Compiled query.
+ *
+ * Returns: non-zero if @q is a {field: ...} table, the only kind
+ * of query the planner helpers below can see into.
+ **/
+int libretrodb_query_is_table(libretrodb_query_t *q)
+{
+   return ((struct query*)q)->root.func == query_func_all_map;
+}
+
+/**
+ * libretrodb_query_references:
+ * @q                   : Compiled query.
+ * @field               : Field name, not NUL terminated.
+ * @len                 : Length of @field.
+ *
+ * Returns: non-zero if filtering with @q may look at the top-level
+ * field @field. Records only need those fields to be filtered,
+ * fields that are missing compare as nil either way.
+ **/
+int libretrodb_query_references(libretrodb_query_t *q,
+      const char *field, size_t len)
+{
+   unsigned i;
+   const struct invocation *root = &((struct query*)q)->root;
+
+   if (root->func != query_func_all_map)
+      return 1;
+
+   for (i = 0; i < root->argc; i += 2)
+   {
+      const struct rmsgpack_dom_value *key = &root->argv[i].a.value;
+
+      if (root->argv[i].type != AT_VALUE || key->type != RDT_STRING)
+         return 1;
+
+      if (     key->val.string.len == len
+            && !memcmp(key->val.string.buff, field, len))
+         return 1;
+   }
+
+   return 0;
+}
+
+/**
+ * libretrodb_query_equals:
+ * @q                   : Compiled query.
+ * @field               : Field name.
+ *
+ * Returns: the constant the top-level field @field has to be equal
+ * to for a record to match @q, or NULL if @q does not say.
+ **/
+const struct rmsgpack_dom_value *libretrodb_query_equals(
+      libretrodb_query_t *q, const char *field)
+{
+   unsigned i;
+   size_t len                    = strlen(field);
+   const struct invocation *root = &((struct query*)q)->root;
+
+   if (root->func != query_func_all_map || root->argc % 2 != 0)
+      return NULL;
+
+   for (i = 0; i < root->argc; i += 2)
+   {
+      const struct rmsgpack_dom_value *key = &root->argv[i].a.value;
+
+      if (     root->argv[i].type     == AT_VALUE
+            && root->argv[i + 1].type == AT_VALUE
+            && key->type              == RDT_STRING
+            && key->val.string.len    == len
+            && !memcmp(key->val.string.buff, field, len))
+         return &root->argv[i + 1].a.value;
+   }
+
+   return NULL;
+}
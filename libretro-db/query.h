@@ -38,6 +38,14 @@ void libretrodb_query_dec_ref(libretrodb_query_t *q);
 
 int libretrodb_query_filter(libretrodb_query_t *q, struct rmsgpack_dom_value *v);
 
+int libretrodb_query_is_table(libretrodb_query_t *q);
+
+int libretrodb_query_references(libretrodb_query_t *q,
+      const char *field, size_t len);
+
+const struct rmsgpack_dom_value *libretrodb_query_equals(
+      libretrodb_query_t *q, const char *field);
+
 RETRO_END_DECLS
 
 #endif
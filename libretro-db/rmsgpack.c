@@ -658,3 +658,257 @@ int rmsgpack_read(RFILE *fd,
 error:
    return -errno;
 }
+
+static int rmsgpack_buf_uint(const uint8_t *buf, size_t size, size_t *pos,
+      size_t len, uint64_t *out)
+{
+   size_t i;
+   uint64_t v = 0;
+
+   if (size - *pos < len)
+      return -EINVAL;
+
+   /* big endian, whatever the host is */
+   for (i = 0; i < len; i++)
+      v = (v << 8) | buf[*pos + i];
+
+   *pos += len;
+   *out  = v;
+   return 0;
+}
+
+static int rmsgpack_buf_container(const uint8_t *buf, size_t size,
+      size_t *pos, uint32_t len, uint32_t items,
+      struct rmsgpack_read_callbacks *callbacks, void *data)
+{
+   int rv;
+   uint32_t i;
+
+   for (i = 0; i < len * items; i++)
+      if ((rv = rmsgpack_read_buf(buf, size, pos, callbacks, data)) < 0)
+         return rv;
+
+   return 0;
+}
+
+/**
+ * rmsgpack_read_buf:
+ * @buf                 : Encoded data.
+ * @size                : Size of @buf.
+ * @pos                 : Read position, advanced past the value.
+ * @callbacks           : Callbacks, as for rmsgpack_read.
+ * @data                : Callback context.
+ *
+ * Same as rmsgpack_read but decodes from memory. String and
+ * binary callbacks get a pointer into @buf instead of a malloc'd
+ * copy, it is neither owned by the callee nor NUL terminated.
+ *
+ * Returns: 0 if successful, otherwise negative.
+ **/
+int rmsgpack_read_buf(const void *buf, size_t size, size_t *pos,
+      struct rmsgpack_read_callbacks *callbacks, void *data)
+{
+   int rv;
+   uint8_t type;
+   uint64_t tmp_len  = 0;
+   uint64_t tmp_uint = 0;
+   const uint8_t *p  = (const uint8_t*)buf;
+
+   if (*pos >= size)
+      return -EINVAL;
+
+   type = p[(*pos)++];
+
+   if (type < MPF_FIXMAP)
+   {
+      if (!callbacks->read_int)
+         return 0;
+      return callbacks->read_int(type, data);
+   }
+   else if (type < MPF_FIXARRAY)
+   {
+      if (callbacks->read_map_start &&
+            (rv = callbacks->read_map_start(type - MPF_FIXMAP, data)) < 0)
+         return rv;
+      return rmsgpack_buf_container(p, size, pos,
+            type - MPF_FIXMAP, 2, callbacks, data);
+   }
+   else if (type < MPF_FIXSTR)
+   {
+      if (callbacks->read_array_start &&
+            (rv = callbacks->read_array_start(type - MPF_FIXARRAY, data)) < 0)
+         return rv;
+      return rmsgpack_buf_container(p, size, pos,
+            type - MPF_FIXARRAY, 1, callbacks, data);
+   }
+   else if (type < MPF_NIL)
+   {
+      tmp_len = type - MPF_FIXSTR;
+      if (size - *pos < tmp_len)
+         return -EINVAL;
+      *pos += (size_t)tmp_len;
+      if (!callbacks->read_string)
+         return 0;
+      return callbacks->read_string((char*)p + *pos - tmp_len,
+            (uint32_t)tmp_len, data);
+   }
+   else if (type > MPF_MAP32)
+   {
+      if (!callbacks->read_int)
+         return 0;
+      return callbacks->read_int(type - 0xff - 1, data);
+   }
+
+   switch (type)
+   {
+      case _MPF_NIL:
+         if (callbacks->read_nil)
+            return callbacks->read_nil(data);
+         break;
+      case _MPF_FALSE:
+         if (callbacks->read_bool)
+            return callbacks->read_bool(0, data);
+         break;
+      case _MPF_TRUE:
+         if (callbacks->read_bool)
+            return callbacks->read_bool(1, data);
+         break;
+      case _MPF_BIN8:
+      case _MPF_BIN16:
+      case _MPF_BIN32:
+      case _MPF_STR8:
+      case _MPF_STR16:
+      case _MPF_STR32:
+         if ((rv = rmsgpack_buf_uint(p, size, pos, (type >= _MPF_STR8)
+                     ? 1 << (type - _MPF_STR8)
+                     : 1 << (type - _MPF_BIN8), &tmp_len)) < 0)
+            return rv;
+         if (size - *pos < tmp_len)
+            return -EINVAL;
+         *pos += (size_t)tmp_len;
+
+         if (type >= _MPF_STR8)
+         {
+            if (callbacks->read_string)
+               return callbacks->read_string((char*)p + *pos - tmp_len,
+                     (uint32_t)tmp_len, data);
+         }
+         else if (callbacks->read_bin)
+            return callbacks->read_bin((void*)(p + *pos - tmp_len),
+                  (uint32_t)tmp_len, data);
+         break;
+      case _MPF_UINT8:
+      case _MPF_UINT16:
+      case _MPF_UINT32:
+      case _MPF_UINT64:
+         if ((rv = rmsgpack_buf_uint(p, size, pos,
+                     1 << (type - _MPF_UINT8), &tmp_uint)) < 0)
+            return rv;
+         if (callbacks->read_uint)
+            return callbacks->read_uint(tmp_uint, data);
+         break;
+      case _MPF_INT8:
+      case _MPF_INT16:
+      case _MPF_INT32:
+      case _MPF_INT64:
+         {
+            int64_t tmp_int;
+            unsigned bits = 8 << (type - _MPF_INT8);
+
+            if ((rv = rmsgpack_buf_uint(p, size, pos,
+                        1 << (type - _MPF_INT8), &tmp_uint)) < 0)
+               return rv;
+
+            /* sign extend */
+            if (bits < 64 && (tmp_uint & (UINT64_C(1) << (bits - 1))))
+               tmp_uint |= ~UINT64_C(0) << bits;
+            tmp_int = (int64_t)tmp_uint;
+
+            if (callbacks->read_int)
+               return callbacks->read_int(tmp_int, data);
+         }
+         break;
+      case _MPF_ARRAY16:
+      case _MPF_ARRAY32:
+         if ((rv = rmsgpack_buf_uint(p, size, pos,
+                     2 << (type - _MPF_ARRAY16), &tmp_len)) < 0)
+            return rv;
+         if (callbacks->read_array_start &&
+               (rv = callbacks->read_array_start((uint32_t)tmp_len, data)) < 0)
+            return rv;
+         return rmsgpack_buf_container(p, size, pos,
+               (uint32_t)tmp_len, 1, callbacks, data);
+      case _MPF_MAP16:
+      case _MPF_MAP32:
+         if ((rv = rmsgpack_buf_uint(p, size, pos,
+                     2 << (type - _MPF_MAP16), &tmp_len)) < 0)
+            return rv;
+         if (callbacks->read_map_start &&
+               (rv = callbacks->read_map_start((uint32_t)tmp_len, data)) < 0)
+            return rv;
+         return rmsgpack_buf_container(p, size, pos,
+               (uint32_t)tmp_len, 2, callbacks, data);
+   }
+
+   return 0;
+}
+
+/* No callbacks at all, rmsgpack_read_buf then only walks the data */
+static struct rmsgpack_read_callbacks rmsgpack_skip_callbacks = {
+   NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL
+};
+
+/**
+ * rmsgpack_read_map_header_buf:
+ * @buf                 : Encoded data.
+ * @size                : Size of @buf.
+ * @pos                 : Read position, advanced past the map header.
+ * @len                 : Number of key/value pairs that follow.
+ *
+ * Returns: 0 if a map header was read, 1 if the value at @pos is
+ * not a map (@pos is left alone), otherwise negative.
+ **/
+int rmsgpack_read_map_header_buf(const void *buf, size_t size, size_t *pos,
+      uint32_t *len)
+{
+   int rv;
+   uint64_t tmp_len  = 0;
+   size_t tmp_pos    = *pos;
+   const uint8_t *p  = (const uint8_t*)buf;
+   uint8_t type;
+
+   if (tmp_pos >= size)
+      return -EINVAL;
+
+   type = p[tmp_pos++];
+
+   if (type >= MPF_FIXMAP && type < MPF_FIXARRAY)
+      tmp_len = type - MPF_FIXMAP;
+   else if (type == MPF_MAP16 || type == MPF_MAP32)
+   {
+      if ((rv = rmsgpack_buf_uint(p, size, &tmp_pos,
+                  2 << (type - MPF_MAP16), &tmp_len)) < 0)
+         return rv;
+   }
+   else
+      return 1;
+
+   *pos = tmp_pos;
+   *len = (uint32_t)tmp_len;
+   return 0;
+}
+
+/**
+ * rmsgpack_skip_buf:
+ * @buf                 : Encoded data.
+ * @size                : Size of @buf.
+ * @pos                 : Read position, advanced past the value.
+ *
+ * Steps over one value, containers included, without decoding it.
+ *
+ * Returns: 0 if successful, otherwise negative.
+ **/
+int rmsgpack_skip_buf(const void *buf, size_t size, size_t *pos)
+{
+   return rmsgpack_read_buf(buf, size, pos, &rmsgpack_skip_callbacks, NULL);
+}
@@ -24,6 +24,7 @@
 #define __LIBRETRODB_MSGPACK_H__
 
 #include <stdint.h>
+#include <stddef.h>
 
 #include <streams/file_stream.h>
 
@@ -57,5 +58,13 @@ int rmsgpack_write_uint(RFILE *fd, uint64_t value );
 
 int rmsgpack_read(RFILE *fd, struct rmsgpack_read_callbacks *callbacks, void *data);
 
+int rmsgpack_read_buf(const void *buf, size_t size, size_t *pos,
+      struct rmsgpack_read_callbacks *callbacks, void *data);
+
+int rmsgpack_read_map_header_buf(const void *buf, size_t size, size_t *pos,
+      uint32_t *len);
+
+int rmsgpack_skip_buf(const void *buf, size_t size, size_t *pos);
+
 #endif
 
@@ -189,6 +189,50 @@ static struct rmsgpack_read_callbacks dom_reader_callbacks = {
 	dom_read_array_start
 };
 
+static char *dom_copy_buff(const char *value, uint32_t len)
+{
+   char *buff = (char*)malloc(len + 1);
+
+   if (!buff)
+      return NULL;
+
+   memcpy(buff, value, len);
+   buff[len] = '\0';
+   return buff;
+}
+
+static int dom_copy_string(char *value, uint32_t len, void *data)
+{
+   char *buff = dom_copy_buff(value, len);
+
+   if (!buff)
+      return -ENOMEM;
+
+   return dom_read_string(buff, len, data);
+}
+
+static int dom_copy_bin(void *value, uint32_t len, void *data)
+{
+   char *buff = dom_copy_buff((const char*)value, len);
+
+   if (!buff)
+      return -ENOMEM;
+
+   return dom_read_bin(buff, len, data);
+}
+
+/* Memory reader, strings and binaries are copied out of the buffer */
+static struct rmsgpack_read_callbacks dom_buf_copy_callbacks = {
+	dom_read_nil,
+	dom_read_bool,
+	dom_read_int,
+	dom_read_uint,
+	dom_copy_string,
+	dom_copy_bin,
+	dom_read_map_start,
+	dom_read_array_start
+};
+
 void rmsgpack_dom_value_free(struct rmsgpack_dom_value *v)
 {
    unsigned i;
@@ -283,7 +327,7 @@ int rmsgpack_dom_value_cmp(
                         &b->val.map.items[i].value)) != 0)
                return rv;
          }
-         break;
+         return 0;
       case RDT_ARRAY:
          if (a->val.array.len != b->val.array.len)
             return 1;
@@ -293,7 +337,7 @@ int rmsgpack_dom_value_cmp(
                         &b->val.array.items[i])) != 0)
                return rv;
          }
-         break;
+         return 0;
    }
 
    return 1;
@@ -418,6 +462,185 @@ int rmsgpack_dom_read(RFILE *fd, struct rmsgpack_dom_value *out)
    return rv;
 }
 
+/**
+ * rmsgpack_dom_read_buf:
+ * @buf                 : Encoded data.
+ * @size                : Size of @buf.
+ * @pos                 : Read position, advanced past the value.
+ * @out                 : Decoded value.
+ *
+ * Decodes one value from memory. The result owns its strings,
+ * free it with rmsgpack_dom_value_free.
+ *
+ * Returns: 0 if successful, otherwise negative.
+ **/
+int rmsgpack_dom_read_buf(const void *buf, size_t size, size_t *pos,
+      struct rmsgpack_dom_value *out)
+{
+   struct dom_reader_state s;
+   int rv = 0;
+
+   s.i        = 0;
+   s.stack[0] = out;
+   out->type  = RDT_NULL;
+
+   rv = rmsgpack_read_buf(buf, size, pos, &dom_buf_copy_callbacks, &s);
+
+   if (rv < 0)
+      rmsgpack_dom_value_free(out);
+
+   return rv;
+}
+
+/**
+ * rmsgpack_dom_read_view:
+ * @buf                 : Encoded data.
+ * @size                : Size of @buf.
+ * @pos                 : Read position, advanced past the value.
+ * @out                 : Decoded value.
+ *
+ * Decodes one value from memory without copying strings and
+ * binaries: they point into @buf, are only valid as long as it
+ * is and are not NUL terminated. Free with rmsgpack_dom_view_free.
+ *
+ * Returns: 0 if successful, otherwise negative.
+ **/
+int rmsgpack_dom_read_view(const void *buf, size_t size, size_t *pos,
+      struct rmsgpack_dom_value *out)
+{
+   struct dom_reader_state s;
+   int rv = 0;
+
+   s.i        = 0;
+   s.stack[0] = out;
+   out->type  = RDT_NULL;
+
+   rv = rmsgpack_read_buf(buf, size, pos, &dom_reader_callbacks, &s);
+
+   if (rv < 0)
+      rmsgpack_dom_view_free(out);
+
+   return rv;
+}
+
+void rmsgpack_dom_view_free(struct rmsgpack_dom_value *v)
+{
+   unsigned i;
+
+   switch (v->type)
+   {
+      case RDT_MAP:
+         for (i = 0; i < v->val.map.len; i++)
+         {
+            rmsgpack_dom_view_free(&v->val.map.items[i].key);
+            rmsgpack_dom_view_free(&v->val.map.items[i].value);
+         }
+         free(v->val.map.items);
+         break;
+      case RDT_ARRAY:
+         for (i = 0; i < v->val.array.len; i++)
+            rmsgpack_dom_view_free(&v->val.array.items[i]);
+         free(v->val.array.items);
+         break;
+      default:
+         break;
+   }
+
+   v->type = RDT_NULL;
+}
+
+/**
+ * rmsgpack_dom_read_fields:
+ * @buf                 : Encoded data.
+ * @size                : Size of @buf.
+ * @pos                 : Read position, advanced past the value.
+ * @want                : Called with every key of a top-level map.
+ * @ctx                 : Context for @want.
+ * @out                 : Decoded value.
+ *
+ * Like rmsgpack_dom_read_buf, but of a map only the pairs whose
+ * key @want returns non-zero for are decoded, all other values
+ * are stepped over. Anything that is not a map is decoded whole.
+ * Free @out with rmsgpack_dom_value_free.
+ *
+ * Returns: 0 if successful, otherwise negative.
+ **/
+int rmsgpack_dom_read_fields(const void *buf, size_t size, size_t *pos,
+      int (*want)(const char *key, uint32_t len, void *ctx), void *ctx,
+      struct rmsgpack_dom_value *out)
+{
+   int rv;
+   uint32_t i;
+   uint32_t len                    = 0;
+   uint32_t kept                   = 0;
+   struct rmsgpack_dom_pair *items = NULL;
+
+   out->type = RDT_NULL;
+
+   if ((rv = rmsgpack_read_map_header_buf(buf, size, pos, &len)) != 0)
+   {
+      if (rv < 0)
+         return rv;
+      return rmsgpack_dom_read_buf(buf, size, pos, out);
+   }
+
+   if (len)
+   {
+      items = (struct rmsgpack_dom_pair*)calloc(len, sizeof(*items));
+      if (!items)
+         return -ENOMEM;
+   }
+
+   out->type          = RDT_MAP;
+   out->val.map.len   = 0;
+   out->val.map.items = items;
+
+   for (i = 0; i < len; i++)
+   {
+      struct rmsgpack_dom_value key;
+
+      if ((rv = rmsgpack_dom_read_view(buf, size, pos, &key)) < 0)
+         goto error;
+
+      if (key.type != RDT_STRING || !want(key.val.string.buff,
+               key.val.string.len, ctx))
+      {
+         rmsgpack_dom_view_free(&key);
+         if ((rv = rmsgpack_skip_buf(buf, size, pos)) < 0)
+            goto error;
+         continue;
+      }
+
+      items[kept].key.type            = RDT_STRING;
+      items[kept].key.val.string.len  = key.val.string.len;
+      items[kept].key.val.string.buff = dom_copy_buff(
+            key.val.string.buff, key.val.string.len);
+
+      if (!items[kept].key.val.string.buff)
+      {
+         items[kept].key.type = RDT_NULL;
+         rv                   = -ENOMEM;
+         goto error;
+      }
+
+      out->val.map.len = ++kept;
+
+      if ((rv = rmsgpack_dom_read_buf(buf, size, pos,
+                  &items[kept - 1].value)) < 0)
+      {
+         /* already freed by rmsgpack_dom_read_buf */
+         items[kept - 1].value.type = RDT_NULL;
+         goto error;
+      }
+   }
+
+   return 0;
+
+error:
+   rmsgpack_dom_value_free(out);
+   return rv;
+}
+
 int rmsgpack_dom_read_into(RFILE *fd, ...)
 {
    va_list ap;
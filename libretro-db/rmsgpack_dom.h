@@ -24,6 +24,7 @@
 #define __LIBRETRODB_MSGPACK_DOM_H__
 
 #include <stdint.h>
+#include <stddef.h>
 
 #include <retro_common_api.h>
 #include <streams/file_stream.h>
@@ -91,6 +92,18 @@ struct rmsgpack_dom_value *rmsgpack_dom_value_map_value(
 
 int rmsgpack_dom_read(RFILE *fd, struct rmsgpack_dom_value *out);
 
+int rmsgpack_dom_read_buf(const void *buf, size_t size, size_t *pos,
+      struct rmsgpack_dom_value *out);
+
+int rmsgpack_dom_read_view(const void *buf, size_t size, size_t *pos,
+      struct rmsgpack_dom_value *out);
+
+void rmsgpack_dom_view_free(struct rmsgpack_dom_value *v);
+
+int rmsgpack_dom_read_fields(const void *buf, size_t size, size_t *pos,
+      int (*want)(const char *key, uint32_t len, void *ctx), void *ctx,
+      struct rmsgpack_dom_value *out);
+
 int rmsgpack_dom_write(RFILE *fd, const struct rmsgpack_dom_value *obj);
 
 int rmsgpack_dom_read_into(RFILE *fd, ...);
@@ -22,14 +22,23 @@
 
 #include <retro_inline.h>
 #include <compat/strl.h>
-#include <compat/intrinsics.h>
+#include <features/features_cpu.h>
+#ifdef HAVE_ZLIB
+#include <streams/trans_stream.h>
+#endif
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
 
 #include "state_manager.h"
+#include "state_manager_raw.h"
 #include "../msg_hash.h"
 #include "../movie.h"
 #include "../core.h"
 #include "../verbosity.h"
 #include "../audio/audio_driver.h"
+#include "../gfx/video_driver.h"
 
 #ifdef HAVE_NETWORKING
 #include "../network/netplay/netplay.h"
@@ -39,124 +48,6 @@
 /* Keep it off unless you're chasing a core bug, it slows things down. */
 #define STRICT_BUF_SIZE 0
 
-#ifndef UINT16_MAX
-#define UINT16_MAX 0xffff
-#endif
-
-#ifndef UINT32_MAX
-#define UINT32_MAX 0xffffffffu
-#endif
-
-#if defined(__x86_64__) || defined(__i386__) || defined(__i486__) || defined(__i686__)
-#define CPU_X86
-#endif
-
-/* Other arches SIGBUS (usually) on unaligned accesses. */
-#ifndef CPU_X86
-#define NO_UNALIGNED_MEM
-#endif
-
-#if __SSE2__
-#include <emmintrin.h>
-#endif
-
-/* There's no equivalent in libc, you'd think so ...
- * std::mismatch exists, but it's not optimized at all. */
-static size_t find_change(const uint16_t *a, const uint16_t *b)
-{
-#if __SSE2__
-   const __m128i *a128 = (const __m128i*)a;
-   const __m128i *b128 = (const __m128i*)b;
-
-   for (;;)
-   {
-      __m128i v0    = _mm_loadu_si128(a128);
-      __m128i v1    = _mm_loadu_si128(b128);
-      __m128i c     = _mm_cmpeq_epi32(v0, v1);
-      uint32_t mask = _mm_movemask_epi8(c);
-
-      if (mask != 0xffff) /* Something has changed, figure out where. */
-      {
-         size_t ret = (((uint8_t*)a128 - (uint8_t*)a) |
-               (compat_ctz(~mask))) >> 1;
-         return ret | (a[ret] == b[ret]);
-      }
-
-      a128++;
-      b128++;
-   }
-#else
-   const uint16_t *a_org = a;
-#ifdef NO_UNALIGNED_MEM
-   while (((uintptr_t)a & (sizeof(size_t) - 1)) && *a == *b)
-   {
-      a++;
-      b++;
-   }
-   if (*a == *b)
-#endif
-   {
-      const size_t *a_big = (const size_t*)a;
-      const size_t *b_big = (const size_t*)b;
-
-      while (*a_big == *b_big)
-      {
-         a_big++;
-         b_big++;
-      }
-      a = (const uint16_t*)a_big;
-      b = (const uint16_t*)b_big;
-
-      while (*a == *b)
-      {
-         a++;
-         b++;
-      }
-   }
-   return a - a_org;
-#endif
-}
-
-static size_t find_same(const uint16_t *a, const uint16_t *b)
-{
-   const uint16_t *a_org = a;
-#ifdef NO_UNALIGNED_MEM
-   if (((uintptr_t)a & (sizeof(uint32_t) - 1)) && *a != *b)
-   {
-      a++;
-      b++;
-   }
-   if (*a != *b)
-#endif
-   {
-      /* With this, it's random whether two consecutive identical
-       * words are caught.
-       *
-       * Luckily, compression rate is the same for both cases, and
-       * three is always caught.
-       *
-       * (We prefer to miss two-word blocks, anyways; fewer iterations
-       * of the outer loop, as well as in the decompressor.) */
-      const uint32_t *a_big = (const uint32_t*)a;
-      const uint32_t *b_big = (const uint32_t*)b;
-
-      while (*a_big != *b_big)
-      {
-         a_big++;
-         b_big++;
-      }
-      a = (const uint16_t*)a_big;
-      b = (const uint16_t*)b_big;
-
-      if (a != a_org && a[-1] == b[-1])
-      {
-         a--;
-         b--;
-      }
-   }
-   return a - a_org;
-}
-
 struct state_manager
 {
    uint8_t *data;
@@ -179,30 +70,54 @@ struct state_manager
 
    unsigned entries;
    bool thisblock_valid;
+
+#ifdef HAVE_ZLIB
+   /* Entropy stage, see state_manager_push_do. The raw delta is
+    * built in 'scratch', deflated into the ring, and inflated
+    * back into 'scratch' on pop. */
+   bool compress;
+   uint8_t *scratch;
+   size_t scratch_size;
+   void *deflate_stream;
+   void *inflate_stream;
+#endif
+
+   /* Push statistics, reported on deinit. */
+   uint64_t delta_bytes;
+   uint64_t stored_bytes;
+   retro_time_t delta_time;
+   retro_time_t entropy_time;
+   unsigned pushes;
 #if STRICT_BUF_SIZE
    size_t debugsize;
    uint8_t *debugblock;
 #endif
 };
 
-/* Format per frame (pseudocode): */
-#if 0
-size nextstart;
-repeat {
-   uint16 numchanged; /* everything is counted in units of uint16 */
-   if (numchanged)
-   {
-      uint16 numunchanged; /* skip these before handling numchanged */
-      uint16[numchanged] changeddata;
-   }
-   else
-   {
-      uint32 numunchanged;
-      if (!numunchanged)
-         break;
-   }
-}
-size thisstart;
+#ifdef HAVE_THREADS
+/* Number of snapshot buffers the main thread can serialize into
+ * while the worker is still compressing an earlier one. */
+#define REWIND_SNAPSHOTS 2
+
+/* Threaded capture: the main thread only serializes into a free
+ * snapshot buffer and queues it; the worker thread owns the ring
+ * and does the delta compression. If no snapshot buffer is free
+ * the capture is dropped rather than stalling the frame. */
+struct state_manager_async
+{
+   sthread_t *thread;
+   slock_t *lock;
+   scond_t *cond;
+
+   uint8_t *free_snapshots[REWIND_SNAPSHOTS];
+   uint8_t *pending[REWIND_SNAPSHOTS];
+   unsigned free_count;
+   unsigned pending_count;
+
+   unsigned dropped;
+   bool busy;
+   bool quit;
+};
 #endif
 
 struct state_manager_rewind_state
@@ -210,167 +125,18 @@ struct state_manager_rewind_state
    /* Rewind support. */
    state_manager_t *state;
    size_t size;
+#ifdef HAVE_THREADS
+   struct state_manager_async *async;
+#endif
+   /* Main thread cost of capturing, reported on deinit. */
+   retro_time_t capture_time;
+   unsigned captures;
+   unsigned granularity;
 };
 
 static struct state_manager_rewind_state rewind_state;
 static bool frame_is_reversed                         = false;
 
-/* Returns the maximum compressed size of a savestate.
- * It is very likely to compress to far less. */
-static size_t state_manager_raw_maxsize(size_t uncomp)
-{
-   /* bytes covered by a compressed block */
-   const int maxcblkcover = UINT16_MAX * sizeof(uint16_t);
-   /* uncompressed size, rounded to 16 bits */
-   size_t uncomp16        = (uncomp + sizeof(uint16_t) - 1) & -sizeof(uint16_t);
-   /* number of blocks */
-   size_t maxcblks        = (uncomp + maxcblkcover - 1) / maxcblkcover;
-   return uncomp16 + maxcblks * sizeof(uint16_t) * 2 /* two u16 overhead per block */ + sizeof(uint16_t) *
-      3; /* three u16 to end it */
-}
-
-/*
- * See state_manager_raw_compress for information about this.
- * When you're done with it, send it to free().
- */
-static void *state_manager_raw_alloc(size_t len, uint16_t uniq)
-{
-   size_t  len16 = (len + sizeof(uint16_t) - 1) & -sizeof(uint16_t);
-   uint16_t *ret = (uint16_t*)calloc(len16 + sizeof(uint16_t) * 4 + 16, 1);
-
-   /* Force in a different byte at the end, so we don't need to check
-    * bounds in the innermost loop (it's expensive).
-    *
-    * There is also a large amount of data that's the same, to stop
-    * the other scan.
-    *
-    * There is also some padding at the end. This is so we don't
-    * read outside the buffer end if we're reading in large blocks;
-    *
-    * It doesn't make any difference to us, but sacrificing 16 bytes to get
-    * Valgrind happy is worth it. */
-   ret[len16/sizeof(uint16_t) + 3] = uniq;
-
-   return ret;
-}
-
-/*
- * Takes two savestates and creates a patch that turns 'src' into 'dst'.
- * Both 'src' and 'dst' must be returned from state_manager_raw_alloc(),
- * with the same 'len', and different 'uniq'.
- *
- * 'patch' must be size 'state_manager_raw_maxsize(len)' or more.
- * Returns the number of bytes actually written to 'patch'.
- */
-static size_t state_manager_raw_compress(const void *src,
-      const void *dst, size_t len, void *patch)
-{
-   const uint16_t  *old16 = (const uint16_t*)src;
-   const uint16_t  *new16 = (const uint16_t*)dst;
-   uint16_t *compressed16 = (uint16_t*)patch;
-   size_t          num16s = (len + sizeof(uint16_t) - 1)
-      / sizeof(uint16_t);
-
-   while (num16s)
-   {
-      size_t i, changed;
-      size_t skip = find_change(old16, new16);
-
-      if (skip >= num16s)
-         break;
-
-      old16  += skip;
-      new16  += skip;
-      num16s -= skip;
-
-      if (skip > UINT16_MAX)
-      {
-         if (skip > UINT32_MAX)
-         {
-            /* This will make it scan the entire thing again,
-             * but it only hits on 8GB unchanged data anyways,
-             * and if you're doing that, you've got bigger problems. */
-            skip = UINT32_MAX;
-         }
-         *compressed16++ = 0;
-         *compressed16++ = skip;
-         *compressed16++ = skip >> 16;
-         continue;
-      }
-
-      changed = find_same(old16, new16);
-      if (changed > UINT16_MAX)
-         changed = UINT16_MAX;
-
-      *compressed16++ = changed;
-      *compressed16++ = skip;
-
-      for (i = 0; i < changed; i++)
-         compressed16[i] = old16[i];
-
-      old16 += changed;
-      new16 += changed;
-      num16s -= changed;
-      compressed16 += changed;
-   }
-
-   compressed16[0] = 0;
-   compressed16[1] = 0;
-   compressed16[2] = 0;
-
-   return (uint8_t*)(compressed16+3) - (uint8_t*)patch;
-}
-
-/*
- * Takes 'patch' from a previous call to 'state_manager_raw_compress'
- * and applies it to 'data' ('src' from that call),
- * yielding 'dst' in that call.
- *
- * If the given arguments do not match a previous call to
- * state_manager_raw_compress(), anything at all can happen.
- */
-static void state_manager_raw_decompress(const void *patch,
-      size_t patchlen, void *data, size_t datalen)
-{
-   uint16_t         *out16 = (uint16_t*)data;
-   const uint16_t *patch16 = (const uint16_t*)patch;
-
-   (void)patchlen;
-   (void)datalen;
-
-   for (;;)
-   {
-      uint16_t numchanged = *(patch16++);
-
-      if (numchanged)
-      {
-         uint16_t i;
-
-         out16 += *patch16++;
-
-         /* We could do memcpy, but it seems that memcpy has a
-          * constant-per-call overhead that actually shows up.
-          *
-          * Our average size in here seems to be 8 or something.
-          * Therefore, we do something with lower overhead. */
-         for (i = 0; i < numchanged; i++)
-            out16[i] = patch16[i];
-
-         patch16 += numchanged;
-         out16 += numchanged;
-      }
-      else
-      {
-         uint32_t numunchanged = patch16[0] | (patch16[1] << 16);
-
-         if (!numunchanged)
-            break;
-         patch16 += 2;
-         out16 += numunchanged;
-      }
-   }
-}
-
 /* The start offsets point to 'nextstart' of any given compressed frame.
  * Each uint16 is stored native endian; anything that claims any other
  * endianness refers to the endianness of this specific item.
@@ -418,6 +184,17 @@ static void state_manager_free(state_manager_t *state)
       free(state->thisblock);
    if (state->nextblock)
       free(state->nextblock);
+#ifdef HAVE_ZLIB
+   if (state->scratch)
+      free(state->scratch);
+   if (state->deflate_stream)
+      zlib_deflate_backend.stream_free(state->deflate_stream);
+   if (state->inflate_stream)
+      zlib_inflate_backend.stream_free(state->inflate_stream);
+   state->scratch        = NULL;
+   state->deflate_stream = NULL;
+   state->inflate_stream = NULL;
+#endif
 #if STRICT_BUF_SIZE
    if (state->debugblock)
       free(state->debugblock);
@@ -428,7 +205,8 @@ static void state_manager_free(state_manager_t *state)
    state->nextblock  = NULL;
 }
 
-static state_manager_t *state_manager_new(size_t state_size, size_t buffer_size)
+static state_manager_t *state_manager_new(size_t state_size,
+      size_t buffer_size, bool compress)
 {
    size_t max_comp_size, block_size;
    uint8_t *next_block    = NULL;
@@ -464,6 +242,22 @@ static state_manager_t *state_manager_new(size_t state_size, size_t buffer_size)
    state->head        = state->data + sizeof(size_t);
    state->tail        = state->data + sizeof(size_t);
 
+#ifdef HAVE_ZLIB
+   if (compress)
+   {
+      /* A stored block is prefixed with its deflated size,
+       * or 0 if deflate didn't make the delta smaller. */
+      state->scratch_size = state_manager_raw_maxsize(state_size);
+      state->scratch      = (uint8_t*)malloc(state->scratch_size);
+      if (!state->scratch)
+         goto error;
+      state->maxcompsize += sizeof(size_t);
+      state->compress     = true;
+   }
+#else
+   (void)compress;
+#endif
+
 #if STRICT_BUF_SIZE
    state->debugsize   = state_size;
    state->debugblock  = (uint8_t*)malloc(state_size);
@@ -480,6 +274,87 @@ error:
    return NULL;
 }
 
+#ifdef HAVE_ZLIB
+/* Builds the delta between 'oldb' and 'newb' in the scratch buffer
+ * and stores it deflated at 'out', behind its deflated size. Deltas
+ * that don't get smaller are stored as-is behind a size of 0.
+ * Returns the number of bytes written to 'out'. */
+static size_t state_manager_push_deflate(state_manager_t *state,
+      const uint8_t *oldb, const uint8_t *newb, uint8_t *out)
+{
+   uint32_t rd, wn;
+   enum trans_stream_error err = TRANS_STREAM_ERROR_NONE;
+   retro_time_t start          = cpu_features_get_time_usec();
+   size_t delta_len            = state_manager_raw_compress(oldb, newb,
+         state->blocksize, state->scratch);
+   retro_time_t mid            = cpu_features_get_time_usec();
+
+   state->delta_time  += mid - start;
+   state->delta_bytes += delta_len;
+
+   if (!state->deflate_stream)
+   {
+      state->deflate_stream = zlib_deflate_backend.stream_new();
+      /* Level 1; deltas are mostly zero runs already. */
+      if (state->deflate_stream)
+         zlib_deflate_backend.define(state->deflate_stream, "level", 1);
+   }
+
+   if (state->deflate_stream)
+   {
+      zlib_deflate_backend.set_in(state->deflate_stream,
+            state->scratch, (uint32_t)delta_len);
+      zlib_deflate_backend.set_out(state->deflate_stream,
+            out + sizeof(size_t), (uint32_t)delta_len);
+
+      if (zlib_deflate_backend.trans(state->deflate_stream, true,
+               &rd, &wn, &err) && err == TRANS_STREAM_ERROR_NONE)
+      {
+         write_size_t(out, wn);
+         state->entropy_time += cpu_features_get_time_usec() - mid;
+         state->stored_bytes += sizeof(size_t) + wn;
+         return sizeof(size_t) + wn;
+      }
+
+      /* The stream is left halfway through, start over next time. */
+      zlib_deflate_backend.stream_free(state->deflate_stream);
+      state->deflate_stream = NULL;
+   }
+
+   write_size_t(out, 0);
+   memcpy(out + sizeof(size_t), state->scratch, delta_len);
+   state->entropy_time += cpu_features_get_time_usec() - mid;
+   state->stored_bytes += sizeof(size_t) + delta_len;
+   return sizeof(size_t) + delta_len;
+}
+
+static bool state_manager_inflate(state_manager_t *state,
+      const uint8_t *in, size_t in_len)
+{
+   uint32_t rd, wn;
+   enum trans_stream_error err = TRANS_STREAM_ERROR_NONE;
+
+   if (!state->inflate_stream)
+      state->inflate_stream = zlib_inflate_backend.stream_new();
+   if (!state->inflate_stream)
+      return false;
+
+   zlib_inflate_backend.set_in(state->inflate_stream,
+         in, (uint32_t)in_len);
+   zlib_inflate_backend.set_out(state->inflate_stream,
+         state->scratch, (uint32_t)state->scratch_size);
+
+   if (zlib_inflate_backend.trans(state->inflate_stream, true,
+            &rd, &wn, &err) && err == TRANS_STREAM_ERROR_NONE)
+      return true;
+
+   RARCH_ERR("[Rewind]: Failed to inflate rewind state.\n");
+   zlib_inflate_backend.stream_free(state->inflate_stream);
+   state->inflate_stream = NULL;
+   return false;
+}
+#endif
+
 static bool state_manager_pop(state_manager_t *state, const void **data)
 {
    size_t start;
@@ -506,6 +381,22 @@ static bool state_manager_pop(state_manager_t *state, const void **data)
    compressed = state->data + start + sizeof(size_t);
    out = state->thisblock;
 
+#ifdef HAVE_ZLIB
+   if (state->compress)
+   {
+      size_t deflated_len = read_size_t(compressed);
+
+      compressed += sizeof(size_t);
+
+      if (deflated_len)
+      {
+         if (!state_manager_inflate(state, compressed, deflated_len))
+            return false;
+         compressed = state->scratch;
+      }
+   }
+#endif
+
    state_manager_raw_decompress(compressed,
          state->maxcompsize, out, state->blocksize);
 
@@ -569,8 +460,23 @@ recheckcapacity:;
       newb        = state->nextblock;
       compressed  = state->head + sizeof(size_t);
 
-      compressed += state_manager_raw_compress(oldb, newb,
-            state->blocksize, compressed);
+#ifdef HAVE_ZLIB
+      if (state->compress)
+         compressed += state_manager_push_deflate(state, oldb, newb,
+               compressed);
+      else
+#endif
+      {
+         retro_time_t start = cpu_features_get_time_usec();
+         size_t delta_len   = state_manager_raw_compress(oldb, newb,
+               state->blocksize, compressed);
+
+         state->delta_time   += cpu_features_get_time_usec() - start;
+         state->delta_bytes  += delta_len;
+         state->stored_bytes += delta_len;
+         compressed          += delta_len;
+      }
+      state->pushes++;
 
       if (compressed - state->data + state->maxcompsize > state->capacity)
       {
@@ -593,6 +499,176 @@ recheckcapacity:;
    state->entries++;
 }
 
+#ifdef HAVE_THREADS
+static void state_manager_async_thread(void *data)
+{
+   struct state_manager_async *async = (struct state_manager_async*)data;
+
+   for (;;)
+   {
+      const void *ignored = NULL;
+      uint8_t *snapshot   = NULL;
+      uint8_t *old_next   = NULL;
+      state_manager_t *state;
+      size_t uniq_pos;
+
+      slock_lock(async->lock);
+      while (!async->pending_count && !async->quit)
+         scond_wait(async->cond, async->lock);
+
+      if (!async->pending_count)
+      {
+         slock_unlock(async->lock);
+         break;
+      }
+
+      snapshot = async->pending[0];
+      async->pending_count--;
+      memmove(async->pending, async->pending + 1,
+            async->pending_count * sizeof(*async->pending));
+      async->busy = true;
+      slock_unlock(async->lock);
+
+      /* Nothing else touches the ring while busy is set;
+       * the main thread waits in state_manager_async_flush. */
+      state    = rewind_state.state;
+      state_manager_push_where(state, (void**)&ignored);
+
+      /* The compressor relies on the sentinel past the end of
+       * the two blocks being different. */
+      uniq_pos = state->blocksize / sizeof(uint16_t) + 3;
+      ((uint16_t*)snapshot)[uniq_pos] =
+         ((uint16_t*)state->thisblock)[uniq_pos] ^ 1;
+
+      old_next         = state->nextblock;
+      state->nextblock = snapshot;
+      state_manager_push_do(state);
+
+      /* push_do swapped the blocks, whichever one is not
+       * thisblock anymore can be handed back. */
+      if (state->nextblock == snapshot)
+      {
+         state->nextblock = old_next;
+         old_next         = snapshot;
+      }
+
+      slock_lock(async->lock);
+      async->free_snapshots[async->free_count++] = old_next;
+      async->busy = false;
+      scond_broadcast(async->cond);
+      slock_unlock(async->lock);
+   }
+}
+
+/* Waits until the worker has pushed everything that was queued. */
+static void state_manager_async_flush(struct state_manager_async *async)
+{
+   slock_lock(async->lock);
+   while (async->pending_count || async->busy)
+      scond_wait(async->cond, async->lock);
+   slock_unlock(async->lock);
+}
+
+static void state_manager_async_free(struct state_manager_async *async)
+{
+   unsigned i;
+
+   if (!async)
+      return;
+
+   if (async->thread)
+   {
+      slock_lock(async->lock);
+      async->quit = true;
+      scond_broadcast(async->cond);
+      slock_unlock(async->lock);
+      sthread_join(async->thread);
+   }
+
+   for (i = 0; i < async->free_count; i++)
+      free(async->free_snapshots[i]);
+   for (i = 0; i < async->pending_count; i++)
+      free(async->pending[i]);
+
+   if (async->dropped)
+      RARCH_LOG("[Rewind]: %u captures dropped while the "
+            "worker was busy.\n", async->dropped);
+
+   if (async->cond)
+      scond_free(async->cond);
+   if (async->lock)
+      slock_free(async->lock);
+   free(async);
+}
+
+static struct state_manager_async *state_manager_async_new(
+      size_t state_size)
+{
+   unsigned i;
+   struct state_manager_async *async = (struct state_manager_async*)
+      calloc(1, sizeof(*async));
+
+   if (!async)
+      return NULL;
+
+   async->lock = slock_new();
+   async->cond = scond_new();
+
+   if (!async->lock || !async->cond)
+      goto error;
+
+   for (i = 0; i < REWIND_SNAPSHOTS; i++)
+   {
+      uint8_t *snapshot = (uint8_t*)state_manager_raw_alloc(state_size, 0);
+      if (!snapshot)
+         goto error;
+      async->free_snapshots[async->free_count++] = snapshot;
+   }
+
+   async->thread = sthread_create(state_manager_async_thread, async);
+   if (!async->thread)
+      goto error;
+
+   return async;
+
+error:
+   state_manager_async_free(async);
+   return NULL;
+}
+
+static void state_manager_async_push(struct state_manager_async *async)
+{
+   retro_ctx_serialize_info_t serial_info;
+   uint8_t *snapshot = NULL;
+
+   slock_lock(async->lock);
+   if (async->free_count)
+      snapshot = async->free_snapshots[--async->free_count];
+   else
+      async->dropped++;
+   slock_unlock(async->lock);
+
+   if (!snapshot)
+      return;
+
+   serial_info.data = snapshot;
+   serial_info.size = rewind_state.size;
+
+   if (!core_serialize(&serial_info))
+   {
+      slock_lock(async->lock);
+      async->free_snapshots[async->free_count++] = snapshot;
+      slock_unlock(async->lock);
+      return;
+   }
+
+   slock_lock(async->lock);
+   async->pending[async->pending_count++] = snapshot;
+   scond_signal(async->cond);
+   slock_unlock(async->lock);
+}
+#endif
+
 #if 0
 static void state_manager_capacity(state_manager_t *state,
       unsigned *entries, size_t *bytes, bool *full)
@@ -611,7 +687,36 @@ static void state_manager_capacity(state_manager_t *state,
 }
 #endif
 
-void state_manager_event_init(unsigned rewind_buffer_size)
+static void state_manager_log_stats(const state_manager_t *state)
+{
+   double stored_per_push, seconds_per_mb;
+   const struct retro_system_av_info *av_info =
+      video_viewport_get_system_av_info();
+   double fps = av_info ? av_info->timing.fps : 0.0;
+
+   if (!state->pushes || !state->stored_bytes)
+      return;
+
+   /* One push covers 'granularity' frames; the ring holds about
+    * one MB / stored_per_push of them per MB of rewind buffer. */
+   stored_per_push = (double)state->stored_bytes / state->pushes;
+   seconds_per_mb  = fps > 0.0
+      ? 1000000.0 / stored_per_push
+      * (rewind_state.granularity ? rewind_state.granularity : 1) / fps
+      : 0.0;
+
+   RARCH_LOG("[Rewind]: %u pushes, %.1f KB stored per push "
+         "(%.1f%% of the raw delta), %.1f seconds of history per MB.\n",
+         state->pushes, stored_per_push / 1024.0,
+         100.0 * state->stored_bytes / state->delta_bytes,
+         seconds_per_mb);
+   RARCH_LOG("[Rewind]: %.3f ms delta + %.3f ms compression per push.\n",
+         state->delta_time / (state->pushes * 1000.0),
+         state->entropy_time / (state->pushes * 1000.0));
+}
+
+void state_manager_event_init(unsigned rewind_buffer_size,
+      bool threaded, bool compression)
 {
    retro_ctx_serialize_info_t serial_info;
    retro_ctx_size_info_t info;
@@ -641,8 +746,17 @@ void state_manager_event_init(unsigned rewind_buffer_size)
          msg_hash_to_str(MSG_REWIND_INIT),
          (unsigned)(rewind_buffer_size / 1000000));
 
+   RARCH_LOG("[Rewind]: Using %s delta scan.\n",
+         state_manager_raw_init_simd(cpu_features_get()));
+
+#ifndef HAVE_ZLIB
+   if (compression)
+      RARCH_WARN("[Rewind]: Compression needs zlib support, "
+            "storing uncompressed deltas.\n");
+#endif
+
    rewind_state.state = state_manager_new(rewind_state.size,
-         rewind_buffer_size);
+         rewind_buffer_size, compression);
 
    if (!rewind_state.state)
       RARCH_WARN("%s.\n", msg_hash_to_str(MSG_REWIND_INIT_FAILED));
@@ -655,6 +769,16 @@ void state_manager_event_init(unsigned rewind_buffer_size)
    core_serialize(&serial_info);
 
    state_manager_push_do(rewind_state.state);
+
+#ifdef HAVE_THREADS
+   if (threaded && rewind_state.state)
+   {
+      rewind_state.async = state_manager_async_new(rewind_state.size);
+      if (!rewind_state.async)
+         RARCH_WARN("[Rewind]: Could not start capture thread, "
+               "capturing on the main thread.\n");
+   }
+#endif
 }
 
 
@@ -665,8 +789,23 @@ bool state_manager_frame_is_reversed(void)
 
 void state_manager_event_deinit(void)
 {
+#ifdef HAVE_THREADS
+   /* Stop the worker first, it owns the ring while running. */
+   state_manager_async_free(rewind_state.async);
+   rewind_state.async = NULL;
+#endif
+
+   if (rewind_state.captures)
+      RARCH_LOG("[Rewind]: %u captures, %.3f ms average main thread "
+            "cost per capture.\n", rewind_state.captures,
+            rewind_state.capture_time
+            / (rewind_state.captures * 1000.0));
+   rewind_state.captures     = 0;
+   rewind_state.capture_time = 0;
+
    if (rewind_state.state)
    {
+      state_manager_log_stats(rewind_state.state);
       state_manager_free(rewind_state.state);
       free(rewind_state.state);
    }
@@ -712,6 +851,11 @@ bool state_manager_check_rewind(bool pressed,
    {
       const void *buf    = NULL;
 
+#ifdef HAVE_THREADS
+      if (rewind_state.async)
+         state_manager_async_flush(rewind_state.async);
+#endif
+
       if (state_manager_pop(rewind_state.state, &buf))
       {
          retro_ctx_serialize_info_t serial_info;
@@ -775,17 +919,30 @@ bool state_manager_check_rewind(bool pressed,
 
       if ((cnt == 0) || bsv_movie_ctl(BSV_MOVIE_CTL_IS_INITED, NULL))
       {
-         retro_ctx_serialize_info_t serial_info;
-         void *state = NULL;
+         retro_time_t start = cpu_features_get_time_usec();
 
-         state_manager_push_where(rewind_state.state, &state);
+#ifdef HAVE_THREADS
+         if (rewind_state.async)
+            state_manager_async_push(rewind_state.async);
+         else
+#endif
+         {
+            retro_ctx_serialize_info_t serial_info;
+            void *state = NULL;
 
-         serial_info.data = state;
-         serial_info.size = rewind_state.size;
+            state_manager_push_where(rewind_state.state, &state);
 
-         core_serialize(&serial_info);
+            serial_info.data = state;
+            serial_info.size = rewind_state.size;
+
+            core_serialize(&serial_info);
+
+            state_manager_push_do(rewind_state.state);
+         }
 
-         state_manager_push_do(rewind_state.state);
+         rewind_state.capture_time += cpu_features_get_time_usec() - start;
+         rewind_state.captures++;
+         rewind_state.granularity   = rewind_granularity;
       }
    }
 
@@ -32,7 +32,16 @@ bool state_manager_frame_is_reversed(void);
 
 void state_manager_event_deinit(void);
 
-void state_manager_event_init(unsigned rewind_buffer_size);
+/**
+ * state_manager_event_init:
+ * @rewind_buffer_size   : size of the rewind ring in bytes.
+ * @threaded             : compress captured states on a worker
+ *                         thread instead of the main thread.
+ * @compression          : run each delta through zlib before it
+ *                         is stored in the ring.
+ **/
+void state_manager_event_init(unsigned rewind_buffer_size,
+      bool threaded, bool compression);
 
 /**
  * check_rewind:
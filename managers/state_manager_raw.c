@@ -0,0 +1,559 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *  Copyright (C) 2014-2017 - Alfred Agrell
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define __STDC_LIMIT_MACROS
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libretro.h>
+#include <retro_inline.h>
+#include <compat/intrinsics.h>
+
+#include "state_manager_raw.h"
+
+#ifndef UINT16_MAX
+#define UINT16_MAX 0xffff
+#endif
+
+#ifndef UINT32_MAX
+#define UINT32_MAX 0xffffffffu
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(__i486__) || defined(__i686__)
+#define CPU_X86
+#endif
+
+/* Other arches SIGBUS (usually) on unaligned accesses. */
+#ifndef CPU_X86
+#define NO_UNALIGNED_MEM
+#endif
+
+#if __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* AVX2 is selected at runtime, so it is built with a per-function
+ * target attribute unless the whole build already targets it. */
+#if defined(CPU_X86) && (defined(__AVX2__) || (defined(__GNUC__) && (__GNUC__ >= 5 || defined(__clang__))))
+#define HAVE_STATE_MANAGER_AVX2
+#include <immintrin.h>
+#if defined(__AVX2__)
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+#if (defined(__ARM_NEON__) || defined(__ARM_NEON)) && !defined(DONT_WANT_ARM_OPTIMIZATIONS)
+#define HAVE_STATE_MANAGER_NEON
+#include <arm_neon.h>
+#endif
+
+/* The widest scan reads this many bytes past the point where it
+ * stops, see state_manager_raw_alloc. */
+#define STATE_MANAGER_RAW_PADDING 32
+
+/* Format per frame (pseudocode): */
+#if 0
+size nextstart;
+repeat {
+   uint16 numchanged; /* everything is counted in units of uint16 */
+   if (numchanged)
+   {
+      uint16 numunchanged; /* skip these before handling numchanged */
+      uint16[numchanged] changeddata;
+   }
+   else
+   {
+      uint32 numunchanged;
+      if (!numunchanged)
+         break;
+   }
+}
+size thisstart;
+#endif
+
+/* There's no equivalent in libc, you'd think so ...
+ * std::mismatch exists, but it's not optimized at all. */
+static size_t find_change_generic(const uint16_t *a, const uint16_t *b)
+{
+   const uint16_t *a_org = a;
+#ifdef NO_UNALIGNED_MEM
+   while (((uintptr_t)a & (sizeof(size_t) - 1)) && *a == *b)
+   {
+      a++;
+      b++;
+   }
+   if (*a == *b)
+#endif
+   {
+      const size_t *a_big = (const size_t*)a;
+      const size_t *b_big = (const size_t*)b;
+
+      while (*a_big == *b_big)
+      {
+         a_big++;
+         b_big++;
+      }
+      a = (const uint16_t*)a_big;
+      b = (const uint16_t*)b_big;
+
+      while (*a == *b)
+      {
+         a++;
+         b++;
+      }
+   }
+   return a - a_org;
+}
+
+static size_t find_same_generic(const uint16_t *a, const uint16_t *b)
+{
+   const uint16_t *a_org = a;
+#ifdef NO_UNALIGNED_MEM
+   if (((uintptr_t)a & (sizeof(uint32_t) - 1)) && *a != *b)
+   {
+      a++;
+      b++;
+   }
+   if (*a != *b)
+#endif
+   {
+      /* With this, it's random whether two consecutive identical
+       * words are caught.
+       *
+       * Luckily, compression rate is the same for both cases, and
+       * three is always caught.
+       *
+       * (We prefer to miss two-word blocks, anyways; fewer iterations
+       * of the outer loop, as well as in the decompressor.) */
+      const uint32_t *a_big = (const uint32_t*)a;
+      const uint32_t *b_big = (const uint32_t*)b;
+
+      while (*a_big != *b_big)
+      {
+         a_big++;
+         b_big++;
+      }
+      a = (const uint16_t*)a_big;
+      b = (const uint16_t*)b_big;
+
+      if (a != a_org && a[-1] == b[-1])
+      {
+         a--;
+         b--;
+      }
+   }
+   return a - a_org;
+}
+
+static void decompress_generic(const void *patch, void *data)
+{
+   uint16_t         *out16 = (uint16_t*)data;
+   const uint16_t *patch16 = (const uint16_t*)patch;
+
+   for (;;)
+   {
+      uint16_t numchanged = *(patch16++);
+
+      if (numchanged)
+      {
+         uint16_t i;
+
+         out16 += *patch16++;
+
+         /* We could do memcpy, but it seems that memcpy has a
+          * constant-per-call overhead that actually shows up.
+          *
+          * Our average size in here seems to be 8 or something.
+          * Therefore, we do something with lower overhead. */
+         for (i = 0; i < numchanged; i++)
+            out16[i] = patch16[i];
+
+         patch16 += numchanged;
+         out16 += numchanged;
+      }
+      else
+      {
+         uint32_t numunchanged = patch16[0] | (patch16[1] << 16);
+
+         if (!numunchanged)
+            break;
+         patch16 += 2;
+         out16 += numunchanged;
+      }
+   }
+}
+
+#if __SSE2__
+static size_t find_change_sse2(const uint16_t *a, const uint16_t *b)
+{
+   const __m128i *a128 = (const __m128i*)a;
+   const __m128i *b128 = (const __m128i*)b;
+
+   for (;;)
+   {
+      __m128i v0    = _mm_loadu_si128(a128);
+      __m128i v1    = _mm_loadu_si128(b128);
+      __m128i c     = _mm_cmpeq_epi32(v0, v1);
+      uint32_t mask = _mm_movemask_epi8(c);
+
+      if (mask != 0xffff) /* Something has changed, figure out where. */
+      {
+         size_t ret = (((uint8_t*)a128 - (uint8_t*)a) |
+               (compat_ctz(~mask))) >> 1;
+         return ret | (a[ret] == b[ret]);
+      }
+
+      a128++;
+      b128++;
+   }
+}
+#endif
+
+#ifdef HAVE_STATE_MANAGER_AVX2
+static TARGET_AVX2 size_t find_change_avx2(
+      const uint16_t *a, const uint16_t *b)
+{
+   const __m256i *a256 = (const __m256i*)a;
+   const __m256i *b256 = (const __m256i*)b;
+
+   for (;;)
+   {
+      __m256i v0    = _mm256_loadu_si256(a256);
+      __m256i v1    = _mm256_loadu_si256(b256);
+      __m256i c     = _mm256_cmpeq_epi32(v0, v1);
+      uint32_t mask = (uint32_t)_mm256_movemask_epi8(c);
+
+      if (mask != 0xffffffffu)
+      {
+         size_t ret = (((uint8_t*)a256 - (uint8_t*)a) |
+               (compat_ctz(~mask))) >> 1;
+         return ret | (a[ret] == b[ret]);
+      }
+
+      a256++;
+      b256++;
+   }
+}
+
+/* Same result as find_same_generic: the first 32-bit word (counted
+ * from a) that is identical, backed up by one uint16 if possible. */
+static TARGET_AVX2 size_t find_same_avx2(
+      const uint16_t *a, const uint16_t *b)
+{
+   const __m256i *a256 = (const __m256i*)a;
+   const __m256i *b256 = (const __m256i*)b;
+
+   for (;;)
+   {
+      __m256i v0    = _mm256_loadu_si256(a256);
+      __m256i v1    = _mm256_loadu_si256(b256);
+      __m256i c     = _mm256_cmpeq_epi32(v0, v1);
+      uint32_t mask = (uint32_t)_mm256_movemask_epi8(c);
+
+      if (mask)
+      {
+         size_t ret = (((uint8_t*)a256 - (uint8_t*)a) |
+               (compat_ctz(mask))) >> 1;
+         if (ret && a[ret - 1] == b[ret - 1])
+            ret--;
+         return ret;
+      }
+
+      a256++;
+      b256++;
+   }
+}
+
+static TARGET_AVX2 void decompress_avx2(const void *patch, void *data)
+{
+   uint16_t         *out16 = (uint16_t*)data;
+   const uint16_t *patch16 = (const uint16_t*)patch;
+
+   for (;;)
+   {
+      uint16_t numchanged = *(patch16++);
+
+      if (numchanged)
+      {
+         uint16_t i = 0;
+
+         out16 += *patch16++;
+
+         /* Long runs go 16 uint16 at a time, the short
+          * ones that dominate stay on the cheap loop. */
+         for (; i + 16 <= numchanged; i += 16)
+            _mm256_storeu_si256((__m256i*)(out16 + i),
+                  _mm256_loadu_si256((const __m256i*)(patch16 + i)));
+         for (; i < numchanged; i++)
+            out16[i] = patch16[i];
+
+         patch16 += numchanged;
+         out16 += numchanged;
+      }
+      else
+      {
+         uint32_t numunchanged = patch16[0] | (patch16[1] << 16);
+
+         if (!numunchanged)
+            break;
+         patch16 += 2;
+         out16 += numunchanged;
+      }
+   }
+}
+#endif
+
+#ifdef HAVE_STATE_MANAGER_NEON
+static size_t find_change_neon(const uint16_t *a, const uint16_t *b)
+{
+   const uint8_t *a8 = (const uint8_t*)a;
+   const uint8_t *b8 = (const uint8_t*)b;
+
+   for (;;)
+   {
+      uint32x4_t c  = vceqq_u32(
+            vreinterpretq_u32_u8(vld1q_u8(a8)),
+            vreinterpretq_u32_u8(vld1q_u8(b8)));
+      uint32x2_t c2 = vand_u32(vget_low_u32(c), vget_high_u32(c));
+
+      if ((vget_lane_u32(c2, 0) & vget_lane_u32(c2, 1)) != 0xffffffffu)
+      {
+         size_t ret = (a8 - (const uint8_t*)a) >> 1;
+         while (a[ret] == b[ret])
+            ret++;
+         return ret;
+      }
+
+      a8 += 16;
+      b8 += 16;
+   }
+}
+
+static size_t find_same_neon(const uint16_t *a, const uint16_t *b)
+{
+   const uint8_t *a8 = (const uint8_t*)a;
+   const uint8_t *b8 = (const uint8_t*)b;
+
+   for (;;)
+   {
+      uint32x4_t c  = vceqq_u32(
+            vreinterpretq_u32_u8(vld1q_u8(a8)),
+            vreinterpretq_u32_u8(vld1q_u8(b8)));
+      uint32x2_t c2 = vorr_u32(vget_low_u32(c), vget_high_u32(c));
+
+      if (vget_lane_u32(c2, 0) | vget_lane_u32(c2, 1))
+      {
+         size_t ret = (a8 - (const uint8_t*)a) >> 1;
+         while (a[ret] != b[ret] || a[ret + 1] != b[ret + 1])
+            ret += 2;
+         if (ret && a[ret - 1] == b[ret - 1])
+            ret--;
+         return ret;
+      }
+
+      a8 += 16;
+      b8 += 16;
+   }
+}
+
+static void decompress_neon(const void *patch, void *data)
+{
+   uint16_t         *out16 = (uint16_t*)data;
+   const uint16_t *patch16 = (const uint16_t*)patch;
+
+   for (;;)
+   {
+      uint16_t numchanged = *(patch16++);
+
+      if (numchanged)
+      {
+         uint16_t i = 0;
+
+         out16 += *patch16++;
+
+         for (; i + 8 <= numchanged; i += 8)
+            vst1q_u16(out16 + i, vld1q_u16(patch16 + i));
+         for (; i < numchanged; i++)
+            out16[i] = patch16[i];
+
+         patch16 += numchanged;
+         out16 += numchanged;
+      }
+      else
+      {
+         uint32_t numunchanged = patch16[0] | (patch16[1] << 16);
+
+         if (!numunchanged)
+            break;
+         patch16 += 2;
+         out16 += numunchanged;
+      }
+   }
+}
+#endif
+
+static size_t (*find_change)(const uint16_t *a, const uint16_t *b) =
+#if __SSE2__
+   find_change_sse2;
+#else
+   find_change_generic;
+#endif
+static size_t (*find_same)(const uint16_t *a, const uint16_t *b) =
+   find_same_generic;
+static void (*decompress)(const void *patch, void *data) =
+   decompress_generic;
+
+const char *state_manager_raw_init_simd(uint64_t cpu)
+{
+   find_change = find_change_generic;
+   find_same   = find_same_generic;
+   decompress  = decompress_generic;
+
+#ifdef HAVE_STATE_MANAGER_AVX2
+   if (cpu & RETRO_SIMD_AVX2)
+   {
+      find_change = find_change_avx2;
+      find_same   = find_same_avx2;
+      decompress  = decompress_avx2;
+      return "AVX2";
+   }
+#endif
+#if __SSE2__
+   if (cpu & RETRO_SIMD_SSE2)
+   {
+      find_change = find_change_sse2;
+      return "SSE2";
+   }
+#endif
+#ifdef HAVE_STATE_MANAGER_NEON
+   if (cpu & RETRO_SIMD_NEON)
+   {
+      find_change = find_change_neon;
+      find_same   = find_same_neon;
+      decompress  = decompress_neon;
+      return "NEON";
+   }
+#endif
+
+   return "generic";
+}
+
+size_t state_manager_raw_maxsize(size_t uncomp)
+{
+   /* bytes covered by a compressed block */
+   const int maxcblkcover = UINT16_MAX * sizeof(uint16_t);
+   /* uncompressed size, rounded to 16 bits */
+   size_t uncomp16        = (uncomp + sizeof(uint16_t) - 1) & -sizeof(uint16_t);
+   /* number of blocks */
+   size_t maxcblks        = (uncomp + maxcblkcover - 1) / maxcblkcover;
+   return uncomp16 + maxcblks * sizeof(uint16_t) * 2 /* two u16 overhead per block */ + sizeof(uint16_t) *
+      3; /* three u16 to end it */
+}
+
+void *state_manager_raw_alloc(size_t len, uint16_t uniq)
+{
+   size_t  len16 = (len + sizeof(uint16_t) - 1) & -sizeof(uint16_t);
+   uint16_t *ret = (uint16_t*)calloc(len16 + sizeof(uint16_t) * 4
+         + STATE_MANAGER_RAW_PADDING, 1);
+
+   /* Force in a different byte at the end, so we don't need to check
+    * bounds in the innermost loop (it's expensive).
+    *
+    * There is also a large amount of data that's the same, to stop
+    * the other scan.
+    *
+    * There is also some padding at the end. This is so we don't
+    * read outside the buffer end if we're reading in large blocks;
+    *
+    * It doesn't make any difference to us, but sacrificing 32 bytes to get
+    * Valgrind happy is worth it. */
+   if (ret)
+      ret[len16/sizeof(uint16_t) + 3] = uniq;
+
+   return ret;
+}
+
+size_t state_manager_raw_compress(const void *src,
+      const void *dst, size_t len, void *patch)
+{
+   const uint16_t  *old16 = (const uint16_t*)src;
+   const uint16_t  *new16 = (const uint16_t*)dst;
+   uint16_t *compressed16 = (uint16_t*)patch;
+   size_t          num16s = (len + sizeof(uint16_t) - 1)
+      / sizeof(uint16_t);
+
+   while (num16s)
+   {
+      size_t i, changed;
+      size_t skip = find_change(old16, new16);
+
+      if (skip >= num16s)
+         break;
+
+      old16  += skip;
+      new16  += skip;
+      num16s -= skip;
+
+      if (skip > UINT16_MAX)
+      {
+         if (skip > UINT32_MAX)
+         {
+            /* This will make it scan the entire thing again,
+             * but it only hits on 8GB unchanged data anyways,
+             * and if you're doing that, you've got bigger problems. */
+            skip = UINT32_MAX;
+         }
+         *compressed16++ = 0;
+         *compressed16++ = skip;
+         *compressed16++ = skip >> 16;
+         continue;
+      }
+
+      changed = find_same(old16, new16);
+      if (changed > UINT16_MAX)
+         changed = UINT16_MAX;
+
+      *compressed16++ = changed;
+      *compressed16++ = skip;
+
+      for (i = 0; i < changed; i++)
+         compressed16[i] = old16[i];
+
+      old16 += changed;
+      new16 += changed;
+      num16s -= changed;
+      compressed16 += changed;
+   }
+
+   compressed16[0] = 0;
+   compressed16[1] = 0;
+   compressed16[2] = 0;
+
+   return (uint8_t*)(compressed16+3) - (uint8_t*)patch;
+}
+
+void state_manager_raw_decompress(const void *patch,
+      size_t patchlen, void *data, size_t datalen)
+{
+   (void)patchlen;
+   (void)datalen;
+
+   decompress(patch, data);
+}
@@ -2899,7 +2899,7 @@ static bool setting_append_list(
       case SETTINGS_LIST_CORE:
          {
             unsigned i;
-            struct bool_entry bool_entries[5];
+            struct bool_entry bool_entries[6];
 
             START_GROUP(list, list_info, &group_info,
                   msg_hash_to_str(MENU_ENUM_LABEL_VALUE_CORE_SETTINGS), parent_group);
@@ -2942,6 +2942,12 @@ static bool setting_append_list(
             bool_entries[4].default_value  = allow_rotate;
             bool_entries[4].flags          = SD_FLAG_ADVANCED;
 
+            bool_entries[5].target         = &settings->bools.core_info_cache_enable;
+            bool_entries[5].name_enum_idx  = MENU_ENUM_LABEL_CORE_INFO_CACHE_ENABLE;
+            bool_entries[5].SHORT_enum_idx = MENU_ENUM_LABEL_VALUE_CORE_INFO_CACHE_ENABLE;
+            bool_entries[5].default_value  = core_info_cache_enable;
+            bool_entries[5].flags          = SD_FLAG_ADVANCED;
+
             for (i = 0; i < ARRAY_SIZE(bool_entries); i++)
             {
                CONFIG_BOOL(
@@ -3270,6 +3276,40 @@ static bool setting_append_list(
                   general_read_handler);
          menu_settings_list_current_add_range(list, list_info, 1, 32768, 1, true, true);
 
+#ifdef HAVE_THREADS
+         CONFIG_BOOL(
+               list, list_info,
+               &settings->bools.rewind_threaded,
+               MENU_ENUM_LABEL_REWIND_THREADED,
+               MENU_ENUM_LABEL_VALUE_REWIND_THREADED,
+               rewind_threaded,
+               MENU_ENUM_LABEL_VALUE_OFF,
+               MENU_ENUM_LABEL_VALUE_ON,
+               &group_info,
+               &subgroup_info,
+               parent_group,
+               general_write_handler,
+               general_read_handler,
+               SD_FLAG_ADVANCED);
+#endif
+
+#ifdef HAVE_ZLIB
+         CONFIG_BOOL(
+               list, list_info,
+               &settings->bools.rewind_compression,
+               MENU_ENUM_LABEL_REWIND_COMPRESSION,
+               MENU_ENUM_LABEL_VALUE_REWIND_COMPRESSION,
+               rewind_compression,
+               MENU_ENUM_LABEL_VALUE_OFF,
+               MENU_ENUM_LABEL_VALUE_ON,
+               &group_info,
+               &subgroup_info,
+               parent_group,
+               general_write_handler,
+               general_read_handler,
+               SD_FLAG_ADVANCED);
+#endif
+
          END_SUB_GROUP(list, list_info, parent_group);
          END_GROUP(list, list_info, parent_group);
          break;
@@ -3887,6 +3927,54 @@ static bool setting_append_list(
             menu_settings_list_current_add_range(list, list_info, 0, 15, 1, true, true);
             settings_data_list_current_add_flags(list, list_info, SD_FLAG_LAKKA_ADVANCED);
 
+            CONFIG_BOOL(
+                  list, list_info,
+                  &settings->bools.run_ahead_enabled,
+                  MENU_ENUM_LABEL_RUN_AHEAD_ENABLED,
+                  MENU_ENUM_LABEL_VALUE_RUN_AHEAD_ENABLED,
+                  run_ahead_enabled,
+                  MENU_ENUM_LABEL_VALUE_OFF,
+                  MENU_ENUM_LABEL_VALUE_ON,
+                  &group_info,
+                  &subgroup_info,
+                  parent_group,
+                  general_write_handler,
+                  general_read_handler,
+                  SD_FLAG_NONE
+                  );
+            settings_data_list_current_add_flags(list, list_info, SD_FLAG_ADVANCED);
+
+            CONFIG_UINT(
+                  list, list_info,
+                  &settings->uints.run_ahead_frames,
+                  MENU_ENUM_LABEL_RUN_AHEAD_FRAMES,
+                  MENU_ENUM_LABEL_VALUE_RUN_AHEAD_FRAMES,
+                  run_ahead_frames,
+                  &group_info,
+                  &subgroup_info,
+                  parent_group,
+                  general_write_handler,
+                  general_read_handler);
+            menu_settings_list_current_add_range(list, list_info, 1, 6, 1, true, true);
+            settings_data_list_current_add_flags(list, list_info, SD_FLAG_ADVANCED);
+
+            CONFIG_BOOL(
+                  list, list_info,
+                  &settings->bools.run_ahead_secondary_instance,
+                  MENU_ENUM_LABEL_RUN_AHEAD_SECONDARY_INSTANCE,
+                  MENU_ENUM_LABEL_VALUE_RUN_AHEAD_SECONDARY_INSTANCE,
+                  run_ahead_secondary_instance,
+                  MENU_ENUM_LABEL_VALUE_OFF,
+                  MENU_ENUM_LABEL_VALUE_ON,
+                  &group_info,
+                  &subgroup_info,
+                  parent_group,
+                  general_write_handler,
+                  general_read_handler,
+                  SD_FLAG_NONE
+                  );
+            settings_data_list_current_add_flags(list, list_info, SD_FLAG_ADVANCED);
+
 #if !defined(RARCH_MOBILE)
             CONFIG_BOOL(
                   list, list_info,
@@ -6535,6 +6623,21 @@ static bool setting_append_list(
                general_read_handler,
                SD_FLAG_NONE);
 
+         CONFIG_BOOL(
+               list, list_info,
+               &settings->bools.playlist_cache_enable,
+               MENU_ENUM_LABEL_PLAYLIST_CACHE_ENABLE,
+               MENU_ENUM_LABEL_VALUE_PLAYLIST_CACHE_ENABLE,
+               def_playlist_cache_enable,
+               MENU_ENUM_LABEL_VALUE_OFF,
+               MENU_ENUM_LABEL_VALUE_ON,
+               &group_info,
+               &subgroup_info,
+               parent_group,
+               general_write_handler,
+               general_read_handler,
+               SD_FLAG_ADVANCED);
+
          END_SUB_GROUP(list, list_info, parent_group);
 
          END_GROUP(list, list_info, parent_group);
@@ -6897,6 +7000,21 @@ static bool setting_append_list(
             menu_settings_list_current_add_range(list, list_info, -600, 600, 1, false, false);
             settings_data_list_current_add_flags(list, list_info, SD_FLAG_ADVANCED);
 
+            CONFIG_BOOL(
+                  list, list_info,
+                  &settings->bools.netplay_replay_fast_path,
+                  MENU_ENUM_LABEL_NETPLAY_REPLAY_FAST_PATH,
+                  MENU_ENUM_LABEL_VALUE_NETPLAY_REPLAY_FAST_PATH,
+                  netplay_replay_fast_path,
+                  MENU_ENUM_LABEL_VALUE_OFF,
+                  MENU_ENUM_LABEL_VALUE_ON,
+                  &group_info,
+                  &subgroup_info,
+                  parent_group,
+                  general_write_handler,
+                  general_read_handler,
+                  SD_FLAG_ADVANCED);
+
             CONFIG_INT(
                   list, list_info,
                   (int *) &settings->uints.netplay_input_latency_frames_min,
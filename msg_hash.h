@@ -679,6 +679,9 @@ enum msg_hash_enums
    MENU_LABEL(VIDEO_GPU_SCREENSHOT),
    MENU_LABEL(VIDEO_BLACK_FRAME_INSERTION),
    MENU_LABEL(VIDEO_FRAME_DELAY),
+   MENU_LABEL(RUN_AHEAD_ENABLED),
+   MENU_LABEL(RUN_AHEAD_FRAMES),
+   MENU_LABEL(RUN_AHEAD_SECONDARY_INSTANCE),
    MENU_LABEL(VIDEO_VSYNC),
    MENU_LABEL(VIDEO_HARD_SYNC),
    MENU_LABEL(VIDEO_HARD_SYNC_FRAMES),
@@ -820,6 +823,7 @@ enum msg_hash_enums
    MENU_LABEL(CONTENT_HISTORY_SIZE),
    MENU_LABEL(PLAYLIST_ENTRY_REMOVE),
    MENU_LABEL(PLAYLIST_ENTRY_RENAME),
+   MENU_LABEL(PLAYLIST_CACHE_ENABLE),
    MENU_LABEL(GOTO_FAVORITES),
    MENU_LABEL(GOTO_MUSIC),
    MENU_LABEL(GOTO_IMAGES),
@@ -1141,6 +1145,8 @@ enum msg_hash_enums
    MENU_LABEL(SCREENSHOT),
    MENU_LABEL(REWIND),
    MENU_LABEL(REWIND_GRANULARITY),
+   MENU_LABEL(REWIND_THREADED),
+   MENU_LABEL(REWIND_COMPRESSION),
    MENU_LABEL(INPUT_META_REWIND),
 
    MENU_LABEL(SCREEN_RESOLUTION),
@@ -1171,6 +1177,7 @@ enum msg_hash_enums
    MENU_LABEL(NETPLAY_REQUIRE_SLAVES),
    MENU_LABEL(NETPLAY_STATELESS_MODE),
    MENU_LABEL(NETPLAY_CHECK_FRAMES),
+   MENU_LABEL(NETPLAY_REPLAY_FAST_PATH),
    MENU_LABEL(NETPLAY_INPUT_LATENCY_FRAMES_MIN),
    MENU_LABEL(NETPLAY_INPUT_LATENCY_FRAMES_RANGE),
    MENU_LABEL(NETPLAY_SPECTATOR_MODE_ENABLE),
@@ -1370,6 +1377,7 @@ enum msg_hash_enums
 
    MENU_LABEL(DUMMY_ON_CORE_SHUTDOWN),
    MENU_LABEL(CHECK_FOR_MISSING_FIRMWARE),
+   MENU_LABEL(CORE_INFO_CACHE_ENABLE),
 
    MENU_LABEL(DETECT_CORE_LIST_OK_CURRENT_CORE),
    MENU_LABEL(DETECT_CORE_LIST_OK),
@@ -20,28 +20,28 @@
 
 #include "netplay_private.h"
 
+/* When a network thread owns the socket, each buffer is a single producer,
+ * single consumer ring: the main thread writes end of send buffers and start
+ * of recv buffers, the network thread the other way around. Offsets are read
+ * once into locals, and only ever stored with their final value. */
+
 static size_t buf_used(struct socket_buffer *sbuf)
 {
-   if (sbuf->end < sbuf->start)
-   {
-      size_t newend = sbuf->end;
-      while (newend < sbuf->start) newend += sbuf->bufsz;
-      return newend - sbuf->start;
-   }
+   size_t start = NETPLAY_LOAD(sbuf->start);
+   size_t end   = NETPLAY_LOAD(sbuf->end);
 
-   return sbuf->end - sbuf->start;
+   if (end < start)
+      return end + sbuf->bufsz - start;
+
+   return end - start;
 }
 
-static size_t buf_unread(struct socket_buffer *sbuf)
+static size_t buf_unread(struct socket_buffer *sbuf, size_t end)
 {
-   if (sbuf->end < sbuf->read)
-   {
-      size_t newend = sbuf->end;
-      while (newend < sbuf->read) newend += sbuf->bufsz;
-      return newend - sbuf->read;
-   }
+   if (end < sbuf->read)
+      return end + sbuf->bufsz - sbuf->read;
 
-   return sbuf->end - sbuf->read;
+   return end - sbuf->read;
 }
 
 static size_t buf_remaining(struct socket_buffer *sbuf)
@@ -119,6 +119,68 @@ void netplay_clear_socket_buffer(struct socket_buffer *sbuf)
    sbuf->start = sbuf->read = sbuf->end = 0;
 }
 
+/* Copy as much of buf into the send buffer as fits */
+static size_t buf_queue(struct socket_buffer *sbuf, const void *buf,
+   size_t len)
+{
+   size_t end = sbuf->end;
+
+   if (len > buf_remaining(sbuf))
+      len = buf_remaining(sbuf);
+
+   if (sbuf->bufsz - end < len)
+   {
+      /* Half at a time */
+      size_t chunka = sbuf->bufsz - end,
+             chunkb = len - chunka;
+      memcpy(sbuf->data + end, buf, chunka);
+      memcpy(sbuf->data, (const unsigned char *) buf + chunka, chunkb);
+      end = chunkb;
+   }
+   else
+   {
+      memcpy(sbuf->data + end, buf, len);
+      end += len;
+      if (end >= sbuf->bufsz)
+         end = 0;
+   }
+
+   NETPLAY_STORE(sbuf->end, end);
+   return len;
+}
+
+/* Queue everything through the network thread, waiting for it to make room
+ * unless nowait is set */
+static bool buf_send_threaded(struct socket_buffer *sbuf, const void *buf,
+   size_t len, bool nowait)
+{
+   const unsigned char *cbuf = (const unsigned char*)buf;
+
+   if (nowait && buf_remaining(sbuf) < len)
+      return false;
+
+   while (len)
+   {
+      uint32_t progress = netplay_io_progress(sbuf->io);
+      size_t queued;
+
+      if (NETPLAY_LOAD(sbuf->error))
+         return false;
+
+      queued = buf_queue(sbuf, cbuf, len);
+      cbuf  += queued;
+      len   -= queued;
+
+      if (len)
+      {
+         netplay_io_kick(sbuf->io);
+         netplay_io_wait(sbuf->io, progress, RETRY_MS * 1000);
+      }
+   }
+
+   return true;
+}
+
 /**
  * netplay_send
  *
@@ -127,6 +189,9 @@ void netplay_clear_socket_buffer(struct socket_buffer *sbuf)
 bool netplay_send(struct socket_buffer *sbuf, int sockfd, const void *buf,
    size_t len)
 {
+   if (sbuf->io)
+      return buf_send_threaded(sbuf, buf, len, false);
+
    if (buf_remaining(sbuf) < len)
    {
       /* Need to force a blocking send */
@@ -165,6 +230,20 @@ bool netplay_send(struct socket_buffer *sbuf, int sockfd, const void *buf,
    return true;
 }
 
+/**
+ * netplay_send_nowait
+ *
+ * Queue the given data for sending, failing instead of waiting if the
+ * network thread hasn't made room for it.
+ */
+bool netplay_send_nowait(struct socket_buffer *sbuf, int sockfd,
+   const void *buf, size_t len)
+{
+   if (sbuf->io)
+      return buf_send_threaded(sbuf, buf, len, true);
+   return netplay_send(sbuf, sockfd, buf, len);
+}
+
 /**
  * netplay_send_flush
  *
@@ -177,6 +256,23 @@ bool netplay_send_flush(struct socket_buffer *sbuf, int sockfd, bool block)
 {
    ssize_t sent;
 
+   if (sbuf->io)
+   {
+      if (buf_used(sbuf))
+         netplay_io_kick(sbuf->io);
+
+      while (block && buf_used(sbuf))
+      {
+         uint32_t progress = netplay_io_progress(sbuf->io);
+         if (NETPLAY_LOAD(sbuf->error))
+            break;
+         if (buf_used(sbuf))
+            netplay_io_wait(sbuf->io, progress, RETRY_MS * 1000);
+      }
+
+      return !NETPLAY_LOAD(sbuf->error);
+   }
+
    if (buf_used(sbuf) == 0)
       return true;
 
@@ -235,88 +331,136 @@ bool netplay_send_flush(struct socket_buffer *sbuf, int sockfd, bool block)
    return true;
 }
 
-/**
- * netplay_recv
- *
- * Receive buffered or fresh data.
- *
- * Returns number of bytes returned, which may be short or 0, or -1 on error.
- */
-ssize_t netplay_recv(struct socket_buffer *sbuf, int sockfd, void *buf,
-   size_t len, bool block)
+/* Receive up to len bytes without blocking. A zero-length recv would read
+ * as the peer hanging up, so an empty span isn't asked for at all. */
+static bool buf_recv(int sockfd, unsigned char *data, size_t len,
+   size_t *recvd)
 {
-   bool error;
-   ssize_t recvd;
+   bool error = false;
+   ssize_t ret;
 
-   /* Receive whatever we can into the buffer */
-   if (sbuf->end >= sbuf->start)
+   *recvd = 0;
+   if (!len)
+      return true;
+
+   ret = socket_receive_all_nonblocking(sockfd, &error, data, len);
+   if (ret < 0 || error)
+      return false;
+
+   *recvd = (size_t)ret;
+   return true;
+}
+
+/* Receive whatever fits into the free space of the buffer */
+static bool buf_fill(struct socket_buffer *sbuf, int sockfd)
+{
+   size_t recvd;
+   size_t start = NETPLAY_LOAD(sbuf->start);
+   size_t end   = sbuf->end;
+
+   if (end >= start)
    {
-      error = false;
-      recvd = socket_receive_all_nonblocking(sockfd, &error,
-         sbuf->data + sbuf->end, sbuf->bufsz - sbuf->end -
-         ((sbuf->start == 0) ? 1 : 0));
-      if (recvd < 0 || error)
-         return -1;
-      sbuf->end += recvd;
-      if (sbuf->end >= sbuf->bufsz)
+      if (!buf_recv(sockfd, sbuf->data + end,
+            sbuf->bufsz - end - ((start == 0) ? 1 : 0), &recvd))
+         return false;
+      end += recvd;
+      if (end >= sbuf->bufsz)
       {
-         sbuf->end = 0;
-         error = false;
-         recvd = socket_receive_all_nonblocking(sockfd, &error, sbuf->data, sbuf->start - 1);
-         if (recvd < 0 || error)
-            return -1;
-         sbuf->end += recvd;
-
+         end = 0;
+         if (!buf_recv(sockfd, sbuf->data, start - 1, &recvd))
+         {
+            NETPLAY_STORE(sbuf->end, end);
+            return false;
+         }
+         end += recvd;
       }
-
    }
    else
    {
-      error = false;
-      recvd = socket_receive_all_nonblocking(sockfd, &error, sbuf->data + sbuf->end, sbuf->start - sbuf->end - 1);
-      if (recvd < 0 || error)
-         return -1;
-      sbuf->end += recvd;
-
+      if (!buf_recv(sockfd, sbuf->data + end, start - end - 1, &recvd))
+         return false;
+      end += recvd;
    }
 
-   /* Now copy it into the reader */
-   if (sbuf->end >= sbuf->read || (sbuf->bufsz - sbuf->read) >= len)
-   {
-      size_t unread = buf_unread(sbuf);
-      if (len <= unread)
-      {
-         memcpy(buf, sbuf->data + sbuf->read, len);
-         sbuf->read += len;
-         if (sbuf->read >= sbuf->bufsz)
-            sbuf->read = 0;
-         recvd = len;
-
-      }
-      else
-      {
-         memcpy(buf, sbuf->data + sbuf->read, unread);
-         sbuf->read += unread;
-         if (sbuf->read >= sbuf->bufsz)
-            sbuf->read = 0;
-         recvd = unread;
+   NETPLAY_STORE(sbuf->end, end);
+   return true;
+}
 
-      }
+/* Copy up to len received bytes out to the reader */
+static size_t buf_take(struct socket_buffer *sbuf, void *buf, size_t len)
+{
+   size_t recvd;
+   size_t end = NETPLAY_LOAD(sbuf->end);
 
+   if (end >= sbuf->read || (sbuf->bufsz - sbuf->read) >= len)
+   {
+      size_t unread = buf_unread(sbuf, end);
+      if (len > unread)
+         len = unread;
+      memcpy(buf, sbuf->data + sbuf->read, len);
+      sbuf->read += len;
+      if (sbuf->read >= sbuf->bufsz)
+         sbuf->read = 0;
+      recvd = len;
    }
    else
    {
       /* Our read goes around the edge */
       size_t chunka = sbuf->bufsz - sbuf->read,
              pchunklen = len - chunka,
-             chunkb = (pchunklen >= sbuf->end) ? sbuf->end : pchunklen;
+             chunkb = (pchunklen >= end) ? end : pchunklen;
       memcpy(buf, sbuf->data + sbuf->read, chunka);
       memcpy((unsigned char *) buf + chunka, sbuf->data, chunkb);
       sbuf->read = chunkb;
       recvd = chunka + chunkb;
+   }
+
+   return recvd;
+}
+
+/**
+ * netplay_recv
+ *
+ * Receive buffered or fresh data.
+ *
+ * Returns number of bytes returned, which may be short or 0, or -1 on error.
+ */
+ssize_t netplay_recv(struct socket_buffer *sbuf, int sockfd, void *buf,
+   size_t len, bool block)
+{
+   ssize_t recvd;
 
+   if (sbuf->io)
+   {
+      /* The network thread has already received what there is */
+      recvd = buf_take(sbuf, buf, len);
+
+      while (block && (size_t) recvd < len)
+      {
+         uint32_t progress = netplay_io_progress(sbuf->io);
+         recvd += buf_take(sbuf, (unsigned char *) buf + recvd, len - recvd);
+         if ((size_t) recvd == len)
+            break;
+         if (NETPLAY_LOAD(sbuf->error))
+            return -1;
+         netplay_io_wait(sbuf->io, progress, RETRY_MS * 1000);
+      }
+
+      if (block)
+         netplay_recv_flush(sbuf);
+
+      if (recvd == 0 && NETPLAY_LOAD(sbuf->error))
+         return -1;
+      return recvd;
    }
 
+   /* Receive whatever we can into the buffer */
+   if (!buf_fill(sbuf, sockfd))
+      return -1;
+
+   /* Now copy it into the reader */
+   recvd = buf_take(sbuf, buf, len);
+
    /* Perhaps block for more data */
    if (block)
    {
@@ -352,5 +496,84 @@ void netplay_recv_reset(struct socket_buffer *sbuf)
  */
 void netplay_recv_flush(struct socket_buffer *sbuf)
 {
-   sbuf->start = sbuf->read;
+   NETPLAY_STORE(sbuf->start, sbuf->read);
+
+   /* The network thread may be waiting for us to make room */
+   if (sbuf->io && NETPLAY_LOAD(sbuf->full))
+      netplay_io_kick(sbuf->io);
+}
+
+/**
+ * netplay_buf_fill
+ *
+ * Network thread: receive into the free space of a recv buffer.
+ *
+ * Returns false on socket failures. Sets *full if there's no space left.
+ */
+bool netplay_buf_fill(struct socket_buffer *sbuf, int sockfd, bool *full)
+{
+   bool ret = true;
+
+   if (buf_remaining(sbuf))
+      ret = buf_fill(sbuf, sockfd);
+   *full    = netplay_buf_full(sbuf);
+   return ret;
+}
+
+/**
+ * netplay_buf_full
+ *
+ * Network thread: whether a recv buffer has no free space left.
+ */
+bool netplay_buf_full(struct socket_buffer *sbuf)
+{
+   return buf_remaining(sbuf) == 0;
+}
+
+/**
+ * netplay_buf_drain
+ *
+ * Network thread: send what's queued in a send buffer.
+ *
+ * Returns false on socket failures. Sets *pending if data is left over.
+ */
+bool netplay_buf_drain(struct socket_buffer *sbuf, int sockfd, bool *pending)
+{
+   ssize_t sent;
+   size_t start = sbuf->start;
+   size_t end   = NETPLAY_LOAD(sbuf->end);
+
+   *pending = false;
+
+   if (start == end)
+      return true;
+
+   if (end < start)
+   {
+      /* Up to the edge first */
+      sent = socket_send_all_nonblocking(sockfd, sbuf->data + start,
+            sbuf->bufsz - start, true);
+      if (sent < 0)
+         return false;
+      start += sent;
+      if (start < sbuf->bufsz)
+      {
+         NETPLAY_STORE(sbuf->start, start);
+         *pending = true;
+         return true;
+      }
+      start = 0;
+   }
+
+   sent = socket_send_all_nonblocking(sockfd, sbuf->data + start,
+         end - start, true);
+   if (sent < 0)
+   {
+      NETPLAY_STORE(sbuf->start, start);
+      return false;
+   }
+   start += sent;
+   NETPLAY_STORE(sbuf->start, start);
+   *pending = (start != end);
+   return true;
 }
@@ -16,9 +16,11 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <sys/types.h>
 
 #include <boolean.h>
+#include <memalign.h>
 #include <encodings/crc32.h>
 
 #include "netplay_private.h"
@@ -57,6 +59,7 @@ bool netplay_delta_frame_ready(netplay_t *netplay, struct delta_frame *delta,
    delta->used = true;
    delta->frame = frame;
    delta->crc = 0;
+   delta->stale_state = false;
    for (i = 0; i < MAX_INPUT_DEVICES; i++)
    {
       clear_input(delta->resolved_input[i]);
@@ -81,8 +84,127 @@ uint32_t netplay_delta_frame_crc(netplay_t *netplay, struct delta_frame *delta)
    return encoding_crc32(0L, (const unsigned char*)delta->state, netplay->state_size);
 }
 
+static size_t netplay_delta_block_size(size_t state_size, size_t block)
+{
+   size_t offset = block * NETPLAY_DELTA_BLOCK_SIZE;
+   size_t size   = state_size - offset;
+   return size < NETPLAY_DELTA_BLOCK_SIZE ? size : NETPLAY_DELTA_BLOCK_SIZE;
+}
+
+/**
+ * netplay_delta_hash_blocks
+ *
+ * Hash each block of a savestate for NETPLAY_COMPRESSION_DELTA.
+ */
+void netplay_delta_hash_blocks(size_t state_size, const uint8_t *state,
+      uint32_t *hashes)
+{
+   size_t b;
+   size_t blocks = NETPLAY_DELTA_BLOCKS(state_size);
+
+   for (b = 0; b < blocks; b++)
+      hashes[b] = encoding_crc32(0, state + b * NETPLAY_DELTA_BLOCK_SIZE,
+            netplay_delta_block_size(state_size, b));
+}
+
+/**
+ * netplay_delta_encode_blocks
+ *
+ * Gather, in order, the blocks of a savestate whose hashes differ from the
+ * base's, and set their bits in the bitmap (in host order).
+ *
+ * Returns: the number of bytes gathered.
+ */
+size_t netplay_delta_encode_blocks(size_t state_size, const uint8_t *state,
+      const uint32_t *hashes, const uint32_t *base_hashes,
+      uint32_t *bitmap, uint8_t *blocks)
+{
+   size_t b;
+   size_t len      = 0;
+   size_t nblocks  = NETPLAY_DELTA_BLOCKS(state_size);
+
+   memset(bitmap, 0, NETPLAY_DELTA_BITMAP_WORDS(nblocks) * sizeof(uint32_t));
+
+   for (b = 0; b < nblocks; b++)
+   {
+      size_t size;
+
+      if (hashes[b] == base_hashes[b])
+         continue;
+
+      size = netplay_delta_block_size(state_size, b);
+      memcpy(blocks + len, state + b * NETPLAY_DELTA_BLOCK_SIZE, size);
+      len            += size;
+      bitmap[b / 32] |= 1U << (b % 32);
+   }
+
+   return len;
+}
+
+/**
+ * netplay_delta_decode_blocks
+ *
+ * Rebuild a savestate from blocks gathered by netplay_delta_encode_blocks,
+ * taking every block not in the bitmap from the base. The state and the base
+ * may be the same buffer.
+ *
+ * Returns: false if there were fewer bytes than the bitmap calls for. The
+ * missing blocks are taken from the base.
+ */
+bool netplay_delta_decode_blocks(size_t state_size, uint8_t *state,
+      const uint8_t *base, const uint32_t *bitmap,
+      const uint8_t *blocks, size_t len)
+{
+   size_t b;
+   size_t used     = 0;
+   size_t nblocks  = NETPLAY_DELTA_BLOCKS(state_size);
+   bool complete   = true;
+
+   for (b = 0; b < nblocks; b++)
+   {
+      size_t offset = b * NETPLAY_DELTA_BLOCK_SIZE;
+      size_t size   = netplay_delta_block_size(state_size, b);
+
+      if (bitmap[b / 32] & (1U << (b % 32)))
+      {
+         if (used + size <= len)
+         {
+            memcpy(state + offset, blocks + used, size);
+            used += size;
+            continue;
+         }
+         complete = false;
+      }
+
+      if (state != base)
+         memcpy(state + offset, base + offset, size);
+   }
+
+   return complete;
+}
+
+/**
+ * netplay_replay_needs_state
+ *
+ * Whether a replayed frame's state must be serialized. Frames before
+ * unread_frame_count have all their input and can't be rolled back to again,
+ * so with the replay fast path they only need a state for CRC checks.
+ */
+bool netplay_replay_needs_state(netplay_t *netplay, struct delta_frame *delta)
+{
+   if (!netplay->replay_fast_path ||
+       delta->frame >= netplay->unread_frame_count)
+      return true;
+
+   if (netplay->is_server)
+      return netplay->check_frames &&
+         delta->frame % abs(netplay->check_frames) == 0;
+
+   return delta->crc && netplay->crcs_valid;
+}
+
 /*
- * Free an input state list
+ * Free an input state list. Pooled states go back with the pool.
  */
 static void free_input_state(netplay_input_state_t *list)
 {
@@ -91,7 +213,8 @@ static void free_input_state(netplay_input_state_t *list)
    while (cur)
    {
       next = cur->next;
-      free(cur);
+      if (!cur->pooled)
+         free(cur);
       cur = next;
    }
    *list = NULL;
@@ -106,11 +229,8 @@ void netplay_delta_frame_free(struct delta_frame *delta)
 {
    uint32_t i;
 
-   if (delta->state)
-   {
-      free(delta->state);
-      delta->state = NULL;
-   }
+   /* The state itself lives in netplay->state_block */
+   delta->state = NULL;
 
    for (i = 0; i < MAX_INPUT_DEVICES; i++)
    {
@@ -120,22 +240,110 @@ void netplay_delta_frame_free(struct delta_frame *delta)
    }
 }
 
+#define INPUT_STATE_STRIDE \
+   ((sizeof(struct netplay_input_state) + \
+     (NETPLAY_INPUT_STATE_WORDS-1) * sizeof(uint32_t) + \
+     sizeof(void*) - 1) & ~(sizeof(void*) - 1))
+
+static struct netplay_input_chunk *input_chunk_new(size_t count)
+{
+   struct netplay_input_chunk *chunk = (struct netplay_input_chunk*)
+      calloc(1, sizeof(*chunk));
+   if (!chunk)
+      return NULL;
+
+   chunk->data = (uint8_t*)memalign_alloc(NETPLAY_FRAME_ALIGN,
+         count * INPUT_STATE_STRIDE);
+   if (!chunk->data)
+   {
+      free(chunk);
+      return NULL;
+   }
+   chunk->count = count;
+   return chunk;
+}
+
+/**
+ * netplay_input_pool_init
+ *
+ * Preallocate the input state pool for the frame buffer.
+ */
+bool netplay_input_pool_init(netplay_t *netplay)
+{
+   if (netplay->input_pool)
+      return true;
+   netplay->input_pool = input_chunk_new(
+         netplay->buffer_size * NETPLAY_INPUT_POOL_PER_FRAME);
+   return netplay->input_pool != NULL;
+}
+
+/**
+ * netplay_input_pool_free
+ *
+ * Free the input state pool. Delta frames must be freed first.
+ */
+void netplay_input_pool_free(netplay_t *netplay)
+{
+   struct netplay_input_chunk *chunk = netplay->input_pool;
+   while (chunk)
+   {
+      struct netplay_input_chunk *next = chunk->next;
+      memalign_free(chunk->data);
+      free(chunk);
+      chunk = next;
+   }
+   netplay->input_pool = NULL;
+}
+
+/* Take a zeroed input state from the pool, growing it by another chunk if
+ * it's run dry. Since states are reused in place, this only happens while
+ * the lists fill up, not every frame. */
+static netplay_input_state_t input_pool_get(netplay_t *netplay, size_t size)
+{
+   netplay_input_state_t ret;
+   struct netplay_input_chunk *chunk = netplay->input_pool;
+
+   if (size > NETPLAY_INPUT_STATE_WORDS)
+      return (netplay_input_state_t)calloc(1,
+            sizeof(struct netplay_input_state) + (size-1) * sizeof(uint32_t));
+
+   if (!chunk || chunk->used >= chunk->count)
+   {
+      chunk = input_chunk_new(netplay->buffer_size *
+            NETPLAY_INPUT_POOL_PER_FRAME);
+      if (!chunk)
+         return NULL;
+      chunk->next         = netplay->input_pool;
+      netplay->input_pool = chunk;
+   }
+
+   ret = (netplay_input_state_t)(chunk->data +
+         chunk->used++ * INPUT_STATE_STRIDE);
+   memset(ret, 0, INPUT_STATE_STRIDE);
+   ret->pooled = true;
+   return ret;
+}
+
 /**
  * netplay_input_state_for
  *
  * Get an input state for a particular client
  */
-netplay_input_state_t netplay_input_state_for(netplay_input_state_t *list,
-      uint32_t client_num, size_t size, bool must_create, bool must_not_create)
+netplay_input_state_t netplay_input_state_for(netplay_t *netplay,
+      netplay_input_state_t *list, uint32_t client_num, size_t size,
+      bool must_create, bool must_not_create)
 {
    netplay_input_state_t ret;
    while (*list)
    {
       ret = *list;
-      if (!ret->used && !must_not_create && ret->size == size)
+      if (!ret->used && !must_not_create &&
+          (ret->size == size ||
+           (ret->pooled && size <= NETPLAY_INPUT_STATE_WORDS)))
       {
          ret->client_num = client_num;
          ret->used = true;
+         ret->size = size;
          memset(ret->data, 0, size*sizeof(uint32_t));
          return ret;
       }
@@ -151,8 +359,8 @@ netplay_input_state_t netplay_input_state_for(netplay_input_state_t *list,
    if (must_not_create)
       return NULL;
 
-   /* Couldn't find a slot, allocate a fresh one */
-   ret = (netplay_input_state_t)calloc(1, sizeof(struct netplay_input_state) + (size-1) * sizeof(uint32_t));
+   /* Couldn't find a slot, take a fresh one */
+   ret = input_pool_get(netplay, size);
    if (!ret)
       return NULL;
    *list = ret;
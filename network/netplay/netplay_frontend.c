@@ -22,6 +22,7 @@
 
 #include <boolean.h>
 #include <compat/strl.h>
+#include <encodings/crc32.h>
 #include <retro_assert.h>
 #include <string/stdstring.h>
 #include <net/net_http.h>
@@ -147,7 +148,7 @@ static bool get_self_input_state(netplay_t *netplay)
          local_device = 0;
       used_devices |= (1<<local_device);
 
-      istate = netplay_input_state_for(&ptr->real_input[devi],
+      istate = netplay_input_state_for(netplay, &ptr->real_input[devi],
             /* If we're a slave, we write our own input to MAX_CLIENTS to keep it separate */
             (netplay->self_mode==NETPLAY_CONNECTION_SLAVE)?MAX_CLIENTS:netplay->self_client_num,
             netplay_expected_input_size(netplay, 1 << devi),
@@ -1100,6 +1101,426 @@ void netplay_send_savestate(netplay_t *netplay,
    }
 }
 
+static struct compression_transcoder *netplay_delta_transcoder(
+      netplay_t *netplay, struct netplay_connection *connection)
+{
+   if (connection->compression_supported & NETPLAY_COMPRESSION_ZLIB)
+      return &netplay->compress_zlib;
+   return &netplay->compress_nil;
+}
+
+/* Allocates the scratch space shared by all connections, all or nothing */
+static bool netplay_delta_init(netplay_t *netplay)
+{
+   size_t blocks = NETPLAY_DELTA_BLOCKS(netplay->state_size);
+   size_t words  = NETPLAY_DELTA_BITMAP_WORDS(blocks);
+   uint32_t *wire, *hashes, *frame_hashes;
+   uint8_t *data;
+
+   if (!netplay->state_size)
+      return false;
+
+   if (netplay->delta_wire)
+      return true;
+
+   wire         = (uint32_t*)malloc((blocks + words) * sizeof(uint32_t));
+   hashes       = (uint32_t*)malloc(blocks * sizeof(uint32_t));
+   frame_hashes = (uint32_t*)malloc(blocks * sizeof(uint32_t));
+   data         = (uint8_t*)malloc(netplay->state_size);
+   if (!wire || !hashes || !frame_hashes || !data)
+   {
+      free(wire);
+      free(hashes);
+      free(frame_hashes);
+      free(data);
+      return false;
+   }
+
+   netplay->delta_wire         = wire;
+   netplay->delta_hashes       = hashes;
+   netplay->delta_frame_hashes = frame_hashes;
+   netplay->delta_blocks       = data;
+   return true;
+}
+
+/**
+ * netplay_delta_connection_init
+ * @netplay              : pointer to netplay object
+ * @connection           : connection using NETPLAY_COMPRESSION_DELTA
+ *
+ * Allocates the state kept for block-level savestate transfers. Until a
+ * state has gone over, both sides take the other to hold an all-zero state.
+ *
+ * Returns: true on success, false if out of memory or serialization isn't
+ * ready yet.
+ **/
+bool netplay_delta_connection_init(netplay_t *netplay,
+      struct netplay_connection *connection)
+{
+   size_t blocks = NETPLAY_DELTA_BLOCKS(netplay->state_size);
+
+   if (!netplay_delta_init(netplay))
+      return false;
+
+   if (connection->delta_base)
+      return true;
+
+   connection->delta_peer_hashes = (uint32_t*)malloc(
+         blocks * sizeof(uint32_t));
+   connection->delta_base_hashes = (uint32_t*)malloc(
+         blocks * sizeof(uint32_t));
+   connection->delta_base        = (uint8_t*)calloc(netplay->state_size, 1);
+   if (!connection->delta_peer_hashes || !connection->delta_base_hashes ||
+       !connection->delta_base)
+   {
+      netplay_delta_connection_free(connection);
+      return false;
+   }
+
+   netplay_delta_hash_blocks(netplay->state_size, connection->delta_base,
+         connection->delta_base_hashes);
+   memcpy(connection->delta_peer_hashes, connection->delta_base_hashes,
+         blocks * sizeof(uint32_t));
+   connection->delta_sent     = 0;
+   connection->delta_received = 0;
+   connection->delta_reported = false;
+   return true;
+}
+
+/**
+ * netplay_delta_connection_free
+ * @connection           : connection
+ *
+ * Frees what netplay_delta_connection_init allocated.
+ **/
+void netplay_delta_connection_free(struct netplay_connection *connection)
+{
+   if (connection->delta_peer_hashes)
+      free(connection->delta_peer_hashes);
+   if (connection->delta_base_hashes)
+      free(connection->delta_base_hashes);
+   if (connection->delta_base)
+      free(connection->delta_base);
+   connection->delta_peer_hashes = NULL;
+   connection->delta_base_hashes = NULL;
+   connection->delta_base        = NULL;
+}
+
+/* The state we hold for a frame, if it's still in the buffer. States are
+ * saved as frames are run, so that excludes the frame we're about to run. */
+static const uint8_t *netplay_delta_frame_state(netplay_t *netplay,
+      uint32_t frame)
+{
+   size_t ptr;
+   struct delta_frame *delta;
+   uint32_t back = netplay->run_frame_count - frame;
+
+   if (frame >= netplay->run_frame_count || back >= netplay->buffer_size)
+      return NULL;
+
+   ptr   = (netplay->run_ptr + netplay->buffer_size - back) %
+      netplay->buffer_size;
+   delta = &netplay->buffer[ptr];
+   if (!delta->used || !delta->state || delta->stale_state ||
+       delta->frame != frame)
+      return NULL;
+
+   return (const uint8_t*)delta->state;
+}
+
+/**
+ * netplay_delta_hash_frame_base
+ * @netplay              : pointer to netplay object
+ *
+ * Hashes the blocks of the last synced frame's state, before a savestate
+ * load moves other_ptr. That frame has had all its input everywhere, so the
+ * receiver should hold the very same state, and a loaded savestate usually
+ * has a lot more in common with it than with the last one sent. When we're
+ * fully caught up, the synced frame hasn't been run yet, so it's the one
+ * before it.
+ */
+static void netplay_delta_hash_frame_base(netplay_t *netplay)
+{
+   size_t i;
+   const uint8_t *state;
+   bool wanted    = false;
+   uint32_t frame = netplay->other_frame_count;
+
+   netplay->delta_frame_valid = false;
+
+   for (i = 0; i < netplay->connections_size; i++)
+   {
+      struct netplay_connection *connection = &netplay->connections[i];
+      if (connection->active &&
+          connection->mode >= NETPLAY_CONNECTION_CONNECTED &&
+          (connection->compression_supported & NETPLAY_COMPRESSION_DELTA))
+         wanted = true;
+   }
+
+   if (!wanted)
+      return;
+
+   if (frame >= netplay->run_frame_count)
+      frame = netplay->run_frame_count - 1;
+
+   state = netplay_delta_frame_state(netplay, frame);
+   if (!state || !netplay_delta_init(netplay))
+      return;
+
+   netplay_delta_hash_blocks(netplay->state_size, state,
+         netplay->delta_frame_hashes);
+   netplay->delta_frame_count = frame;
+   netplay->delta_frame_valid = true;
+}
+
+static size_t netplay_delta_count_changed(size_t blocks,
+      const uint32_t *hashes, const uint32_t *base_hashes)
+{
+   size_t b, changed = 0;
+   for (b = 0; b < blocks; b++)
+      if (hashes[b] != base_hashes[b])
+         changed++;
+   return changed;
+}
+
+/**
+ * netplay_send_savestate_delta
+ * @netplay              : pointer to netplay object
+ * @serial_info          : the savestate being loaded
+ *
+ * Send a loaded savestate to those connected peers using block-level
+ * transfers. Every block hash goes along, but only the blocks that differ
+ * from the base are compressed and sent. The base is whichever needs fewer
+ * blocks of the synced frame hashed by netplay_delta_hash_frame_base and the
+ * last state this peer rebuilt, unless the peer has just reported what it
+ * holds, which is then used as is.
+ */
+static void netplay_send_savestate_delta(netplay_t *netplay,
+      retro_ctx_serialize_info_t *serial_info)
+{
+   size_t i, b;
+   const uint8_t *state = (const uint8_t*)serial_info->data_const;
+   size_t blocks        = NETPLAY_DELTA_BLOCKS(netplay->state_size);
+   size_t words         = NETPLAY_DELTA_BITMAP_WORDS(blocks);
+   bool hashed          = false;
+
+   /* The receiver only accepts states of its own size */
+   if (serial_info->size != netplay->state_size)
+      return;
+
+   for (i = 0; i < netplay->connections_size; i++)
+   {
+      uint32_t header[6];
+      uint32_t rd, wn;
+      uint32_t *bitmap;
+      uint32_t base_frame;
+      const uint32_t *base_hashes;
+      size_t len = 0;
+      struct compression_transcoder *z;
+      struct netplay_connection *connection = &netplay->connections[i];
+
+      if (!connection->active ||
+          connection->mode < NETPLAY_CONNECTION_CONNECTED ||
+          !(connection->compression_supported & NETPLAY_COMPRESSION_DELTA))
+         continue;
+
+      if (!netplay_delta_connection_init(netplay, connection))
+      {
+         netplay_hangup(netplay, connection);
+         continue;
+      }
+
+      /* The hashes are the same for everyone */
+      if (!hashed)
+      {
+         netplay_delta_hash_blocks(netplay->state_size, state,
+               netplay->delta_hashes);
+         for (b = 0; b < blocks; b++)
+            netplay->delta_wire[b] = htonl(netplay->delta_hashes[b]);
+         hashed = true;
+      }
+
+      base_frame  = NETPLAY_DELTA_BASE_PREVIOUS;
+      base_hashes = connection->delta_peer_hashes;
+      if (!connection->delta_reported && netplay->delta_frame_valid &&
+          netplay_delta_count_changed(blocks, netplay->delta_hashes,
+             netplay->delta_frame_hashes) <
+          netplay_delta_count_changed(blocks, netplay->delta_hashes,
+             connection->delta_peer_hashes))
+      {
+         base_frame  = netplay->delta_frame_count;
+         base_hashes = netplay->delta_frame_hashes;
+      }
+
+      /* Gather the blocks this peer doesn't hold */
+      bitmap = netplay->delta_wire + blocks;
+      len    = netplay_delta_encode_blocks(netplay->state_size, state,
+            netplay->delta_hashes, base_hashes, bitmap, netplay->delta_blocks);
+      for (b = 0; b < words; b++)
+         bitmap[b] = htonl(bitmap[b]);
+
+      /* Compress them */
+      z = netplay_delta_transcoder(netplay, connection);
+      z->compression_backend->set_in(z->compression_stream,
+         netplay->delta_blocks, (uint32_t)len);
+      z->compression_backend->set_out(z->compression_stream,
+         netplay->zbuffer, (uint32_t)netplay->zbuffer_size);
+      if (!z->compression_backend->trans(z->compression_stream, true, &rd,
+            &wn, NULL))
+      {
+         netplay_hangup(netplay, connection);
+         continue;
+      }
+
+      header[0] = htonl(NETPLAY_CMD_LOAD_SAVESTATE_DELTA);
+      header[1] = htonl(4*sizeof(uint32_t) +
+            (blocks + words) * sizeof(uint32_t) + wn);
+      header[2] = htonl(netplay->run_frame_count);
+      header[3] = htonl(serial_info->size);
+      header[4] = htonl(NETPLAY_DELTA_BLOCK_SIZE);
+      header[5] = htonl(base_frame);
+
+      if (!netplay_send(&connection->send_packet_buffer, connection->fd, header,
+            sizeof(header)) ||
+          !netplay_send(&connection->send_packet_buffer, connection->fd,
+            netplay->delta_wire, (blocks + words) * sizeof(uint32_t)) ||
+          !netplay_send(&connection->send_packet_buffer, connection->fd,
+            netplay->zbuffer, wn))
+      {
+         netplay_hangup(netplay, connection);
+         continue;
+      }
+
+      /* From here on the peer builds on this state */
+      memcpy(connection->delta_peer_hashes, netplay->delta_hashes,
+            blocks * sizeof(uint32_t));
+      connection->delta_sent++;
+      connection->delta_reported = false;
+   }
+}
+
+/**
+ * netplay_recv_savestate_delta
+ * @netplay              : pointer to netplay object
+ * @connection           : connection the state came from
+ * @state                : buffer to rebuild the state in
+ * @base_frame           : frame whose state the delta is against, or
+ *                         NETPLAY_DELTA_BASE_PREVIOUS
+ * @zlen                 : length of the compressed blocks in zbuffer
+ *
+ * Rebuilds a LOAD_SAVESTATE_DELTA from the block hashes and bitmap in
+ * delta_wire, the compressed blocks in zbuffer and the base: our state for
+ * base_frame, or the last state received from this connection. If the
+ * result doesn't match the hashes, the blocks we do hold are reported back
+ * and a fresh savestate is requested.
+ *
+ * Returns: true if the state was rebuilt and can be loaded.
+ **/
+bool netplay_recv_savestate_delta(netplay_t *netplay,
+      struct netplay_connection *connection, uint8_t *state,
+      uint32_t base_frame, uint32_t zlen)
+{
+   size_t b;
+   uint32_t rd, wn;
+   uint32_t header[3];
+   bool ok                       = true;
+   size_t blocks                 = NETPLAY_DELTA_BLOCKS(netplay->state_size);
+   uint32_t *bitmap              = netplay->delta_wire + blocks;
+   const uint8_t *base           = connection->delta_base;
+   struct compression_transcoder *z =
+      netplay_delta_transcoder(netplay, connection);
+
+   if (base_frame != NETPLAY_DELTA_BASE_PREVIOUS)
+   {
+      base = netplay_delta_frame_state(netplay, base_frame);
+
+      /* Rebuilding on what we have will fail the hashes, and get the
+       * blocks we're missing sent */
+      if (!base)
+      {
+         RARCH_WARN("CMD_LOAD_SAVESTATE_DELTA is based on frame %u, which we don't hold.\n",
+               base_frame);
+         base = connection->delta_base;
+      }
+   }
+
+   z->decompression_backend->set_in(z->decompression_stream,
+      netplay->zbuffer, zlen);
+   z->decompression_backend->set_out(z->decompression_stream,
+      netplay->delta_blocks, (uint32_t)netplay->state_size);
+   if (!z->decompression_backend->trans(z->decompression_stream, true,
+         &rd, &wn, NULL))
+      wn = 0;
+
+   for (b = 0; b < blocks; b++)
+      netplay->delta_hashes[b] = ntohl(netplay->delta_wire[b]);
+   for (b = 0; b < NETPLAY_DELTA_BITMAP_WORDS(blocks); b++)
+      bitmap[b] = ntohl(bitmap[b]);
+
+   netplay_delta_decode_blocks(netplay->state_size, state, base, bitmap,
+         netplay->delta_blocks, wn);
+
+   /* Whatever we ended up with is what the next delta builds on */
+   memcpy(connection->delta_base, state, netplay->state_size);
+   netplay_delta_hash_blocks(netplay->state_size, state,
+         connection->delta_base_hashes);
+   connection->delta_received++;
+
+   for (b = 0; b < blocks && ok; b++)
+      ok = connection->delta_base_hashes[b] == netplay->delta_hashes[b];
+
+   if (ok)
+      return true;
+
+   RARCH_ERR("CMD_LOAD_SAVESTATE_DELTA did not match the blocks we hold, requesting a savestate.\n");
+
+   /* Tell the peer what we have, so its next savestate builds on that */
+   header[0] = htonl(NETPLAY_CMD_SAVESTATE_BLOCKS);
+   header[1] = htonl((1 + blocks) * sizeof(uint32_t));
+   header[2] = htonl(connection->delta_received);
+   for (b = 0; b < blocks; b++)
+      netplay->delta_wire[b] = htonl(connection->delta_base_hashes[b]);
+
+   if (!netplay_send(&connection->send_packet_buffer, connection->fd, header,
+         sizeof(header)) ||
+       !netplay_send(&connection->send_packet_buffer, connection->fd,
+         netplay->delta_wire, blocks * sizeof(uint32_t)))
+   {
+      netplay_hangup(netplay, connection);
+      return false;
+   }
+
+   /* This may have been the answer to an earlier request */
+   netplay->savestate_request_outstanding = false;
+   netplay_cmd_request_savestate(netplay);
+   return false;
+}
+
+/**
+ * netplay_recv_savestate_blocks
+ * @netplay              : pointer to netplay object
+ * @connection           : connection the report came from
+ * @count                : number of states the peer had received
+ *
+ * Takes the block hashes in delta_wire, reported by the peer through
+ * SAVESTATE_BLOCKS, as what it holds, unless we have sent it states since.
+ * The next state sent to it is diffed against them.
+ **/
+void netplay_recv_savestate_blocks(netplay_t *netplay,
+      struct netplay_connection *connection, uint32_t count)
+{
+   size_t b;
+   size_t blocks = NETPLAY_DELTA_BLOCKS(netplay->state_size);
+
+   /* A state still on its way will fail too and be reported again */
+   if (count != connection->delta_sent)
+      return;
+
+   for (b = 0; b < blocks; b++)
+      connection->delta_peer_hashes[b] = ntohl(netplay->delta_wire[b]);
+   connection->delta_reported = true;
+}
+
 /**
  * netplay_load_savestate
  * @netplay              : pointer to netplay object
@@ -1115,6 +1536,9 @@ void netplay_load_savestate(netplay_t *netplay,
 {
    retro_ctx_serialize_info_t tmp_serial_info;
 
+   /* Before the synced frame moves, and the loaded state may overwrite it */
+   netplay_delta_hash_frame_base(netplay);
+
    netplay_force_future(netplay);
 
    /* Record it in our own buffer */
@@ -1164,6 +1588,7 @@ void netplay_load_savestate(netplay_t *netplay,
    if (netplay->compress_zlib.compression_backend)
       netplay_send_savestate(netplay, serial_info, NETPLAY_COMPRESSION_ZLIB,
          &netplay->compress_zlib);
+   netplay_send_savestate_delta(netplay, serial_info);
 }
 
 /**
@@ -1367,6 +1792,7 @@ bool init_netplay(void *direct_host, const char *server, unsigned port)
             : server_port_deferred   ) : (port != 0 ? port : RARCH_DEFAULT_PORT),
          settings->bools.netplay_stateless_mode,
          settings->ints.netplay_check_frames,
+         settings->bools.netplay_replay_fast_path,
          &cbs,
          settings->bools.netplay_nat_traversal,
          settings->paths.username,
@@ -395,6 +395,10 @@ bool netplay_handshake_init(netplay_t *netplay,
       connection->compression_supported = 0;
    }
 
+   /* Block-level savestates go through whichever transcoder we picked */
+   if (compression & NETPLAY_COMPRESSION_DELTA)
+      connection->compression_supported |= NETPLAY_COMPRESSION_DELTA;
+
    if (!ctrans->decompression_backend)
       ctrans->decompression_backend = ctrans->compression_backend->reverse;
 
@@ -21,9 +21,11 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/types.h>
 
 #include <boolean.h>
+#include <memalign.h>
 #include <compat/strl.h>
 
 #include "netplay_private.h"
@@ -241,9 +243,11 @@ static bool netplay_init_socket_buffers(netplay_t *netplay)
    size_t i;
    size_t packet_buffer_size = netplay->zbuffer_size +
       NETPLAY_MAX_STALL_FRAMES * 16;
+   bool ret                  = true;
    netplay->packet_buffer_size = packet_buffer_size;
 
-   for (i = 0; i < netplay->connections_size; i++)
+   netplay_io_lock(netplay);
+   for (i = 0; i < netplay->connections_size && ret; i++)
    {
       struct netplay_connection *connection = &netplay->connections[i];
       if (connection->active)
@@ -254,7 +258,7 @@ static bool netplay_init_socket_buffers(netplay_t *netplay)
                   packet_buffer_size) ||
                 !netplay_resize_socket_buffer(&connection->recv_packet_buffer,
                   packet_buffer_size))
-               return false;
+               ret = false;
          }
          else
          {
@@ -262,12 +266,13 @@ static bool netplay_init_socket_buffers(netplay_t *netplay)
                   packet_buffer_size) ||
                 !netplay_init_socket_buffer(&connection->recv_packet_buffer,
                   packet_buffer_size))
-               return false;
+               ret = false;
          }
       }
    }
+   netplay_io_unlock(netplay);
 
-   return true;
+   return ret;
 }
 
 bool netplay_init_serialization(netplay_t *netplay)
@@ -285,17 +290,26 @@ bool netplay_init_serialization(netplay_t *netplay)
 
    netplay->state_size = info.size;
 
-   for (i = 0; i < netplay->buffer_size; i++)
-   {
-      netplay->buffer[i].state = calloc(netplay->state_size, 1);
+   /* One block for the whole ring, so replays walk through memory in order
+    * and nothing is allocated per frame */
+   netplay->state_stride = (netplay->state_size + NETPLAY_FRAME_ALIGN - 1) &
+      ~((size_t)NETPLAY_FRAME_ALIGN - 1);
+   netplay->state_block  = (uint8_t*)memalign_alloc(NETPLAY_FRAME_ALIGN,
+         netplay->state_stride * netplay->buffer_size);
 
-      if (!netplay->buffer[i].state)
-      {
-         netplay->quirks |= NETPLAY_QUIRK_NO_SAVESTATES;
-         return false;
-      }
+   if (!netplay->state_block)
+   {
+      netplay->quirks |= NETPLAY_QUIRK_NO_SAVESTATES;
+      return false;
    }
 
+   memset(netplay->state_block, 0,
+         netplay->state_stride * netplay->buffer_size);
+
+   for (i = 0; i < netplay->buffer_size; i++)
+      netplay->buffer[i].state = netplay->state_block +
+         i * netplay->state_stride;
+
    netplay->zbuffer_size = netplay->state_size * 2;
    netplay->zbuffer = (uint8_t *) calloc(netplay->zbuffer_size, 1);
    if (!netplay->zbuffer)
@@ -384,14 +398,18 @@ static bool netplay_init_buffers(netplay_t *netplay)
    if (netplay->is_server)
       netplay->buffer_size *= 2;
 
-   delta_frames = (struct delta_frame*)calloc(netplay->buffer_size,
-         sizeof(*delta_frames));
+   delta_frames = (struct delta_frame*)memalign_alloc(NETPLAY_FRAME_ALIGN,
+         netplay->buffer_size * sizeof(*delta_frames));
 
    if (!delta_frames)
       return false;
 
+   memset(delta_frames, 0, netplay->buffer_size * sizeof(*delta_frames));
    netplay->buffer = delta_frames;
 
+   if (!netplay_input_pool_init(netplay))
+      return false;
+
    if (!(netplay->quirks & (NETPLAY_QUIRK_NO_SAVESTATES|NETPLAY_QUIRK_INITIALIZATION)))
       netplay_init_serialization(netplay);
 
@@ -405,6 +423,8 @@ static bool netplay_init_buffers(netplay_t *netplay)
  * @port                 : Port of server.
  * @stateless_mode       : Shall we use stateless mode?
  * @check_frames         : Frequency with which to check CRCs.
+ * @replay_fast_path     : Skip states of replayed frames that can't be
+ *                         rolled back to again.
  * @cb                   : Libretro callbacks.
  * @nat_traversal        : If true, attempt NAT traversal.
  * @nick                 : Nickname of user.
@@ -416,7 +436,7 @@ static bool netplay_init_buffers(netplay_t *netplay)
  * Returns: new netplay data.
  */
 netplay_t *netplay_new(void *direct_host, const char *server, uint16_t port,
-   bool stateless_mode, int check_frames,
+   bool stateless_mode, int check_frames, bool replay_fast_path,
    const struct retro_callbacks *cb, bool nat_traversal, const char *nick,
    uint64_t quirks)
 {
@@ -434,6 +454,7 @@ netplay_t *netplay_new(void *direct_host, const char *server, uint16_t port,
    netplay->check_frames         = check_frames;
    netplay->crc_validity_checked = false;
    netplay->crcs_valid           = true;
+   netplay->replay_fast_path     = replay_fast_path;
    netplay->quirks               = quirks;
    netplay->self_mode            = netplay->is_server ?
                                 NETPLAY_CONNECTION_SPECTATING :
@@ -506,6 +527,10 @@ netplay_t *netplay_new(void *direct_host, const char *server, uint16_t port,
          goto error;
    }
 
+   /* Hand the sockets over to a network thread if we can */
+   if (netplay_io_init(netplay) && !netplay->is_server)
+      netplay_io_attach(netplay, &netplay->connections[0]);
+
    return netplay;
 
 error:
@@ -537,12 +562,16 @@ void netplay_free(netplay_t *netplay)
       struct netplay_connection *connection = &netplay->connections[i];
       if (connection->active)
       {
+         netplay_io_detach(netplay, connection);
          socket_close(connection->fd);
          netplay_deinit_socket_buffer(&connection->send_packet_buffer);
          netplay_deinit_socket_buffer(&connection->recv_packet_buffer);
+         netplay_delta_connection_free(connection);
       }
    }
 
+   netplay_io_deinit(netplay);
+
    if (netplay->connections && netplay->connections != &netplay->one_connection)
       free(netplay->connections);
 
@@ -554,11 +583,24 @@ void netplay_free(netplay_t *netplay)
       for (i = 0; i < netplay->buffer_size; i++)
          netplay_delta_frame_free(&netplay->buffer[i]);
 
-      free(netplay->buffer);
+      memalign_free(netplay->buffer);
    }
 
+   netplay_input_pool_free(netplay);
+
+   if (netplay->state_block)
+      memalign_free(netplay->state_block);
+
    if (netplay->zbuffer)
       free(netplay->zbuffer);
+   if (netplay->delta_wire)
+      free(netplay->delta_wire);
+   if (netplay->delta_hashes)
+      free(netplay->delta_hashes);
+   if (netplay->delta_blocks)
+      free(netplay->delta_blocks);
+   if (netplay->delta_frame_hashes)
+      free(netplay->delta_frame_hashes);
 
    if (netplay->compress_nil.compression_stream)
    {
@@ -120,10 +120,12 @@ void netplay_hangup(netplay_t *netplay, struct netplay_connection *connection)
    RARCH_LOG("%s\n", dmsg);
    runloop_msg_queue_push(dmsg, 1, 180, false);
 
+   netplay_io_detach(netplay, connection);
    socket_close(connection->fd);
    connection->active = false;
    netplay_deinit_socket_buffer(&connection->send_packet_buffer);
    netplay_deinit_socket_buffer(&connection->recv_packet_buffer);
+   netplay_delta_connection_free(connection);
 
    if (!netplay->is_server)
    {
@@ -268,8 +270,19 @@ static bool send_input_frame(netplay_t *netplay, struct delta_frame *dframe,
              (connection->mode != NETPLAY_CONNECTION_PLAYING ||
               i+1 != client_num))
          {
-            if (!netplay_send(&connection->send_packet_buffer, connection->fd,
-                  buffer, bufused*sizeof(uint32_t)))
+            /* Nobody waits for a spectator who can't keep up */
+            if (connection->mode == NETPLAY_CONNECTION_SPECTATING)
+            {
+               if (!netplay_send_nowait(&connection->send_packet_buffer,
+                     connection->fd, buffer, bufused*sizeof(uint32_t)))
+               {
+                  RARCH_WARN("Netplay spectator %u is too far behind.\n",
+                        (unsigned) (i+1));
+                  netplay_hangup(netplay, connection);
+               }
+            }
+            else if (!netplay_send(&connection->send_packet_buffer,
+                  connection->fd, buffer, bufused*sizeof(uint32_t)))
                netplay_hangup(netplay, connection);
          }
       }
@@ -1021,7 +1034,7 @@ static bool netplay_get_cmd(netplay_t *netplay,
                   continue;
 
                dsize = netplay_expected_input_size(netplay, 1 << device);
-               istate = netplay_input_state_for(&dframe->real_input[device],
+               istate = netplay_input_state_for(netplay, &dframe->real_input[device],
                      client_num, dsize,
                      false /* Must be false because of slave-mode clients */,
                      false);
@@ -1288,7 +1301,7 @@ static bool netplay_get_cmd(netplay_t *netplay,
                         netplay_input_state_t istate;
                         if (!(devices & (1<<device))) continue;
                         dsize = netplay_expected_input_size(netplay, 1 << device);
-                        istate = netplay_input_state_for(
+                        istate = netplay_input_state_for(netplay,
                               &dframe->real_input[device], client_num, dsize,
                               false, false);
                         if (!istate) continue;
@@ -1522,7 +1535,13 @@ static bool netplay_get_cmd(netplay_t *netplay,
             {
                /* We've already replayed up to this frame, so we can check it
                 * directly */
-               uint32_t local_crc = netplay_delta_frame_crc(
+               uint32_t local_crc;
+
+               /* Unless the replay fast path didn't keep its state */
+               if (netplay->buffer[tmp_ptr].stale_state)
+                  break;
+
+               local_crc = netplay_delta_frame_crc(
                      netplay, &netplay->buffer[tmp_ptr]);
 
                if (buffer[1] != local_crc)
@@ -1547,10 +1566,13 @@ static bool netplay_get_cmd(netplay_t *netplay,
          break;
 
       case NETPLAY_CMD_LOAD_SAVESTATE:
+      case NETPLAY_CMD_LOAD_SAVESTATE_DELTA:
       case NETPLAY_CMD_RESET:
          {
             uint32_t frame;
             uint32_t isize;
+            uint32_t block_size, base_frame;
+            size_t delta_wire_size = 0;
             uint32_t rd, wn;
             uint32_t client, client_num;
             uint32_t load_frame_count;
@@ -1603,9 +1625,27 @@ static bool netplay_get_cmd(netplay_t *netplay,
              * gets loaded. This is just to avoid having reloading implemented in
              * too many places. */
 
+            if (cmd == NETPLAY_CMD_LOAD_SAVESTATE_DELTA)
+            {
+               size_t blocks = NETPLAY_DELTA_BLOCKS(netplay->state_size);
+
+               if (!(connection->compression_supported & NETPLAY_COMPRESSION_DELTA) ||
+                   !netplay_delta_connection_init(netplay, connection))
+               {
+                  RARCH_ERR("CMD_LOAD_SAVESTATE_DELTA received but not usable.\n");
+                  return netplay_cmd_nak(netplay, connection);
+               }
+
+               delta_wire_size = (blocks + NETPLAY_DELTA_BITMAP_WORDS(blocks)) *
+                  sizeof(uint32_t);
+            }
+
             /* Check the payload size */
             if ((cmd == NETPLAY_CMD_LOAD_SAVESTATE &&
                  (cmd_size < 2*sizeof(uint32_t) || cmd_size > netplay->zbuffer_size + 2*sizeof(uint32_t))) ||
+                (cmd == NETPLAY_CMD_LOAD_SAVESTATE_DELTA &&
+                 (cmd_size < 4*sizeof(uint32_t) + delta_wire_size ||
+                  cmd_size > netplay->zbuffer_size + 4*sizeof(uint32_t) + delta_wire_size)) ||
                 (cmd == NETPLAY_CMD_RESET && cmd_size != sizeof(uint32_t)))
             {
                RARCH_ERR("CMD_LOAD_SAVESTATE received an unexpected payload size.\n");
@@ -1665,14 +1705,10 @@ static bool netplay_get_cmd(netplay_t *netplay,
                }
 
                /* And decompress it */
-               switch (connection->compression_supported)
-               {
-                  case NETPLAY_COMPRESSION_ZLIB:
-                     ctrans = &netplay->compress_zlib;
-                     break;
-                  default:
-                     ctrans = &netplay->compress_nil;
-               }
+               if (connection->compression_supported & NETPLAY_COMPRESSION_ZLIB)
+                  ctrans = &netplay->compress_zlib;
+               else
+                  ctrans = &netplay->compress_nil;
                ctrans->decompression_backend->set_in(ctrans->decompression_stream,
                   netplay->zbuffer, cmd_size - 2*sizeof(uint32_t));
                ctrans->decompression_backend->set_out(ctrans->decompression_stream,
@@ -1684,6 +1720,65 @@ static bool netplay_get_cmd(netplay_t *netplay,
                /* Force a rewind to the relevant frame */
                netplay->force_rewind = true;
             }
+            else if (cmd == NETPLAY_CMD_LOAD_SAVESTATE_DELTA)
+            {
+               RECV(&isize, sizeof(isize))
+               {
+                  RARCH_ERR("CMD_LOAD_SAVESTATE failed to receive inflated size.\n");
+                  return netplay_cmd_nak(netplay, connection);
+               }
+               isize = ntohl(isize);
+
+               if (isize != netplay->state_size)
+               {
+                  RARCH_ERR("CMD_LOAD_SAVESTATE received an unexpected save state size.\n");
+                  return netplay_cmd_nak(netplay, connection);
+               }
+
+               RECV(&block_size, sizeof(block_size))
+               {
+                  RARCH_ERR("CMD_LOAD_SAVESTATE_DELTA failed to receive block size.\n");
+                  return netplay_cmd_nak(netplay, connection);
+               }
+
+               if (ntohl(block_size) != NETPLAY_DELTA_BLOCK_SIZE)
+               {
+                  RARCH_ERR("CMD_LOAD_SAVESTATE_DELTA received an unexpected block size.\n");
+                  return netplay_cmd_nak(netplay, connection);
+               }
+
+               RECV(&base_frame, sizeof(base_frame))
+               {
+                  RARCH_ERR("CMD_LOAD_SAVESTATE_DELTA failed to receive base frame.\n");
+                  return netplay_cmd_nak(netplay, connection);
+               }
+
+               RECV(netplay->delta_wire, delta_wire_size)
+               {
+                  RARCH_ERR("CMD_LOAD_SAVESTATE_DELTA failed to receive block hashes.\n");
+                  return netplay_cmd_nak(netplay, connection);
+               }
+
+               RECV(netplay->zbuffer, cmd_size - 4*sizeof(uint32_t) - delta_wire_size)
+               {
+                  RARCH_ERR("CMD_LOAD_SAVESTATE failed to receive savestate.\n");
+                  return netplay_cmd_nak(netplay, connection);
+               }
+
+               /* If it didn't add up, a full savestate has been requested
+                * and will be loaded instead */
+               if (!netplay_recv_savestate_delta(netplay, connection,
+                     (uint8_t*)netplay->buffer[load_ptr].state, ntohl(base_frame),
+                     (uint32_t)(cmd_size - 4*sizeof(uint32_t) - delta_wire_size)))
+               {
+                  if (!connection->active)
+                     return false;
+                  break;
+               }
+
+               /* Force a rewind to the relevant frame */
+               netplay->force_rewind = true;
+            }
             else
             {
                /* Resetting */
@@ -1733,6 +1828,35 @@ static bool netplay_get_cmd(netplay_t *netplay,
             break;
          }
 
+      case NETPLAY_CMD_SAVESTATE_BLOCKS:
+         {
+            uint32_t count;
+
+            if (!(connection->compression_supported & NETPLAY_COMPRESSION_DELTA) ||
+                !netplay_delta_connection_init(netplay, connection) ||
+                cmd_size != (1 + NETPLAY_DELTA_BLOCKS(netplay->state_size)) *
+                  sizeof(uint32_t))
+            {
+               RARCH_ERR("CMD_SAVESTATE_BLOCKS received an unexpected payload size.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            RECV(&count, sizeof(count))
+            {
+               RARCH_ERR("CMD_SAVESTATE_BLOCKS failed to receive state count.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            RECV(netplay->delta_wire, cmd_size - sizeof(count))
+            {
+               RARCH_ERR("CMD_SAVESTATE_BLOCKS failed to receive block hashes.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            netplay_recv_savestate_blocks(netplay, connection, ntohl(count));
+            break;
+         }
+
       case NETPLAY_CMD_PAUSE:
          {
             char msg[512], nick[NETPLAY_NICK_LEN];
@@ -1861,10 +1985,15 @@ int netplay_poll_net_input(netplay_t *netplay, bool block)
 
    do
    {
+      uint32_t progress = 0;
+
       had_input = false;
 
       netplay->timeout_cnt++;
 
+      if (netplay->io)
+         progress = netplay_io_progress(netplay->io);
+
       /* Read input from each connection */
       for (i = 0; i < netplay->connections_size; i++)
       {
@@ -1884,20 +2013,25 @@ int netplay_poll_net_input(netplay_t *netplay, bool block)
          /* If we're supposed to block but we didn't have enough input, wait for it */
          if (!had_input)
          {
-            fd_set fds;
-            struct timeval tv = {0};
-            tv.tv_usec = RETRY_MS * 1000;
-
-            FD_ZERO(&fds);
-            for (i = 0; i < netplay->connections_size; i++)
+            if (netplay->io)
+               netplay_io_wait(netplay->io, progress, RETRY_MS * 1000);
+            else
             {
-               struct netplay_connection *connection = &netplay->connections[i];
-               if (connection->active)
-                  FD_SET(connection->fd, &fds);
-            }
+               fd_set fds;
+               struct timeval tv = {0};
+               tv.tv_usec = RETRY_MS * 1000;
 
-            if (socket_select(max_fd, &fds, NULL, NULL, &tv) < 0)
-               return -1;
+               FD_ZERO(&fds);
+               for (i = 0; i < netplay->connections_size; i++)
+               {
+                  struct netplay_connection *connection = &netplay->connections[i];
+                  if (connection->active)
+                     FD_SET(connection->fd, &fds);
+               }
+
+               if (socket_select(max_fd, &fds, NULL, NULL, &tv) < 0)
+                  return -1;
+            }
 
             RARCH_LOG("Network is stalling at frame %u, count %u of %d ...\n",
                   netplay->run_frame_count, netplay->timeout_cnt, MAX_RETRIES);
@@ -1952,7 +2086,7 @@ void netplay_handle_slaves(netplay_t *netplay)
                if (!istate_in)
                {
                   /* Start with blank input */
-                  netplay_input_state_for(&frame->real_input[device],
+                  netplay_input_state_for(netplay, &frame->real_input[device],
                         client_num,
                         netplay_expected_input_size(netplay, 1 << device), true,
                         false);
@@ -1961,7 +2095,7 @@ void netplay_handle_slaves(netplay_t *netplay)
                else
                {
                   /* Copy the previous input */
-                  istate_out = netplay_input_state_for(&frame->real_input[device],
+                  istate_out = netplay_input_state_for(netplay, &frame->real_input[device],
                         client_num, istate_in->size, true, false);
                   memcpy(istate_out->data, istate_in->data,
                         istate_in->size * sizeof(uint32_t));
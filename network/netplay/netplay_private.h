@@ -52,11 +52,37 @@ typedef uint32_t client_bitmap_t;
  * callbacks are in use, we assign a pseudodevice for it */
 #define RETRO_DEVICE_NETPLAY_KEYBOARD RETRO_DEVICE_SUBCLASS(RETRO_DEVICE_KEYBOARD, 65535)
 
+/* Sockets are serviced by a network thread on platforms with epoll */
+#if defined(HAVE_THREADS) && defined(__linux__)
+#define HAVE_NETPLAY_IO_THREAD 1
+#endif
+
+/* Ring buffer offsets that the network thread and the main thread share.
+ * Each offset has a single writer. */
+#ifdef HAVE_NETPLAY_IO_THREAD
+#define NETPLAY_LOAD(x)      __atomic_load_n(&(x), __ATOMIC_ACQUIRE)
+#define NETPLAY_STORE(x, v)  __atomic_store_n(&(x), (v), __ATOMIC_RELEASE)
+#else
+#define NETPLAY_LOAD(x)      (x)
+#define NETPLAY_STORE(x, v)  ((x) = (v))
+#endif
+
 #define NETPLAY_MAX_STALL_FRAMES       60
 #define NETPLAY_FRAME_RUN_TIME_WINDOW  120
 #define NETPLAY_MAX_REQ_STALL_TIME     60
 #define NETPLAY_MAX_REQ_STALL_FREQUENCY 120
 
+/* Savestates in the frame ring are laid out back to back, each starting on
+ * its own cache line */
+#define NETPLAY_FRAME_ALIGN            64
+
+/* Words of input data in a pooled input state, enough for the largest device
+ * (the keyboard). Larger states fall back to the heap. */
+#define NETPLAY_INPUT_STATE_WORDS      5
+
+/* Input states allocated per frame in each chunk of the input state pool */
+#define NETPLAY_INPUT_POOL_PER_FRAME   8
+
 #define PREV_PTR(x) ((x) == 0 ? netplay->buffer_size - 1 : (x) - 1)
 #define NEXT_PTR(x) ((x + 1) % netplay->buffer_size)
 
@@ -89,12 +115,23 @@ typedef uint32_t client_bitmap_t;
 
 /* Compression protocols supported */
 #define NETPLAY_COMPRESSION_ZLIB (1<<0)
+/* Savestates are sent as the blocks the peer doesn't already hold */
+#define NETPLAY_COMPRESSION_DELTA (1<<1)
 #if HAVE_ZLIB
-#define NETPLAY_COMPRESSION_SUPPORTED NETPLAY_COMPRESSION_ZLIB
+#define NETPLAY_COMPRESSION_SUPPORTED \
+   (NETPLAY_COMPRESSION_ZLIB | NETPLAY_COMPRESSION_DELTA)
 #else
-#define NETPLAY_COMPRESSION_SUPPORTED 0
+#define NETPLAY_COMPRESSION_SUPPORTED NETPLAY_COMPRESSION_DELTA
 #endif
 
+/* Savestates are hashed and diffed in blocks of this size */
+#define NETPLAY_DELTA_BLOCK_SIZE 1024
+#define NETPLAY_DELTA_BLOCKS(size) \
+   (((size) + NETPLAY_DELTA_BLOCK_SIZE - 1) / NETPLAY_DELTA_BLOCK_SIZE)
+#define NETPLAY_DELTA_BITMAP_WORDS(blocks) (((blocks) + 31) / 32)
+/* LOAD_SAVESTATE_DELTA base: the last state received on the connection */
+#define NETPLAY_DELTA_BASE_PREVIOUS 0xFFFFFFFF
+
 enum netplay_cmd
 {
    /* Basic commands */
@@ -166,6 +203,12 @@ enum netplay_cmd
    /* Sends over cheats enabled on client (unsupported) */
    NETPLAY_CMD_CHEATS         = 0x0047,
 
+   /* Send the blocks of a savestate the client doesn't hold yet */
+   NETPLAY_CMD_LOAD_SAVESTATE_DELTA = 0x0048,
+
+   /* Report the blocks held after a failed LOAD_SAVESTATE_DELTA */
+   NETPLAY_CMD_SAVESTATE_BLOCKS = 0x0049,
+
    /* Misc. commands */
 
    /* Sends multiple config requests over,
@@ -277,6 +320,9 @@ typedef struct netplay_input_state
    /* Is this a buffer with real data? */
    bool used;
 
+   /* Does this belong to the input state pool, rather than the heap? */
+   bool pooled;
+
    /* Whose data is this? */
    uint32_t client_num;
 
@@ -298,6 +344,10 @@ struct delta_frame
    /* The CRC-32 of the serialized state if we've calculated it, else 0 */
    uint32_t crc;
 
+   /* Was serialization skipped when this frame was replayed? The state is
+    * then left over from before the replay, and can't be used for CRCs. */
+   bool stale_state;
+
    /* The resolved input, i.e., what's actually going to the core. One input
     * per device. */
    netplay_input_state_t resolved_input[MAX_INPUT_DEVICES];
@@ -316,12 +366,33 @@ struct delta_frame
    bool have_real[MAX_CLIENTS];
 };
 
+/* A chunk of the input state pool. Input states are carved out of chunks in
+ * order and only returned when netplay is freed, since each delta frame keeps
+ * its lists around for reuse. */
+struct netplay_input_chunk
+{
+   struct netplay_input_chunk *next;
+   size_t used, count;
+   uint8_t *data;
+};
+
 struct socket_buffer
 {
    unsigned char *data;
    size_t bufsz;
    size_t start, end;
    size_t read;
+
+   /* The network thread moving data through this buffer, or NULL if the
+    * socket is read and written inline */
+   struct netplay_io *io;
+
+   /* Set by the network thread when the socket fails */
+   bool error;
+
+   /* Set by the network thread when it stops receiving because the buffer
+    * is full */
+   bool full;
 };
 
 /* Each connection gets a connection struct */
@@ -348,6 +419,9 @@ struct netplay_connection
    /* Buffers for sending and receiving data */
    struct socket_buffer send_packet_buffer, recv_packet_buffer;
 
+   /* The events the network thread is waiting for on fd */
+   uint32_t io_events;
+
    /* Mode of the connection */
    enum rarch_netplay_connection_mode mode;
 
@@ -359,6 +433,21 @@ struct netplay_connection
    /* What compression does this peer support? */
    uint32_t compression_supported;
 
+   /* With NETPLAY_COMPRESSION_DELTA: Hashes of the savestate blocks we
+    * believe the peer holds, and how many states we sent it */
+   uint32_t *delta_peer_hashes;
+   uint32_t delta_sent;
+
+   /* Set when delta_peer_hashes came from a SAVESTATE_BLOCKS report, which
+    * the next state then has to be diffed against */
+   bool delta_reported;
+
+   /* The last savestate received from the peer, which its next one is
+    * diffed against, its block hashes and how many states we received */
+   uint8_t *delta_base;
+   uint32_t *delta_base_hashes;
+   uint32_t delta_received;
+
    /* Is this player paused? */
    bool paused;
 
@@ -451,6 +540,19 @@ struct netplay
    struct delta_frame *buffer;
    size_t buffer_size;
 
+   /* The network thread, if sockets aren't serviced inline */
+   struct netplay_io *io;
+
+   /* The savestates of every frame in buffer, in one aligned block */
+   uint8_t *state_block;
+   size_t state_stride;
+
+   /* Where input states come from */
+   struct netplay_input_chunk *input_pool;
+
+   /* Skip serializing replayed frames which can't be rolled back to again */
+   bool replay_fast_path;
+
    /* Compression transcoder */
    struct compression_transcoder compress_nil,
                                  compress_zlib;
@@ -459,6 +561,19 @@ struct netplay
    uint8_t *zbuffer;
    size_t zbuffer_size;
 
+   /* Scratch space for NETPLAY_COMPRESSION_DELTA transfers: the block
+    * hashes and bitmap as they go over the wire, the hashes in host order,
+    * and the changed blocks before compression */
+   uint32_t *delta_wire;
+   uint32_t *delta_hashes;
+   uint8_t *delta_blocks;
+
+   /* Block hashes of the last synced frame's state, taken when a savestate
+    * is loaded, to diff it against */
+   uint32_t *delta_frame_hashes;
+   uint32_t delta_frame_count;
+   bool delta_frame_valid;
+
    /* The size of our packet buffers */
    size_t packet_buffer_size;
 
@@ -603,6 +718,15 @@ void netplay_deinit_socket_buffer(struct socket_buffer *sbuf);
 bool netplay_send(struct socket_buffer *sbuf, int sockfd, const void *buf,
    size_t len);
 
+/**
+ * netplay_send_nowait
+ *
+ * Queue the given data for sending, failing instead of waiting if the
+ * network thread hasn't made room for it.
+ */
+bool netplay_send_nowait(struct socket_buffer *sbuf, int sockfd,
+   const void *buf, size_t len);
+
 /**
  * netplay_send_flush
  *
@@ -639,6 +763,31 @@ void netplay_recv_reset(struct socket_buffer *sbuf);
  */
 void netplay_recv_flush(struct socket_buffer *sbuf);
 
+/**
+ * netplay_buf_fill
+ *
+ * Network thread: receive into the free space of a recv buffer.
+ *
+ * Returns false on socket failures. Sets *full if there's no space left.
+ */
+bool netplay_buf_fill(struct socket_buffer *sbuf, int sockfd, bool *full);
+
+/**
+ * netplay_buf_full
+ *
+ * Network thread: whether a recv buffer has no free space left.
+ */
+bool netplay_buf_full(struct socket_buffer *sbuf);
+
+/**
+ * netplay_buf_drain
+ *
+ * Network thread: send what's queued in a send buffer.
+ *
+ * Returns false on socket failures. Sets *pending if data is left over.
+ */
+bool netplay_buf_drain(struct socket_buffer *sbuf, int sockfd, bool *pending);
+
 
 /***************************************************************
  * NETPLAY-DELTA.C
@@ -670,13 +819,71 @@ uint32_t netplay_delta_frame_crc(netplay_t *netplay, struct delta_frame *delta);
  */
 void netplay_delta_frame_free(struct delta_frame *delta);
 
+/**
+ * netplay_delta_hash_blocks
+ *
+ * Hash each block of a savestate for NETPLAY_COMPRESSION_DELTA.
+ */
+void netplay_delta_hash_blocks(size_t state_size, const uint8_t *state,
+      uint32_t *hashes);
+
+/**
+ * netplay_delta_encode_blocks
+ *
+ * Gather, in order, the blocks of a savestate whose hashes differ from the
+ * base's, and set their bits in the bitmap (in host order).
+ *
+ * Returns: the number of bytes gathered.
+ */
+size_t netplay_delta_encode_blocks(size_t state_size, const uint8_t *state,
+      const uint32_t *hashes, const uint32_t *base_hashes,
+      uint32_t *bitmap, uint8_t *blocks);
+
+/**
+ * netplay_delta_decode_blocks
+ *
+ * Rebuild a savestate from blocks gathered by netplay_delta_encode_blocks,
+ * taking every block not in the bitmap from the base. The state and the base
+ * may be the same buffer.
+ *
+ * Returns: false if there were fewer bytes than the bitmap calls for. The
+ * missing blocks are taken from the base.
+ */
+bool netplay_delta_decode_blocks(size_t state_size, uint8_t *state,
+      const uint8_t *base, const uint32_t *bitmap,
+      const uint8_t *blocks, size_t len);
+
+/**
+ * netplay_replay_needs_state
+ *
+ * Whether a replayed frame's state must be serialized. Frames before
+ * unread_frame_count have all their input and can't be rolled back to again,
+ * so with the replay fast path they only need a state for CRC checks.
+ */
+bool netplay_replay_needs_state(netplay_t *netplay, struct delta_frame *delta);
+
+/**
+ * netplay_input_pool_init
+ *
+ * Preallocate the input state pool for the frame buffer.
+ */
+bool netplay_input_pool_init(netplay_t *netplay);
+
+/**
+ * netplay_input_pool_free
+ *
+ * Free the input state pool. Delta frames must be freed first.
+ */
+void netplay_input_pool_free(netplay_t *netplay);
+
 /**
  * netplay_input_state_for
  *
  * Get an input state for a particular client
  */
-netplay_input_state_t netplay_input_state_for(netplay_input_state_t *list,
-      uint32_t client_num, size_t size, bool must_create, bool must_not_create);
+netplay_input_state_t netplay_input_state_for(netplay_t *netplay,
+      netplay_input_state_t *list, uint32_t client_num, size_t size,
+      bool must_create, bool must_not_create);
 
 /**
  * netplay_expected_input_size
@@ -715,6 +922,62 @@ bool netplay_lan_ad_server(netplay_t *netplay);
 void netplay_load_savestate(netplay_t *netplay,
       retro_ctx_serialize_info_t *serial_info, bool save);
 
+/**
+ * netplay_delta_connection_init
+ * @netplay              : pointer to netplay object
+ * @connection           : connection using NETPLAY_COMPRESSION_DELTA
+ *
+ * Allocates the state kept for block-level savestate transfers. Until a
+ * state has gone over, both sides take the other to hold an all-zero state.
+ *
+ * Returns: true on success, false if out of memory or serialization isn't
+ * ready yet.
+ **/
+bool netplay_delta_connection_init(netplay_t *netplay,
+      struct netplay_connection *connection);
+
+/**
+ * netplay_delta_connection_free
+ * @connection           : connection
+ *
+ * Frees what netplay_delta_connection_init allocated.
+ **/
+void netplay_delta_connection_free(struct netplay_connection *connection);
+
+/**
+ * netplay_recv_savestate_delta
+ * @netplay              : pointer to netplay object
+ * @connection           : connection the state came from
+ * @state                : buffer to rebuild the state in
+ * @base_frame           : frame whose state the delta is against, or
+ *                         NETPLAY_DELTA_BASE_PREVIOUS
+ * @zlen                 : length of the compressed blocks in zbuffer
+ *
+ * Rebuilds a LOAD_SAVESTATE_DELTA from the block hashes and bitmap in
+ * delta_wire, the compressed blocks in zbuffer and the base: our state for
+ * base_frame, or the last state received from this connection. If the
+ * result doesn't match the hashes, the blocks we do hold are reported back
+ * and a fresh savestate is requested.
+ *
+ * Returns: true if the state was rebuilt and can be loaded.
+ **/
+bool netplay_recv_savestate_delta(netplay_t *netplay,
+      struct netplay_connection *connection, uint8_t *state,
+      uint32_t base_frame, uint32_t zlen);
+
+/**
+ * netplay_recv_savestate_blocks
+ * @netplay              : pointer to netplay object
+ * @connection           : connection the report came from
+ * @count                : number of states the peer had received
+ *
+ * Takes the block hashes in delta_wire, reported by the peer through
+ * SAVESTATE_BLOCKS, as what it holds, unless we have sent it states since.
+ * The next state sent to it is diffed against them.
+ **/
+void netplay_recv_savestate_blocks(netplay_t *netplay,
+      struct netplay_connection *connection, uint32_t count);
+
 /**
  * netplay_settings_share_mode
  *
@@ -780,6 +1043,8 @@ bool netplay_wait_and_init_serialization(netplay_t *netplay);
  * @port                 : Port of server.
  * @stateless_mode       : Shall we run in stateless mode?
  * @check_frames         : Frequency with which to check CRCs.
+ * @replay_fast_path     : Skip states of replayed frames that can't be
+ *                         rolled back to again.
  * @cb                   : Libretro callbacks.
  * @nat_traversal        : If true, attempt NAT traversal.
  * @nick                 : Nickname of user.
@@ -791,7 +1056,7 @@ bool netplay_wait_and_init_serialization(netplay_t *netplay);
  * Returns: new netplay data.
  */
 netplay_t *netplay_new(void *direct_host, const char *server, uint16_t port,
-   bool stateless_mode, int check_frames,
+   bool stateless_mode, int check_frames, bool replay_fast_path,
    const struct retro_callbacks *cb, bool nat_traversal, const char *nick,
    uint64_t quirks);
 
@@ -985,4 +1250,73 @@ bool netplay_sync_pre_frame(netplay_t *netplay);
  */
 void netplay_sync_post_frame(netplay_t *netplay, bool stalled);
 
+
+/***************************************************************
+ * NETPLAY-THREAD.C
+ **************************************************************/
+
+/**
+ * netplay_io_init
+ *
+ * Start the network thread. Without one, sockets are serviced inline.
+ */
+bool netplay_io_init(netplay_t *netplay);
+
+/**
+ * netplay_io_deinit
+ *
+ * Stop the network thread. Connections must be detached first.
+ */
+void netplay_io_deinit(netplay_t *netplay);
+
+/**
+ * netplay_io_attach
+ *
+ * Hand a connection's socket over to the network thread.
+ */
+bool netplay_io_attach(netplay_t *netplay,
+   struct netplay_connection *connection);
+
+/**
+ * netplay_io_detach
+ *
+ * Take a connection's socket back from the network thread, before it's
+ * closed.
+ */
+void netplay_io_detach(netplay_t *netplay,
+   struct netplay_connection *connection);
+
+/**
+ * netplay_io_lock
+ *
+ * Keep the network thread away from the connections while they're
+ * reallocated or their buffers resized.
+ */
+void netplay_io_lock(netplay_t *netplay);
+
+void netplay_io_unlock(netplay_t *netplay);
+
+/**
+ * netplay_io_progress
+ *
+ * A counter that the network thread bumps whenever it's moved data.
+ */
+uint32_t netplay_io_progress(struct netplay_io *io);
+
+/**
+ * netplay_io_kick
+ *
+ * Wake the network thread up to send queued data.
+ */
+void netplay_io_kick(struct netplay_io *io);
+
+/**
+ * netplay_io_wait
+ *
+ * Wait until the network thread has moved data since the given progress
+ * count, or the timeout in microseconds has passed.
+ */
+void netplay_io_wait(struct netplay_io *io, uint32_t progress,
+   int64_t timeout_us);
+
 #endif
@@ -98,14 +98,14 @@ netplay_input_state_t netplay_device_client_state(netplay_t *netplay,
 {
    uint32_t dsize = netplay_expected_input_size(netplay, 1 << device);
    netplay_input_state_t simstate =
-      netplay_input_state_for(
+      netplay_input_state_for(netplay,
          &simframe->real_input[device], client,
          dsize, false, true);
    if (!simstate)
    {
       if (netplay->read_frame_count[client] > simframe->frame)
          return NULL;
-      simstate = netplay_input_state_for(&simframe->simlated_input[device],
+      simstate = netplay_input_state_for(netplay, &simframe->simlated_input[device],
             client, dsize, false, true);
    }
    return simstate;
@@ -334,19 +334,19 @@ bool netplay_resolve_input(netplay_t *netplay, size_t sim_ptr, bool resim)
          if (!(clients & (1<<client))) continue;
 
          /* Resolve this client-device */
-         simstate = netplay_input_state_for(&simframe->real_input[device], client, dsize, false, true);
+         simstate = netplay_input_state_for(netplay, &simframe->real_input[device], client, dsize, false, true);
          if (!simstate)
          {
             /* Don't already have this input, so must simulate if we're supposed to have it at all */
             if (netplay->read_frame_count[client] > simframe->frame)
                continue;
-            simstate = netplay_input_state_for(&simframe->simlated_input[device], client, dsize, false, false);
+            simstate = netplay_input_state_for(netplay, &simframe->simlated_input[device], client, dsize, false, false);
             if (!simstate)
                continue;
 
             prev = PREV_PTR(netplay->read_ptr[client]);
             pframe = &netplay->buffer[prev];
-            pstate = netplay_input_state_for(&pframe->real_input[device], client, dsize, false, true);
+            pstate = netplay_input_state_for(netplay, &pframe->real_input[device], client, dsize, false, true);
             if (!pstate)
                continue;
 
@@ -391,14 +391,16 @@ bool netplay_resolve_input(netplay_t *netplay, size_t sim_ptr, bool resim)
             && (simframe->resolved_input[device]->size != dsize
                   || simframe->resolved_input[device]->client_num != 0))
       {
-         /* The default resolved input is of the wrong size! */
+         /* The default resolved input is of the wrong size! Pooled states
+          * aren't ours to free, they go back with the pool. */
          netplay_input_state_t nextistate = simframe->resolved_input[device]->next;
-         free(simframe->resolved_input[device]);
+         if (!simframe->resolved_input[device]->pooled)
+            free(simframe->resolved_input[device]);
          simframe->resolved_input[device] = nextistate;
       }
 
       /* Now we copy the state, whether real or simulated, out into the resolved state */
-      resstate = netplay_input_state_for(&simframe->resolved_input[device], 0,
+      resstate = netplay_input_state_for(netplay, &simframe->resolved_input[device], 0,
             dsize, false, false);
       if (!resstate)
          continue;
@@ -433,7 +435,7 @@ bool netplay_resolve_input(netplay_t *netplay, size_t sim_ptr, bool resim)
             digital = digital_keyboard;
          else
             digital = digital_common;
-         oldresstate = netplay_input_state_for(&simframe->resolved_input[device], 1, dsize, false, false);
+         oldresstate = netplay_input_state_for(netplay, &simframe->resolved_input[device], 1, dsize, false, false);
          if (!oldresstate)
             continue;
          memcpy(oldresstate->data, resstate->data, dsize * sizeof(uint32_t));
@@ -511,6 +513,7 @@ bool netplay_sync_pre_frame(netplay_t *netplay)
       serial_info.data = netplay->buffer[netplay->run_ptr].state;
       serial_info.size = netplay->state_size;
 
+      netplay->buffer[netplay->run_ptr].stale_state = false;
       memset(serial_info.data, 0, serial_info.size);
       if ((netplay->quirks & NETPLAY_QUIRK_INITIALIZATION) || netplay->run_frame_count == 0)
       {
@@ -606,7 +609,8 @@ bool netplay_sync_pre_frame(netplay_t *netplay)
             RARCH_WARN("Cannot set Netplay port to close-on-exec. It may fail to reopen if the client disconnects.\n");
 #endif
 
-         /* Allocate a connection */
+         /* Allocate a connection, while the network thread isn't looking */
+         netplay_io_lock(netplay);
          for (connection_num = 0; connection_num < netplay->connections_size; connection_num++)
             if (!netplay->connections[connection_num].active &&
                 netplay->connections[connection_num].mode != NETPLAY_CONNECTION_DELAYED_DISCONNECT) break;
@@ -617,6 +621,7 @@ bool netplay_sync_pre_frame(netplay_t *netplay)
                netplay->connections = (struct netplay_connection*)malloc(sizeof(struct netplay_connection));
                if (netplay->connections == NULL)
                {
+                  netplay_io_unlock(netplay);
                   socket_close(new_fd);
                   goto process;
                }
@@ -631,6 +636,7 @@ bool netplay_sync_pre_frame(netplay_t *netplay)
                      new_connections_size*sizeof(struct netplay_connection));
                if (new_connections == NULL)
                {
+                  netplay_io_unlock(netplay);
                   socket_close(new_fd);
                   goto process;
                }
@@ -658,10 +664,13 @@ bool netplay_sync_pre_frame(netplay_t *netplay)
             if (connection->send_packet_buffer.data)
                netplay_deinit_socket_buffer(&connection->send_packet_buffer);
             connection->active = false;
+            netplay_io_unlock(netplay);
             socket_close(new_fd);
             goto process;
          }
+         netplay_io_unlock(netplay);
 
+         netplay_io_attach(netplay, connection);
          netplay_handshake_init_send(netplay, connection);
 
       }
@@ -814,9 +823,15 @@ void netplay_sync_post_frame(netplay_t *netplay, bool stalled)
 
          start = cpu_features_get_time_usec();
 
-         /* Remember the current state */
-         memset(serial_info.data, 0, serial_info.size);
-         core_serialize(&serial_info);
+         /* Remember the current state, unless nothing will look at it */
+         if (netplay_replay_needs_state(netplay, ptr))
+         {
+            memset(serial_info.data, 0, serial_info.size);
+            core_serialize(&serial_info);
+            ptr->stale_state = false;
+         }
+         else
+            ptr->stale_state = true;
          if (netplay->replay_frame_count < netplay->unread_frame_count)
             netplay_handle_frame_hash(netplay, ptr);
 
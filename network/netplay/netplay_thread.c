@@ -0,0 +1,411 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2016-2017 - Gregor Richards
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+
+#include "netplay_private.h"
+
+#ifdef HAVE_NETPLAY_IO_THREAD
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#include <rthreads/rthreads.h>
+
+/* The epoll token for the wakeup eventfd; connections use their index */
+#define NETPLAY_IO_WAKE_TOKEN 0xFFFFFFFF
+
+#define NETPLAY_IO_MAX_EVENTS 64
+
+/* How long the thread sleeps with nothing to do, in milliseconds */
+#define NETPLAY_IO_IDLE_MS    500
+
+/*
+ * The network thread owns every connection's socket: it receives into the
+ * recv buffers, sends from the send buffers, and otherwise sleeps in
+ * epoll_wait. The main thread never makes socket calls for an attached
+ * connection, so a slow peer can't stall the frame. Commands are still
+ * encoded and decoded by the main thread, straight out of the buffers.
+ */
+struct netplay_io
+{
+   netplay_t *netplay;
+   sthread_t *thread;
+
+   /* Held by the thread while it touches the connections */
+   slock_t *lock;
+
+   /* For waiting on progress */
+   slock_t *progress_lock;
+   scond_t *progress_cond;
+   uint32_t progress;
+
+   int epoll_fd;
+   int wake_fd;
+
+   /* Set when wake_fd has been written and the thread hasn't woken yet */
+   bool woken;
+   bool quit;
+};
+
+static void netplay_io_set_events(struct netplay_io *io,
+   struct netplay_connection *connection, uint32_t events)
+{
+   struct epoll_event event = {0};
+
+   if (connection->io_events == events)
+      return;
+
+   event.events   = events;
+   event.data.u32 = (uint32_t)(connection - io->netplay->connections);
+   epoll_ctl(io->epoll_fd, EPOLL_CTL_MOD, connection->fd, &event);
+   connection->io_events = events;
+}
+
+static void netplay_io_fail(struct netplay_io *io,
+   struct netplay_connection *connection)
+{
+   /* The main thread will notice and hang up */
+   NETPLAY_STORE(connection->send_packet_buffer.error, true);
+   NETPLAY_STORE(connection->recv_packet_buffer.error, true);
+   epoll_ctl(io->epoll_fd, EPOLL_CTL_DEL, connection->fd, NULL);
+   connection->io_events = 0;
+}
+
+/* Move whatever data we can for one connection, given the epoll events it
+ * came up with, if any. Returns true if it did. */
+static bool netplay_io_service(struct netplay_io *io,
+   struct netplay_connection *connection, uint32_t events)
+{
+   struct socket_buffer *rbuf = &connection->recv_packet_buffer;
+   struct socket_buffer *sbuf = &connection->send_packet_buffer;
+   bool pending = false, full = false;
+   size_t recv_end, send_start;
+
+   if (NETPLAY_LOAD(rbuf->error))
+      return false;
+
+   recv_end   = rbuf->end;
+   send_start = sbuf->start;
+
+   /* Only receive when there's both data and room for it. While the buffer
+    * is full, listening stays off until the main thread has read some. */
+   if (NETPLAY_LOAD(rbuf->full))
+      full = netplay_buf_full(rbuf);
+   if (full && (events & (EPOLLERR|EPOLLHUP)))
+   {
+      /* Errors are reported even with listening off, so don't wait around
+       * for room. What's already buffered can still be read. */
+      netplay_io_fail(io, connection);
+      return true;
+   }
+   if (events && !full)
+   {
+      if (!netplay_buf_fill(rbuf, connection->fd, &full))
+      {
+         netplay_io_fail(io, connection);
+         return true;
+      }
+   }
+   NETPLAY_STORE(rbuf->full, full);
+
+   if (!netplay_buf_drain(sbuf, connection->fd, &pending))
+   {
+      netplay_io_fail(io, connection);
+      return true;
+   }
+
+   /* Stop listening while the recv buffer is full, and only ask about
+    * writability while there's something to write */
+   netplay_io_set_events(io, connection,
+         (full ? 0 : EPOLLIN) | (pending ? EPOLLOUT : 0));
+
+   return recv_end != rbuf->end || send_start != sbuf->start;
+}
+
+static void netplay_io_thread(void *data)
+{
+   struct netplay_io *io = (struct netplay_io*)data;
+   struct epoll_event events[NETPLAY_IO_MAX_EVENTS];
+
+   while (!NETPLAY_LOAD(io->quit))
+   {
+      size_t i;
+      int j, nevents;
+      bool moved = false;
+
+      nevents = epoll_wait(io->epoll_fd, events, NETPLAY_IO_MAX_EVENTS,
+            NETPLAY_IO_IDLE_MS);
+      if (nevents < 0)
+      {
+         if (errno != EINTR)
+            break;
+         nevents = 0;
+      }
+
+      slock_lock(io->lock);
+
+      for (j = 0; j < nevents; j++)
+      {
+         uint32_t token = events[j].data.u32;
+         struct netplay_connection *connection;
+
+         if (token == NETPLAY_IO_WAKE_TOKEN)
+         {
+            uint64_t count;
+            if (read(io->wake_fd, &count, sizeof(count)) < 0) { }
+            NETPLAY_STORE(io->woken, false);
+            continue;
+         }
+
+         if (token >= io->netplay->connections_size)
+            continue;
+         connection = &io->netplay->connections[token];
+         if (!connection->active || connection->recv_packet_buffer.io != io)
+            continue;
+
+         if (events[j].events & (EPOLLERR|EPOLLHUP|EPOLLIN))
+            moved |= netplay_io_service(io, connection,
+                  events[j].events & (EPOLLERR|EPOLLHUP|EPOLLIN));
+      }
+
+      /* Send anything newly queued, and catch up on buffers that had filled */
+      for (i = 0; i < io->netplay->connections_size; i++)
+      {
+         struct netplay_connection *connection = &io->netplay->connections[i];
+         if (!connection->active || connection->send_packet_buffer.io != io)
+            continue;
+         moved |= netplay_io_service(io, connection, 0);
+      }
+
+      slock_unlock(io->lock);
+
+      if (moved)
+      {
+         slock_lock(io->progress_lock);
+         io->progress++;
+         scond_broadcast(io->progress_cond);
+         slock_unlock(io->progress_lock);
+      }
+   }
+}
+
+/**
+ * netplay_io_init
+ *
+ * Start the network thread. Without one, sockets are serviced inline.
+ */
+bool netplay_io_init(netplay_t *netplay)
+{
+   struct epoll_event event = {0};
+   struct netplay_io *io = (struct netplay_io*)calloc(1, sizeof(*io));
+
+   if (!io)
+      return false;
+
+   io->netplay  = netplay;
+   io->epoll_fd = epoll_create(MAX_CLIENTS);
+   io->wake_fd  = eventfd(0, EFD_NONBLOCK);
+   if (io->epoll_fd < 0 || io->wake_fd < 0)
+      goto error;
+
+   event.events   = EPOLLIN;
+   event.data.u32 = NETPLAY_IO_WAKE_TOKEN;
+   if (epoll_ctl(io->epoll_fd, EPOLL_CTL_ADD, io->wake_fd, &event) < 0)
+      goto error;
+
+   io->lock          = slock_new();
+   io->progress_lock = slock_new();
+   io->progress_cond = scond_new();
+   if (!io->lock || !io->progress_lock || !io->progress_cond)
+      goto error;
+
+   io->thread = sthread_create(netplay_io_thread, io);
+   if (!io->thread)
+      goto error;
+
+   netplay->io = io;
+   return true;
+
+error:
+   RARCH_WARN("Netplay could not start its network thread.\n");
+   if (io->lock)
+      slock_free(io->lock);
+   if (io->progress_lock)
+      slock_free(io->progress_lock);
+   if (io->progress_cond)
+      scond_free(io->progress_cond);
+   if (io->wake_fd >= 0)
+      close(io->wake_fd);
+   if (io->epoll_fd >= 0)
+      close(io->epoll_fd);
+   free(io);
+   return false;
+}
+
+/**
+ * netplay_io_deinit
+ *
+ * Stop the network thread. Connections must be detached first.
+ */
+void netplay_io_deinit(netplay_t *netplay)
+{
+   struct netplay_io *io = netplay->io;
+
+   if (!io)
+      return;
+
+   NETPLAY_STORE(io->quit, true);
+   netplay_io_kick(io);
+   sthread_join(io->thread);
+
+   slock_free(io->lock);
+   slock_free(io->progress_lock);
+   scond_free(io->progress_cond);
+   close(io->wake_fd);
+   close(io->epoll_fd);
+   free(io);
+   netplay->io = NULL;
+}
+
+/**
+ * netplay_io_attach
+ *
+ * Hand a connection's socket over to the network thread.
+ */
+bool netplay_io_attach(netplay_t *netplay,
+   struct netplay_connection *connection)
+{
+   struct epoll_event event = {0};
+   struct netplay_io *io    = netplay->io;
+
+   if (!io)
+      return false;
+
+   event.events   = EPOLLIN | EPOLLOUT;
+   event.data.u32 = (uint32_t)(connection - netplay->connections);
+
+   slock_lock(io->lock);
+   if (epoll_ctl(io->epoll_fd, EPOLL_CTL_ADD, connection->fd, &event) < 0)
+   {
+      slock_unlock(io->lock);
+      return false;
+   }
+   connection->io_events                   = event.events;
+   connection->send_packet_buffer.error    = false;
+   connection->recv_packet_buffer.error    = false;
+   connection->recv_packet_buffer.full     = false;
+   connection->send_packet_buffer.io       = io;
+   connection->recv_packet_buffer.io       = io;
+   slock_unlock(io->lock);
+
+   return true;
+}
+
+/**
+ * netplay_io_detach
+ *
+ * Take a connection's socket back from the network thread, before it's
+ * closed.
+ */
+void netplay_io_detach(netplay_t *netplay,
+   struct netplay_connection *connection)
+{
+   struct netplay_io *io = netplay->io;
+
+   if (!io || connection->send_packet_buffer.io != io)
+      return;
+
+   slock_lock(io->lock);
+   epoll_ctl(io->epoll_fd, EPOLL_CTL_DEL, connection->fd, NULL);
+   connection->io_events             = 0;
+   connection->send_packet_buffer.io = NULL;
+   connection->recv_packet_buffer.io = NULL;
+   slock_unlock(io->lock);
+}
+
+void netplay_io_lock(netplay_t *netplay)
+{
+   if (netplay->io)
+      slock_lock(netplay->io->lock);
+}
+
+void netplay_io_unlock(netplay_t *netplay)
+{
+   if (netplay->io)
+      slock_unlock(netplay->io->lock);
+}
+
+/**
+ * netplay_io_progress
+ *
+ * A counter that the network thread bumps whenever it's moved data.
+ */
+uint32_t netplay_io_progress(struct netplay_io *io)
+{
+   uint32_t progress;
+   slock_lock(io->progress_lock);
+   progress = io->progress;
+   slock_unlock(io->progress_lock);
+   return progress;
+}
+
+/**
+ * netplay_io_kick
+ *
+ * Wake the network thread up to send queued data.
+ */
+void netplay_io_kick(struct netplay_io *io)
+{
+   uint64_t one = 1;
+
+   if (__atomic_exchange_n(&io->woken, true, __ATOMIC_ACQ_REL))
+      return;
+   if (write(io->wake_fd, &one, sizeof(one)) < 0) { }
+}
+
+/**
+ * netplay_io_wait
+ *
+ * Wait until the network thread has moved data since the given progress
+ * count, or the timeout in microseconds has passed.
+ */
+void netplay_io_wait(struct netplay_io *io, uint32_t progress,
+   int64_t timeout_us)
+{
+   slock_lock(io->progress_lock);
+   if (io->progress == progress)
+      scond_wait_timeout(io->progress_cond, io->progress_lock, timeout_us);
+   slock_unlock(io->progress_lock);
+}
+
+#else
+
+bool netplay_io_init(netplay_t *netplay) { return false; }
+void netplay_io_deinit(netplay_t *netplay) { }
+bool netplay_io_attach(netplay_t *netplay,
+   struct netplay_connection *connection) { return false; }
+void netplay_io_detach(netplay_t *netplay,
+   struct netplay_connection *connection) { }
+void netplay_io_lock(netplay_t *netplay) { }
+void netplay_io_unlock(netplay_t *netplay) { }
+uint32_t netplay_io_progress(struct netplay_io *io) { return 0; }
+void netplay_io_kick(struct netplay_io *io) { }
+void netplay_io_wait(struct netplay_io *io, uint32_t progress,
+   int64_t timeout_us) { }
+
+#endif
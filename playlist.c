@@ -17,22 +17,38 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 
 #include <libretro.h>
 #include <boolean.h>
+#include <retro_miscellaneous.h>
 #include <compat/posix_string.h>
+#include <compat/strl.h>
 #include <string/stdstring.h>
-#include <streams/interface_stream.h>
 #include <streams/file_stream.h>
 #include <file/file_path.h>
 
 #include "playlist.h"
+#include "configuration.h"
 #include "verbosity.h"
 
 #ifndef PLAYLIST_ENTRIES
 #define PLAYLIST_ENTRIES 6
 #endif
 
+/* Binary cache, written next to the playlist as <playlist>.cache */
+#define PLAYLIST_CACHE_MAGIC   0x43504152 /* "RAPC" */
+#define PLAYLIST_CACHE_VERSION 1
+
+/* Set in playlist_entry::owned for the strings that were strdup'd.
+ * The others point into one of the playlist's blocks. */
+#define PLAYLIST_OWN_PATH      (1 << 0)
+#define PLAYLIST_OWN_LABEL     (1 << 1)
+#define PLAYLIST_OWN_CORE_PATH (1 << 2)
+#define PLAYLIST_OWN_CORE_NAME (1 << 3)
+#define PLAYLIST_OWN_CRC32     (1 << 4)
+#define PLAYLIST_OWN_DB_NAME   (1 << 5)
+
 struct playlist_entry
 {
    char *path;
@@ -41,22 +57,266 @@ struct playlist_entry
    char *core_name;
    char *db_name;
    char *crc32;
+   uint32_t hash;
+   unsigned owned;
 };
 
+/* A playlist or cache file read in one go. Entries loaded
+ * from it point straight into the data, which follows
+ * this header in the same allocation. */
+struct playlist_block
+{
+   struct playlist_block *next;
+};
+
+struct playlist_cache_header
+{
+   uint32_t magic;
+   uint32_t version;
+   uint32_t count;
+   uint32_t strings_size;
+   /* Of the playlist file the cache was built from */
+   int64_t mtime;
+   int64_t size;
+};
+
+/* Followed by the strings. Fields are string offsets + 1,
+ * 0 means NULL, in the playlist file order. */
+struct playlist_cache_record
+{
+   uint32_t hash;
+   uint32_t fields[PLAYLIST_ENTRIES];
+};
+
+/* The entries are a ring of 'cap' slots, entry 0 lives at
+ * slot 'head' and pushing to the top just moves 'head' back.
+ * 'index' is an open addressing hash table (linear probing)
+ * of slot + 1 by path, 0 marks a free bucket. */
 struct content_playlist
 {
    bool modified;
    size_t size;
    size_t cap;
+   size_t head;
+   size_t index_mask;
 
    char *conf_path;
+   uint32_t *index;
    struct playlist_entry *entries;
+   struct playlist_block *blocks;
 };
 
 typedef int (playlist_sort_fun_t)(
       const struct playlist_entry *a,
       const struct playlist_entry *b);
 
+static uint32_t playlist_hash(const char *path)
+{
+   uint32_t hash = 5381;
+
+   if (!path)
+      return hash;
+
+   while (*path)
+   {
+#ifdef _WIN32
+      /* Pushes compare paths case-insensitively here */
+      hash = (hash << 5) + hash + (uint32_t)tolower((unsigned char)*path++);
+#else
+      hash = (hash << 5) + hash + (uint8_t)*path++;
+#endif
+   }
+
+   return hash;
+}
+
+static size_t playlist_slot(playlist_t *playlist, size_t idx)
+{
+   size_t slot = playlist->head + idx;
+   if (slot >= playlist->cap)
+      slot -= playlist->cap;
+   return slot;
+}
+
+static size_t playlist_slot_to_index(playlist_t *playlist, size_t slot)
+{
+   if (slot >= playlist->head)
+      return slot - playlist->head;
+   return slot + playlist->cap - playlist->head;
+}
+
+static void playlist_index_insert(playlist_t *playlist, size_t slot)
+{
+   size_t i = playlist->entries[slot].hash & playlist->index_mask;
+
+   while (playlist->index[i])
+      i = (i + 1) & playlist->index_mask;
+
+   playlist->index[i] = (uint32_t)(slot + 1);
+}
+
+static void playlist_index_rebuild(playlist_t *playlist)
+{
+   size_t i;
+
+   memset(playlist->index, 0,
+         (playlist->index_mask + 1) * sizeof(*playlist->index));
+
+   for (i = 0; i < playlist->size; i++)
+      playlist_index_insert(playlist, playlist_slot(playlist, i));
+}
+
+/* Makes room in the index for 'count' entries,
+ * keeping it at most half full. */
+static bool playlist_index_reserve(playlist_t *playlist, size_t count)
+{
+   uint32_t *index = NULL;
+   size_t buckets  = 64;
+
+   if (playlist->index && count * 2 <= playlist->index_mask + 1)
+      return true;
+
+   while (buckets < count * 2)
+      buckets *= 2;
+
+   index = (uint32_t*)malloc(buckets * sizeof(*index));
+   if (!index)
+      return false;
+
+   free(playlist->index);
+   playlist->index      = index;
+   playlist->index_mask = buckets - 1;
+   playlist_index_rebuild(playlist);
+
+   return true;
+}
+
+static size_t playlist_index_find_slot(playlist_t *playlist,
+      uint32_t hash, size_t slot)
+{
+   size_t i = hash & playlist->index_mask;
+
+   while (playlist->index[i] != slot + 1)
+      i = (i + 1) & playlist->index_mask;
+
+   return i;
+}
+
+static void playlist_index_remove(playlist_t *playlist, size_t slot)
+{
+   size_t i = playlist_index_find_slot(playlist,
+         playlist->entries[slot].hash, slot);
+   size_t j = i;
+
+   /* Backward shift deletion, so probes never need tombstones */
+   playlist->index[i] = 0;
+
+   for (;;)
+   {
+      size_t home;
+
+      j = (j + 1) & playlist->index_mask;
+      if (!playlist->index[j])
+         break;
+
+      home = playlist->entries[playlist->index[j] - 1].hash
+         & playlist->index_mask;
+
+      /* Leave it if its home bucket lies cyclically in (i, j] */
+      if (i <= j ? (home > i && home <= j) : (home > i || home <= j))
+         continue;
+
+      playlist->index[i] = playlist->index[j];
+      playlist->index[j] = 0;
+      i                  = j;
+   }
+}
+
+/* Moves the entry in slot 'from' to slot 'to', which must be free */
+static void playlist_move_entry(playlist_t *playlist,
+      size_t from, size_t to)
+{
+   struct playlist_entry *entry = &playlist->entries[from];
+
+   playlist->index[playlist_index_find_slot(playlist, entry->hash, from)]
+                       = (uint32_t)(to + 1);
+   playlist->entries[to] = *entry;
+}
+
+static bool playlist_path_equal_push(const char *a, const char *b)
+{
+   if (!a)
+      a = "";
+   if (!b)
+      b = "";
+#ifdef _WIN32
+   /*prevent duplicates on case-insensitive operating systems*/
+   return string_is_equal_noncase(a, b);
+#else
+   return string_is_equal(a, b);
+#endif
+}
+
+/* Index of the first entry with this path and core path,
+ * the same way playlist_push compares them, or playlist->size. */
+static size_t playlist_find_push(playlist_t *playlist,
+      const char *path, const char *core_path)
+{
+   size_t i;
+   uint32_t hash = playlist_hash(path);
+   size_t found  = playlist->size;
+
+   if (!playlist->index)
+      return found;
+
+   for (i = hash & playlist->index_mask; playlist->index[i];
+         i = (i + 1) & playlist->index_mask)
+   {
+      size_t slot                  = playlist->index[i] - 1;
+      struct playlist_entry *entry = &playlist->entries[slot];
+      size_t idx;
+
+      if (entry->hash != hash
+            || !playlist_path_equal_push(entry->path, path)
+            || !string_is_equal(entry->core_path, core_path))
+         continue;
+
+      idx = playlist_slot_to_index(playlist, slot);
+      if (idx < found)
+         found = idx;
+   }
+
+   return found;
+}
+
+/* Index of the first entry with exactly this path, or playlist->size */
+static size_t playlist_find_path(playlist_t *playlist, const char *path)
+{
+   size_t i;
+   uint32_t hash = playlist_hash(path);
+   size_t found  = playlist->size;
+
+   if (!path || !playlist->index)
+      return found;
+
+   for (i = hash & playlist->index_mask; playlist->index[i];
+         i = (i + 1) & playlist->index_mask)
+   {
+      size_t slot                  = playlist->index[i] - 1;
+      struct playlist_entry *entry = &playlist->entries[slot];
+      size_t idx;
+
+      if (entry->hash != hash || !string_is_equal(entry->path, path))
+         continue;
+
+      idx = playlist_slot_to_index(playlist, slot);
+      if (idx < found)
+         found = idx;
+   }
+
+   return found;
+}
+
 uint32_t playlist_get_size(playlist_t *playlist)
 {
    if (!playlist)
@@ -88,21 +348,58 @@ void playlist_get_index(playlist_t *playlist,
       const char **crc32,
       const char **db_name)
 {
+   struct playlist_entry *entry = NULL;
+
    if (!playlist)
       return;
 
+   entry = &playlist->entries[playlist_slot(playlist, idx)];
+
    if (path)
-      *path      = playlist->entries[idx].path;
+      *path      = entry->path;
    if (label)
-      *label     = playlist->entries[idx].label;
+      *label     = entry->label;
    if (core_path)
-      *core_path = playlist->entries[idx].core_path;
+      *core_path = entry->core_path;
    if (core_name)
-      *core_name = playlist->entries[idx].core_name;
+      *core_name = entry->core_name;
    if (db_name)
-      *db_name   = playlist->entries[idx].db_name;
+      *db_name   = entry->db_name;
    if (crc32)
-      *crc32     = playlist->entries[idx].crc32;
+      *crc32     = entry->crc32;
+}
+
+/**
+ * playlist_free_entry:
+ * @entry               : Playlist entry handle.
+ *
+ * Frees playlist entry.
+ **/
+static void playlist_free_entry(struct playlist_entry *entry)
+{
+   if (!entry)
+      return;
+
+   if (entry->owned & PLAYLIST_OWN_PATH)
+      free(entry->path);
+   if (entry->owned & PLAYLIST_OWN_LABEL)
+      free(entry->label);
+   if (entry->owned & PLAYLIST_OWN_CORE_PATH)
+      free(entry->core_path);
+   if (entry->owned & PLAYLIST_OWN_CORE_NAME)
+      free(entry->core_name);
+   if (entry->owned & PLAYLIST_OWN_DB_NAME)
+      free(entry->db_name);
+   if (entry->owned & PLAYLIST_OWN_CRC32)
+      free(entry->crc32);
+
+   entry->path      = NULL;
+   entry->label     = NULL;
+   entry->core_path = NULL;
+   entry->core_name = NULL;
+   entry->db_name   = NULL;
+   entry->crc32     = NULL;
+   entry->owned     = 0;
 }
 
 /**
@@ -115,11 +412,36 @@ void playlist_get_index(playlist_t *playlist,
 void playlist_delete_index(playlist_t *playlist,
       size_t idx)
 {
-   if (!playlist)
+   size_t i;
+   size_t slot;
+
+   if (!playlist || idx >= playlist->size)
       return;
 
-   memmove(playlist->entries + idx, playlist->entries + idx + 1,
-         (playlist->size - idx) * sizeof(struct playlist_entry));
+   slot = playlist_slot(playlist, idx);
+   playlist_index_remove(playlist, slot);
+   playlist_free_entry(&playlist->entries[slot]);
+
+   /* Close the gap from whichever side is shorter */
+   if (idx < playlist->size / 2)
+   {
+      for (i = idx; i > 0; i--)
+         playlist_move_entry(playlist,
+               playlist_slot(playlist, i - 1),
+               playlist_slot(playlist, i));
+      slot           = playlist->head;
+      playlist->head = playlist_slot(playlist, 1);
+   }
+   else
+   {
+      for (i = idx; i + 1 < playlist->size; i++)
+         playlist_move_entry(playlist,
+               playlist_slot(playlist, i + 1),
+               playlist_slot(playlist, i));
+      slot = playlist_slot(playlist, playlist->size - 1);
+   }
+
+   memset(&playlist->entries[slot], 0, sizeof(playlist->entries[slot]));
 
    playlist->size     = playlist->size - 1;
    playlist->modified = true;
@@ -133,75 +455,55 @@ void playlist_get_index_by_path(playlist_t *playlist,
       char **db_name)
 {
    size_t i;
+   struct playlist_entry *entry = NULL;
+
    if (!playlist)
       return;
 
-   for (i = 0; i < playlist->size; i++)
-   {
-      if (!string_is_equal(playlist->entries[i].path, search_path))
-         continue;
+   i = playlist_find_path(playlist, search_path);
+   if (i >= playlist->size)
+      return;
 
-      if (path)
-         *path      = playlist->entries[i].path;
-      if (label)
-         *label     = playlist->entries[i].label;
-      if (core_path)
-         *core_path = playlist->entries[i].core_path;
-      if (core_name)
-         *core_name = playlist->entries[i].core_name;
-      if (db_name)
-         *db_name   = playlist->entries[i].db_name;
-      if (crc32)
-         *crc32     = playlist->entries[i].crc32;
-      break;
-   }
+   entry = &playlist->entries[playlist_slot(playlist, i)];
+
+   if (path)
+      *path      = entry->path;
+   if (label)
+      *label     = entry->label;
+   if (core_path)
+      *core_path = entry->core_path;
+   if (core_name)
+      *core_name = entry->core_name;
+   if (db_name)
+      *db_name   = entry->db_name;
+   if (crc32)
+      *crc32     = entry->crc32;
 }
 
 bool playlist_entry_exists(playlist_t *playlist,
       const char *path,
       const char *crc32)
 {
-   size_t i;
    if (!playlist)
       return false;
 
-   for (i = 0; i < playlist->size; i++)
-      if (string_is_equal(playlist->entries[i].path, path))
-         return true;
-
-   return false;
+   return playlist_find_path(playlist, path) < playlist->size;
 }
 
-/**
- * playlist_free_entry:
- * @entry               : Playlist entry handle.
- *
- * Frees playlist entry.
- **/
-static void playlist_free_entry(struct playlist_entry *entry)
+static void playlist_update_field(struct playlist_entry *entry,
+      char **field, unsigned own, const char *value)
 {
-   if (!entry)
-      return;
+   char *copy = strdup(value);
 
-   if (entry->path != NULL)
-      free(entry->path);
-   if (entry->label != NULL)
-      free(entry->label);
-   if (entry->core_path != NULL)
-      free(entry->core_path);
-   if (entry->core_name != NULL)
-      free(entry->core_name);
-   if (entry->db_name != NULL)
-      free(entry->db_name);
-   if (entry->crc32 != NULL)
-      free(entry->crc32);
+   if (entry->owned & own)
+      free(*field);
 
-   entry->path      = NULL;
-   entry->label     = NULL;
-   entry->core_path = NULL;
-   entry->core_name = NULL;
-   entry->db_name   = NULL;
-   entry->crc32     = NULL;
+   *field = copy;
+
+   if (copy)
+      entry->owned |=  own;
+   else
+      entry->owned &= ~own;
 }
 
 void playlist_update(playlist_t *playlist, size_t idx,
@@ -210,63 +512,72 @@ void playlist_update(playlist_t *playlist, size_t idx,
       const char *crc32,
       const char *db_name)
 {
+   size_t slot;
    struct playlist_entry *entry = NULL;
 
-   if (!playlist || idx > playlist->size)
+   if (!playlist || idx >= playlist->size)
       return;
 
-   entry            = &playlist->entries[idx];
+   slot             = playlist_slot(playlist, idx);
+   entry            = &playlist->entries[slot];
 
    if (path && (path != entry->path))
    {
-      if (entry->path != NULL)
-         free(entry->path);
-      entry->path        = strdup(path);
+      playlist_index_remove(playlist, slot);
+      playlist_update_field(entry, &entry->path, PLAYLIST_OWN_PATH, path);
+      entry->hash        = playlist_hash(entry->path);
+      playlist_index_insert(playlist, slot);
       playlist->modified = true;
    }
 
    if (label && (label != entry->label))
    {
-      if (entry->label != NULL)
-         free(entry->label);
-      entry->label       = strdup(label);
+      playlist_update_field(entry, &entry->label, PLAYLIST_OWN_LABEL, label);
       playlist->modified = true;
    }
 
    if (core_path && (core_path != entry->core_path))
    {
-      if (entry->core_path != NULL)
-         free(entry->core_path);
-      entry->core_path   = NULL;
-      entry->core_path   = strdup(core_path);
+      playlist_update_field(entry, &entry->core_path,
+            PLAYLIST_OWN_CORE_PATH, core_path);
       playlist->modified = true;
    }
 
    if (core_name && (core_name != entry->core_name))
    {
-      if (entry->core_name != NULL)
-         free(entry->core_name);
-      entry->core_name   = strdup(core_name);
+      playlist_update_field(entry, &entry->core_name,
+            PLAYLIST_OWN_CORE_NAME, core_name);
       playlist->modified = true;
    }
 
    if (db_name && (db_name != entry->db_name))
    {
-      if (entry->db_name != NULL)
-         free(entry->db_name);
-      entry->db_name     = strdup(db_name);
+      playlist_update_field(entry, &entry->db_name,
+            PLAYLIST_OWN_DB_NAME, db_name);
       playlist->modified = true;
    }
 
    if (crc32 && (crc32 != entry->crc32))
    {
-      if (entry->crc32 != NULL)
-         free(entry->crc32);
-      entry->crc32       = strdup(crc32);
+      playlist_update_field(entry, &entry->crc32,
+            PLAYLIST_OWN_CRC32, crc32);
       playlist->modified = true;
    }
 }
 
+static void playlist_push_field(struct playlist_entry *entry,
+      char **field, unsigned own, const char *value)
+{
+   *field = NULL;
+
+   if (string_is_empty(value))
+      return;
+
+   *field = strdup(value);
+   if (*field)
+      entry->owned |= own;
+}
+
 /**
  * playlist_push:
  * @playlist        	   : Playlist handle.
@@ -283,8 +594,9 @@ bool playlist_push(playlist_t *playlist,
       const char *db_name)
 {
    size_t i;
-   bool core_path_empty = string_is_empty(core_path);
-   bool core_name_empty = string_is_empty(core_name);
+   struct playlist_entry *entry = NULL;
+   bool core_path_empty         = string_is_empty(core_path);
+   bool core_name_empty         = string_is_empty(core_name);
 
    if (core_path_empty || core_name_empty)
    {
@@ -305,31 +617,17 @@ bool playlist_push(playlist_t *playlist,
    if (string_is_empty(path))
       path = NULL;
 
-   if (!playlist)
+   if (!playlist || !playlist->cap)
       return false;
 
-   for (i = 0; i < playlist->size; i++)
+   /* Core name can have changed while still being the same core.
+    * Differentiate based on the core path only. */
+   i = playlist_find_push(playlist, path, core_path);
+
+   if (i < playlist->size)
    {
       struct playlist_entry tmp;
-      bool equal_path;
-
-      equal_path = (!path && !playlist->entries[i].path) ||
-         (path && playlist->entries[i].path &&
-#ifdef _WIN32
-          /*prevent duplicates on case-insensitive operating systems*/
-          string_is_equal_noncase(path,playlist->entries[i].path)
-#else
-          string_is_equal(path,playlist->entries[i].path)
-#endif
-          );
-
-      /* Core name can have changed while still being the same core.
-       * Differentiate based on the core path only. */
-      if (!equal_path)
-         continue;
-
-      if (!string_is_equal(playlist->entries[i].core_path, core_path))
-         continue;
+      size_t slot;
 
       /* If top entry, we don't want to push a new entry since
        * the top and the entry to be pushed are the same. */
@@ -337,47 +635,52 @@ bool playlist_push(playlist_t *playlist,
          return false;
 
       /* Seen it before, bump to top. */
-      tmp = playlist->entries[i];
-      memmove(playlist->entries + 1, playlist->entries,
-            i * sizeof(struct playlist_entry));
-      playlist->entries[0] = tmp;
+      slot = playlist_slot(playlist, i);
+      tmp  = playlist->entries[slot];
+      playlist_index_remove(playlist, slot);
+
+      for (; i > 0; i--)
+         playlist_move_entry(playlist,
+               playlist_slot(playlist, i - 1),
+               playlist_slot(playlist, i));
+
+      playlist->entries[playlist->head] = tmp;
+      playlist_index_insert(playlist, playlist->head);
 
       goto success;
    }
 
+   if (!playlist_index_reserve(playlist, playlist->size + 1))
+      return false;
+
    if (playlist->size == playlist->cap)
    {
-      struct playlist_entry *entry = &playlist->entries[playlist->cap - 1];
+      size_t last = playlist_slot(playlist, playlist->size - 1);
 
-      if (entry)
-         playlist_free_entry(entry);
+      playlist_index_remove(playlist, last);
+      playlist_free_entry(&playlist->entries[last]);
       playlist->size--;
    }
 
-   if (playlist->entries)
-   {
-      memmove(playlist->entries + 1, playlist->entries,
-            (playlist->cap - 1) * sizeof(struct playlist_entry));
-
-      playlist->entries[0].path         = NULL;
-      playlist->entries[0].label        = NULL;
-      playlist->entries[0].core_path    = NULL;
-      playlist->entries[0].core_name    = NULL;
-      playlist->entries[0].db_name      = NULL;
-      playlist->entries[0].crc32        = NULL;
-      if (!string_is_empty(path))
-         playlist->entries[0].path      = strdup(path);
-      if (!string_is_empty(label))
-         playlist->entries[0].label     = strdup(label);
-      if (!string_is_empty(core_path))
-         playlist->entries[0].core_path = strdup(core_path);
-      if (!string_is_empty(core_name))
-         playlist->entries[0].core_name = strdup(core_name);
-      if (!string_is_empty(db_name))
-         playlist->entries[0].db_name   = strdup(db_name);
-      if (!string_is_empty(crc32))
-         playlist->entries[0].crc32     = strdup(crc32);
-   }
+   playlist->head = playlist_slot(playlist, playlist->cap - 1);
+   entry          = &playlist->entries[playlist->head];
+   entry->owned   = 0;
+
+   playlist_push_field(entry, &entry->path,
+         PLAYLIST_OWN_PATH, path);
+   playlist_push_field(entry, &entry->label,
+         PLAYLIST_OWN_LABEL, label);
+   playlist_push_field(entry, &entry->core_path,
+         PLAYLIST_OWN_CORE_PATH, core_path);
+   playlist_push_field(entry, &entry->core_name,
+         PLAYLIST_OWN_CORE_NAME, core_name);
+   playlist_push_field(entry, &entry->db_name,
+         PLAYLIST_OWN_DB_NAME, db_name);
+   playlist_push_field(entry, &entry->crc32,
+         PLAYLIST_OWN_CRC32, crc32);
+
+   entry->hash    = playlist_hash(entry->path);
+   playlist_index_insert(playlist, playlist->head);
 
    playlist->size++;
 
@@ -387,6 +690,129 @@ success:
    return true;
 }
 
+static bool playlist_cache_enabled(void)
+{
+   settings_t *settings = config_get_ptr();
+   return settings && settings->bools.playlist_cache_enable;
+}
+
+static void playlist_get_cache_path(playlist_t *playlist,
+      char *s, size_t len)
+{
+   strlcpy(s, playlist->conf_path, len);
+   strlcat(s, ".cache", len);
+}
+
+/**
+ * playlist_write_cache:
+ * @playlist            : Playlist handle.
+ *
+ * Writes the binary cache of the playlist, stamped with
+ * the modification time and size its playlist file has
+ * right now. playlist_read_cache only accepts a cache
+ * whose stamp still matches the playlist file.
+ **/
+static void playlist_write_cache(playlist_t *playlist)
+{
+   size_t i;
+   unsigned j;
+   struct playlist_cache_header header;
+   char cache_path[PATH_MAX_LENGTH];
+   size_t strings_size            = 0;
+   size_t records_size            = 0;
+   uint8_t *buf                   = NULL;
+   char *strings                  = NULL;
+   struct playlist_cache_record *records = NULL;
+
+   header.mtime = path_get_mtime(playlist->conf_path);
+   header.size  = path_get_size(playlist->conf_path);
+
+   if (header.mtime < 0 || header.size < 0)
+      return;
+
+   for (i = 0; i < playlist->size; i++)
+   {
+      const struct playlist_entry *entry =
+         &playlist->entries[playlist_slot(playlist, i)];
+      const char *fields[PLAYLIST_ENTRIES];
+
+      fields[0] = entry->path;
+      fields[1] = entry->label;
+      fields[2] = entry->core_path;
+      fields[3] = entry->core_name;
+      fields[4] = entry->crc32;
+      fields[5] = entry->db_name;
+
+      for (j = 0; j < PLAYLIST_ENTRIES; j++)
+         if (fields[j])
+            strings_size += strlen(fields[j]) + 1;
+   }
+
+   if (strings_size >= UINT32_MAX)
+      return;
+
+   records_size = playlist->size * sizeof(*records);
+   buf          = (uint8_t*)malloc(sizeof(header)
+         + records_size + strings_size);
+   if (!buf)
+      return;
+
+   records      = (struct playlist_cache_record*)(buf + sizeof(header));
+   strings      = (char*)buf + sizeof(header) + records_size;
+   strings_size = 0;
+
+   for (i = 0; i < playlist->size; i++)
+   {
+      const struct playlist_entry *entry =
+         &playlist->entries[playlist_slot(playlist, i)];
+      const char *fields[PLAYLIST_ENTRIES];
+
+      fields[0] = entry->path;
+      fields[1] = entry->label;
+      fields[2] = entry->core_path;
+      fields[3] = entry->core_name;
+      fields[4] = entry->crc32;
+      fields[5] = entry->db_name;
+
+      records[i].hash = entry->hash;
+
+      for (j = 0; j < PLAYLIST_ENTRIES; j++)
+      {
+         size_t len;
+
+         records[i].fields[j] = 0;
+         if (!fields[j])
+            continue;
+
+         len                  = strlen(fields[j]) + 1;
+         records[i].fields[j] = (uint32_t)(strings_size + 1);
+         memcpy(strings + strings_size, fields[j], len);
+         strings_size        += len;
+      }
+   }
+
+   header.magic        = PLAYLIST_CACHE_MAGIC;
+   header.version      = PLAYLIST_CACHE_VERSION;
+   header.count        = (uint32_t)playlist->size;
+   header.strings_size = (uint32_t)strings_size;
+   memcpy(buf, &header, sizeof(header));
+
+   playlist_get_cache_path(playlist, cache_path, sizeof(cache_path));
+
+   if (!filestream_write_file(cache_path, buf,
+            sizeof(header) + records_size + strings_size))
+      RARCH_WARN("Failed to write playlist cache: %s\n", cache_path);
+
+   free(buf);
+}
+
+/**
+ * playlist_write_file:
+ * @playlist            : Playlist handle.
+ *
+ * Writes the playlist to its file if it was modified,
+ * and refreshes its binary cache if that is enabled.
+ **/
 void playlist_write_file(playlist_t *playlist)
 {
    size_t i;
@@ -405,74 +831,85 @@ void playlist_write_file(playlist_t *playlist)
    }
 
    for (i = 0; i < playlist->size; i++)
+   {
+      const struct playlist_entry *entry =
+         &playlist->entries[playlist_slot(playlist, i)];
+
       filestream_printf(file, "%s\n%s\n%s\n%s\n%s\n%s\n",
-            playlist->entries[i].path    ? playlist->entries[i].path    : "",
-            playlist->entries[i].label   ? playlist->entries[i].label   : "",
-            playlist->entries[i].core_path,
-            playlist->entries[i].core_name,
-            playlist->entries[i].crc32   ? playlist->entries[i].crc32   : "",
-            playlist->entries[i].db_name ? playlist->entries[i].db_name : ""
+            entry->path    ? entry->path    : "",
+            entry->label   ? entry->label   : "",
+            entry->core_path,
+            entry->core_name,
+            entry->crc32   ? entry->crc32   : "",
+            entry->db_name ? entry->db_name : ""
             );
+   }
 
    playlist->modified = false;
 
    RARCH_LOG("Written to playlist file: %s\n", playlist->conf_path);
 
    filestream_close(file);
+
+   if (playlist_cache_enabled())
+      playlist_write_cache(playlist);
 }
 
 /**
- * playlist_free:
- * @playlist            : Playlist handle.
+ * playlist_clear:
+ * @playlist        	   : Playlist handle.
  *
- * Frees playlist handle.
- */
-void playlist_free(playlist_t *playlist)
+ * Clears all playlist entries in playlist.
+ **/
+void playlist_clear(playlist_t *playlist)
 {
    size_t i;
-
    if (!playlist)
       return;
 
-   if (playlist->conf_path != NULL)
-      free(playlist->conf_path);
-
-   playlist->conf_path = NULL;
-
    for (i = 0; i < playlist->size; i++)
-   {
-      struct playlist_entry *entry = &playlist->entries[i];
+      playlist_free_entry(&playlist->entries[playlist_slot(playlist, i)]);
 
-      if (entry)
-         playlist_free_entry(entry);
+   while (playlist->blocks)
+   {
+      struct playlist_block *next = playlist->blocks->next;
+      free(playlist->blocks);
+      playlist->blocks = next;
    }
 
-   free(playlist->entries);
-   playlist->entries = NULL;
+   if (playlist->index)
+      memset(playlist->index, 0,
+            (playlist->index_mask + 1) * sizeof(*playlist->index));
 
-   free(playlist);
+   playlist->size = 0;
+   playlist->head = 0;
 }
 
 /**
- * playlist_clear:
- * @playlist        	   : Playlist handle.
+ * playlist_free:
+ * @playlist            : Playlist handle.
  *
- * Clears all playlist entries in playlist.
- **/
-void playlist_clear(playlist_t *playlist)
+ * Frees playlist handle.
+ */
+void playlist_free(playlist_t *playlist)
 {
-   size_t i;
    if (!playlist)
       return;
 
-   for (i = 0; i < playlist->size; i++)
-   {
-      struct playlist_entry *entry = &playlist->entries[i];
+   playlist_clear(playlist);
 
-      if (entry)
-         playlist_free_entry(entry);
-   }
-   playlist->size = 0;
+   if (playlist->conf_path != NULL)
+      free(playlist->conf_path);
+
+   playlist->conf_path = NULL;
+
+   free(playlist->index);
+   playlist->index = NULL;
+
+   free(playlist->entries);
+   playlist->entries = NULL;
+
+   free(playlist);
 }
 
 /**
@@ -489,71 +926,236 @@ size_t playlist_size(playlist_t *playlist)
    return playlist->size;
 }
 
+/**
+ * playlist_read_block:
+ * @playlist            : Playlist handle.
+ * @path                : File to read.
+ * @len                 : Number of bytes read.
+ *
+ * Reads a whole file into a new block owned by @playlist,
+ * followed by a NUL byte.
+ *
+ * Returns: the file data, or NULL if the file can't be read.
+ **/
+static char *playlist_read_block(playlist_t *playlist,
+      const char *path, size_t *len)
+{
+   int64_t size                 = 0;
+   struct playlist_block *block = NULL;
+   char *data                   = NULL;
+   RFILE *file                  = filestream_open(path,
+         RETRO_VFS_FILE_ACCESS_READ,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (!file)
+      return NULL;
+
+   size = filestream_get_size(file);
+   if (size < 0 || (uint64_t)size >= SIZE_MAX - sizeof(*block))
+      goto error;
+
+   block = (struct playlist_block*)malloc(
+         sizeof(*block) + (size_t)size + 1);
+   if (!block)
+      goto error;
+
+   data = (char*)(block + 1);
+
+   if (size && filestream_read(file, data, size) != size)
+      goto error;
+
+   filestream_close(file);
+
+   data[size]       = '\0';
+   *len             = (size_t)size;
+   block->next      = playlist->blocks;
+   playlist->blocks = block;
+
+   return data;
+
+error:
+   filestream_close(file);
+   free(block);
+   return NULL;
+}
+
+static char *playlist_next_line(char **s, char *end)
+{
+   char *line = *s;
+   char *eol  = NULL;
+
+   if (line >= end)
+      return NULL;
+
+   eol = (char*)memchr(line, '\n', end - line);
+   if (!eol)
+      eol = end;
 
+   *s   = eol + 1;
+   *eol = '\0';
+
+   /* Terminate regardless of Windows or Unix line endings */
+   if (eol > line && eol[-1] == '\r')
+      eol[-1] = '\0';
+
+   return line;
+}
+
+/**
+ * playlist_read_file:
+ * @playlist            : Playlist handle.
+ * @path                : Path to playlist file.
+ *
+ * Loads the entries of a playlist file. The file is read
+ * into a single block and split in place, the entries
+ * point into it rather than owning copies of their lines.
+ **/
 static bool playlist_read_file(
       playlist_t *playlist, const char *path)
 {
-   unsigned i;
-   char buf[PLAYLIST_ENTRIES][1024];
-   intfstream_t *file = intfstream_open_file(
-         path, RETRO_VFS_FILE_ACCESS_READ,
-         RETRO_VFS_FILE_ACCESS_HINT_NONE);
+   size_t len = 0;
+   char *end  = NULL;
+   char *s    = playlist_read_block(playlist, path, &len);
 
    /* If playlist file does not exist,
     * create an empty playlist instead.
     */
-   if (!file)
+   if (!s)
       return true;
 
-   for (i = 0; i < PLAYLIST_ENTRIES; i++)
-      buf[i][0] = '\0';
+   end = s + len;
 
    for (playlist->size = 0; playlist->size < playlist->cap; )
    {
       unsigned i;
+      char *buf[PLAYLIST_ENTRIES];
       struct playlist_entry *entry     = NULL;
-      for (i = 0; i < PLAYLIST_ENTRIES; i++)
-      {
-         char *last  = NULL;
-         *buf[i]     = '\0';
 
-         if (!intfstream_gets(file, buf[i], sizeof(buf[i])))
+      for (i = 0; i < PLAYLIST_ENTRIES; i++)
+         if (!(buf[i] = playlist_next_line(&s, end)))
             goto end;
 
-         /* Read playlist entry and terminate string with NUL character
-          * regardless of Windows or Unix line endings
-          */
-         if((last = strrchr(buf[i], '\r')))
-            *last = '\0';
-         else if((last = strrchr(buf[i], '\n')))
-            *last = '\0';
-      }
-
-      entry = &playlist->entries[playlist->size];
-
       if (!*buf[2] || !*buf[3])
          continue;
 
-      if (*buf[0])
-         entry->path      = strdup(buf[0]);
-      if (*buf[1])
-         entry->label     = strdup(buf[1]);
-
-      entry->core_path    = strdup(buf[2]);
-      entry->core_name    = strdup(buf[3]);
-      if (*buf[4])
-         entry->crc32     = strdup(buf[4]);
-      if (*buf[5])
-         entry->db_name   = strdup(buf[5]);
+      if (!playlist_index_reserve(playlist, playlist->size + 1))
+         break;
+
+      entry            = &playlist->entries[playlist->size];
+      entry->path      = *buf[0] ? buf[0] : NULL;
+      entry->label     = *buf[1] ? buf[1] : NULL;
+      entry->core_path = buf[2];
+      entry->core_name = buf[3];
+      entry->crc32     = *buf[4] ? buf[4] : NULL;
+      entry->db_name   = *buf[5] ? buf[5] : NULL;
+      entry->hash      = playlist_hash(entry->path);
+      entry->owned     = 0;
+
+      playlist_index_insert(playlist, playlist->size);
       playlist->size++;
    }
 
 end:
-   intfstream_close(file);
-   free(file);
    return true;
 }
 
+/**
+ * playlist_read_cache:
+ * @playlist            : Playlist handle.
+ * @mtime               : Modification time of the playlist file.
+ * @size                : Size of the playlist file.
+ *
+ * Loads the entries from the binary cache of the playlist,
+ * if there is one and it was built from the playlist file
+ * as it is now.
+ *
+ * Returns: true if the entries were loaded from the cache.
+ **/
+static bool playlist_read_cache(playlist_t *playlist,
+      int64_t mtime, int64_t size)
+{
+   size_t i, count;
+   struct playlist_cache_header header;
+   char cache_path[PATH_MAX_LENGTH];
+   size_t len          = 0;
+   const uint8_t *recs = NULL;
+   char *strings       = NULL;
+   char *data          = NULL;
+
+   playlist_get_cache_path(playlist, cache_path, sizeof(cache_path));
+
+   if (!path_is_valid(cache_path))
+      return false;
+
+   data = playlist_read_block(playlist, cache_path, &len);
+   if (!data || len < sizeof(header))
+      goto error;
+
+   memcpy(&header, data, sizeof(header));
+
+   if (     header.magic   != PLAYLIST_CACHE_MAGIC
+         || header.version != PLAYLIST_CACHE_VERSION
+         || header.mtime   != mtime
+         || header.size    != size)
+      goto error;
+
+   if ((len - sizeof(header)) / sizeof(struct playlist_cache_record)
+         < header.count)
+      goto error;
+
+   recs    = (const uint8_t*)data + sizeof(header);
+   strings = data + sizeof(header)
+      + header.count * sizeof(struct playlist_cache_record);
+
+   if ((size_t)(data + len - strings) != header.strings_size
+         || (header.strings_size && strings[header.strings_size - 1]))
+      goto error;
+
+   count = MIN(header.count, playlist->cap);
+
+   if (!playlist_index_reserve(playlist, count))
+      goto error;
+
+   for (i = 0; i < count; i++)
+   {
+      unsigned j;
+      struct playlist_cache_record rec;
+      char *fields[PLAYLIST_ENTRIES];
+      struct playlist_entry *entry = &playlist->entries[i];
+
+      memcpy(&rec, recs + i * sizeof(rec), sizeof(rec));
+
+      for (j = 0; j < PLAYLIST_ENTRIES; j++)
+      {
+         if (rec.fields[j] > header.strings_size)
+            goto error;
+         fields[j] = rec.fields[j] ? strings + rec.fields[j] - 1 : NULL;
+      }
+
+      if (!fields[2] || !fields[3])
+         goto error;
+
+      entry->path      = fields[0];
+      entry->label     = fields[1];
+      entry->core_path = fields[2];
+      entry->core_name = fields[3];
+      entry->crc32     = fields[4];
+      entry->db_name   = fields[5];
+      entry->hash      = rec.hash;
+      entry->owned     = 0;
+
+      playlist_index_insert(playlist, i);
+      playlist->size++;
+   }
+
+   return true;
+
+error:
+   RARCH_WARN("Ignoring invalid playlist cache: %s\n", cache_path);
+   playlist_clear(playlist);
+   return false;
+}
+
 /**
  * playlist_init:
  * @path            	   : Path to playlist contents file.
@@ -565,6 +1167,9 @@ end:
  **/
 playlist_t *playlist_init(const char *path, size_t size)
 {
+   int64_t file_mtime             = -1;
+   int64_t file_size              = -1;
+   bool use_cache                 = playlist_cache_enabled();
    struct playlist_entry *entries = NULL;
    playlist_t           *playlist = (playlist_t*)malloc(sizeof(*playlist));
    if (!playlist)
@@ -577,14 +1182,32 @@ playlist_t *playlist_init(const char *path, size_t size)
       return NULL;
    }
 
-   playlist->modified  = false;
-   playlist->size      = 0;
-   playlist->cap       = size;
-   playlist->conf_path = strdup(path);
-   playlist->entries   = entries;
+   playlist->modified   = false;
+   playlist->size       = 0;
+   playlist->cap        = size;
+   playlist->head       = 0;
+   playlist->index_mask = 0;
+   playlist->conf_path  = strdup(path);
+   playlist->index      = NULL;
+   playlist->entries    = entries;
+   playlist->blocks     = NULL;
+
+   if (use_cache)
+   {
+      file_mtime = path_get_mtime(path);
+      file_size  = path_get_size(path);
+
+      if (file_mtime >= 0 && file_size >= 0
+            && playlist_read_cache(playlist, file_mtime, file_size))
+         return playlist;
+   }
 
    playlist_read_file(playlist, path);
 
+   /* Missing or stale, the next load can use it */
+   if (use_cache && file_mtime >= 0 && file_size >= 0)
+      playlist_write_cache(playlist);
+
    return playlist;
 }
 
@@ -600,9 +1223,36 @@ static int playlist_qsort_func(const struct playlist_entry *a,
    return strcasecmp(a_label, b_label);
 }
 
+static void playlist_reverse(struct playlist_entry *entries, size_t len)
+{
+   size_t i;
+
+   for (i = 0; i < len / 2; i++)
+   {
+      struct playlist_entry tmp = entries[i];
+      entries[i]                = entries[len - 1 - i];
+      entries[len - 1 - i]      = tmp;
+   }
+}
+
 void playlist_qsort(playlist_t *playlist)
 {
+   if (!playlist || !playlist->size)
+      return;
+
+   /* Rotate the ring so entry 0 is in slot 0 again */
+   if (playlist->head)
+   {
+      playlist_reverse(playlist->entries, playlist->head);
+      playlist_reverse(playlist->entries + playlist->head,
+            playlist->cap - playlist->head);
+      playlist_reverse(playlist->entries, playlist->cap);
+      playlist->head = 0;
+   }
+
    qsort(playlist->entries, playlist->size,
          sizeof(struct playlist_entry),
          (int (*)(const void *, const void *))playlist_qsort_func);
+
+   playlist_index_rebuild(playlist);
 }
@@ -103,6 +103,7 @@
 #include "camera/camera_driver.h"
 #include "record/record_driver.h"
 #include "core.h"
+#include "runahead.h"
 #include "configuration.h"
 #include "list_special.h"
 #include "managers/core_option_manager.h"
@@ -1760,6 +1761,7 @@ bool rarch_ctl(enum rarch_ctl_state state, void *data)
             bool threaded_enable = false;
 #endif
             task_queue_deinit();
+            task_queue_set_worker_count(cpu_features_get_core_amount());
             task_queue_init(threaded_enable, runloop_msg_queue_push);
          }
          break;
@@ -3187,7 +3189,11 @@ int runloop_iterate(unsigned *sleep_ms)
    if ((settings->uints.video_frame_delay > 0) && !input_nonblock_state)
       retro_sleep(settings->uints.video_frame_delay);
 
-   core_run();
+   if (settings->bools.run_ahead_enabled && !input_nonblock_state)
+      runahead_run(settings->uints.run_ahead_frames,
+            settings->bools.run_ahead_secondary_instance);
+   else
+      core_run();
 
 #ifdef HAVE_CHEEVOS
    if (runloop_check_cheevos())
@@ -0,0 +1,540 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <boolean.h>
+#include <libretro.h>
+#include <compat/strl.h>
+#include <file/file_path.h>
+#include <features/features_cpu.h>
+#include <streams/file_stream.h>
+#include <string/stdstring.h>
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef HAVE_NETWORKING
+#include "network/netplay/netplay.h"
+#endif
+
+#include "runahead.h"
+#include "configuration.h"
+#include "dynamic.h"
+#include "paths.h"
+#include "verbosity.h"
+#include "gfx/video_driver.h"
+#include "input/input_driver.h"
+#include "managers/state_manager.h"
+
+static void    *runahead_state                = NULL;
+static size_t   runahead_state_size           = 0;
+static bool     runahead_unavailable          = false;
+
+/* Accumulated cost, reported on deinit. */
+static uint64_t     runahead_frame_count      = 0;
+static retro_time_t runahead_time_total       = 0;
+static retro_time_t runahead_time_base        = 0;
+
+#ifdef HAVE_DYNAMIC
+struct runahead_content
+{
+   char *path;
+   char *meta;
+   void *data;
+   size_t size;
+   bool loaded;
+   bool contentless;
+};
+
+static struct runahead_content runahead_content;
+static struct retro_core_t secondary_core;
+static char secondary_library_path[PATH_MAX_LENGTH];
+static bool secondary_inited                  = false;
+static bool secondary_unavailable             = false;
+#endif
+
+static bool runahead_is_possible(void)
+{
+   if (runahead_unavailable || !core_is_game_loaded())
+      return false;
+#ifdef HAVE_NETWORKING
+   /* Netplay does its own rollback. */
+   if (netplay_driver_ctl(RARCH_NETPLAY_CTL_IS_ENABLED, NULL))
+      return false;
+#endif
+   if (state_manager_frame_is_reversed())
+      return false;
+   return true;
+}
+
+static bool runahead_create_state(void)
+{
+   retro_ctx_size_info_t info;
+
+   if (runahead_state)
+      return true;
+
+   info.size = 0;
+   core_serialize_size(&info);
+
+   if (info.size == 0)
+   {
+      RARCH_WARN("[Run-Ahead]: Core does not support save states, "
+            "run-ahead disabled.\n");
+      runahead_unavailable = true;
+      return false;
+   }
+
+   runahead_state = malloc(info.size);
+   if (!runahead_state)
+   {
+      runahead_unavailable = true;
+      return false;
+   }
+
+   runahead_state_size = info.size;
+   return true;
+}
+
+static bool runahead_save_state(void)
+{
+   retro_ctx_serialize_info_t serial_info;
+
+   serial_info.data       = runahead_state;
+   serial_info.data_const = NULL;
+   serial_info.size       = runahead_state_size;
+
+   if (core_serialize(&serial_info))
+      return true;
+
+   RARCH_WARN("[Run-Ahead]: Failed to serialize state, "
+         "run-ahead disabled.\n");
+   runahead_unavailable = true;
+   return false;
+}
+
+static bool runahead_load_state(void)
+{
+   retro_ctx_serialize_info_t serial_info;
+
+   serial_info.data       = NULL;
+   serial_info.data_const = runahead_state;
+   serial_info.size       = runahead_state_size;
+
+   if (core_unserialize(&serial_info))
+      return true;
+
+   RARCH_WARN("[Run-Ahead]: Failed to unserialize state, "
+         "run-ahead disabled.\n");
+   runahead_unavailable = true;
+   return false;
+}
+
+#ifdef HAVE_DYNAMIC
+static void runahead_frame_null(const void *data, unsigned width,
+      unsigned height, size_t pitch)
+{
+}
+
+static void runahead_input_poll_null(void)
+{
+}
+
+static void runahead_audio_sample_null(int16_t left, int16_t right)
+{
+}
+
+static size_t runahead_audio_sample_batch_null(const int16_t *data,
+      size_t frames)
+{
+   return frames;
+}
+
+static void runahead_content_free(void)
+{
+   free(runahead_content.path);
+   free(runahead_content.meta);
+   free(runahead_content.data);
+   memset(&runahead_content, 0, sizeof(runahead_content));
+}
+
+/**
+ * runahead_secondary_environment_cb:
+ *
+ * Environment callback of the secondary core. Queries are
+ * forwarded to the frontend, but anything that would register
+ * callbacks or reconfigure frontend state is swallowed so the
+ * secondary instance never clobbers what the primary core set up.
+ **/
+static bool runahead_secondary_environment_cb(unsigned cmd, void *data)
+{
+   switch (cmd)
+   {
+      case RETRO_ENVIRONMENT_SET_HW_RENDER:
+      case RETRO_ENVIRONMENT_SET_HW_SHARED_CONTEXT:
+      case RETRO_ENVIRONMENT_SET_HW_RENDER_CONTEXT_NEGOTIATION_INTERFACE:
+         return false;
+      case RETRO_ENVIRONMENT_GET_VARIABLE_UPDATE:
+         /* Must not consume the primary core's update flag. */
+         *(bool*)data = false;
+         return true;
+      case RETRO_ENVIRONMENT_SHUTDOWN:
+      case RETRO_ENVIRONMENT_SET_ROTATION:
+      case RETRO_ENVIRONMENT_SET_MESSAGE:
+      case RETRO_ENVIRONMENT_SET_PERFORMANCE_LEVEL:
+      case RETRO_ENVIRONMENT_SET_PIXEL_FORMAT:
+      case RETRO_ENVIRONMENT_SET_INPUT_DESCRIPTORS:
+      case RETRO_ENVIRONMENT_SET_KEYBOARD_CALLBACK:
+      case RETRO_ENVIRONMENT_SET_DISK_CONTROL_INTERFACE:
+      case RETRO_ENVIRONMENT_SET_VARIABLES:
+      case RETRO_ENVIRONMENT_SET_SUPPORT_NO_GAME:
+      case RETRO_ENVIRONMENT_SET_AUDIO_CALLBACK:
+      case RETRO_ENVIRONMENT_SET_FRAME_TIME_CALLBACK:
+      case RETRO_ENVIRONMENT_SET_SYSTEM_AV_INFO:
+      case RETRO_ENVIRONMENT_SET_PROC_ADDRESS_CALLBACK:
+      case RETRO_ENVIRONMENT_SET_SUBSYSTEM_INFO:
+      case RETRO_ENVIRONMENT_SET_CONTROLLER_INFO:
+      case RETRO_ENVIRONMENT_SET_MEMORY_MAPS:
+      case RETRO_ENVIRONMENT_SET_GEOMETRY:
+      case RETRO_ENVIRONMENT_SET_SUPPORT_ACHIEVEMENTS:
+      case RETRO_ENVIRONMENT_SET_SERIALIZATION_QUIRKS:
+         return true;
+      default:
+         break;
+   }
+
+   return rarch_environment_cb(cmd, data);
+}
+
+static bool runahead_secondary_copy_library(void)
+{
+   char tmp_dir[PATH_MAX_LENGTH];
+   void *buf                = NULL;
+   ssize_t len              = 0;
+   settings_t *settings     = config_get_ptr();
+   const char *core_path    = path_get(RARCH_PATH_CORE);
+   bool ret                 = false;
+
+   tmp_dir[0]               = '\0';
+
+   if (string_is_empty(core_path))
+      return false;
+
+   if (!string_is_empty(settings->paths.directory_cache))
+      strlcpy(tmp_dir, settings->paths.directory_cache, sizeof(tmp_dir));
+   else
+   {
+#ifdef _WIN32
+      const char *env = getenv("TEMP");
+#else
+      const char *env = getenv("TMPDIR");
+#endif
+      strlcpy(tmp_dir, string_is_empty(env) ? "/tmp" : env,
+            sizeof(tmp_dir));
+   }
+
+   /* The dynamic linker hands out the already loaded instance
+    * when the same library is opened twice, so the secondary
+    * core has to be loaded from a private copy. */
+   fill_pathname_join(secondary_library_path, tmp_dir,
+         "retroarch_runahead_", sizeof(secondary_library_path));
+   strlcat(secondary_library_path, path_basename(core_path),
+         sizeof(secondary_library_path));
+
+   if (!filestream_read_file(core_path, &buf, &len))
+      return false;
+
+   ret = filestream_write_file(secondary_library_path, buf, len);
+   free(buf);
+
+   if (!ret)
+      RARCH_WARN("[Run-Ahead]: Could not write \"%s\".\n",
+            secondary_library_path);
+
+   return ret;
+}
+
+static void runahead_secondary_deinit(void)
+{
+   if (secondary_inited)
+   {
+      if (secondary_core.game_loaded)
+         secondary_core.retro_unload_game();
+      if (secondary_core.inited)
+         secondary_core.retro_deinit();
+   }
+
+   uninit_libretro_sym_secondary(&secondary_core);
+
+   if (!string_is_empty(secondary_library_path))
+      filestream_delete(secondary_library_path);
+
+   secondary_library_path[0] = '\0';
+   secondary_inited          = false;
+}
+
+static bool runahead_secondary_init(void)
+{
+   unsigned i;
+   struct retro_game_info info;
+   settings_t *settings = config_get_ptr();
+   unsigned max_users   = *(input_driver_get_uint(INPUT_ACTION_MAX_USERS));
+
+   if (secondary_inited)
+      return true;
+   if (secondary_unavailable)
+      return false;
+
+   /* Only ever try once per content. */
+   secondary_unavailable = true;
+
+   if (video_driver_is_hw_context())
+   {
+      RARCH_WARN("[Run-Ahead]: Secondary instance is not supported "
+            "with hardware rendered cores.\n");
+      return false;
+   }
+
+   if (!runahead_content.loaded)
+   {
+      RARCH_WARN("[Run-Ahead]: Secondary instance needs the content "
+            "to be reloaded after enabling it.\n");
+      return false;
+   }
+
+   if (!runahead_secondary_copy_library())
+      goto error;
+
+   if (!init_libretro_sym_secondary(secondary_library_path,
+            &secondary_core))
+      goto error;
+
+   if (secondary_core.retro_api_version() != RETRO_API_VERSION)
+      goto error;
+
+   secondary_core.retro_set_environment(runahead_secondary_environment_cb);
+   secondary_core.retro_set_video_refresh(runahead_frame_null);
+   secondary_core.retro_set_audio_sample(runahead_audio_sample_null);
+   secondary_core.retro_set_audio_sample_batch(
+         runahead_audio_sample_batch_null);
+   secondary_core.retro_set_input_poll(runahead_input_poll_null);
+   secondary_core.retro_set_input_state(input_state);
+
+   secondary_core.retro_init();
+   secondary_core.inited = true;
+
+   info.path = runahead_content.path;
+   info.data = runahead_content.data;
+   info.size = runahead_content.size;
+   info.meta = runahead_content.meta;
+
+   secondary_core.game_loaded = secondary_core.retro_load_game(
+         runahead_content.contentless ? NULL : &info);
+
+   if (!secondary_core.game_loaded)
+      goto error;
+
+   if (secondary_core.retro_serialize_size() != runahead_state_size)
+   {
+      RARCH_WARN("[Run-Ahead]: Secondary instance state size "
+            "does not match.\n");
+      goto error;
+   }
+
+   for (i = 0; i < max_users; i++)
+      secondary_core.retro_set_controller_port_device(i,
+            settings->uints.input_libretro_device[i]);
+
+   secondary_inited      = true;
+   secondary_unavailable = false;
+
+   RARCH_LOG("[Run-Ahead]: Secondary instance loaded from \"%s\".\n",
+         secondary_library_path);
+   return true;
+
+error:
+   RARCH_WARN("[Run-Ahead]: Could not start secondary instance, "
+         "falling back to single instance.\n");
+   secondary_inited = true;
+   runahead_secondary_deinit();
+   return false;
+}
+
+/* The primary core runs the real frame with audio, the secondary
+ * instance is brought to the same state and runs ahead silently. */
+static void runahead_run_secondary(unsigned frames,
+      retro_time_t *base_time)
+{
+   unsigned i;
+   retro_time_t start;
+
+   core_set_output_suspended(true, false);
+   start      = cpu_features_get_time_usec();
+   core_run();
+   *base_time = cpu_features_get_time_usec() - start;
+   core_set_output_suspended(false, false);
+
+   if (!runahead_save_state())
+      return;
+
+   if (!secondary_core.retro_unserialize(runahead_state,
+            runahead_state_size))
+   {
+      RARCH_WARN("[Run-Ahead]: Secondary instance failed to "
+            "unserialize, falling back to single instance.\n");
+      runahead_secondary_deinit();
+      secondary_unavailable = true;
+      return;
+   }
+
+   for (i = 1; i <= frames; i++)
+   {
+      secondary_core.retro_set_video_refresh(
+            (i == frames) ? video_driver_frame : runahead_frame_null);
+      secondary_core.retro_run();
+   }
+}
+#endif
+
+/* Runs the real frame with all output discarded, saves the
+ * state, runs ahead and presents the last frame, then rolls
+ * back to the saved state. */
+static void runahead_run_single(unsigned frames,
+      retro_time_t *base_time)
+{
+   unsigned i;
+   retro_time_t start;
+
+   core_set_output_suspended(true, true);
+
+   start      = cpu_features_get_time_usec();
+   core_run();
+   *base_time = cpu_features_get_time_usec() - start;
+
+   if (!runahead_save_state())
+   {
+      core_set_output_suspended(false, false);
+      return;
+   }
+
+   for (i = 1; i < frames; i++)
+      core_run_no_input_polling();
+
+   core_set_output_suspended(false, false);
+   core_run_no_input_polling();
+
+   runahead_load_state();
+}
+
+void runahead_run(unsigned frames, bool use_secondary)
+{
+   retro_time_t start;
+   retro_time_t base_time = 0;
+
+   if (frames == 0 || !runahead_is_possible() || !runahead_create_state())
+   {
+      core_run();
+      return;
+   }
+
+   start = cpu_features_get_time_usec();
+
+#ifdef HAVE_DYNAMIC
+   if (use_secondary && runahead_secondary_init())
+      runahead_run_secondary(frames, &base_time);
+   else
+#endif
+      runahead_run_single(frames, &base_time);
+
+   runahead_time_total += cpu_features_get_time_usec() - start;
+   runahead_time_base  += base_time;
+   runahead_frame_count++;
+}
+
+void runahead_set_load_info(const retro_ctx_load_content_info_t *load_info)
+{
+#ifdef HAVE_DYNAMIC
+   settings_t *settings = config_get_ptr();
+   const struct retro_game_info *info = NULL;
+
+   runahead_content_free();
+
+   if (     !settings->bools.run_ahead_enabled
+         || !settings->bools.run_ahead_secondary_instance
+         || !load_info
+         || load_info->special)
+      return;
+
+   info = load_info->info;
+
+   if (!info || !load_info->content
+         || string_is_empty(load_info->content->elems[0].data))
+   {
+      runahead_content.contentless = true;
+      runahead_content.loaded      = true;
+      return;
+   }
+
+   if (info->path)
+      runahead_content.path = strdup(info->path);
+   if (info->meta)
+      runahead_content.meta = strdup(info->meta);
+   if (info->data && info->size)
+   {
+      runahead_content.data = malloc(info->size);
+      if (!runahead_content.data)
+      {
+         runahead_content_free();
+         return;
+      }
+      memcpy(runahead_content.data, info->data, info->size);
+      runahead_content.size = info->size;
+   }
+
+   runahead_content.loaded = true;
+#endif
+}
+
+void runahead_deinit(void)
+{
+   if (runahead_frame_count)
+   {
+      /* Everything beyond the real frame is the cost of run-ahead:
+       * serialization, the hidden frames and the rollback. */
+      RARCH_LOG("[Run-Ahead]: %u frames, %.3f ms per frame "
+            "(%.3f ms extra over a plain frame).\n",
+            (unsigned)runahead_frame_count,
+            runahead_time_total / (runahead_frame_count * 1000.0),
+            (runahead_time_total - runahead_time_base)
+            / (runahead_frame_count * 1000.0));
+   }
+
+#ifdef HAVE_DYNAMIC
+   runahead_secondary_deinit();
+   secondary_unavailable = false;
+   runahead_content_free();
+#endif
+
+   free(runahead_state);
+   runahead_state       = NULL;
+   runahead_state_size  = 0;
+   runahead_unavailable = false;
+   runahead_frame_count = 0;
+   runahead_time_total  = 0;
+   runahead_time_base   = 0;
+}
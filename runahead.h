@@ -0,0 +1,61 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __RARCH_RUNAHEAD_H
+#define __RARCH_RUNAHEAD_H
+
+#include <boolean.h>
+#include <retro_common_api.h>
+
+#include "core.h"
+
+RETRO_BEGIN_DECLS
+
+/**
+ * runahead_run:
+ * @frames               : Number of frames to run ahead.
+ * @use_secondary        : Run the hidden frames on a second
+ *                         instance of the core.
+ *
+ * Runs the core for one frame, but presents the video output
+ * of the frame @frames frames in the future, which removes
+ * that many frames of internal input lag from the core.
+ *
+ * Falls back to a plain core_run when run-ahead is not
+ * possible (netplay, rewinding, core cannot serialize).
+ **/
+void runahead_run(unsigned frames, bool use_secondary);
+
+/**
+ * runahead_set_load_info:
+ * @load_info            : Content that was just loaded into
+ *                         the primary core.
+ *
+ * Keeps a private copy of the loaded content so the secondary
+ * core instance can load the same game later on.
+ **/
+void runahead_set_load_info(const retro_ctx_load_content_info_t *load_info);
+
+/**
+ * runahead_deinit:
+ *
+ * Frees run-ahead buffers, unloads the secondary core instance
+ * and logs the accumulated run-ahead cost.
+ **/
+void runahead_deinit(void);
+
+RETRO_END_DECLS
+
+#endif
@@ -928,6 +928,7 @@ bool input_autoconfigure_disconnect(unsigned i, const char *ident)
 
    task->state   = state;
    task->handler = input_autoconfigure_disconnect_handler;
+   task->serial  = true;
 
    task_queue_push(task);
 
@@ -1029,6 +1030,7 @@ bool input_autoconfigure_connect(
 
    task->state                      = state;
    task->handler                    = input_autoconfigure_connect_handler;
+   task->serial                     = true;
 
    task_queue_push(task);
 
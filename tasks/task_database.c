@@ -26,9 +26,14 @@
 #include <streams/file_stream.h>
 #include <streams/chd_stream.h>
 #include <streams/interface_stream.h>
+#include <features/features_cpu.h>
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
 #include "tasks_internal.h"
 
 #include "../database_info.h"
+#include "../libretro-db/libretrodb_lookup.h"
 
 #include "../file_path_special.h"
 #include "../list_special.h"
@@ -64,6 +69,8 @@ typedef struct db_handle
    char *content_database_path;
    char *fullpath;
    database_info_handle_t *handle;
+   struct database_scanner *scanner;
+   libretrodb_lookup_t *lookup;
    database_state_handle_t state;
 } db_handle_t;
 
@@ -337,13 +344,20 @@ static int task_database_chd_get_serial(const char *name, char* serial)
 
 static int intfstream_get_crc(intfstream_t *fd, uint32_t *crc)
 {
-   ssize_t read = 0;
-   uint32_t acc = 0;
-   uint8_t buffer[4096];
+   ssize_t read    = 0;
+   uint32_t acc    = 0;
+   /* Large reads, this mostly runs against network shares */
+   size_t size     = 64 * 1024;
+   uint8_t *buffer = (uint8_t*)malloc(size);
+
+   if (!buffer)
+      return 0;
 
-   while ((read = intfstream_read(fd, buffer, sizeof(buffer))) > 0)
+   while ((read = intfstream_read(fd, buffer, size)) > 0)
       acc = encoding_crc32(acc, buffer, read);
 
+   free(buffer);
+
    if (read < 0)
       return 0;
 
@@ -475,27 +489,37 @@ static int task_database_gdi_get_crc(const char *name, uint32_t *crc)
    return rv;
 }
 
-static bool task_database_chd_get_crc(const char *name, uint32_t *crc)
+#define DATABASE_CHD_MAX_THREADS 8
+
+static bool task_database_chd_crc_consumer(const uint8_t *data, size_t len,
+      void *userdata)
 {
-   int rv;
-   intfstream_t *fd = intfstream_open_chd_track(
-         name,
-         RETRO_VFS_FILE_ACCESS_READ,
-         RETRO_VFS_FILE_ACCESS_HINT_NONE,
-         CHDSTREAM_TRACK_PRIMARY);
-   if (!fd)
+   uint32_t *acc = (uint32_t*)userdata;
+   *acc          = encoding_crc32(*acc, data, len);
+   return true;
+}
+
+static bool task_database_chd_get_crc(const char *name, uint32_t *crc,
+      unsigned workers)
+{
+   bool rv;
+   unsigned threads    = cpu_features_get_core_amount() / MAX(workers, 1);
+   uint32_t acc        = 0;
+   chdstream_t *stream = chdstream_open(name, CHDSTREAM_TRACK_PRIMARY);
+   if (!stream)
       return 0;
 
-   rv = intfstream_get_crc(fd, crc);
-   if (rv == 1)
+   /* Hunks decompress independently, spread them over
+    * the cores the other hashing workers aren't using */
+   rv = chdstream_read_track(stream,
+         MIN(MAX(threads, 1), DATABASE_CHD_MAX_THREADS),
+         task_database_chd_crc_consumer, &acc);
+   if (rv)
    {
+      *crc = acc;
       RARCH_LOG("CHD '%s' crc: %x\n", name, *crc);
    }
-   if (fd)
-   {
-      intfstream_close(fd);
-      free(fd);
-   }
+   chdstream_close(stream);
    return rv;
 }
 
@@ -561,69 +585,872 @@ end:
    free(path);
 }
 
-static int task_database_iterate_playlist(
-      database_state_handle_t *db_state,
-      database_info_handle_t *db, const char *name)
+/* What we learn from reading a file, before any
+ * database lookup happens. This is what the hashing
+ * threads produce and what the scan cache persists. */
+typedef struct database_scan_result
+{
+   enum database_type type;
+   int ret;
+   uint32_t crc;
+   uint32_t archive_crc;
+   char *serial;
+} database_scan_result_t;
+
+typedef struct database_scan_cache_entry
+{
+   char *path;
+   int32_t size;
+   int64_t mtime;
+   bool seen;
+   database_scan_result_t result;
+} database_scan_cache_entry_t;
+
+/* (path, size, mtime) -> result, looked up through
+ * an open addressing table keyed on the path hash. */
+typedef struct database_scan_cache
+{
+   database_scan_cache_entry_t *entries;
+   size_t count;
+   size_t capacity;
+   size_t *table;      /* entry index + 1, 0 is empty */
+   size_t table_size;  /* power of two */
+   bool dirty;
+} database_scan_cache_t;
+
+typedef struct database_scan_entry
+{
+   char *path;
+   int32_t size;
+   int64_t mtime;
+   bool done;
+   bool cached;
+   database_scan_result_t result;
+} database_scan_entry_t;
+
+typedef struct database_scanner
+{
+   database_scan_entry_t *entries;
+   size_t count;
+   database_scan_cache_t *cache;
+   char *cache_path;
+   unsigned hashed;
+   unsigned cached;
+   retro_time_t start_time;
+#ifdef HAVE_THREADS
+   slock_t *lock;
+   scond_t *cond;
+   sthread_t **threads;
+   unsigned num_threads;
+   /* how many threads can be hashing at once, fixed
+    * so that the CHD decompression threads never add up
+    * to more than the cores */
+   unsigned hash_workers;
+   size_t next;
+   bool quit;
+#endif
+} database_scanner_t;
+
+#define DATABASE_SCAN_CACHE_MAGIC   0x43534152 /* RASC */
+#define DATABASE_SCAN_CACHE_VERSION 1
+#define DATABASE_SCAN_MAX_THREADS   16
+
+static uint32_t database_scan_cache_hash(const char *path)
+{
+   uint32_t hash = 5381;
+   while (*path)
+      hash = (hash << 5) + hash + (uint8_t)*path++;
+   return hash;
+}
+
+static void database_scan_result_free(database_scan_result_t *res)
+{
+   if (res->serial)
+      free(res->serial);
+   res->serial = NULL;
+}
+
+static void database_scan_cache_free(database_scan_cache_t *cache)
+{
+   size_t i;
+
+   if (!cache)
+      return;
+
+   for (i = 0; i < cache->count; i++)
+   {
+      free(cache->entries[i].path);
+      database_scan_result_free(&cache->entries[i].result);
+   }
+
+   free(cache->entries);
+   free(cache->table);
+   free(cache);
+}
+
+static database_scan_cache_entry_t *database_scan_cache_find(
+      database_scan_cache_t *cache, const char *path)
 {
+   size_t mask;
+   size_t slot;
+
+   if (!cache || !cache->table_size)
+      return NULL;
+
+   mask = cache->table_size - 1;
+
+   for (slot = database_scan_cache_hash(path) & mask;
+         cache->table[slot]; slot = (slot + 1) & mask)
+   {
+      database_scan_cache_entry_t *entry =
+         &cache->entries[cache->table[slot] - 1];
+
+      if (string_is_equal(entry->path, path))
+         return entry;
+   }
+
+   return NULL;
+}
+
+static bool database_scan_cache_rehash(database_scan_cache_t *cache,
+      size_t table_size)
+{
+   size_t i;
+   size_t *table = (size_t*)calloc(table_size, sizeof(*table));
+
+   if (!table)
+      return false;
+
+   for (i = 0; i < cache->count; i++)
+   {
+      size_t slot = database_scan_cache_hash(cache->entries[i].path)
+         & (table_size - 1);
+
+      while (table[slot])
+         slot = (slot + 1) & (table_size - 1);
+
+      table[slot] = i + 1;
+   }
+
+   free(cache->table);
+   cache->table      = table;
+   cache->table_size = table_size;
+   return true;
+}
+
+/* Takes ownership of path and of res->serial. */
+static bool database_scan_cache_insert(database_scan_cache_t *cache,
+      char *path, int32_t size, int64_t mtime,
+      database_scan_result_t *res)
+{
+   database_scan_cache_entry_t *entry = database_scan_cache_find(cache, path);
+
+   if (entry)
+   {
+      free(path);
+      database_scan_result_free(&entry->result);
+   }
+   else
+   {
+      size_t slot;
+
+      if (cache->count == cache->capacity)
+      {
+         size_t capacity = cache->capacity ? cache->capacity * 2 : 256;
+         database_scan_cache_entry_t *entries =
+            (database_scan_cache_entry_t*)realloc(cache->entries,
+                  capacity * sizeof(*entries));
+
+         if (!entries)
+            return false;
+
+         cache->entries  = entries;
+         cache->capacity = capacity;
+      }
+
+      /* Keep the table at most half full */
+      if ((cache->count + 1) * 2 > cache->table_size)
+         if (!database_scan_cache_rehash(cache,
+                  cache->table_size ? cache->table_size * 2 : 512))
+            return false;
+
+      entry       = &cache->entries[cache->count];
+      entry->path = path;
+
+      for (slot = database_scan_cache_hash(path) & (cache->table_size - 1);
+            cache->table[slot];
+            slot = (slot + 1) & (cache->table_size - 1));
+
+      cache->table[slot] = ++cache->count;
+   }
+
+   entry->size   = size;
+   entry->mtime  = mtime;
+   entry->seen   = true;
+   entry->result = *res;
+   res->serial   = NULL;
+   cache->dirty  = true;
+   return true;
+}
+
+/* Cache file layout, native endian since it never
+ * leaves the machine it was written on:
+ *
+ * magic, version, count (uint32_t each), then per entry
+ * path length (uint32_t), path, size (int32_t), mtime (int64_t),
+ * type, ret (uint8_t each), crc, archive_crc (uint32_t each),
+ * serial length (uint32_t), serial.
+ */
+static database_scan_cache_t *database_scan_cache_load(const char *path)
+{
+   uint32_t i, header[3];
+   void *buf                     = NULL;
+   ssize_t len                   = 0;
+   const uint8_t *ptr            = NULL;
+   const uint8_t *end            = NULL;
+   database_scan_cache_t *cache  = (database_scan_cache_t*)
+      calloc(1, sizeof(*cache));
+
+   if (!cache)
+      return NULL;
+
+   if (string_is_empty(path) || !path_is_valid(path))
+      return cache;
+
+   if (!filestream_read_file(path, &buf, &len))
+      return cache;
+
+   ptr = (const uint8_t*)buf;
+   end = ptr + len;
+
+#define SCAN_CACHE_READ(dst, n) \
+   if ((size_t)(end - ptr) < (n)) \
+      goto error; \
+   memcpy(dst, ptr, n); \
+   ptr += (n)
+
+   SCAN_CACHE_READ(header, sizeof(header));
+
+   if (     header[0] != DATABASE_SCAN_CACHE_MAGIC
+         || header[1] != DATABASE_SCAN_CACHE_VERSION)
+      goto error;
+
+   for (i = 0; i < header[2]; i++)
+   {
+      uint32_t path_len, serial_len;
+      uint8_t type_ret[2];
+      int32_t size;
+      int64_t mtime;
+      char *entry_path           = NULL;
+      database_scan_result_t res = {DATABASE_TYPE_NONE};
+
+      SCAN_CACHE_READ(&path_len, sizeof(path_len));
+      if ((size_t)(end - ptr) < path_len || !path_len)
+         goto error;
+      entry_path = (char*)malloc(path_len + 1);
+      if (!entry_path)
+         goto error;
+      memcpy(entry_path, ptr, path_len);
+      entry_path[path_len] = '\0';
+      ptr += path_len;
+
+      if ((size_t)(end - ptr) < sizeof(size) + sizeof(mtime)
+            + sizeof(type_ret) + 2 * sizeof(uint32_t) + sizeof(serial_len))
+      {
+         free(entry_path);
+         goto error;
+      }
+
+      SCAN_CACHE_READ(&size, sizeof(size));
+      SCAN_CACHE_READ(&mtime, sizeof(mtime));
+      SCAN_CACHE_READ(type_ret, sizeof(type_ret));
+      SCAN_CACHE_READ(&res.crc, sizeof(res.crc));
+      SCAN_CACHE_READ(&res.archive_crc, sizeof(res.archive_crc));
+      SCAN_CACHE_READ(&serial_len, sizeof(serial_len));
+
+      res.type = (enum database_type)type_ret[0];
+      res.ret  = type_ret[1];
+
+      if (serial_len)
+      {
+         if ((size_t)(end - ptr) < serial_len
+               || !(res.serial = (char*)malloc(serial_len + 1)))
+         {
+            free(entry_path);
+            goto error;
+         }
+         memcpy(res.serial, ptr, serial_len);
+         res.serial[serial_len] = '\0';
+         ptr += serial_len;
+      }
+
+      if (!database_scan_cache_insert(cache, entry_path, size, mtime, &res))
+      {
+         free(entry_path);
+         database_scan_result_free(&res);
+         goto error;
+      }
+   }
+
+#undef SCAN_CACHE_READ
+
+   for (i = 0; i < cache->count; i++)
+      cache->entries[i].seen = false;
+   cache->dirty = false;
+
+   free(buf);
+   return cache;
+
+error:
+   RARCH_WARN("[Scanner]: Ignoring corrupt scan cache \"%s\".\n", path);
+   free(buf);
+   database_scan_cache_free(cache);
+   return (database_scan_cache_t*)calloc(1, sizeof(database_scan_cache_t));
+}
+
+/* Whether @path is @root itself or inside it,
+ * so /roms doesn't also match /roms2/game.bin */
+static bool database_scan_cache_is_below(const char *path,
+      const char *root, size_t root_len)
+{
+   if (!root_len || strncmp(path, root, root_len))
+      return false;
+   if (root[root_len - 1] == '/' || root[root_len - 1] == '\\')
+      return true;
+   return path[root_len] == '/' || path[root_len] == '\\'
+      || path[root_len] == '\0';
+}
+
+/* Entries below @root that weren't seen by a
+ * completed scan of @root are dropped. */
+static void database_scan_cache_save(database_scan_cache_t *cache,
+      const char *path, const char *root)
+{
+   size_t i;
+   uint32_t header[3];
+   RFILE *file    = NULL;
+   size_t root_len = root ? strlen(root) : 0;
+
+   if (!cache || !cache->dirty || string_is_empty(path))
+      return;
+
+   header[0] = DATABASE_SCAN_CACHE_MAGIC;
+   header[1] = DATABASE_SCAN_CACHE_VERSION;
+   header[2] = 0;
+
+   for (i = 0; i < cache->count; i++)
+      if (cache->entries[i].seen || !database_scan_cache_is_below(
+               cache->entries[i].path, root, root_len))
+         header[2]++;
+
+   file = filestream_open(path, RETRO_VFS_FILE_ACCESS_WRITE,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (!file)
+   {
+      RARCH_WARN("[Scanner]: Could not write scan cache \"%s\".\n", path);
+      return;
+   }
+
+   filestream_write(file, header, sizeof(header));
+
+   for (i = 0; i < cache->count; i++)
+   {
+      const database_scan_cache_entry_t *entry = &cache->entries[i];
+      uint32_t path_len   = (uint32_t)strlen(entry->path);
+      uint32_t serial_len = entry->result.serial ?
+         (uint32_t)strlen(entry->result.serial) : 0;
+      uint8_t type_ret[2];
+
+      if (!entry->seen && database_scan_cache_is_below(
+               entry->path, root, root_len))
+         continue;
+
+      type_ret[0] = (uint8_t)entry->result.type;
+      type_ret[1] = (uint8_t)entry->result.ret;
+
+      filestream_write(file, &path_len, sizeof(path_len));
+      filestream_write(file, entry->path, path_len);
+      filestream_write(file, &entry->size, sizeof(entry->size));
+      filestream_write(file, &entry->mtime, sizeof(entry->mtime));
+      filestream_write(file, type_ret, sizeof(type_ret));
+      filestream_write(file, &entry->result.crc, sizeof(entry->result.crc));
+      filestream_write(file, &entry->result.archive_crc,
+            sizeof(entry->result.archive_crc));
+      filestream_write(file, &serial_len, sizeof(serial_len));
+      if (serial_len)
+         filestream_write(file, entry->result.serial, serial_len);
+   }
+
+   filestream_close(file);
+   cache->dirty = false;
+}
+
+/* Everything task_database_iterate_playlist used to do
+ * inline, minus the pruning of files referenced by cue/gdi
+ * sheets which has to stay in list order. Safe to call from
+ * the hashing threads, @workers says how many of them
+ * can be hashing at the same time. */
+static void task_database_identify(const char *name,
+      database_scan_result_t *res, unsigned workers)
+{
+   char serial[4096];
+
+   serial[0]        = '\0';
+   res->type        = DATABASE_TYPE_NONE;
+   res->ret         = 1;
+   res->crc         = 0;
+   res->archive_crc = 0;
+   res->serial      = NULL;
+
    switch (msg_hash_to_file_type(msg_hash_calculate(path_get_extension(name))))
    {
       case FILE_TYPE_COMPRESSED:
 #ifdef HAVE_COMPRESSION
-         database_info_set_type(db, DATABASE_TYPE_CRC_LOOKUP);
+         res->type = DATABASE_TYPE_CRC_LOOKUP;
          /* first check crc of archive itself */
-         return intfstream_file_get_crc(name,
-               0, SIZE_MAX, &db_state->archive_crc);
-#else
-         break;
+         res->ret  = intfstream_file_get_crc(name,
+               0, SIZE_MAX, &res->archive_crc);
 #endif
+         break;
       case FILE_TYPE_CUE:
-         task_database_cue_prune(db, name);
-         db_state->serial[0] = '\0';
-         if (task_database_cue_get_serial(name, db_state->serial))
-            database_info_set_type(db, DATABASE_TYPE_SERIAL_LOOKUP);
+         if (task_database_cue_get_serial(name, serial))
+            res->type = DATABASE_TYPE_SERIAL_LOOKUP;
          else
          {
-            database_info_set_type(db, DATABASE_TYPE_CRC_LOOKUP);
-            return task_database_cue_get_crc(name, &db_state->crc);
+            res->type = DATABASE_TYPE_CRC_LOOKUP;
+            res->ret  = task_database_cue_get_crc(name, &res->crc);
          }
          break;
       case FILE_TYPE_GDI:
-         gdi_prune(db, name);
-         db_state->serial[0] = '\0';
          /* There are no serial databases, so don't bother with
             serials at the moment */
-         if (0 && task_database_gdi_get_serial(name, db_state->serial))
-            database_info_set_type(db, DATABASE_TYPE_SERIAL_LOOKUP);
+         if (0 && task_database_gdi_get_serial(name, serial))
+            res->type = DATABASE_TYPE_SERIAL_LOOKUP;
          else
          {
-            database_info_set_type(db, DATABASE_TYPE_CRC_LOOKUP);
-            return task_database_gdi_get_crc(name, &db_state->crc);
+            res->type = DATABASE_TYPE_CRC_LOOKUP;
+            res->ret  = task_database_gdi_get_crc(name, &res->crc);
          }
          break;
       case FILE_TYPE_ISO:
-         db_state->serial[0] = '\0';
-         intfstream_file_get_serial(name, 0, SIZE_MAX, db_state->serial);
-         database_info_set_type(db, DATABASE_TYPE_SERIAL_LOOKUP);
+         intfstream_file_get_serial(name, 0, SIZE_MAX, serial);
+         res->type = DATABASE_TYPE_SERIAL_LOOKUP;
          break;
       case FILE_TYPE_CHD:
-         db_state->serial[0] = '\0';
-         if (task_database_chd_get_serial(name, db_state->serial))
-            database_info_set_type(db, DATABASE_TYPE_SERIAL_LOOKUP);
+         if (task_database_chd_get_serial(name, serial))
+            res->type = DATABASE_TYPE_SERIAL_LOOKUP;
          else
          {
-            database_info_set_type(db, DATABASE_TYPE_CRC_LOOKUP);
-            return task_database_chd_get_crc(name, &db_state->crc);
+            res->type = DATABASE_TYPE_CRC_LOOKUP;
+            res->ret  = task_database_chd_get_crc(name, &res->crc, workers);
          }
          break;
       case FILE_TYPE_LUTRO:
-         database_info_set_type(db, DATABASE_TYPE_ITERATE_LUTRO);
+         res->type = DATABASE_TYPE_ITERATE_LUTRO;
          break;
       default:
-         database_info_set_type(db, DATABASE_TYPE_CRC_LOOKUP);
-         return intfstream_file_get_crc(name, 0, SIZE_MAX, &db_state->crc);
+         res->type = DATABASE_TYPE_CRC_LOOKUP;
+         res->ret  = intfstream_file_get_crc(name, 0, SIZE_MAX, &res->crc);
+         break;
    }
 
-   return 1;
+   if (!string_is_empty(serial))
+      res->serial = strdup(serial);
+}
+
+/* Note that for cue/gdi sheets the key is the sheet
+ * itself, not the track that actually got hashed. */
+static void database_scanner_process(database_scanner_t *scanner,
+      database_scan_entry_t *entry, unsigned workers)
+{
+   database_scan_cache_entry_t *cached = NULL;
+
+   entry->size  = path_get_size(entry->path);
+   entry->mtime = path_get_mtime(entry->path);
+
+   /* The cache is read-only while the scan runs, the
+    * task thread marks the hits as seen at the end. Each
+    * path is only looked at by one thread. */
+   cached = database_scan_cache_find(scanner->cache, entry->path);
+
+   if (     cached
+         && cached->size  == entry->size
+         && cached->mtime == entry->mtime
+         && entry->mtime  != -1)
+   {
+      entry->result         = cached->result;
+      entry->result.serial  = cached->result.serial ?
+         strdup(cached->result.serial) : NULL;
+      entry->cached         = true;
+      return;
+   }
+
+   task_database_identify(entry->path, &entry->result, workers);
+}
+
+#ifdef HAVE_THREADS
+static void database_scanner_thread(void *data)
+{
+   database_scanner_t *scanner = (database_scanner_t*)data;
+
+   for (;;)
+   {
+      database_scan_entry_t *entry = NULL;
+
+      slock_lock(scanner->lock);
+      while (!scanner->quit && scanner->next < scanner->count
+            && scanner->entries[scanner->next].done)
+         scanner->next++;
+      if (!scanner->quit && scanner->next < scanner->count)
+         entry = &scanner->entries[scanner->next++];
+      slock_unlock(scanner->lock);
+
+      if (!entry)
+         break;
+
+      database_scanner_process(scanner, entry, scanner->hash_workers);
+
+      slock_lock(scanner->lock);
+      entry->done = true;
+      if (entry->cached)
+         scanner->cached++;
+      else
+         scanner->hashed++;
+      scond_broadcast(scanner->cond);
+      slock_unlock(scanner->lock);
+   }
+}
+#endif
+
+static void database_scanner_free(database_scanner_t *scanner,
+      const char *root, bool completed)
+{
+   size_t i;
+
+   if (!scanner)
+      return;
+
+#ifdef HAVE_THREADS
+   if (scanner->threads)
+   {
+      slock_lock(scanner->lock);
+      scanner->quit = true;
+      slock_unlock(scanner->lock);
+
+      for (i = 0; i < scanner->num_threads; i++)
+         if (scanner->threads[i])
+            sthread_join(scanner->threads[i]);
+      free(scanner->threads);
+   }
+
+   scond_free(scanner->cond);
+   slock_free(scanner->lock);
+#endif
+
+   /* The hashing threads are gone, the cache is ours again */
+   for (i = 0; i < scanner->count; i++)
+   {
+      database_scan_entry_t *entry = &scanner->entries[i];
+
+      if (entry->done && entry->cached)
+      {
+         database_scan_cache_entry_t *cached =
+            database_scan_cache_find(scanner->cache, entry->path);
+         if (cached)
+            cached->seen = true;
+      }
+   }
+
+   /* Remember everything we hashed, even for an
+    * aborted scan, but only let a completed one
+    * forget about files that are gone. */
+   for (i = 0; i < scanner->count; i++)
+   {
+      database_scan_entry_t *entry = &scanner->entries[i];
+
+      if (     entry->done && !entry->cached
+            && entry->result.ret && entry->mtime != -1)
+      {
+         if (database_scan_cache_insert(scanner->cache, entry->path,
+                  entry->size, entry->mtime, &entry->result))
+            entry->path = NULL;
+      }
+
+      free(entry->path);
+      database_scan_result_free(&entry->result);
+   }
+
+   RARCH_LOG("[Scanner]: %u files hashed, %u from cache, %.2f s.\n",
+         scanner->hashed, scanner->cached,
+         (cpu_features_get_time_usec() - scanner->start_time) / 1000000.0);
+
+   database_scan_cache_save(scanner->cache, scanner->cache_path,
+         completed ? root : NULL);
+   database_scan_cache_free(scanner->cache);
+
+   free(scanner->cache_path);
+   free(scanner->entries);
+   free(scanner);
+}
+
+/* Tracks referenced by a cue/gdi sheet further down the list
+ * get pruned when the iteration reaches the sheet, so take them
+ * out before the hashing threads start on them. @table maps the
+ * entry paths to their index + 1, like the scan cache does. */
+static void database_scanner_skip_tracks(database_scanner_t *scanner,
+      const struct string_list *list, size_t index,
+      const size_t *table, size_t table_size)
+{
+   size_t slot;
+   bool cue;
+   char *path       = NULL;
+   intfstream_t *fd = NULL;
+   const char *name = list->elems[index].data;
+
+   switch (msg_hash_to_file_type(msg_hash_calculate(path_get_extension(name))))
+   {
+      case FILE_TYPE_CUE:
+         cue = true;
+         break;
+      case FILE_TYPE_GDI:
+         cue = false;
+         break;
+      default:
+         return;
+   }
+
+   path = (char *)malloc(PATH_MAX_LENGTH + 1);
+   fd   = intfstream_open_file(name,
+         RETRO_VFS_FILE_ACCESS_READ, RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (!path || !fd)
+      goto end;
+
+   while (cue
+         ? cue_next_file(fd, name, path, PATH_MAX_LENGTH)
+         : gdi_next_file(fd, name, path, PATH_MAX_LENGTH))
+   {
+      for (slot = database_scan_cache_hash(path) & (table_size - 1);
+            table[slot]; slot = (slot + 1) & (table_size - 1))
+      {
+         database_scan_entry_t *entry = &scanner->entries[table[slot] - 1];
+
+         if (     table[slot] - 1 > index
+               && entry->path && string_is_equal(entry->path, path))
+         {
+            free(entry->path);
+            entry->path = NULL;
+            entry->done = true;
+         }
+      }
+   }
+
+end:
+   if (fd)
+   {
+      intfstream_close(fd);
+      free(fd);
+   }
+   free(path);
+}
+
+static database_scanner_t *database_scanner_new(
+      const struct string_list *list, const char *cache_path)
+{
+   size_t i;
+   database_scanner_t *scanner = (database_scanner_t*)
+      calloc(1, sizeof(*scanner));
+
+   if (!scanner)
+      return NULL;
+
+   scanner->start_time = cpu_features_get_time_usec();
+   scanner->count      = list->size;
+   scanner->entries    = (database_scan_entry_t*)
+      calloc(list->size ? list->size : 1, sizeof(*scanner->entries));
+   scanner->cache      = database_scan_cache_load(cache_path);
+   scanner->cache_path = string_is_empty(cache_path) ?
+      NULL : strdup(cache_path);
+
+   if (!scanner->entries)
+      scanner->count = 0;
+   if (!scanner->entries || !scanner->cache)
+      goto error;
+
+   for (i = 0; i < list->size; i++)
+   {
+      database_scan_entry_t *entry = &scanner->entries[i];
+      const char *path             = list->elems[i].data;
+
+      /* Archive members are handled by the archive lookup */
+      if (!path || path_contains_compressed_file(path))
+      {
+         entry->done = true;
+         continue;
+      }
+
+      entry->path = strdup(path);
+   }
+
+   {
+      size_t table_size = 16;
+      size_t *table     = NULL;
+
+      while (table_size < list->size * 2)
+         table_size *= 2;
+
+      /* Without the table the tracks are still pruned
+       * later, they just get hashed for nothing. */
+      if ((table = (size_t*)calloc(table_size, sizeof(*table))))
+      {
+         for (i = 0; i < list->size; i++)
+         {
+            size_t slot;
+
+            if (!scanner->entries[i].path)
+               continue;
+
+            for (slot = database_scan_cache_hash(scanner->entries[i].path)
+                  & (table_size - 1);
+                  table[slot]; slot = (slot + 1) & (table_size - 1));
+
+            table[slot] = i + 1;
+         }
+
+         for (i = 0; i < list->size; i++)
+            if (scanner->entries[i].path)
+               database_scanner_skip_tracks(scanner, list, i,
+                     table, table_size);
+
+         free(table);
+      }
+   }
+
+#ifdef HAVE_THREADS
+   {
+      size_t pending        = 0;
+      unsigned cores        = cpu_features_get_core_amount();
+
+      for (i = 0; i < scanner->count; i++)
+         if (scanner->entries[i].path)
+            pending++;
+
+      scanner->lock         = slock_new();
+      scanner->cond         = scond_new();
+      /* At least two, so reading one file overlaps
+       * hashing another even on single core machines. */
+      scanner->num_threads  = MAX(2, MIN(cores, DATABASE_SCAN_MAX_THREADS));
+      scanner->hash_workers = (unsigned)MAX(1, MIN(scanner->num_threads, pending));
+      scanner->threads      = (sthread_t**)calloc(scanner->num_threads,
+            sizeof(*scanner->threads));
+
+      if (!scanner->lock || !scanner->cond || !scanner->threads)
+         goto error;
+
+      for (i = 0; i < scanner->num_threads; i++)
+         scanner->threads[i] = sthread_create(
+               database_scanner_thread, scanner);
+   }
+#endif
+
+   return scanner;
+
+error:
+   database_scanner_free(scanner, NULL, false);
+   return NULL;
+}
+
+/* Copies the result for list entry @index into @db_state.
+ * Returns -1 if it isn't available yet, otherwise what
+ * task_database_iterate_playlist has to return. */
+static int database_scanner_fetch(database_scanner_t *scanner,
+      size_t index, const char *name,
+      database_info_handle_t *db, database_state_handle_t *db_state)
+{
+   int ret;
+   database_scan_result_t tmp;
+   const database_scan_result_t *res = NULL;
+
+   if (scanner && index < scanner->count && scanner->entries[index].path)
+   {
+      database_scan_entry_t *entry = &scanner->entries[index];
+
+#ifdef HAVE_THREADS
+      slock_lock(scanner->lock);
+      if (!entry->done)
+      {
+         /* Don't hold up the main thread when the
+          * task queue isn't threaded, just come back. */
+         if (task_queue_is_threaded())
+            scond_wait_timeout(scanner->cond, scanner->lock, 100000);
+      }
+      if (!entry->done)
+      {
+         slock_unlock(scanner->lock);
+         return -1;
+      }
+      slock_unlock(scanner->lock);
+#else
+      if (!entry->done)
+      {
+         database_scanner_process(scanner, entry, 1);
+         entry->done = true;
+         if (entry->cached)
+            scanner->cached++;
+         else
+            scanner->hashed++;
+      }
+#endif
+
+      res = &entry->result;
+   }
+   else
+   {
+      task_database_identify(name, &tmp, 1);
+      res = &tmp;
+   }
+
+   if (res->type != DATABASE_TYPE_NONE)
+      database_info_set_type(db, res->type);
+
+   db_state->crc         = res->crc;
+   db_state->archive_crc = res->archive_crc;
+   strlcpy(db_state->serial, res->serial ? res->serial : "",
+         sizeof(db_state->serial));
+   ret                   = res->ret;
+
+   if (res == &tmp)
+      database_scan_result_free(&tmp);
+
+   return ret;
+}
+
+static int task_database_iterate_playlist(
+      db_handle_t *_db,
+      database_state_handle_t *db_state,
+      database_info_handle_t *db, const char *name)
+{
+   int ret = database_scanner_fetch(_db->scanner,
+         db->list_ptr, name, db, db_state);
+
+   /* Still being hashed, come back later */
+   if (ret < 0)
+      return 1;
+
+   switch (msg_hash_to_file_type(msg_hash_calculate(path_get_extension(name))))
+   {
+      case FILE_TYPE_CUE:
+         task_database_cue_prune(db, name);
+         break;
+      case FILE_TYPE_GDI:
+         gdi_prune(db, name);
+         break;
+      default:
+         break;
+   }
+
+   return ret;
 }
 
 static int database_info_list_iterate_end_no_match(
@@ -694,22 +1521,20 @@ static int task_database_iterate_next(database_info_handle_t *db)
    return -1;
 }
 
-static int database_info_list_iterate_new(database_state_handle_t *db_state,
-      const char *query)
+/* Decodes the matching record of the current database,
+ * found_match expects it at db_state->info->list[entry_index]. */
+static bool database_info_list_iterate_record(
+      database_state_handle_t *db_state,
+      libretrodb_lookup_db_t *rdb, int record)
 {
-   const char *new_database = database_info_get_current_name(db_state);
-
-#if 0
-   RARCH_LOG("Check database [%d/%d] : %s\n", (unsigned)db_state->list_index,
-         (unsigned)db_state->list->size, new_database);
-#endif
    if (db_state->info)
    {
       database_info_list_free(db_state->info);
       free(db_state->info);
    }
-   db_state->info = database_info_list_new(new_database, query);
-   return 0;
+   db_state->entry_index = 0;
+   db_state->info        = database_info_list_new_record(rdb, record);
+   return db_state->info != NULL;
 }
 
 static int database_info_list_iterate_found_match(
@@ -838,73 +1663,51 @@ static int task_database_iterate_crc_lookup(
       const char *name,
       const char *archive_entry)
 {
+   int record                  = -1;
+   int archive_record          = -1;
+   libretrodb_lookup_db_t *rdb = NULL;
 
    if (!db_state->list ||
          (unsigned)db_state->list_index == (unsigned)db_state->list->size)
       return database_info_list_iterate_end_no_match(db, db_state, name);
 
-   if (db_state->entry_index == 0)
+   /* don't scan files that can't be in this database */
+   if (!(path_contains_compressed_file(name) &&
+      core_info_database_match_archive_member(
+      db_state->list->elems[db_state->list_index].data)) &&
+       !core_info_database_supports_content_path(
+      db_state->list->elems[db_state->list_index].data, name))
+      return database_info_list_iterate_next(db_state);
+
+   /* The database is only read the first time the scan needs
+    * it, after that both crcs are a hash table probe away. */
+   rdb = libretrodb_lookup_open(_db->lookup,
+         database_info_get_current_name(db_state));
+
+   /* Entries without a crc never match */
+   if (db_state->crc)
+      record         = libretrodb_lookup_crc(rdb, db_state->crc);
+   if (db_state->archive_crc)
+      archive_record = libretrodb_lookup_crc(rdb, db_state->archive_crc);
+
+   /* The earliest record in the database wins,
+    * an archive match is preferred on the same record. */
+   if (archive_record >= 0 && (record < 0 || archive_record <= record))
    {
-      char query[50];
-
-      query[0] = '\0';
-
-      /* don't scan files that can't be in this database */
-      if (!(path_contains_compressed_file(name) &&
-         core_info_database_match_archive_member(
-         db_state->list->elems[db_state->list_index].data)) &&
-          !core_info_database_supports_content_path(
-         db_state->list->elems[db_state->list_index].data, name))
-         return database_info_list_iterate_next(db_state);
-
-      snprintf(query, sizeof(query),
-            "{crc:or(b\"%08X\",b\"%08X\")}",
-            db_state->crc, db_state->archive_crc);
-
-      database_info_list_iterate_new(db_state, query);
+      if (database_info_list_iterate_record(db_state, rdb, archive_record))
+         return database_info_list_iterate_found_match(
+               _db,
+               db_state, db, NULL);
    }
-
-   if (db_state->info)
+   else if (record >= 0)
    {
-      database_info_t *db_info_entry =
-         &db_state->info->list[db_state->entry_index];
-
-      if (db_info_entry && db_info_entry->crc32)
-      {
-#if 0
-         RARCH_LOG("CRC32: 0x%08X , entry CRC32: 0x%08X (%s).\n",
-               db_state->crc, db_info_entry->crc32, db_info_entry->name);
-#endif
-         if (db_state->archive_crc == db_info_entry->crc32)
-            return database_info_list_iterate_found_match(
-                  _db,
-                  db_state, db, NULL);
-         if (db_state->crc == db_info_entry->crc32)
-            return database_info_list_iterate_found_match(
-                  _db,
-                  db_state, db, archive_entry);
-      }
-   }
-
-   db_state->entry_index++;
-
-   if (db_state->info)
-   {
-      if (db_state->entry_index >= db_state->info->count)
-         return database_info_list_iterate_next(db_state);
+      if (database_info_list_iterate_record(db_state, rdb, record))
+         return database_info_list_iterate_found_match(
+               _db,
+               db_state, db, archive_entry);
    }
 
-   /* If we haven't reached the end of the database list yet,
-    * continue iterating. */
-   if (db_state->list_index < db_state->list->size)
-      return 1;
-
-   database_info_list_free(db_state->info);
-
-   if (db_state->info)
-      free(db_state->info);
-
-   return 0;
+   return database_info_list_iterate_next(db_state);
 }
 
 static int task_database_iterate_playlist_archive(
@@ -976,61 +1779,28 @@ static int task_database_iterate_serial_lookup(
       database_state_handle_t *db_state,
       database_info_handle_t *db, const char *name)
 {
+   int record                  = -1;
+   libretrodb_lookup_db_t *rdb = NULL;
+
    if (!db_state->list ||
          (unsigned)db_state->list_index == (unsigned)db_state->list->size)
       return database_info_list_iterate_end_no_match(db, db_state, name);
 
-   if (db_state->entry_index == 0)
-   {
-      char query[50];
-      char *serial_buf =
-         bin_to_hex_alloc((uint8_t*)db_state->serial, strlen(db_state->serial) * sizeof(uint8_t));
-
-      if (!serial_buf)
-         return 1;
-
-      query[0] = '\0';
-
-      snprintf(query, sizeof(query), "{'serial': b'%s'}", serial_buf);
-      database_info_list_iterate_new(db_state, query);
-
-      free(serial_buf);
-   }
+   rdb    = libretrodb_lookup_open(_db->lookup,
+         database_info_get_current_name(db_state));
+   record = libretrodb_lookup_serial(rdb, db_state->serial);
 
-   if (db_state->info)
+   if (record >= 0 && database_info_list_iterate_record(db_state, rdb, record))
    {
-      database_info_t *db_info_entry = &db_state->info->list[
-         db_state->entry_index];
-
-      if (db_info_entry && db_info_entry->serial)
-      {
-#if 0
-         RARCH_LOG("serial: %s , entry serial: %s (%s).\n",
-                   db_state->serial, db_info_entry->serial,
-                   db_info_entry->name);
-#endif
-         if (string_is_equal(db_state->serial, db_info_entry->serial))
-            return database_info_list_iterate_found_match(_db,
-                  db_state, db, NULL);
-      }
-   }
-
-   db_state->entry_index++;
+      database_info_t *db_info_entry = &db_state->info->list[0];
 
-   if (db_state->info)
-   {
-      if (db_state->entry_index >= db_state->info->count)
-         return database_info_list_iterate_next(db_state);
+      if (db_info_entry->serial &&
+            string_is_equal(db_state->serial, db_info_entry->serial))
+         return database_info_list_iterate_found_match(_db,
+               db_state, db, NULL);
    }
 
-   /* If we haven't reached the end of the database list yet,
-    * continue iterating. */
-   if (db_state->list_index < db_state->list->size)
-      return 1;
-
-   database_info_list_free(db_state->info);
-   free(db_state->info);
-   return 0;
+   return database_info_list_iterate_next(db_state);
 }
 
 static int task_database_iterate(
@@ -1050,7 +1820,7 @@ static int task_database_iterate(
    switch (database_info_get_type(db))
    {
       case DATABASE_TYPE_ITERATE:
-         return task_database_iterate_playlist(db_state, db, name);
+         return task_database_iterate_playlist(_db, db_state, db, name);
       case DATABASE_TYPE_ITERATE_ARCHIVE:
          return task_database_iterate_playlist_archive(_db, db_state, db, name);
       case DATABASE_TYPE_ITERATE_LUTRO:
@@ -1084,6 +1854,7 @@ static void task_database_handler(retro_task_t *task)
    database_info_handle_t  *dbinfo  = NULL;
    database_state_handle_t *dbstate = NULL;
    db_handle_t *db                  = NULL;
+   bool completed                   = false;
 
    if (!task)
       goto task_finished;
@@ -1167,6 +1938,27 @@ static void task_database_handler(retro_task_t *task)
                }
             }
          }
+
+         /* Every database is indexed once and shared by all
+          * the files of this scan */
+         if (!db->lookup)
+            db->lookup = libretrodb_lookup_new();
+
+         if (!db->scanner && dbinfo->list)
+         {
+            char *cache_path = (char*)malloc(PATH_MAX_LENGTH * sizeof(char));
+
+            cache_path[0]    = '\0';
+
+            if (!string_is_empty(db->playlist_directory))
+               fill_pathname_join(cache_path, db->playlist_directory,
+                     file_path_str(FILE_PATH_CONTENT_SCAN_CACHE),
+                     PATH_MAX_LENGTH * sizeof(char));
+
+            /* Starts hashing the whole list in the background */
+            db->scanner = database_scanner_new(dbinfo->list, cache_path);
+            free(cache_path);
+         }
          dbinfo->status = DATABASE_STATUS_ITERATE_START;
          break;
       case DATABASE_STATUS_ITERATE_START:
@@ -1174,6 +1966,9 @@ static void task_database_handler(retro_task_t *task)
          task_database_cleanup_state(dbstate);
          dbstate->list_index  = 0;
          dbstate->entry_index = 0;
+         if (dbinfo->list->size)
+            task_set_progress(task, (int8_t)
+                  (dbinfo->list_ptr * 100 / dbinfo->list->size));
          task_database_iterate_start(dbinfo, name);
          break;
       case DATABASE_STATUS_ITERATE:
@@ -1199,6 +1994,7 @@ static void task_database_handler(retro_task_t *task)
                runloop_msg_queue_push(
                      msg_hash_to_str(MSG_SCANNING_OF_FILE_FINISHED),
                      0, 180, true);
+            completed = true;
             goto task_finished;
          }
          break;
@@ -1221,6 +2017,9 @@ task_finished:
 
    if (db)
    {
+      database_scanner_free(db->scanner, db->fullpath, completed);
+      libretrodb_lookup_free(db->lookup);
+
       if (!string_is_empty(db->playlist_directory))
          free(db->playlist_directory);
       if (!string_is_empty(db->content_database_path))
@@ -1255,6 +2054,7 @@ bool task_push_dbscan(
    t->state                  = db;
    t->callback               = cb;
    t->title                  = strdup(msg_hash_to_str(MSG_PREPARING_FOR_CONTENT_SCAN));
+   t->priority               = TASK_PRIORITY_LOW;
 
    db->is_directory          = directory;
    db->playlist_directory    = NULL;
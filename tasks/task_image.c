@@ -363,6 +363,7 @@ bool task_push_image_load(const char *fullpath, retro_task_callback_t cb, void *
    t->cleanup         = task_image_load_free;
    t->callback        = cb;
    t->user_data       = user_data;
+   t->priority        = TASK_PRIORITY_HIGH;
 
    task_queue_push(t);
 
@@ -52,6 +52,7 @@ bool task_push_netplay_lan_scan(retro_task_callback_t cb)
 
    task->type     = TASK_TYPE_BLOCKING;
    task->handler  = task_netplay_lan_scan_handler;
+   task->serial   = true;
    task->callback = cb;
    task->title    = strdup(msg_hash_to_str(MSG_NETPLAY_LAN_SCANNING));
 
@@ -69,6 +70,7 @@ bool task_push_netplay_lan_scan_rooms(retro_task_callback_t cb)
 
    task->type     = TASK_TYPE_BLOCKING;
    task->handler  = task_netplay_lan_scan_handler;
+   task->serial   = true;
    task->callback = cb;
    task->title    = strdup(msg_hash_to_str(MSG_NETPLAY_LAN_SCANNING));
 
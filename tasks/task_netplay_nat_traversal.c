@@ -84,6 +84,7 @@ bool task_push_netplay_nat_traversal(void *nat_traversal_state, uint16_t port)
 
    task->type     = TASK_TYPE_BLOCKING;
    task->handler  = task_netplay_nat_traversal_handler;
+   task->serial   = true;
    task->callback = netplay_nat_traversal_callback;
    task->task_data = ntsd;
 
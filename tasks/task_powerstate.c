@@ -72,6 +72,7 @@ void task_push_get_powerstate(void)
    task->type     = TASK_TYPE_NONE;
    task->state    = state;
    task->handler  = task_powerstate_handler;
+   task->serial   = true;
    task->callback = task_powerstate_cb;
    task->mute     = true;
 
@@ -55,6 +55,10 @@
 
 #define SAVE_STATE_CHUNK 4096
 
+/* SRAM is compared in blocks outside the lock, so a scan never holds
+ * up the emulation for longer than one memcpy of SRAM */
+#define AUTOSAVE_BLOCK_SIZE   4096
+
 static struct string_list *task_save_files = NULL;
 
 struct ram_type
@@ -122,17 +126,133 @@ struct autosave
    volatile bool quit;
    size_t bufsize;
    unsigned interval;
+   /* what was last written, and the SRAM being looked at */
    void *buffer;
+   void *staging;
    const void *retro_buffer;
    const char *path;
    slock_t *lock;
    slock_t *cond_lock;
    scond_t *cond;
    sthread_t *thread;
+
+   /* Totals, for the log */
+   unsigned saves;
+   uint64_t bytes_written;
 };
 
 static struct autosave_st autosave_state;
 
+/**
+ * autosave_scan:
+ * @save            : pointer to autosave object
+ *
+ * Snapshots SRAM into the staging buffer under the lock, so that a
+ * save never mixes SRAM from different frames, then compares it
+ * against the last written copy block by block with the lock
+ * released. If anything changed, the snapshot becomes the autosave
+ * buffer.
+ *
+ * Returns: number of blocks that changed.
+ **/
+static unsigned autosave_scan(autosave_t *save)
+{
+   size_t offset;
+   unsigned dirty          = 0;
+   const uint8_t *buffer   = (const uint8_t*)save->buffer;
+   const uint8_t *staging  = (const uint8_t*)save->staging;
+
+   slock_lock(save->lock);
+   memcpy(save->staging, save->retro_buffer, save->bufsize);
+   slock_unlock(save->lock);
+
+   for (offset = 0; offset < save->bufsize; offset += AUTOSAVE_BLOCK_SIZE)
+   {
+      size_t len = save->bufsize - offset;
+      if (len > AUTOSAVE_BLOCK_SIZE)
+         len = AUTOSAVE_BLOCK_SIZE;
+
+      if (string_is_not_equal_fast(buffer + offset, staging + offset, len))
+         dirty++;
+   }
+
+   if (dirty)
+   {
+      void *tmp     = save->buffer;
+      save->buffer  = save->staging;
+      save->staging = tmp;
+   }
+
+   return dirty;
+}
+
+/**
+ * autosave_write:
+ * @save            : pointer to autosave object
+ *
+ * Writes the autosave buffer to a temporary file next to the
+ * save and renames it into place, so that a crash mid-write
+ * can't leave a truncated save behind. Where renaming over an
+ * existing file fails (Windows), the old save is moved to a
+ * backup first and only deleted once the new one is in place,
+ * so there's always a complete copy on disk.
+ *
+ * Returns: true if successful, otherwise false.
+ **/
+static bool autosave_write(autosave_t *save)
+{
+   char tmp_path[PATH_MAX_LENGTH];
+   char bak_path[PATH_MAX_LENGTH];
+   bool failed        = false;
+   intfstream_t *file = NULL;
+
+   tmp_path[0] = '\0';
+   bak_path[0] = '\0';
+   strlcpy(tmp_path, save->path, sizeof(tmp_path));
+   strlcat(tmp_path, ".tmp", sizeof(tmp_path));
+   strlcpy(bak_path, save->path, sizeof(bak_path));
+   strlcat(bak_path, ".bak", sizeof(bak_path));
+
+   file = intfstream_open_file(tmp_path,
+         RETRO_VFS_FILE_ACCESS_WRITE, RETRO_VFS_FILE_ACCESS_HINT_NONE);
+   if (!file)
+      return false;
+
+   failed |= ((size_t)intfstream_write(file, save->buffer, save->bufsize) != save->bufsize);
+   failed |= (intfstream_flush(file) != 0);
+   failed |= (intfstream_close(file) != 0);
+   free(file);
+
+   if (!failed && filestream_rename(tmp_path, save->path) != 0)
+   {
+      /* Renaming over an existing file fails on Windows.
+       * A backup left over from an earlier failure is stale,
+       * the save itself is still there. */
+      if (path_is_valid(bak_path))
+         filestream_delete(bak_path);
+
+      if (filestream_rename(save->path, bak_path) != 0)
+         failed = true;
+      else if (filestream_rename(tmp_path, save->path) != 0)
+      {
+         filestream_rename(bak_path, save->path);
+         failed = true;
+      }
+      else
+         filestream_delete(bak_path);
+   }
+
+   if (failed)
+   {
+      filestream_delete(tmp_path);
+      return false;
+   }
+
+   save->saves++;
+   save->bytes_written += save->bufsize;
+   return true;
+}
+
 /**
  * autosave_thread:
  * @data            : pointer to autosave object
@@ -143,45 +263,28 @@ static void autosave_thread(void *data)
 {
    bool first_log   = true;
    autosave_t *save = (autosave_t*)data;
+   unsigned blocks  = (unsigned)((save->bufsize + AUTOSAVE_BLOCK_SIZE - 1)
+         / AUTOSAVE_BLOCK_SIZE);
 
    while (!save->quit)
    {
-      bool differ;
+      unsigned dirty = autosave_scan(save);
 
-      slock_lock(save->lock);
-      differ = string_is_not_equal_fast(save->buffer, save->retro_buffer,
-            save->bufsize);
-      if (differ)
-         memcpy(save->buffer, save->retro_buffer, save->bufsize);
-      slock_unlock(save->lock);
-
-      if (differ)
+      if (dirty)
       {
-         /* Should probably deal with this more elegantly. */
-         intfstream_t *file = intfstream_open_file(save->path,
-               RETRO_VFS_FILE_ACCESS_WRITE, RETRO_VFS_FILE_ACCESS_HINT_NONE);
-
-         if (file)
+         /* Avoid spamming down stderr ... */
+         if (first_log)
          {
-            bool failed = false;
-
-            /* Avoid spamming down stderr ... */
-            if (first_log)
-            {
-               RARCH_LOG("Autosaving SRAM to \"%s\", will continue to check every %u seconds ...\n",
-                     save->path, save->interval);
-               first_log = false;
-            }
-            else
-               RARCH_LOG("SRAM changed ... autosaving ...\n");
-
-            failed |= ((size_t)intfstream_write(file, save->buffer, save->bufsize) != save->bufsize);
-            failed |= (intfstream_flush(file) != 0);
-            failed |= (intfstream_close(file) != 0);
-            free(file);
-            if (failed)
-               RARCH_WARN("Failed to autosave SRAM. Disk might be full.\n");
+            RARCH_LOG("Autosaving SRAM to \"%s\", will continue to check every %u seconds ...\n",
+                  save->path, save->interval);
+            first_log = false;
          }
+         else
+            RARCH_LOG("SRAM changed (%u of %u blocks) ... autosaving ...\n",
+                  dirty, blocks);
+
+         if (!autosave_write(save))
+            RARCH_WARN("Failed to autosave SRAM. Disk might be full.\n");
       }
 
       slock_lock(save->cond_lock);
@@ -221,10 +324,13 @@ static autosave_t *autosave_new(const char *path,
    handle->bufsize               = size;
    handle->interval              = interval;
    handle->buffer                = malloc(size);
+   handle->staging               = malloc(size);
    handle->retro_buffer          = data;
    handle->path                  = path;
+   handle->saves                 = 0;
+   handle->bytes_written         = 0;
 
-   if (!handle->buffer)
+   if (!handle->buffer || !handle->staging)
       goto error;
 
    memcpy(handle->buffer, handle->retro_buffer, handle->bufsize);
@@ -238,7 +344,11 @@ static autosave_t *autosave_new(const char *path,
 
 error:
    if (handle)
+   {
+      free(handle->buffer);
+      free(handle->staging);
       free(handle);
+   }
    return NULL;
 }
 
@@ -256,13 +366,21 @@ static void autosave_free(autosave_t *handle)
    scond_signal(handle->cond);
    sthread_join(handle->thread);
 
+   if (handle->saves)
+      RARCH_LOG("Autosaved \"%s\" %u times, %llu bytes written.\n",
+            handle->path, handle->saves,
+            (unsigned long long)handle->bytes_written);
+
    slock_free(handle->lock);
    slock_free(handle->cond_lock);
    scond_free(handle->cond);
 
    if (handle->buffer)
       free(handle->buffer);
-   handle->buffer = NULL;
+   if (handle->staging)
+      free(handle->staging);
+   handle->buffer  = NULL;
+   handle->staging = NULL;
 }
 
 
@@ -669,6 +787,7 @@ static bool task_push_undo_save_state(const char *path, void *data, size_t size)
    task->type                    = TASK_TYPE_BLOCKING;
    task->state                   = state;
    task->handler                 = task_save_handler;
+   task->serial                  = true;
    task->callback                = undo_save_state_cb;
    task->title                   = strdup(msg_hash_to_str(MSG_UNDOING_SAVE_STATE));
 
@@ -1043,6 +1162,7 @@ static void task_push_save_state(const char *path, void *data, size_t size, bool
    task->type              = TASK_TYPE_BLOCKING;
    task->state             = state;
    task->handler           = task_save_handler;
+   task->serial            = true;
    task->callback          = save_state_cb;
    task->title             = strdup(msg_hash_to_str(MSG_SAVING_STATE));
    task->mute              = state->mute;
@@ -1116,6 +1236,7 @@ static void task_push_load_and_save_state(const char *path, void *data,
    task->state       = state;
    task->type        = TASK_TYPE_BLOCKING;
    task->handler     = task_load_handler;
+   task->serial      = true;
    task->callback    = content_load_and_save_state_cb;
    task->title       = strdup(msg_hash_to_str(MSG_LOADING_STATE));
    task->mute        = state->mute;
@@ -1253,6 +1374,7 @@ bool content_load_state(const char *path,
    task->type                   = TASK_TYPE_BLOCKING;
    task->state                  = state;
    task->handler                = task_load_handler;
+   task->serial                 = true;
    task->callback               = content_load_state_cb;
    task->title                  = strdup(msg_hash_to_str(MSG_LOADING_STATE));
 
@@ -46,6 +46,7 @@ bool task_push_wifi_scan(retro_task_callback_t cb)
    task->type           = TASK_TYPE_BLOCKING;
    task->state          = NULL;
    task->handler        = task_wifi_scan_handler;
+   task->serial         = true;
    task->callback       = cb;
    task->title          = strdup(msg_hash_to_str(
                            MSG_SCANNING_WIRELESS_NETWORKS));
@@ -0,0 +1,428 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Drives the audio flush path (libretro-common/audio/audio_pipeline.c)
+ * offline with recorded core audio, and compares it against running
+ * each stage over the whole batch in turn, the way audio_driver_flush
+ * used to. Checks that both give the same samples, then times them.
+ *
+ * The input is a stereo 16-bit WAV file, or raw s16le stereo samples
+ * (e.g. a recording's audio track dumped with ffmpeg -f s16le). With no
+ * input, a few seconds of synthetic audio are used instead.
+ *
+ * Usage: audioflushbench [options] [input] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <retro_miscellaneous.h>
+#include <compat/getopt.h>
+#include <file/file_path.h>
+#include <string/stdstring.h>
+#include <features/features_cpu.h>
+#include <formats/rwav.h>
+#include <audio/audio_pipeline.h>
+#include <audio/audio_resampler.h>
+#include <audio/dsp_filter.h>
+#include <audio/conversion/s16_to_float.h>
+#include <audio/conversion/float_to_s16.h>
+
+struct flush_path
+{
+   const retro_resampler_t *resampler;
+   void *resampler_data;
+   retro_dsp_filter_t *dsp;
+   float *input_data;
+   float *output;
+   int16_t *output_s16;
+};
+
+static const char *resampler_ident = "sinc";
+static const char *dsp_config      = NULL;
+static enum resampler_quality quality = RESAMPLER_QUALITY_NORMAL;
+static unsigned in_rate            = 0;
+static unsigned out_rate           = 48000;
+static unsigned batch_frames       = 735;
+static float gain                  = 1.0f;
+
+static int16_t *samples;
+static size_t num_frames;
+
+static bool load_input(const char *path)
+{
+   rwav_t wav;
+   long len;
+   void *buf;
+   FILE *file = fopen(path, "rb");
+
+   if (!file)
+   {
+      perror(path);
+      return false;
+   }
+
+   fseek(file, 0, SEEK_END);
+   len = ftell(file);
+   fseek(file, 0, SEEK_SET);
+
+   buf = malloc(len);
+   if (!buf || fread(buf, 1, len, file) != (size_t)len)
+   {
+      fprintf(stderr, "Could not read %s.\n", path);
+      fclose(file);
+      free(buf);
+      return false;
+   }
+   fclose(file);
+
+   if (string_is_equal_noncase(path_get_extension(path), "wav"))
+   {
+      if (rwav_load(&wav, buf, len) != RWAV_ITERATE_DONE ||
+            wav.numchannels != 2 || wav.bitspersample != 16)
+      {
+         fprintf(stderr, "%s is not a stereo 16-bit WAV file.\n", path);
+         free(buf);
+         return false;
+      }
+
+      num_frames = wav.numsamples;
+      samples    = (int16_t*)malloc(num_frames * 4);
+      memcpy(samples, wav.samples, num_frames * 4);
+      if (!in_rate)
+         in_rate = wav.samplerate;
+      rwav_free(&wav);
+      free(buf);
+   }
+   else
+   {
+      num_frames = len / 4;
+      samples    = (int16_t*)buf;
+   }
+
+   if (!in_rate)
+      in_rate = 44100;
+
+   return num_frames != 0;
+}
+
+/* A couple of detuned square waves with some noise on top, about as
+ * busy as a chiptune. */
+static void synth_input(void)
+{
+   size_t i;
+   uint32_t noise = 1;
+
+   if (!in_rate)
+      in_rate = 44100;
+   num_frames = in_rate * 10;
+   samples    = (int16_t*)malloc(num_frames * 4);
+
+   for (i = 0; i < num_frames; i++)
+   {
+      double t = (double)i / in_rate;
+      int a    = fmod(t * 220.0, 1.0) < 0.5 ? 6000 : -6000;
+      int b    = fmod(t * 331.3, 1.0) < 0.25 ? 4000 : -4000;
+      int n;
+
+      noise = noise * 1103515245 + 12345;
+      n     = (int)((noise >> 16) & 0x7ff) - 0x400;
+
+      samples[i * 2 + 0] = (int16_t)(a + n + 8000 * sin(t * 2 * M_PI * 55));
+      samples[i * 2 + 1] = (int16_t)(b - n + 8000 * sin(t * 2 * M_PI * 82.5));
+   }
+}
+
+static bool path_init(struct flush_path *path, size_t outsamples_max)
+{
+   memset(path, 0, sizeof(*path));
+
+   if (!retro_resampler_realloc(&path->resampler_data, &path->resampler,
+            resampler_ident, quality, (double)out_rate / in_rate))
+   {
+      fprintf(stderr, "Could not init resampler \"%s\".\n", resampler_ident);
+      return false;
+   }
+
+   if (dsp_config)
+   {
+      path->dsp = retro_dsp_filter_new(dsp_config, NULL, in_rate);
+      if (!path->dsp)
+      {
+         fprintf(stderr, "Could not load DSP config %s.\n", dsp_config);
+         return false;
+      }
+   }
+
+   path->input_data = (float*)malloc(
+         MAX(batch_frames, AUDIO_PIPELINE_BLOCK_FRAMES) * 2 * sizeof(float));
+   path->output     = (float*)malloc(outsamples_max * sizeof(float));
+   path->output_s16 = (int16_t*)malloc(outsamples_max * sizeof(int16_t));
+
+   return path->input_data && path->output && path->output_s16;
+}
+
+static void path_deinit(struct flush_path *path)
+{
+   if (path->resampler && path->resampler_data)
+      path->resampler->free(path->resampler_data);
+   if (path->dsp)
+      retro_dsp_filter_free(path->dsp);
+   free(path->input_data);
+   free(path->output);
+   free(path->output_s16);
+}
+
+/* One pass per stage, over the whole batch */
+static size_t flush_reference(struct flush_path *path,
+      const int16_t *data, size_t frames, double ratio)
+{
+   struct resampler_data src_data;
+
+   convert_s16_to_float(path->input_data, data, frames * 2, gain);
+
+   src_data.data_in      = path->input_data;
+   src_data.input_frames = frames;
+
+   if (path->dsp)
+   {
+      struct retro_dsp_data dsp_data;
+
+      dsp_data.input         = path->input_data;
+      dsp_data.input_frames  = (unsigned)frames;
+      dsp_data.output        = NULL;
+      dsp_data.output_frames = 0;
+
+      retro_dsp_filter_process(path->dsp, &dsp_data);
+
+      if (dsp_data.output)
+      {
+         src_data.data_in      = dsp_data.output;
+         src_data.input_frames = dsp_data.output_frames;
+      }
+   }
+
+   src_data.data_out      = path->output;
+   src_data.output_frames = 0;
+   src_data.ratio         = ratio;
+
+   path->resampler->process(path->resampler_data, &src_data);
+
+   convert_float_to_s16(path->output_s16, path->output,
+         src_data.output_frames * 2);
+
+   return src_data.output_frames;
+}
+
+static size_t flush_pipeline(struct flush_path *path,
+      const int16_t *data, size_t frames, double ratio)
+{
+   struct audio_pipeline_data pipe_data;
+
+   pipe_data.input          = data;
+   pipe_data.input_frames   = frames;
+   pipe_data.gain           = gain;
+   pipe_data.dsp            = path->dsp;
+   pipe_data.resampler      = path->resampler;
+   pipe_data.resampler_data = path->resampler_data;
+   pipe_data.ratio          = ratio;
+   pipe_data.scratch        = path->input_data;
+   pipe_data.output         = path->output;
+   pipe_data.output_s16     = path->output_s16;
+   pipe_data.output_frames  = 0;
+
+   audio_pipeline_process(&pipe_data);
+
+   return pipe_data.output_frames;
+}
+
+/* Both paths, batch by batch, from a fresh state. Returns false on the
+ * first batch where they disagree. */
+static bool compare(size_t outsamples_max, double ratio)
+{
+   struct flush_path ref, pipe;
+   size_t pos, total = 0;
+   bool ok = false;
+
+   if (!path_init(&ref, outsamples_max) || !path_init(&pipe, outsamples_max))
+      goto end;
+
+   for (pos = 0; pos < num_frames; pos += batch_frames)
+   {
+      size_t frames     = num_frames - pos < batch_frames ?
+         num_frames - pos : batch_frames;
+      size_t ref_frames = flush_reference(&ref,
+            samples + pos * 2, frames, ratio);
+      size_t out_frames = flush_pipeline(&pipe,
+            samples + pos * 2, frames, ratio);
+
+      if (ref_frames != out_frames)
+      {
+         fprintf(stderr, "Batch at frame %u: %u frames out, expected %u.\n",
+               (unsigned)pos, (unsigned)out_frames, (unsigned)ref_frames);
+         goto end;
+      }
+      if (memcmp(ref.output_s16, pipe.output_s16, out_frames * 4))
+      {
+         fprintf(stderr, "Batch at frame %u: output differs.\n",
+               (unsigned)pos);
+         goto end;
+      }
+      total += out_frames;
+   }
+
+   printf("Bit-exact: %u frames in, %u frames out.\n",
+         (unsigned)num_frames, (unsigned)total);
+   ok = true;
+
+end:
+   path_deinit(&ref);
+   path_deinit(&pipe);
+   return ok;
+}
+
+static double bench(const char *name, size_t outsamples_max, double ratio,
+      unsigned iterations,
+      size_t (*flush)(struct flush_path*, const int16_t*, size_t, double))
+{
+   struct flush_path path;
+   unsigned i;
+   double usec;
+   retro_time_t start;
+
+   if (!path_init(&path, outsamples_max))
+   {
+      path_deinit(&path);
+      return 0.0;
+   }
+
+   start = cpu_features_get_time_usec();
+   for (i = 0; i < iterations; i++)
+   {
+      size_t pos;
+      for (pos = 0; pos < num_frames; pos += batch_frames)
+      {
+         size_t frames = num_frames - pos < batch_frames ?
+            num_frames - pos : batch_frames;
+         flush(&path, samples + pos * 2, frames, ratio);
+      }
+   }
+   usec = (double)(cpu_features_get_time_usec() - start) / iterations;
+
+   printf("%-10s %10.1f ms %10.1f ns/frame %8.0fx realtime\n", name,
+         usec / 1000.0, usec * 1000.0 / num_frames,
+         (num_frames * 1000000.0 / in_rate) / usec);
+
+   path_deinit(&path);
+   return usec;
+}
+
+static void usage(void)
+{
+   fprintf(stderr,
+      "Use: audioflushbench [options] [input.wav|input.raw]\n"
+      "Options:\n"
+      "    -r|--resampler <name>:  sinc, nearest or null. Defaults to sinc.\n"
+      "    -q|--quality <0-5>:     Resampler quality. Defaults to 3.\n"
+      "    -s|--in-rate <hz>:      Input rate. Defaults to the WAV's, or 44100.\n"
+      "    -o|--out-rate <hz>:     Output rate. Defaults to 48000.\n"
+      "    -b|--batch <frames>:    Frames per flush. Defaults to 735.\n"
+      "    -g|--gain <gain>:       Volume gain. Defaults to 1.0.\n"
+      "    -d|--dsp <config>:      DSP filter chain config.\n"
+      "    -n|--iterations <n>:    Timed runs over the input. Defaults to 20.\n"
+      "\n");
+}
+
+int main(int argc, char *argv[])
+{
+   size_t outsamples_max;
+   double ratio, ref_usec, pipe_usec;
+   unsigned iterations = 20;
+
+   const struct option opt[] = {
+      {"resampler",  1, NULL, 'r'},
+      {"quality",    1, NULL, 'q'},
+      {"in-rate",    1, NULL, 's'},
+      {"out-rate",   1, NULL, 'o'},
+      {"batch",      1, NULL, 'b'},
+      {"gain",       1, NULL, 'g'},
+      {"dsp",        1, NULL, 'd'},
+      {"iterations", 1, NULL, 'n'},
+      {NULL,         0, NULL, 0}
+   };
+
+   while (1)
+   {
+      int c = getopt_long(argc, argv, "r:q:s:o:b:g:d:n:", opt, NULL);
+      if (c == -1)
+         break;
+
+      switch (c)
+      {
+         case 'r': resampler_ident = optarg;                             break;
+         case 'q': quality         = (enum resampler_quality)atoi(optarg); break;
+         case 's': in_rate         = atoi(optarg);                       break;
+         case 'o': out_rate        = atoi(optarg);                       break;
+         case 'b': batch_frames    = atoi(optarg);                       break;
+         case 'g': gain            = (float)atof(optarg);                break;
+         case 'd': dsp_config      = optarg;                             break;
+         case 'n': iterations      = atoi(optarg);                       break;
+         default:
+            usage();
+            return 1;
+      }
+   }
+
+   if (!batch_frames || !out_rate || !iterations)
+   {
+      usage();
+      return 1;
+   }
+
+   if (optind < argc)
+   {
+      if (!load_input(argv[optind]))
+         return 1;
+   }
+   else
+      synth_input();
+
+   convert_s16_to_float_init_simd();
+   convert_float_to_s16_init_simd();
+
+   ratio          = (double)out_rate / in_rate;
+   /* With room for the resampler's rounding */
+   outsamples_max = batch_frames * 2 * ratio * 1.5 + 16;
+
+   printf("%u frames at %u Hz -> %u Hz, %s resampler, %u frames per flush%s\n",
+         (unsigned)num_frames, in_rate, out_rate, resampler_ident,
+         batch_frames, dsp_config ? ", with DSP" : "");
+
+   if (!compare(outsamples_max, ratio))
+      return 1;
+
+   ref_usec  = bench("separate", outsamples_max, ratio, iterations,
+         flush_reference);
+   pipe_usec = bench("pipeline", outsamples_max, ratio, iterations,
+         flush_pipeline);
+
+   if (ref_usec > 0.0 && pipe_usec > 0.0)
+      printf("Pipeline takes %.1f%% of the time of separate passes.\n",
+            pipe_usec * 100.0 / ref_usec);
+
+   free(samples);
+   return 0;
+}
@@ -0,0 +1,324 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Plays several OGG/MOD streams through libretro-common/audio/audio_mixer.c
+ * at a steady pace, the way audio_driver_flush calls it, and reports how
+ * long each audio_mixer_mix call took on the calling thread. The Makefile
+ * builds it twice: audiomixerbench has the decoder thread, and
+ * audiomixerbench-inline decodes on the mixing thread like before.
+ *
+ * The streams are OGG or MOD/S3M/XM files, handed out to the voices in
+ * turn. With no files, a short synthesized ProTracker module is used.
+ *
+ * Usage: audiomixerbench [options] [file...] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <retro_miscellaneous.h>
+#include <compat/getopt.h>
+#include <features/features_cpu.h>
+#include <audio/audio_mixer.h>
+
+#define MAX_FILES  16
+/* As many as audio_mixer.c can play at once */
+#define MAX_VOICES 8
+
+static unsigned out_rate     = 48000;
+static unsigned batch_frames = 1024;
+static unsigned voices       = 8;
+static unsigned seconds      = 20;
+static unsigned speed        = 1;
+
+static unsigned repeats      = 0;
+static unsigned finished     = 0;
+
+static int compare_time(const void *a, const void *b)
+{
+   retro_time_t x = *(const retro_time_t*)a;
+   retro_time_t y = *(const retro_time_t*)b;
+   return x < y ? -1 : x > y;
+}
+
+static void stop_cb(audio_mixer_sound_t *sound, unsigned reason)
+{
+   if (reason == AUDIO_MIXER_SOUND_REPEATED)
+      repeats++;
+   else if (reason == AUDIO_MIXER_SOUND_FINISHED)
+      finished++;
+}
+
+static void put_be16(uint8_t *p, unsigned v)
+{
+   p[0] = (uint8_t)(v >> 8);
+   p[1] = (uint8_t)v;
+}
+
+/* A four channel ProTracker module: a square and a saw wave playing
+ * pseudo-random notes over four patterns, about half a minute long */
+static void *synth_mod(int32_t *size)
+{
+   static const unsigned periods[] = {
+      428, 381, 339, 320, 285, 254, 226, 214
+   };
+   unsigned i, row, ch;
+   uint32_t seed     = 12345;
+   unsigned patterns = 4;
+   unsigned square   = 64;
+   unsigned saw      = 256;
+   int32_t len       = 1084 + patterns * 1024 + square + saw;
+   uint8_t *mod      = (uint8_t*)calloc(1, len);
+   uint8_t *p        = NULL;
+
+   if (!mod)
+      return NULL;
+
+   memcpy(mod, "audiomixerbench", 15);
+
+   /* Sample headers: name, length, finetune, volume, loop start, loop length */
+   p = mod + 20;
+   memcpy(p, "square", 6);
+   put_be16(p + 22, square / 2);
+   p[25] = 48;
+   put_be16(p + 28, square / 2);
+
+   p = mod + 20 + 30;
+   memcpy(p, "saw", 3);
+   put_be16(p + 22, saw / 2);
+   p[25] = 40;
+   put_be16(p + 28, saw / 2);
+
+   mod[950] = patterns;
+   mod[951] = 127;
+   for (i = 0; i < patterns; i++)
+      mod[952 + i] = i;
+   memcpy(mod + 1080, "M.K.", 4);
+
+   p = mod + 1084;
+   for (i = 0; i < patterns; i++)
+      for (row = 0; row < 64; row++)
+         for (ch = 0; ch < 4; ch++, p += 4)
+         {
+            unsigned sample, period;
+
+            seed = seed * 1103515245 + 12345;
+            if ((row + ch) % 2 || (seed >> 16) % 3 == 0)
+               continue;
+
+            sample = 1 + (ch & 1);
+            period = periods[(seed >> 20) % ARRAY_SIZE(periods)] << (ch >> 1);
+            p[0]   = (uint8_t)((sample & 0xF0) | (period >> 8));
+            p[1]   = (uint8_t)period;
+            p[2]   = (uint8_t)((sample & 0x0F) << 4);
+         }
+
+   for (i = 0; i < square; i++)
+      *p++ = (uint8_t)(int8_t)(i < square / 2 ? 64 : -64);
+   for (i = 0; i < saw; i++)
+      *p++ = (uint8_t)(int8_t)((int)(i * 128 / saw) - 64);
+
+   *size = len;
+   return mod;
+}
+
+static void *load_file(const char *path, int32_t *size)
+{
+   long len;
+   void *data = NULL;
+   FILE *file = fopen(path, "rb");
+
+   if (!file)
+      return NULL;
+
+   fseek(file, 0, SEEK_END);
+   len = ftell(file);
+   fseek(file, 0, SEEK_SET);
+
+   if (len > 0 && (data = malloc(len)))
+   {
+      if (fread(data, 1, len, file) != (size_t)len)
+      {
+         free(data);
+         data = NULL;
+      }
+   }
+
+   fclose(file);
+   *size = (int32_t)len;
+   return data;
+}
+
+static bool is_ogg(const char *path)
+{
+   const char *ext = strrchr(path, '.');
+   return ext && !strcasecmp(ext, ".ogg");
+}
+
+static void usage(void)
+{
+   fprintf(stderr,
+      "Use: audiomixerbench [options] [file.ogg|file.mod...]\n"
+      "Options:\n"
+      "    -o|--out-rate <hz>:     Output rate. Defaults to 48000.\n"
+      "    -b|--batch <frames>:    Frames per mix. Defaults to 1024.\n"
+      "    -v|--voices <n>:        Streams playing at once. Defaults to 8.\n"
+      "    -t|--time <seconds>:    How much audio to mix. Defaults to 20.\n"
+      "    -s|--speed <n>:         How much faster than real time to go.\n"
+      "                            Defaults to 1.\n"
+      "\n");
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned i, calls, silent = 0;
+   unsigned num_files        = 0;
+   double total              = 0.0;
+   const char *files[MAX_FILES];
+   audio_mixer_sound_t *sounds[MAX_VOICES];
+   retro_time_t *times       = NULL;
+   float *buffer             = NULL;
+   retro_time_t start, period;
+
+   const struct option opt[] = {
+      {"out-rate",   1, NULL, 'o'},
+      {"batch",      1, NULL, 'b'},
+      {"voices",     1, NULL, 'v'},
+      {"time",       1, NULL, 't'},
+      {"speed",      1, NULL, 's'},
+      {NULL,         0, NULL, 0}
+   };
+
+   while (1)
+   {
+      int c = getopt_long(argc, argv, "o:b:v:t:s:", opt, NULL);
+      if (c == -1)
+         break;
+
+      switch (c)
+      {
+         case 'o': out_rate     = atoi(optarg); break;
+         case 'b': batch_frames = atoi(optarg); break;
+         case 'v': voices       = atoi(optarg); break;
+         case 't': seconds      = atoi(optarg); break;
+         case 's': speed        = atoi(optarg); break;
+         default:
+            usage();
+            return 1;
+      }
+   }
+
+   for (; optind < argc && num_files < MAX_FILES; optind++)
+      files[num_files++] = argv[optind];
+
+   if (!out_rate || !batch_frames || !voices || !seconds || !speed ||
+         voices > MAX_VOICES)
+   {
+      usage();
+      return 1;
+   }
+
+   audio_mixer_init(out_rate);
+
+   for (i = 0; i < voices; i++)
+   {
+      int32_t size = 0;
+      void *data   = NULL;
+      const char *path = num_files ? files[i % num_files] : NULL;
+
+      if (path)
+         data = load_file(path, &size);
+      else
+         data = synth_mod(&size);
+
+      if (!data)
+      {
+         fprintf(stderr, "Couldn't load %s.\n", path ? path : "module");
+         return 1;
+      }
+
+      if (path && is_ogg(path))
+         sounds[i] = audio_mixer_load_ogg(data, size);
+      else
+         sounds[i] = audio_mixer_load_mod(data, size);
+
+      if (!sounds[i] || !audio_mixer_play(sounds[i], true, 0.5f, stop_cb))
+      {
+         fprintf(stderr, "Couldn't play %s.\n", path ? path : "module");
+         return 1;
+      }
+   }
+
+   calls  = (unsigned)((uint64_t)seconds * out_rate / batch_frames);
+   times  = (retro_time_t*)calloc(calls, sizeof(*times));
+   buffer = (float*)calloc(batch_frames * 2, sizeof(float));
+   period = (retro_time_t)batch_frames * 1000000 / out_rate / speed;
+
+   if (!times || !buffer)
+      return 1;
+
+   start = cpu_features_get_time_usec();
+
+   for (i = 0; i < calls; i++)
+   {
+      unsigned j;
+      retro_time_t now, wake = start + (retro_time_t)i * period;
+
+      now = cpu_features_get_time_usec();
+      if (wake > now)
+         usleep(wake - now);
+
+      memset(buffer, 0, batch_frames * 2 * sizeof(float));
+
+      now = cpu_features_get_time_usec();
+      audio_mixer_mix(buffer, batch_frames, 0.0f, false);
+      times[i] = cpu_features_get_time_usec() - now;
+      total   += times[i];
+
+      for (j = 0; j < batch_frames * 2; j++)
+         if (buffer[j] != 0.0f)
+            break;
+      if (j == batch_frames * 2)
+         silent++;
+   }
+
+   qsort(times, calls, sizeof(*times), compare_time);
+
+   printf("%u voices, %u frames per mix at %u Hz, %s\n",
+         voices, batch_frames, out_rate,
+#ifdef HAVE_THREADS
+         "decoder thread"
+#else
+         "decoding inline"
+#endif
+         );
+   printf("%-10s %10s %10s %10s %10s %12s\n",
+         "calls", "mean us", "p99 us", "max us", "ns/frame", "silent");
+   printf("%-10u %10.1f %10.1f %10.1f %10.1f %12u\n",
+         calls, total / calls, (double)times[calls * 99 / 100],
+         (double)times[calls - 1], total * 1000.0 / calls / batch_frames,
+         silent);
+   printf("%u repeats, %u finished\n", repeats, finished);
+
+   audio_mixer_done();
+
+   for (i = 0; i < voices; i++)
+      audio_mixer_destroy(sounds[i]);
+
+   free(times);
+   free(buffer);
+   return 0;
+}
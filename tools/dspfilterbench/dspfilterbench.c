@@ -0,0 +1,353 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Benchmarks the audio DSP plugins (libretro-common/audio/dsp_filters),
+ * each with its stock .dsp config. Every plugin is run both as its plain
+ * C implementation and as the one picked for this CPU's SIMD features,
+ * and the two outputs are compared. Whole .dsp chains can be timed too,
+ * the way the frontend runs them.
+ *
+ * Usage: dspfilterbench [options] [chain.dsp ...] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <retro_miscellaneous.h>
+#include <compat/getopt.h>
+#include <file/config_file.h>
+#include <file/config_file_userdata.h>
+#include <file/file_path.h>
+#include <features/features_cpu.h>
+#include <libretro_dspfilter.h>
+#include <audio/dsp_filter.h>
+
+typedef const struct dspfilter_implementation *(*get_impl_t)(
+      dspfilter_simd_mask_t mask);
+
+extern const struct dspfilter_implementation *iir_dspfilter_get_implementation(dspfilter_simd_mask_t mask);
+extern const struct dspfilter_implementation *eq_dspfilter_get_implementation(dspfilter_simd_mask_t mask);
+extern const struct dspfilter_implementation *crystalizer_dspfilter_get_implementation(dspfilter_simd_mask_t mask);
+extern const struct dspfilter_implementation *chorus_dspfilter_get_implementation(dspfilter_simd_mask_t mask);
+extern const struct dspfilter_implementation *convolution_dspfilter_get_implementation(dspfilter_simd_mask_t mask);
+extern const struct dspfilter_implementation *echo_dspfilter_get_implementation(dspfilter_simd_mask_t mask);
+extern const struct dspfilter_implementation *panning_dspfilter_get_implementation(dspfilter_simd_mask_t mask);
+extern const struct dspfilter_implementation *phaser_dspfilter_get_implementation(dspfilter_simd_mask_t mask);
+extern const struct dspfilter_implementation *reverb_dspfilter_get_implementation(dspfilter_simd_mask_t mask);
+extern const struct dspfilter_implementation *wahwah_dspfilter_get_implementation(dspfilter_simd_mask_t mask);
+
+static const struct
+{
+   const char *config;
+   get_impl_t get_impl;
+} plugins[] = {
+   { "IIR.dsp",         iir_dspfilter_get_implementation },
+   { "BassBoost.dsp",   iir_dspfilter_get_implementation },
+   { "EQ.dsp",          eq_dspfilter_get_implementation },
+   { "Crystalizer.dsp", crystalizer_dspfilter_get_implementation },
+   { "Chorus.dsp",      chorus_dspfilter_get_implementation },
+   { "Echo.dsp",        echo_dspfilter_get_implementation },
+   { "Panning.dsp",     panning_dspfilter_get_implementation },
+   { "Phaser.dsp",      phaser_dspfilter_get_implementation },
+   { "Reverb.dsp",      reverb_dspfilter_get_implementation },
+   { "Convolution.dsp", convolution_dspfilter_get_implementation },
+   { "WahWah.dsp",      wahwah_dspfilter_get_implementation },
+};
+
+static const struct dspfilter_config dspfilter_config = {
+   config_userdata_get_float,
+   config_userdata_get_int,
+   config_userdata_get_float_array,
+   config_userdata_get_int_array,
+   config_userdata_get_string,
+   config_userdata_free,
+};
+
+static const char *config_dir = "../../libretro-common/audio/dsp_filters";
+static float sample_rate      = 48000.0f;
+static unsigned batch_frames  = 800;
+static unsigned iterations    = 20;
+
+static float *signal;
+static float *work;
+static float *result;
+static float *result_simd;
+static size_t num_frames;
+
+/* A few tones with some noise on top, at a sensible level */
+static void synth_signal(unsigned seconds)
+{
+   size_t i;
+   uint32_t noise = 1;
+
+   num_frames = (size_t)(sample_rate * seconds);
+   signal      = (float*)malloc(num_frames * 2 * sizeof(float));
+   work        = (float*)malloc(num_frames * 2 * sizeof(float));
+   result      = (float*)malloc(num_frames * 2 * sizeof(float));
+   result_simd = (float*)malloc(num_frames * 2 * sizeof(float));
+
+   for (i = 0; i < num_frames; i++)
+   {
+      double t = (double)i / sample_rate;
+      float n;
+
+      noise = noise * 1103515245 + 12345;
+      n     = ((float)(noise >> 16) / 65536.0f - 0.5f) * 0.1f;
+
+      signal[i * 2 + 0] = 0.3f * sin(2 * M_PI * 110.0 * t) +
+         0.2f * sin(2 * M_PI * 1760.0 * t) + n;
+      signal[i * 2 + 1] = 0.3f * sin(2 * M_PI * 164.8 * t) +
+         0.2f * sin(2 * M_PI * 3520.0 * t) - n;
+   }
+}
+
+/* Runs one plugin over the whole signal, a batch at a time. If 'out' is
+ * set, what comes out is collected there. Returns the frames output. */
+static size_t run_plugin(const struct dspfilter_implementation *impl,
+      void *impl_data, float *out)
+{
+   size_t pos, out_frames = 0;
+
+   memcpy(work, signal, num_frames * 2 * sizeof(float));
+
+   for (pos = 0; pos < num_frames; pos += batch_frames)
+   {
+      struct dspfilter_input input;
+      struct dspfilter_output output;
+
+      /* Some plugins expect the output to start off as the input,
+       * which is how retro_dsp_filter_process() calls them. */
+      input.samples  = work + pos * 2;
+      input.frames   = (unsigned)MIN(batch_frames, num_frames - pos);
+      output.samples = input.samples;
+      output.frames  = input.frames;
+
+      impl->process(impl_data, &output, &input);
+
+      if (out)
+         memcpy(out + out_frames * 2, output.samples,
+               output.frames * 2 * sizeof(float));
+      out_frames += output.frames;
+   }
+
+   return out_frames;
+}
+
+static double time_plugin(const struct dspfilter_implementation *impl,
+      void *impl_data)
+{
+   unsigned i;
+   retro_time_t start = cpu_features_get_time_usec();
+
+   for (i = 0; i < iterations; i++)
+      run_plugin(impl, impl_data, NULL);
+
+   return (double)(cpu_features_get_time_usec() - start) * 1000.0 /
+      ((double)iterations * num_frames);
+}
+
+static void *plugin_init(const struct dspfilter_implementation *impl,
+      config_file_t *conf)
+{
+   struct dspfilter_info info;
+   struct config_file_userdata userdata;
+
+   info.input_rate    = sample_rate;
+   userdata.conf      = conf;
+   userdata.prefix[0] = "filter0";
+   userdata.prefix[1] = impl->short_ident;
+
+   return impl->init(&info, &dspfilter_config, &userdata);
+}
+
+static void bench_plugin(const char *config, get_impl_t get_impl,
+      dspfilter_simd_mask_t mask)
+{
+   size_t i, c_frames, simd_frames;
+   double c_ns, simd_ns;
+   float max_diff = 0.0f;
+   char path[PATH_MAX_LENGTH];
+   const struct dspfilter_implementation *c_impl    = get_impl(0);
+   const struct dspfilter_implementation *simd_impl = get_impl(mask);
+   void *c_data                                     = NULL;
+   void *simd_data                                  = NULL;
+   config_file_t *conf                              = NULL;
+
+   fill_pathname_join(path, config_dir, config, sizeof(path));
+   conf = config_file_new(path);
+   if (!conf)
+   {
+      printf("%-18s could not load %s\n", config, path);
+      return;
+   }
+
+   /* Fresh instances for each run, so every run starts from silence */
+   c_data    = plugin_init(c_impl, conf);
+   simd_data = plugin_init(simd_impl, conf);
+   if (!c_data || !simd_data)
+   {
+      printf("%-18s could not init\n", config);
+      goto end;
+   }
+
+   c_frames    = run_plugin(c_impl, c_data, result);
+   simd_frames = run_plugin(simd_impl, simd_data, result_simd);
+
+   for (i = 0; i < MIN(c_frames, simd_frames) * 2; i++)
+   {
+      float diff = fabsf(result[i] - result_simd[i]);
+      if (diff > max_diff || diff != diff)
+         max_diff = diff;
+   }
+
+   c_impl->free(c_data);
+   simd_impl->free(simd_data);
+   c_data    = plugin_init(c_impl, conf);
+   simd_data = plugin_init(simd_impl, conf);
+
+   c_ns      = time_plugin(c_impl, c_data);
+   simd_ns   = time_plugin(simd_impl, simd_data);
+
+   printf("%-18s %10.2f %10.2f %8.2fx %12g%s\n", config, c_ns, simd_ns,
+         c_ns / simd_ns, max_diff,
+         c_frames != simd_frames ? " (frame counts differ)" :
+         c_impl == simd_impl ? " (no SIMD version)" : "");
+
+end:
+   if (c_data)
+      c_impl->free(c_data);
+   if (simd_data)
+      simd_impl->free(simd_data);
+   config_file_free(conf);
+}
+
+static void bench_chain(const char *path)
+{
+   unsigned i;
+   double ns;
+   retro_time_t start;
+   retro_dsp_filter_t *dsp = retro_dsp_filter_new(path, NULL, sample_rate);
+
+   if (!dsp)
+   {
+      printf("%-18s could not load\n", path_basename(path));
+      return;
+   }
+
+   start = cpu_features_get_time_usec();
+   for (i = 0; i < iterations; i++)
+   {
+      size_t pos;
+
+      memcpy(work, signal, num_frames * 2 * sizeof(float));
+
+      for (pos = 0; pos < num_frames; pos += batch_frames)
+      {
+         struct retro_dsp_data data;
+
+         data.input         = work + pos * 2;
+         data.input_frames  = (unsigned)MIN(batch_frames, num_frames - pos);
+         data.output        = NULL;
+         data.output_frames = 0;
+
+         retro_dsp_filter_process(dsp, &data);
+      }
+   }
+   ns = (double)(cpu_features_get_time_usec() - start) * 1000.0 /
+      ((double)iterations * num_frames);
+
+   printf("%-18s %10.2f ns/frame\n", path_basename(path), ns);
+
+   retro_dsp_filter_free(dsp);
+}
+
+static void usage(void)
+{
+   fprintf(stderr,
+      "Use: dspfilterbench [options] [chain.dsp ...]\n"
+      "Options:\n"
+      "    -d|--dir <path>:       Where the stock .dsp configs are.\n"
+      "    -r|--rate <hz>:        Sample rate. Defaults to 48000.\n"
+      "    -b|--batch <frames>:   Frames per call. Defaults to 800.\n"
+      "    -t|--time <seconds>:   Length of the test signal. Defaults to 5.\n"
+      "    -n|--iterations <n>:   Timed runs over the signal. Defaults to 20.\n"
+      "\n"
+      "Each chain given is timed as a whole, e.g. ChipTuneEnhance.dsp.\n"
+      "\n");
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned i, seconds = 5;
+   dspfilter_simd_mask_t mask = (dspfilter_simd_mask_t)cpu_features_get();
+
+   const struct option opt[] = {
+      {"dir",        1, NULL, 'd'},
+      {"rate",       1, NULL, 'r'},
+      {"batch",      1, NULL, 'b'},
+      {"time",       1, NULL, 't'},
+      {"iterations", 1, NULL, 'n'},
+      {NULL,         0, NULL, 0}
+   };
+
+   while (1)
+   {
+      int c = getopt_long(argc, argv, "d:r:b:t:n:", opt, NULL);
+      if (c == -1)
+         break;
+
+      switch (c)
+      {
+         case 'd': config_dir   = optarg;              break;
+         case 'r': sample_rate  = (float)atof(optarg); break;
+         case 'b': batch_frames = atoi(optarg);        break;
+         case 't': seconds      = atoi(optarg);        break;
+         case 'n': iterations   = atoi(optarg);        break;
+         default:
+            usage();
+            return 1;
+      }
+   }
+
+   if (sample_rate <= 0.0f || !batch_frames || !seconds || !iterations)
+   {
+      usage();
+      return 1;
+   }
+
+   synth_signal(seconds);
+
+   printf("%u frames at %.0f Hz, %u frames per call\n\n",
+         (unsigned)num_frames, sample_rate, batch_frames);
+   printf("%-18s %10s %10s %9s %12s\n", "plugin", "C ns/fr",
+         "SIMD ns/fr", "speedup", "max diff");
+
+   for (i = 0; i < ARRAY_SIZE(plugins); i++)
+      bench_plugin(plugins[i].config, plugins[i].get_impl, mask);
+
+   if (optind < argc)
+   {
+      printf("\nChains, as the frontend runs them:\n");
+      for (; optind < argc; optind++)
+         bench_chain(argv[optind]);
+   }
+
+   free(signal);
+   free(work);
+   free(result);
+   free(result_simd);
+   return 0;
+}
@@ -0,0 +1,346 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Benchmarks netplay rollback replays over a simulated loopback
+ * connection: a synthetic core runs with local input, the remote
+ * player's input arrives a fixed number of frames late, in bursts
+ * as it would over a jittery connection, and every
+ * misprediction is replayed the way netplay_sync_post_frame does,
+ * using the real frame ring and input state pool from
+ * netplay_delta.c. Replays are timed with and without the replay
+ * fast path, and the final core state is checked against a run
+ * where every frame had its real input from the start.
+ *
+ * Usage: netplaybench [state size in KB] [frames] [latency] [burst] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <memalign.h>
+#include <features/features_cpu.h>
+#include <encodings/crc32.h>
+
+#include "../../network/netplay/netplay_private.h"
+
+/* The synthetic core: its RAM is its savestate */
+static uint8_t *core_ram;
+static size_t core_size;
+
+static void core_bench_run(uint32_t local, uint32_t remote)
+{
+   size_t i;
+   uint32_t seed = (local * 2654435761u) ^ (remote * 40503u) ^ core_ram[0];
+   size_t  touch = core_size / 8;
+   size_t    pos = seed % core_size;
+
+   /* Change an eighth of RAM, depending on the input and what's there */
+   for (i = 0; i < touch; i++)
+   {
+      seed = seed * 1103515245 + 12345;
+      core_ram[pos] += (uint8_t)(seed >> 16) ^ core_ram[pos ^ 1];
+      if (++pos == core_size)
+         pos = 0;
+   }
+}
+
+static uint32_t local_input(uint32_t frame)
+{
+   return frame / 5;
+}
+
+/* The remote player changes input every 8 frames or so */
+static uint32_t remote_input(uint32_t frame)
+{
+   uint32_t x = (frame / 8) * 2654435761u;
+   return (x >> 29) + frame / 8 / 3;
+}
+
+struct bench_result
+{
+   retro_time_t replay_time;
+   retro_time_t total_time;
+   uint32_t replayed;
+   uint32_t rollbacks;
+   uint32_t stale;
+   unsigned chunks;
+};
+
+static netplay_t *bench_netplay_new(size_t state_size)
+{
+   size_t i;
+   netplay_t *netplay = (netplay_t*)calloc(1, sizeof(*netplay));
+
+   netplay->is_server     = true;
+   netplay->check_frames  = 600;
+   netplay->crcs_valid    = true;
+   netplay->buffer_size   = NETPLAY_MAX_STALL_FRAMES + 1;
+   netplay->buffer        = (struct delta_frame*)memalign_alloc(
+         NETPLAY_FRAME_ALIGN, netplay->buffer_size * sizeof(struct delta_frame));
+   memset(netplay->buffer, 0,
+         netplay->buffer_size * sizeof(struct delta_frame));
+   netplay_input_pool_init(netplay);
+
+   /* Same layout as netplay_init_serialization */
+   netplay->state_size   = state_size;
+   netplay->state_stride = (state_size + NETPLAY_FRAME_ALIGN - 1) &
+      ~((size_t)NETPLAY_FRAME_ALIGN - 1);
+   netplay->state_block  = (uint8_t*)memalign_alloc(NETPLAY_FRAME_ALIGN,
+         netplay->state_stride * netplay->buffer_size);
+   memset(netplay->state_block, 0,
+         netplay->state_stride * netplay->buffer_size);
+   for (i = 0; i < netplay->buffer_size; i++)
+      netplay->buffer[i].state = netplay->state_block +
+         i * netplay->state_stride;
+
+   return netplay;
+}
+
+static void bench_netplay_free(netplay_t *netplay)
+{
+   size_t i;
+   for (i = 0; i < netplay->buffer_size; i++)
+      netplay_delta_frame_free(&netplay->buffer[i]);
+   memalign_free(netplay->buffer);
+   netplay_input_pool_free(netplay);
+   memalign_free(netplay->state_block);
+   free(netplay);
+}
+
+/* The input the core gets for a frame: the real remote input if we have it,
+ * else the last remote input we had */
+static void resolve(netplay_t *netplay, struct delta_frame *delta,
+      uint32_t last_remote, uint32_t *local, uint32_t *remote)
+{
+   netplay_input_state_t lstate, rstate, sstate, res;
+
+   lstate = netplay_input_state_for(netplay, &delta->real_input[0],
+         0, 1, false, true);
+   rstate = netplay_input_state_for(netplay, &delta->real_input[1],
+         1, 1, false, true);
+   sstate = netplay_input_state_for(netplay, &delta->simlated_input[1],
+         1, 1, false, false);
+
+   sstate->data[0] = rstate ? rstate->data[0] : last_remote;
+
+   res = netplay_input_state_for(netplay, &delta->resolved_input[0],
+         0, 1, false, false);
+   res->data[0] = lstate->data[0];
+   res = netplay_input_state_for(netplay, &delta->resolved_input[1],
+         0, 1, false, false);
+   res->data[0] = sstate->data[0];
+
+   *local  = lstate->data[0];
+   *remote = sstate->data[0];
+}
+
+static void serialize(netplay_t *netplay, struct delta_frame *delta)
+{
+   memset(delta->state, 0, netplay->state_size);
+   memcpy(delta->state, core_ram, core_size);
+}
+
+static uint32_t bench(size_t state_size, uint32_t frames, uint32_t latency,
+      uint32_t burst, bool fast_path, struct bench_result *result)
+{
+   uint32_t frame, crc;
+   uint32_t last_remote = 0;
+   retro_time_t start;
+   struct netplay_input_chunk *chunk;
+   netplay_t *netplay        = bench_netplay_new(state_size);
+
+   netplay->replay_fast_path = fast_path;
+   memset(result, 0, sizeof(*result));
+   memset(core_ram, 0, core_size);
+
+   start = cpu_features_get_time_usec();
+
+   /* Keep going after the last frame until all the remote input is in */
+   for (frame = 0; frame < frames + latency + burst; frame++)
+   {
+      uint32_t local, remote;
+      netplay_input_state_t istate;
+
+      if (frame < frames)
+      {
+         /* netplay_sync_pre_frame and our own input */
+         struct delta_frame *ptr = &netplay->buffer[netplay->run_ptr];
+
+         if (!netplay_delta_frame_ready(netplay, ptr, frame))
+         {
+            fprintf(stderr, "Frame %u isn't ready.\n", frame);
+            exit(1);
+         }
+         serialize(netplay, ptr);
+         istate = netplay_input_state_for(netplay, &ptr->real_input[0],
+               0, 1, true, false);
+         istate->data[0] = local_input(frame);
+
+         resolve(netplay, ptr, last_remote, &local, &remote);
+         core_bench_run(local, remote);
+         netplay->run_ptr = NEXT_PTR(netplay->run_ptr);
+         netplay->run_frame_count = frame + 1;
+      }
+
+      /* The remote input for earlier frames comes in */
+      while ((frame + 1) % burst == 0 || frame >= frames + latency)
+      {
+         uint32_t rframe = netplay->unread_frame_count;
+         struct delta_frame *rptr = &netplay->buffer[netplay->unread_ptr];
+
+         if (rframe + latency > frame || rframe >= frames)
+            break;
+
+         istate = netplay_input_state_for(netplay, &rptr->real_input[1],
+               1, 1, true, false);
+         istate->data[0] = last_remote = remote_input(rframe);
+         rptr->have_real[1] = true;
+         netplay->unread_ptr = NEXT_PTR(netplay->unread_ptr);
+         netplay->unread_frame_count = rframe + 1;
+      }
+
+      /* netplay_sync_post_frame: skip frames we predicted right */
+      while (netplay->other_frame_count < netplay->unread_frame_count)
+      {
+         struct delta_frame *optr = &netplay->buffer[netplay->other_ptr];
+         netplay_input_state_t sim = netplay_input_state_for(netplay,
+               &optr->simlated_input[1], 1, 1, false, true);
+         netplay_input_state_t real = netplay_input_state_for(netplay,
+               &optr->real_input[1], 1, 1, false, true);
+
+         if (sim->data[0] != real->data[0])
+            break;
+         netplay->other_ptr = NEXT_PTR(netplay->other_ptr);
+         netplay->other_frame_count++;
+      }
+
+      /* And replay the rest */
+      if (netplay->other_frame_count < netplay->unread_frame_count)
+      {
+         retro_time_t replay_start = cpu_features_get_time_usec();
+
+         netplay->replay_ptr         = netplay->other_ptr;
+         netplay->replay_frame_count = netplay->other_frame_count;
+         memcpy(core_ram, netplay->buffer[netplay->replay_ptr].state,
+               core_size);
+
+         while (netplay->replay_frame_count < netplay->run_frame_count)
+         {
+            struct delta_frame *rptr = &netplay->buffer[netplay->replay_ptr];
+
+            if (netplay_replay_needs_state(netplay, rptr))
+            {
+               serialize(netplay, rptr);
+               rptr->stale_state = false;
+            }
+            else
+            {
+               rptr->stale_state = true;
+               result->stale++;
+            }
+
+            if (netplay->replay_frame_count < netplay->unread_frame_count &&
+                !rptr->stale_state &&
+                rptr->frame % netplay->check_frames == 0)
+               rptr->crc = netplay_delta_frame_crc(netplay, rptr);
+
+            resolve(netplay, rptr, last_remote, &local, &remote);
+            core_bench_run(local, remote);
+            netplay->replay_ptr = NEXT_PTR(netplay->replay_ptr);
+            netplay->replay_frame_count++;
+            result->replayed++;
+         }
+
+         netplay->other_ptr         = netplay->unread_ptr;
+         netplay->other_frame_count = netplay->unread_frame_count;
+         result->rollbacks++;
+         result->replay_time += cpu_features_get_time_usec() - replay_start;
+      }
+   }
+
+   result->total_time = cpu_features_get_time_usec() - start;
+
+   for (chunk = netplay->input_pool; chunk; chunk = chunk->next)
+      result->chunks++;
+
+   crc = encoding_crc32(0L, core_ram, core_size);
+   bench_netplay_free(netplay);
+   return crc;
+}
+
+/* Where the core should end up once every frame has its real input */
+static uint32_t reference(uint32_t frames)
+{
+   uint32_t frame;
+
+   memset(core_ram, 0, core_size);
+   for (frame = 0; frame < frames; frame++)
+      core_bench_run(local_input(frame), remote_input(frame));
+
+   return encoding_crc32(0L, core_ram, core_size);
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned i;
+   uint32_t ref;
+   size_t   kb     = argc > 1 ? strtoul(argv[1], NULL, 0) : 256;
+   uint32_t frames = argc > 2 ? strtoul(argv[2], NULL, 0) : 3000;
+   uint32_t lat    = argc > 3 ? strtoul(argv[3], NULL, 0) : 6;
+   uint32_t burst  = argc > 4 ? strtoul(argv[4], NULL, 0) : 4;
+   bool ok         = true;
+
+   if (!kb || !frames || !burst ||
+         lat + burst >= NETPLAY_MAX_STALL_FRAMES)
+   {
+      fprintf(stderr, "Usage: %s [state size in KB] [frames] [latency] [burst]\n"
+            "latency + burst must be under %u frames\n",
+            argv[0], NETPLAY_MAX_STALL_FRAMES);
+      return 1;
+   }
+
+   core_size = kb * 1024;
+   core_ram  = (uint8_t*)malloc(core_size);
+
+   printf("%u KB state, %u frames, remote input %u frames late "
+         "in bursts of %u\n\n", (unsigned)kb, frames, lat, burst);
+   printf("%-10s %10s %10s %12s %10s %8s %7s\n",
+         "fast path", "rollbacks", "replayed", "replay fps",
+         "total fps", "skipped", "chunks");
+
+   ref = reference(frames);
+
+   for (i = 0; i < 2; i++)
+   {
+      struct bench_result res;
+      uint32_t crc = bench(core_size, frames, lat, burst, i == 1,
+            &res);
+
+      printf("%-10s %10u %10u %12.0f %10.0f %8u %7u\n",
+            i ? "on" : "off", res.rollbacks, res.replayed,
+            res.replay_time ? res.replayed * 1000000.0 / res.replay_time : 0.0,
+            frames * 1000000.0 / res.total_time,
+            res.stale, res.chunks);
+
+      if (crc != ref)
+      {
+         printf("  final state %08X should be %08X!\n", crc, ref);
+         ok = false;
+      }
+   }
+
+   free(core_ram);
+   return ok ? 0 : 1;
+}
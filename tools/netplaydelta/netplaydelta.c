@@ -0,0 +1,226 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Round trip test for the block-level savestate deltas netplay sends
+ * as LOAD_SAVESTATE_DELTA: a state is diffed against a base with
+ * netplay_delta_encode_blocks, the blocks are compressed and
+ * decompressed with the pipe and zlib transcoders netplay uses, and
+ * netplay_delta_decode_blocks has to rebuild the exact state from them
+ * and the base, both into a separate buffer and in place. Truncated
+ * block data must be reported.
+ *
+ * To see it over a real connection, host netplay on one instance,
+ * connect a second one on the same machine to 127.0.0.1, then load
+ * states on the host.
+ *
+ * Usage: netplaydelta [rounds]
+ * Exits with 1 if any round trip fails. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <streams/trans_stream.h>
+
+#include "../../network/netplay/netplay_private.h"
+
+static uint32_t seed = 1;
+
+static uint32_t rand32(void)
+{
+   seed = seed * 1103515245 + 12345;
+   return seed >> 8;
+}
+
+static void fill_random(uint8_t *data, size_t size)
+{
+   size_t i;
+   for (i = 0; i < size; i++)
+      data[i] = (uint8_t)rand32();
+}
+
+/* Compress and decompress the gathered blocks, the way
+ * netplay_send_savestate_delta and netplay_recv_savestate_delta do */
+static size_t transcode(const struct trans_stream_backend *backend,
+      const uint8_t *in, size_t len, uint8_t *zbuf, size_t zbuf_size,
+      uint8_t *out, size_t out_size)
+{
+   uint32_t rd, zlen, wn;
+   void *stream = backend->stream_new();
+
+   backend->set_in(stream, in, (uint32_t)len);
+   backend->set_out(stream, zbuf, (uint32_t)zbuf_size);
+   if (!backend->trans(stream, true, &rd, &zlen, NULL))
+      zlen = 0;
+   backend->stream_free(stream);
+
+   stream = backend->reverse->stream_new();
+   backend->reverse->set_in(stream, zbuf, zlen);
+   backend->reverse->set_out(stream, out, (uint32_t)out_size);
+   if (!backend->reverse->trans(stream, true, &rd, &wn, NULL))
+      wn = 0;
+   backend->reverse->stream_free(stream);
+
+   return wn;
+}
+
+static bool round_trip(const struct trans_stream_backend *backend,
+      size_t size, unsigned changes)
+{
+   unsigned i;
+   bool ok               = true;
+   size_t blocks         = NETPLAY_DELTA_BLOCKS(size);
+   size_t expect         = 0;
+   size_t len, wn;
+   size_t zbuf_size      = size + size / 100 + 1024;
+   uint8_t *base         = (uint8_t*)malloc(size);
+   uint8_t *state        = (uint8_t*)malloc(size);
+   uint8_t *gathered     = (uint8_t*)malloc(size);
+   uint8_t *received     = (uint8_t*)malloc(size);
+   uint8_t *rebuilt      = (uint8_t*)malloc(size);
+   uint8_t *zbuf         = (uint8_t*)malloc(zbuf_size);
+   uint32_t *hashes      = (uint32_t*)malloc(blocks * sizeof(uint32_t));
+   uint32_t *base_hashes = (uint32_t*)malloc(blocks * sizeof(uint32_t));
+   uint32_t *bitmap      = (uint32_t*)calloc(
+         NETPLAY_DELTA_BITMAP_WORDS(blocks), sizeof(uint32_t));
+   bool *changed         = (bool*)calloc(blocks, sizeof(bool));
+
+   fill_random(base, size);
+   memcpy(state, base, size);
+
+   /* Change a few bytes here and there, sometimes in the same block */
+   for (i = 0; i < changes; i++)
+   {
+      size_t pos = rand32() % size;
+      state[pos] ^= (uint8_t)(1 + rand32() % 255);
+   }
+   for (i = 0; i < blocks; i++)
+   {
+      size_t offset = (size_t)i * NETPLAY_DELTA_BLOCK_SIZE;
+      size_t bsize  = MIN(NETPLAY_DELTA_BLOCK_SIZE, size - offset);
+      changed[i]    = memcmp(base + offset, state + offset, bsize) != 0;
+      if (changed[i])
+         expect += bsize;
+   }
+
+   netplay_delta_hash_blocks(size, base, base_hashes);
+   netplay_delta_hash_blocks(size, state, hashes);
+   len = netplay_delta_encode_blocks(size, state, hashes, base_hashes,
+         bitmap, gathered);
+
+   if (len != expect)
+   {
+      printf("  %zu bytes, %u changes: gathered %zu bytes, expected %zu\n",
+            size, changes, len, expect);
+      ok = false;
+   }
+   for (i = 0; i < blocks; i++)
+      if (!!(bitmap[i / 32] & (1U << (i % 32))) != changed[i])
+      {
+         printf("  %zu bytes, %u changes: block %u %s\n", size, changes, i,
+               changed[i] ? "changed but not sent" : "sent but unchanged");
+         ok = false;
+      }
+
+   wn = transcode(backend, gathered, len, zbuf, zbuf_size, received, size);
+   if (wn != len)
+   {
+      printf("  %zu bytes, %u changes: %zu bytes back from %zu\n",
+            size, changes, wn, len);
+      ok = false;
+   }
+
+   /* Into a separate buffer */
+   memset(rebuilt, 0xAA, size);
+   if (!netplay_delta_decode_blocks(size, rebuilt, base, bitmap, received, wn) ||
+       memcmp(rebuilt, state, size))
+   {
+      printf("  %zu bytes, %u changes: rebuilt state differs\n", size, changes);
+      ok = false;
+   }
+
+   /* In place, on top of the base */
+   memcpy(rebuilt, base, size);
+   if (!netplay_delta_decode_blocks(size, rebuilt, rebuilt, bitmap, received, wn) ||
+       memcmp(rebuilt, state, size))
+   {
+      printf("  %zu bytes, %u changes: state rebuilt in place differs\n",
+            size, changes);
+      ok = false;
+   }
+
+   /* Short data has to be noticed */
+   if (len && netplay_delta_decode_blocks(size, rebuilt, base, bitmap,
+            received, len - 1))
+   {
+      printf("  %zu bytes, %u changes: truncated blocks not reported\n",
+            size, changes);
+      ok = false;
+   }
+
+   free(base);
+   free(state);
+   free(gathered);
+   free(received);
+   free(rebuilt);
+   free(zbuf);
+   free(hashes);
+   free(base_hashes);
+   free(bitmap);
+   free(changed);
+   return ok;
+}
+
+int main(int argc, char *argv[])
+{
+   static const size_t sizes[] = {
+      1, 1000, 1024, 1025, 4096, 65536 + 17, 300 * 1024
+   };
+   static const unsigned changes[] = { 0, 1, 3, 40, 1000 };
+   const struct trans_stream_backend *backends[2];
+   const char *names[2]  = { "pipe", "zlib" };
+   unsigned rounds       = argc > 1 ? (unsigned)atoi(argv[1]) : 20;
+   unsigned failed       = 0;
+   unsigned total        = 0;
+   unsigned b, r, s, c;
+
+   backends[0] = trans_stream_get_pipe_backend();
+   backends[1] = trans_stream_get_zlib_deflate_backend();
+
+   for (b = 0; b < 2; b++)
+   {
+      unsigned before = failed;
+
+      if (!backends[b])
+      {
+         printf("%s: not built in, skipped\n", names[b]);
+         continue;
+      }
+
+      for (r = 0; r < rounds; r++)
+         for (s = 0; s < ARRAY_SIZE(sizes); s++)
+            for (c = 0; c < ARRAY_SIZE(changes); c++)
+            {
+               total++;
+               if (!round_trip(backends[b], sizes[s], changes[c]))
+                  failed++;
+            }
+
+      printf("%s: %s\n", names[b], failed == before ? "ok" : "FAILED");
+   }
+
+   printf("%u of %u round trips failed\n", failed, total);
+   return failed ? 1 : 0;
+}
@@ -0,0 +1,360 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Load generator for a netplay server: connects N spectators over
+ * loopback (or to any host), some of which can be made to read
+ * slowly, and reports how steadily each one got its frames. With a
+ * healthy server, the fast spectators keep getting frames at full
+ * speed however badly the slow ones behave.
+ *
+ * Usage: netplayload [-H host] [-P port] [-n spectators]
+ *                    [-s slow spectators] [-t seconds] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+
+#include <compat/getopt.h>
+#include <net/net_compat.h>
+#include <net/net_socket.h>
+#include <features/features_cpu.h>
+
+/* Only for #defines */
+#include "../../network/netplay/netplay_private.h"
+
+struct spectator_report
+{
+   unsigned id;
+   bool slow;
+   bool connected;
+   bool dropped;
+   uint32_t frames;
+   uint64_t bytes;
+   retro_time_t worst_gap;
+};
+
+static const char *host = "localhost";
+static int port         = RARCH_DEFAULT_PORT;
+
+static uint32_t *payload;
+static size_t payload_size;
+
+/* Receive exactly len bytes, giving up at the deadline */
+static bool recv_until(int sock, void *buf, size_t len, retro_time_t deadline)
+{
+   uint8_t *data = (uint8_t*)buf;
+
+   while (len)
+   {
+      ssize_t ret = recv(sock, (char*)data, len, 0);
+      if (ret == 0)
+         return false;
+      if (ret < 0)
+      {
+         if ((errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) ||
+               cpu_features_get_time_usec() >= deadline)
+            return false;
+         continue;
+      }
+      data += ret;
+      len  -= ret;
+   }
+
+   return true;
+}
+
+static bool recv_cmd(int sock, uint32_t *cmd, uint32_t *cmd_size,
+      retro_time_t deadline)
+{
+   uint32_t hdr[2];
+
+   if (!recv_until(sock, hdr, sizeof(hdr), deadline))
+      return false;
+
+   *cmd      = ntohl(hdr[0]);
+   *cmd_size = ntohl(hdr[1]);
+
+   while (*cmd_size > payload_size)
+   {
+      payload_size *= 2;
+      payload = (uint32_t*)realloc(payload, payload_size);
+      if (!payload)
+         return false;
+   }
+
+   return recv_until(sock, payload, *cmd_size, deadline);
+}
+
+static bool send_cmd(int sock, uint32_t cmd, uint32_t cmd_size)
+{
+   uint32_t hdr[2];
+   hdr[0] = htonl(cmd);
+   hdr[1] = htonl(cmd_size);
+   return socket_send_all_blocking(sock, hdr, sizeof(hdr), true) &&
+      socket_send_all_blocking(sock, payload, cmd_size, true);
+}
+
+/* Same handshake as ranetplayer, ending up as a spectator */
+static int spectator_connect(unsigned id, retro_time_t deadline)
+{
+   struct addrinfo *addr;
+   uint32_t cmd, cmd_size;
+   int sock = socket_init((void **) &addr, port, host, SOCKET_PROTOCOL_TCP);
+
+   if (sock < 0)
+      return -1;
+   if (socket_connect(sock, addr, false) < 0)
+      goto error;
+
+   if (!recv_until(sock, payload, 6*sizeof(uint32_t), deadline))
+      goto error;
+   if (payload[3])
+   {
+      fprintf(stderr, "Password required but unsupported.\n");
+      goto error;
+   }
+   if (!socket_send_all_blocking(sock, payload, 6*sizeof(uint32_t), true))
+      goto error;
+
+   memset(payload, 0, NETPLAY_NICK_LEN);
+   snprintf((char *) payload, NETPLAY_NICK_LEN, "Spectator %u", id);
+   if (!send_cmd(sock, NETPLAY_CMD_NICK, NETPLAY_NICK_LEN))
+      goto error;
+
+   /* Their nick, then INFO to echo back, then SYNC */
+   if (!recv_cmd(sock, &cmd, &cmd_size, deadline))
+      goto error;
+   if (!recv_cmd(sock, &cmd, &cmd_size, deadline) || cmd != NETPLAY_CMD_INFO)
+      goto error;
+   if (!send_cmd(sock, cmd, cmd_size))
+      goto error;
+   if (!recv_cmd(sock, &cmd, &cmd_size, deadline) || cmd != NETPLAY_CMD_SYNC)
+      goto error;
+
+   return sock;
+
+error:
+   socket_close(sock);
+   return -1;
+}
+
+static void spectator(unsigned id, bool slow, unsigned seconds, int report_fd)
+{
+   struct spectator_report report;
+   struct timeval tv;
+   uint32_t cmd, cmd_size, last_frame = 0;
+   retro_time_t last_time = 0;
+   retro_time_t start     = cpu_features_get_time_usec();
+   retro_time_t end       = start + seconds * 1000000LL;
+   int sock;
+
+   memset(&report, 0, sizeof(report));
+   report.id   = id;
+   report.slow = slow;
+
+   payload_size = 4096;
+   payload      = (uint32_t*)malloc(payload_size);
+
+   sock = spectator_connect(id, start + 10000000LL);
+   if (sock < 0)
+      goto done;
+   report.connected = true;
+
+   /* Don't block past the end of the run */
+   tv.tv_sec  = 0;
+   tv.tv_usec = 100000;
+   setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, (const char*)&tv, sizeof(tv));
+
+   if (slow)
+   {
+      /* Keep as little in flight as the kernel allows */
+      int size = 1;
+      setsockopt(sock, SOL_SOCKET, SO_RCVBUF, (const char*)&size,
+            sizeof(size));
+   }
+
+   while (cpu_features_get_time_usec() < end)
+   {
+      if (!recv_cmd(sock, &cmd, &cmd_size, end))
+      {
+         if (cpu_features_get_time_usec() < end)
+            report.dropped = true;
+         break;
+      }
+      report.bytes += 8 + cmd_size;
+
+      /* Count the server's frames */
+      if ((cmd == NETPLAY_CMD_NOINPUT && cmd_size >= sizeof(uint32_t)) ||
+          (cmd == NETPLAY_CMD_INPUT && cmd_size >= 2*sizeof(uint32_t) &&
+           ntohl(payload[1]) == 0))
+      {
+         uint32_t frame   = ntohl(payload[0]);
+         retro_time_t now = cpu_features_get_time_usec();
+
+         if (frame > last_frame)
+         {
+            if (last_time && now - last_time > report.worst_gap)
+               report.worst_gap = now - last_time;
+            last_frame = frame;
+            last_time  = now;
+            report.frames++;
+         }
+
+         /* A slow spectator takes a nap every few frames */
+         if (slow && report.frames % 4 == 0)
+            usleep(100000);
+      }
+   }
+
+   socket_close(sock);
+
+done:
+   if (write(report_fd, &report, sizeof(report)) != sizeof(report))
+      perror("write");
+   free(payload);
+}
+
+static void usage(void)
+{
+   fprintf(stderr,
+      "Use: netplayload [options]\n"
+      "Options:\n"
+      "    -H|--host <address>:  Netplay host. Defaults to localhost.\n"
+      "    -P|--port <port>:     Netplay port. Defaults to 55435.\n"
+      "    -n|--number <n>:      Number of spectators. Defaults to 8.\n"
+      "    -s|--slow <n>:        How many of them read slowly. Defaults to 0.\n"
+      "    -t|--time <seconds>:  How long to run. Defaults to 10.\n"
+      "\n");
+}
+
+int main(int argc, char *argv[])
+{
+   struct spectator_report report;
+   unsigned i, number = 8, slow = 0, seconds = 10;
+   unsigned fast_seen = 0, fast_frames_min = (unsigned) -1,
+            fast_frames_max = 0, dropped = 0, failed = 0;
+   retro_time_t fast_worst_gap = 0;
+   int fds[2];
+
+   const struct option opt[] = {
+      {"host",       1, NULL, 'H'},
+      {"port",       1, NULL, 'P'},
+      {"number",     1, NULL, 'n'},
+      {"slow",       1, NULL, 's'},
+      {"time",       1, NULL, 't'},
+      {NULL,         0, NULL, 0}
+   };
+
+   while (1)
+   {
+      int c = getopt_long(argc, argv, "H:P:n:s:t:", opt, NULL);
+      if (c == -1)
+         break;
+
+      switch (c)
+      {
+         case 'H': host    = optarg;       break;
+         case 'P': port    = atoi(optarg); break;
+         case 'n': number  = atoi(optarg); break;
+         case 's': slow    = atoi(optarg); break;
+         case 't': seconds = atoi(optarg); break;
+         default:
+            usage();
+            return 1;
+      }
+   }
+
+   if (!number || slow > number || !seconds)
+   {
+      usage();
+      return 1;
+   }
+
+   signal(SIGPIPE, SIG_IGN);
+   if (pipe(fds) < 0)
+   {
+      perror("pipe");
+      return 1;
+   }
+
+   for (i = 0; i < number; i++)
+   {
+      pid_t pid = fork();
+      if (pid < 0)
+      {
+         perror("fork");
+         return 1;
+      }
+      if (pid == 0)
+      {
+         close(fds[0]);
+         spectator(i + 1, i < slow, seconds, fds[1]);
+         _exit(0);
+      }
+   }
+   close(fds[1]);
+
+   printf("%-4s %-5s %10s %10s %12s %14s\n",
+         "id", "slow", "frames", "fps", "KB", "worst gap ms");
+
+   while (read(fds[0], &report, sizeof(report)) == sizeof(report))
+   {
+      const char *state = report.dropped ? "dropped" : "";
+
+      if (!report.connected)
+      {
+         printf("%-4u %-5s failed to connect\n", report.id,
+               report.slow ? "yes" : "no");
+         failed++;
+         continue;
+      }
+
+      printf("%-4u %-5s %10u %10.1f %12.1f %14.1f %s\n",
+            report.id, report.slow ? "yes" : "no", report.frames,
+            report.frames / (double) seconds, report.bytes / 1024.0,
+            report.worst_gap / 1000.0, state);
+
+      if (report.dropped)
+         dropped++;
+
+      if (!report.slow)
+      {
+         fast_seen++;
+         if (report.frames < fast_frames_min)
+            fast_frames_min = report.frames;
+         if (report.frames > fast_frames_max)
+            fast_frames_max = report.frames;
+         if (report.worst_gap > fast_worst_gap)
+            fast_worst_gap = report.worst_gap;
+      }
+   }
+
+   while (wait(NULL) > 0);
+
+   if (fast_seen)
+      printf("\n%u fast spectators: %.1f-%.1f fps, worst gap %.1f ms\n",
+            fast_seen, fast_frames_min / (double) seconds,
+            fast_frames_max / (double) seconds, fast_worst_gap / 1000.0);
+   printf("%u dropped by the server, %u failed to connect\n",
+         dropped, failed);
+
+   return failed ? 1 : 0;
+}
@@ -0,0 +1,241 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Benchmarks playlist.c on synthetic collections: pushing new
+ * entries, bumping existing ones to the top, path lookups, and
+ * loading the written playlist with and without the binary
+ * cache. Loaded playlists are checked against the pushed ones.
+ *
+ * Usage: playlistbench [directory for the temporary playlists] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#include <retro_miscellaneous.h>
+#include <features/features_cpu.h>
+#include <file/file_path.h>
+
+#include "../../configuration.h"
+#include "../../playlist.h"
+
+static settings_t bench_settings;
+
+settings_t *config_get_ptr(void)
+{
+   return &bench_settings;
+}
+
+/* playlist.c only logs, keep the output readable */
+void RARCH_LOG(const char *fmt, ...) { }
+void RARCH_WARN(const char *fmt, ...) { }
+void RARCH_ERR(const char *fmt, ...) { }
+
+static uint32_t rand_state = 1;
+
+static uint32_t bench_rand(void)
+{
+   rand_state = rand_state * 1103515245 + 12345;
+   return rand_state >> 8;
+}
+
+static void make_entry(unsigned i, char *path, char *label, char *crc)
+{
+   static const char *regions[] = { "USA", "Europe", "Japan", "World" };
+
+   sprintf(label, "Synthetic Game %u (%s)", i, regions[i & 3]);
+   sprintf(path, "/home/user/roms/System %u/%s.zip", i % 7, label);
+   sprintf(crc, "%08X|crc", i * 2654435761u);
+}
+
+static bool check(playlist_t *playlist, unsigned count)
+{
+   unsigned i;
+   char path[PATH_MAX_LENGTH];
+   char label[256];
+   char crc[32];
+
+   if (playlist_size(playlist) != count)
+   {
+      printf("size %u, expected %u\n",
+            (unsigned)playlist_size(playlist), count);
+      return false;
+   }
+
+   /* Pushed to the top, so the last one pushed comes first */
+   for (i = 0; i < count; i++)
+   {
+      const char *e_path  = NULL;
+      const char *e_label = NULL;
+      const char *e_crc   = NULL;
+      const char *e_core  = NULL;
+
+      make_entry(count - 1 - i, path, label, crc);
+      playlist_get_index(playlist, i, &e_path, &e_label,
+            &e_core, NULL, &e_crc, NULL);
+
+      if (!e_path || !e_label || !e_crc || !e_core
+            || strcmp(e_path, path) || strcmp(e_label, label)
+            || strcmp(e_crc, crc)
+            || strcmp(e_core, "/usr/lib/libretro/bench_libretro.so"))
+      {
+         printf("entry %u differs\n", i);
+         return false;
+      }
+   }
+
+   return true;
+}
+
+static double elapsed_ms(retro_time_t start)
+{
+   return (cpu_features_get_time_usec() - start) / 1000.0;
+}
+
+static bool run(const char *dir, unsigned count)
+{
+   unsigned i;
+   retro_time_t start;
+   char lpl[PATH_MAX_LENGTH];
+   char cache[PATH_MAX_LENGTH];
+   char path[PATH_MAX_LENGTH];
+   char label[256];
+   char crc[32];
+   double push_ms, bump_ms, find_ms, write_ms, load_ms, cached_ms;
+   unsigned ops            = count < 20000 ? count : 20000;
+   unsigned found          = 0;
+   bool ok                 = true;
+   playlist_t *playlist    = NULL;
+
+   snprintf(lpl, sizeof(lpl), "%s/playlistbench_%u.lpl", dir, count);
+   snprintf(cache, sizeof(cache), "%s.cache", lpl);
+   remove(lpl);
+   remove(cache);
+
+   bench_settings.bools.playlist_cache_enable = false;
+
+   playlist = playlist_init(lpl, count);
+   if (!playlist)
+      return false;
+
+   start = cpu_features_get_time_usec();
+   for (i = 0; i < count; i++)
+   {
+      make_entry(i, path, label, crc);
+      playlist_push(playlist, path, label,
+            "/usr/lib/libretro/bench_libretro.so", "Bench",
+            crc, "Bench.lpl");
+   }
+   push_ms = elapsed_ms(start);
+
+   ok = check(playlist, count) && ok;
+
+   /* Lookups, half of them misses */
+   start = cpu_features_get_time_usec();
+   for (i = 0; i < ops; i++)
+   {
+      make_entry(bench_rand() % (count * 2), path, label, crc);
+      if (playlist_entry_exists(playlist, path, crc))
+         found++;
+   }
+   find_ms = elapsed_ms(start);
+
+   /* Re-pushing existing entries moves them to the top */
+   start = cpu_features_get_time_usec();
+   for (i = 0; i < ops; i++)
+   {
+      make_entry(bench_rand() % count, path, label, crc);
+      playlist_push(playlist, path, label,
+            "/usr/lib/libretro/bench_libretro.so", "Bench",
+            crc, "Bench.lpl");
+   }
+   bump_ms = elapsed_ms(start);
+
+   playlist_free(playlist);
+
+   /* Write in push order, for check() */
+   playlist = playlist_init(lpl, count);
+   for (i = 0; i < count; i++)
+   {
+      make_entry(i, path, label, crc);
+      playlist_push(playlist, path, label,
+            "/usr/lib/libretro/bench_libretro.so", "Bench",
+            crc, "Bench.lpl");
+   }
+
+   start = cpu_features_get_time_usec();
+   playlist_write_file(playlist);
+   write_ms = elapsed_ms(start);
+   playlist_free(playlist);
+
+   start    = cpu_features_get_time_usec();
+   playlist = playlist_init(lpl, count);
+   load_ms  = elapsed_ms(start);
+   ok       = check(playlist, count) && ok;
+   playlist_free(playlist);
+
+   /* The first load writes the cache, the second one uses it */
+   bench_settings.bools.playlist_cache_enable = true;
+   playlist_free(playlist_init(lpl, count));
+
+   start     = cpu_features_get_time_usec();
+   playlist  = playlist_init(lpl, count);
+   cached_ms = elapsed_ms(start);
+   ok        = check(playlist, count) && ok;
+   playlist_free(playlist);
+
+   if (!path_is_valid(cache))
+      printf("(no cache written, the cached load is a plain load)\n");
+
+   printf("%7u %10.0f %10.0f %10.0f %9.2f %9.2f %9.2f\n", count,
+         push_ms  * 1000000.0 / count,
+         bump_ms  * 1000000.0 / ops,
+         find_ms  * 1000000.0 / ops,
+         write_ms, load_ms, cached_ms);
+
+   if (found == 0)
+      printf("no lookup hit\n");
+
+   remove(lpl);
+   remove(cache);
+
+   return ok;
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned count;
+   const char *dir = argc > 1 ? argv[1] : ".";
+   bool ok         = true;
+
+   printf("%7s %10s %10s %10s %9s %9s %9s\n", "entries",
+         "push ns", "bump ns", "find ns", "write ms", "load ms", "cached ms");
+
+   for (count = 1000; count <= 100000; count *= 10)
+   {
+      ok = run(dir, count) && ok;
+      if (count == 10000)
+         ok = run(dir, 20000) && ok;
+   }
+
+   if (!ok)
+   {
+      printf("FAILED\n");
+      return 1;
+   }
+
+   return 0;
+}
@@ -0,0 +1,454 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Stress test for libretro-common/queues/spsc_queue.c against the
+ * fifo_buffer_t + slock_t + scond_t scheme the threaded audio drivers
+ * used before. Two runs for each:
+ *
+ *  - throughput: a writer and a reader thread move data through the
+ *    queue as fast as they can, sleeping only when it's full or empty.
+ *  - latency: the reader behaves like an audio device, taking a period
+ *    every period's worth of time, while the writer keeps the queue
+ *    topped up the way audio_driver_flush does. Reports how long the
+ *    reader's read calls took, and how often it came up short.
+ *
+ * Every byte is checked on the way out. Busy threads can be added with
+ * -l to get the two sides preempted at bad times.
+ *
+ * Usage: spscbench [options] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <retro_miscellaneous.h>
+#include <compat/getopt.h>
+#include <rthreads/rthreads.h>
+#include <queues/fifo_queue.h>
+#include <queues/spsc_queue.h>
+
+#define MAX_LOAD_THREADS 16
+
+struct transport
+{
+   const char *name;
+   void *(*init)(size_t size);
+   void (*free)(void *data);
+   /* Both move what they can without sleeping */
+   size_t (*write)(void *data, const void *buf, size_t size);
+   size_t (*read)(void *data, void *buf, size_t size);
+   /* Sleep for a bit until there's room or data */
+   void (*wait_write)(void *data);
+   void (*wait_read)(void *data);
+};
+
+struct run
+{
+   const struct transport *transport;
+   void *queue;
+   size_t total;
+   bool paced;
+
+   /* Results */
+   bool corrupt;
+   uint64_t *read_ns;
+   size_t max_reads;
+   size_t reads;
+   size_t short_reads;
+};
+
+static size_t queue_size   = 16384;
+static size_t block_size   = 2940; /* 735 s16 stereo frames */
+static size_t period_size  = 4096; /* 1024 s16 stereo frames */
+static unsigned rate       = 48000;
+static unsigned seconds    = 5;
+static unsigned megabytes  = 1024;
+static unsigned load       = 0;
+static volatile bool load_quit;
+
+static uint64_t now_ns(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void sleep_until(uint64_t when)
+{
+   uint64_t now = now_ns();
+   if (when > now)
+      usleep((useconds_t)((when - now) / 1000));
+}
+
+/* The scheme alsathread.c used */
+struct fifo_lock
+{
+   fifo_buffer_t *fifo;
+   slock_t *fifo_lock;
+   slock_t *cond_lock;
+   scond_t *cond;
+};
+
+static void *fifo_lock_init(size_t size)
+{
+   struct fifo_lock *f = (struct fifo_lock*)calloc(1, sizeof(*f));
+   f->fifo      = fifo_new(size);
+   f->fifo_lock = slock_new();
+   f->cond_lock = slock_new();
+   f->cond      = scond_new();
+   return f;
+}
+
+static void fifo_lock_free(void *data)
+{
+   struct fifo_lock *f = (struct fifo_lock*)data;
+   fifo_free(f->fifo);
+   slock_free(f->fifo_lock);
+   slock_free(f->cond_lock);
+   scond_free(f->cond);
+   free(f);
+}
+
+static size_t fifo_lock_write(void *data, const void *buf, size_t size)
+{
+   struct fifo_lock *f = (struct fifo_lock*)data;
+   slock_lock(f->fifo_lock);
+   size = MIN(size, fifo_write_avail(f->fifo));
+   fifo_write(f->fifo, buf, size);
+   scond_signal(f->cond);
+   slock_unlock(f->fifo_lock);
+   return size;
+}
+
+static size_t fifo_lock_read(void *data, void *buf, size_t size)
+{
+   struct fifo_lock *f = (struct fifo_lock*)data;
+   slock_lock(f->fifo_lock);
+   size = MIN(size, fifo_read_avail(f->fifo));
+   fifo_read(f->fifo, buf, size);
+   scond_signal(f->cond);
+   slock_unlock(f->fifo_lock);
+   return size;
+}
+
+static void fifo_lock_wait(void *data)
+{
+   struct fifo_lock *f = (struct fifo_lock*)data;
+   slock_lock(f->cond_lock);
+   scond_wait_timeout(f->cond, f->cond_lock, 1000);
+   slock_unlock(f->cond_lock);
+}
+
+static const struct transport fifo_lock_transport = {
+   "fifo+lock",
+   fifo_lock_init,
+   fifo_lock_free,
+   fifo_lock_write,
+   fifo_lock_read,
+   fifo_lock_wait,
+   fifo_lock_wait,
+};
+
+static void *spsc_init(size_t size)
+{
+   return spsc_new(size);
+}
+
+static void spsc_free_queue(void *data)
+{
+   spsc_free((spsc_buffer_t*)data);
+}
+
+static size_t spsc_write_queue(void *data, const void *buf, size_t size)
+{
+   return spsc_write((spsc_buffer_t*)data, buf, size);
+}
+
+static size_t spsc_read_queue(void *data, void *buf, size_t size)
+{
+   return spsc_read((spsc_buffer_t*)data, buf, size);
+}
+
+static void spsc_wait_write_queue(void *data)
+{
+   spsc_wait_write((spsc_buffer_t*)data, 1, 1000);
+}
+
+static void spsc_wait_read_queue(void *data)
+{
+   spsc_wait_read((spsc_buffer_t*)data, 1, 1000);
+}
+
+static const struct transport spsc_transport = {
+   "spsc",
+   spsc_init,
+   spsc_free_queue,
+   spsc_write_queue,
+   spsc_read_queue,
+   spsc_wait_write_queue,
+   spsc_wait_read_queue,
+};
+
+static uint8_t pattern(size_t pos)
+{
+   return (uint8_t)((pos * 2654435761u) >> 13);
+}
+
+static void writer_thread(void *data)
+{
+   struct run *run      = (struct run*)data;
+   uint8_t *block       = (uint8_t*)malloc(block_size);
+   uint64_t block_time  = (uint64_t)block_size * 1000000000ull /
+      (rate * 4);
+   uint64_t next        = now_ns();
+   size_t pos           = 0;
+
+   while (pos < run->total)
+   {
+      size_t i, done = 0;
+      size_t len     = MIN(block_size, run->total - pos);
+
+      for (i = 0; i < len; i++)
+         block[i] = pattern(pos + i);
+
+      while (done < len)
+      {
+         size_t written = run->transport->write(run->queue,
+               block + done, len - done);
+         if (!written)
+            run->transport->wait_write(run->queue);
+         done += written;
+      }
+      pos += len;
+
+      /* Like a core running at full speed, ahead of the device */
+      if (run->paced)
+      {
+         next += block_time;
+         sleep_until(next - block_time * 2);
+      }
+   }
+
+   free(block);
+}
+
+static void reader_thread(void *data)
+{
+   struct run *run       = (struct run*)data;
+   uint8_t *period       = (uint8_t*)malloc(period_size);
+   uint64_t period_time  = (uint64_t)period_size * 1000000000ull /
+      (rate * 4);
+   uint64_t next         = now_ns() + period_time;
+   size_t pos            = 0;
+
+   while (pos < run->total)
+   {
+      size_t i, got;
+      uint64_t start = now_ns();
+
+      got = run->transport->read(run->queue, period,
+            MIN(period_size, run->total - pos));
+      if (run->reads < run->max_reads)
+         run->read_ns[run->reads++] = now_ns() - start;
+
+      for (i = 0; i < got; i++)
+         if (period[i] != pattern(pos + i))
+            run->corrupt = true;
+      pos += got;
+
+      if (run->paced)
+      {
+         /* The device plays what it got, and silence for the rest */
+         if (got < period_size && pos < run->total)
+            run->short_reads++;
+         sleep_until(next);
+         next += period_time;
+      }
+      else if (!got)
+         run->transport->wait_read(run->queue);
+   }
+
+   free(period);
+}
+
+static void load_thread(void *data)
+{
+   volatile unsigned spin = 0;
+   while (!load_quit)
+      spin++;
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+   uint64_t x = *(const uint64_t*)a;
+   uint64_t y = *(const uint64_t*)b;
+   return x < y ? -1 : x > y;
+}
+
+static bool run_transport(const struct transport *transport, bool paced,
+      struct run *run, double *elapsed)
+{
+   sthread_t *writer, *reader;
+   uint64_t start;
+
+   memset(run, 0, sizeof(*run));
+   run->transport = transport;
+   run->paced     = paced;
+   run->total     = paced
+      ? (size_t)rate * 4 * seconds
+      : (size_t)megabytes << 20;
+   run->queue     = transport->init(queue_size);
+
+   /* Only the first so many reads of the throughput run are timed */
+   run->max_reads = paced
+      ? run->total / period_size * 2
+      : 1 << 22;
+   run->read_ns   = (uint64_t*)malloc(run->max_reads * sizeof(uint64_t));
+
+   if (!run->queue || !run->read_ns)
+      return false;
+
+   start  = now_ns();
+   reader = sthread_create(reader_thread, run);
+   writer = sthread_create(writer_thread, run);
+   sthread_join(writer);
+   sthread_join(reader);
+   *elapsed = (now_ns() - start) / 1e9;
+
+   transport->free(run->queue);
+   qsort(run->read_ns, run->reads, sizeof(uint64_t), compare_u64);
+   return true;
+}
+
+static void usage(void)
+{
+   fprintf(stderr,
+      "Use: spscbench [options]\n"
+      "Options:\n"
+      "    -q|--queue <bytes>:     Queue size. Defaults to 16384.\n"
+      "    -b|--block <bytes>:     Writer's block size. Defaults to 2940.\n"
+      "    -p|--period <bytes>:    Reader's period size. Defaults to 4096.\n"
+      "    -r|--rate <hz>:         Rate of the paced run, for s16 stereo.\n"
+      "                            Defaults to 48000.\n"
+      "    -t|--time <seconds>:    Length of the paced run. Defaults to 5.\n"
+      "    -m|--megabytes <n>:     Size of the throughput run. Defaults to 1024.\n"
+      "    -l|--load <n>:          Busy threads to run alongside. Defaults to 0.\n"
+      "\n");
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned i;
+   sthread_t *load_threads[MAX_LOAD_THREADS];
+   const struct transport *transports[] = {
+      &fifo_lock_transport, &spsc_transport
+   };
+   bool failed = false;
+
+   const struct option opt[] = {
+      {"queue",      1, NULL, 'q'},
+      {"block",      1, NULL, 'b'},
+      {"period",     1, NULL, 'p'},
+      {"rate",       1, NULL, 'r'},
+      {"time",       1, NULL, 't'},
+      {"megabytes",  1, NULL, 'm'},
+      {"load",       1, NULL, 'l'},
+      {NULL,         0, NULL, 0}
+   };
+
+   while (1)
+   {
+      int c = getopt_long(argc, argv, "q:b:p:r:t:m:l:", opt, NULL);
+      if (c == -1)
+         break;
+
+      switch (c)
+      {
+         case 'q': queue_size  = atoi(optarg); break;
+         case 'b': block_size  = atoi(optarg); break;
+         case 'p': period_size = atoi(optarg); break;
+         case 'r': rate        = atoi(optarg); break;
+         case 't': seconds     = atoi(optarg); break;
+         case 'm': megabytes   = atoi(optarg); break;
+         case 'l': load        = atoi(optarg); break;
+         default:
+            usage();
+            return 1;
+      }
+   }
+
+   if (!queue_size || !block_size || !period_size || !rate || !seconds ||
+         !megabytes || load > MAX_LOAD_THREADS)
+   {
+      usage();
+      return 1;
+   }
+
+   for (i = 0; i < load; i++)
+      load_threads[i] = sthread_create(load_thread, NULL);
+
+   printf("%u busy threads, %u byte queue\n\n", load, (unsigned)queue_size);
+
+   printf("Throughput, %u MB:\n", megabytes);
+   printf("%-10s %10s %10s %10s\n", "queue", "MB/s", "p99 ns", "max ns");
+   for (i = 0; i < ARRAY_SIZE(transports); i++)
+   {
+      struct run run;
+      double elapsed;
+
+      if (!run_transport(transports[i], false, &run, &elapsed))
+         return 1;
+
+      printf("%-10s %10.1f %10llu %10llu%s\n", transports[i]->name,
+            megabytes / elapsed,
+            (unsigned long long)run.read_ns[run.reads * 99 / 100],
+            (unsigned long long)run.read_ns[run.reads - 1],
+            run.corrupt ? "  CORRUPT" : "");
+      failed |= run.corrupt;
+      free(run.read_ns);
+   }
+
+   printf("\nPaced like a %u Hz device, %u seconds, reader's read calls:\n",
+         rate, seconds);
+   printf("%-10s %10s %10s %10s %10s %10s\n",
+         "queue", "p50 ns", "p99 ns", "p99.9 ns", "max ns", "short");
+   for (i = 0; i < ARRAY_SIZE(transports); i++)
+   {
+      struct run run;
+      double elapsed;
+
+      if (!run_transport(transports[i], true, &run, &elapsed))
+         return 1;
+
+      printf("%-10s %10llu %10llu %10llu %10llu %10u%s\n",
+            transports[i]->name,
+            (unsigned long long)run.read_ns[run.reads / 2],
+            (unsigned long long)run.read_ns[run.reads * 99 / 100],
+            (unsigned long long)run.read_ns[run.reads * 999 / 1000],
+            (unsigned long long)run.read_ns[run.reads - 1],
+            (unsigned)run.short_reads,
+            run.corrupt ? "  CORRUPT" : "");
+      failed |= run.corrupt;
+      free(run.read_ns);
+   }
+
+   load_quit = true;
+   for (i = 0; i < load; i++)
+      sthread_join(load_threads[i]);
+
+   return failed ? 1 : 0;
+}
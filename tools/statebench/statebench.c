@@ -0,0 +1,147 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Benchmarks the rewind delta codec (managers/state_manager_raw.c)
+ * on synthetic savestates with different amounts of change between
+ * frames, for each SIMD implementation this CPU can run.
+ *
+ * Usage: statebench [state size in KB] [iterations] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libretro.h>
+#include <features/features_cpu.h>
+
+#include "../../managers/state_manager_raw.h"
+
+static uint32_t rand_state = 1;
+
+static uint32_t bench_rand(void)
+{
+   rand_state = rand_state * 1103515245 + 12345;
+   return rand_state >> 8;
+}
+
+/* Changes 'permille'/1000 of the 16-bit words of 'buf', in runs of
+ * up to 32 words, the way a core's RAM usually changes. */
+static void mutate(uint8_t *buf, size_t len, unsigned permille)
+{
+   uint16_t *buf16 = (uint16_t*)buf;
+   size_t   num16s = len / 2;
+   size_t  changes = num16s * permille / 1000;
+
+   while (changes)
+   {
+      size_t pos = bench_rand() % num16s;
+      size_t run = 1 + bench_rand() % 32;
+
+      if (run > changes)
+         run = changes;
+      if (pos + run > num16s)
+         run = num16s - pos;
+
+      changes -= run;
+      while (run--)
+         buf16[pos++] ^= (uint16_t)(1 + bench_rand() % 0xffff);
+   }
+}
+
+static void bench(uint64_t mask, size_t len, unsigned permille,
+      unsigned iterations)
+{
+   unsigned i;
+   retro_time_t comp_time   = 0;
+   retro_time_t decomp_time = 0;
+   size_t patch_bytes       = 0;
+   bool ok                  = true;
+   const char *name         = state_manager_raw_init_simd(mask);
+   uint8_t *prev            = (uint8_t*)state_manager_raw_alloc(len, 0);
+   uint8_t *cur             = (uint8_t*)state_manager_raw_alloc(len, 1);
+   uint8_t *check           = (uint8_t*)state_manager_raw_alloc(len, 2);
+   uint8_t *patch           = (uint8_t*)malloc(
+         state_manager_raw_maxsize(len));
+
+   rand_state = 1;
+   for (i = 0; i < len; i++)
+      prev[i] = (uint8_t)bench_rand();
+
+   for (i = 0; i < iterations; i++)
+   {
+      retro_time_t start;
+      size_t patch_len;
+
+      memcpy(cur, prev, len);
+      mutate(cur, len, permille);
+
+      start       = cpu_features_get_time_usec();
+      patch_len   = state_manager_raw_compress(prev, cur, len, patch);
+      comp_time  += cpu_features_get_time_usec() - start;
+      patch_bytes += patch_len;
+
+      /* The patch turns 'cur' back into 'prev', as in rewind. */
+      memcpy(check, cur, len);
+      start        = cpu_features_get_time_usec();
+      state_manager_raw_decompress(patch, patch_len, check, len);
+      decomp_time += cpu_features_get_time_usec() - start;
+
+      if (memcmp(check, prev, len))
+         ok = false;
+
+      memcpy(prev, cur, len);
+   }
+
+   printf("%-8s %6u KB %5.1f%% changed: compress %8.1f MB/s, "
+         "decompress %8.1f MB/s, patch %5.1f%% %s\n",
+         name, (unsigned)(len / 1024), permille / 10.0,
+         (double)len * iterations / (comp_time ? comp_time : 1),
+         (double)len * iterations / (decomp_time ? decomp_time : 1),
+         100.0 * patch_bytes / ((double)len * iterations),
+         ok ? "" : "MISMATCH");
+
+   free(prev);
+   free(cur);
+   free(check);
+   free(patch);
+
+   if (!ok)
+      exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned i, j;
+   static const unsigned densities[] = { 1, 10, 100, 500 };
+   uint64_t cpu        = cpu_features_get();
+   uint64_t masks[4];
+   unsigned num_masks  = 0;
+   size_t len          = (argc > 1 ? strtoul(argv[1], NULL, 0) : 4096) * 1024;
+   unsigned iterations = argc > 2 ? strtoul(argv[2], NULL, 0) : 50;
+
+   masks[num_masks++] = 0;
+   if (cpu & RETRO_SIMD_SSE2)
+      masks[num_masks++] = RETRO_SIMD_SSE2;
+   if (cpu & RETRO_SIMD_AVX2)
+      masks[num_masks++] = RETRO_SIMD_SSE2 | RETRO_SIMD_AVX2;
+   if (cpu & RETRO_SIMD_NEON)
+      masks[num_masks++] = RETRO_SIMD_NEON;
+
+   for (i = 0; i < sizeof(densities) / sizeof(densities[0]); i++)
+      for (j = 0; j < num_masks; j++)
+         bench(masks[j], len, densities[i], iterations);
+
+   return 0;
+}